@@ -84,3 +84,57 @@ DEF_BENCH( return new BigPathBench(kRight_Align,    false); )
 DEF_BENCH( return new BigPathBench(kLeft_Align,     true); )
 DEF_BENCH( return new BigPathBench(kMiddle_Align,   true); )
 DEF_BENCH( return new BigPathBench(kRight_Align,    true); )
+
+// The same path stretched across a surface thousands of pixels wide, where it covers very little
+// of its bounds.  Past 8192 pixels we can't supersample, and antialias analytically instead.
+class WideBigPathBench : public Benchmark {
+    SkPath      fPath;
+    SkString    fName;
+    int         fWidth;
+    bool        fStroke;
+
+public:
+    WideBigPathBench(int width, bool stroke) : fWidth(width), fStroke(stroke) {
+        fName.printf("bigpath_wide_%d_%s", fWidth, fStroke ? "stroke" : "fill");
+    }
+
+protected:
+    const char* onGetName() override {
+        return fName.c_str();
+    }
+
+    SkIPoint onGetSize() override {
+        return SkIPoint::Make(fWidth, 100);
+    }
+
+    void onDelayedSetup() override {
+        sk_tool_utils::make_big_path(fPath);
+        const SkRect r = fPath.getBounds();
+        SkMatrix matrix;
+        matrix.setRectToRect(r, SkRect::MakeWH(SkIntToScalar(fWidth), r.height()),
+                             SkMatrix::kFill_ScaleToFit);
+        fPath.transform(matrix);
+    }
+
+    void onDraw(int loops, SkCanvas* canvas) override {
+        SkPaint paint;
+        paint.setAntiAlias(true);
+        if (fStroke) {
+            paint.setStyle(SkPaint::kStroke_Style);
+            paint.setStrokeWidth(2);
+        }
+        this->setupPaint(&paint);
+
+        for (int i = 0; i < loops; i++) {
+            canvas->drawPath(fPath, paint);
+        }
+    }
+
+private:
+    typedef Benchmark INHERITED;
+};
+
+DEF_BENCH( return new WideBigPathBench( 4096, true); )
+DEF_BENCH( return new WideBigPathBench( 4096, false); )
+DEF_BENCH( return new WideBigPathBench(16384, true); )
+DEF_BENCH( return new WideBigPathBench(16384, false); )
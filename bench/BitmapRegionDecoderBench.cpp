@@ -11,12 +11,15 @@
 #include "SkOSFile.h"
 
 BitmapRegionDecoderBench::BitmapRegionDecoderBench(const char* baseName, SkData* encoded,
-        SkColorType colorType, uint32_t sampleSize, const SkIRect& subset)
+        SkColorType colorType, uint32_t sampleSize, const SkIRect& subset, Mode mode,
+        bool useIndex)
     : fBRD(nullptr)
     , fData(SkRef(encoded))
     , fColorType(colorType)
     , fSampleSize(sampleSize)
     , fSubset(subset)
+    , fMode(mode)
+    , fUseIndex(useIndex)
 {
     // Choose a useful name for the color type
     const char* colorName = color_type_to_str(colorType);
@@ -25,6 +28,12 @@ BitmapRegionDecoderBench::BitmapRegionDecoderBench(const char* baseName, SkData*
     if (1 != sampleSize) {
         fName.appendf("_%.3f", 1.0f / (float) sampleSize);
     }
+    if (kFirstTile_Mode == mode) {
+        fName.append("_FirstTile");
+    }
+    if (useIndex) {
+        fName.append("_Index");
+    }
 }
 
 const char* BitmapRegionDecoderBench::onGetName() {
@@ -35,12 +44,26 @@ bool BitmapRegionDecoderBench::isSuitableFor(Backend backend) {
     return kNonRendering_Backend == backend;
 }
 
+SkBitmapRegionDecoder* BitmapRegionDecoderBench::createBRD() {
+    SkBitmapRegionDecoder* brd = SkBitmapRegionDecoder::Create(fData,
+            SkBitmapRegionDecoder::kAndroidCodec_Strategy);
+    if (fUseIndex) {
+        SkAssertResult(brd->buildIndex());
+    }
+    return brd;
+}
+
 void BitmapRegionDecoderBench::onDelayedSetup() {
-    fBRD.reset(SkBitmapRegionDecoder::Create(fData, SkBitmapRegionDecoder::kAndroidCodec_Strategy));
+    if (kNthTile_Mode == fMode) {
+        fBRD.reset(this->createBRD());
+    }
 }
 
 void BitmapRegionDecoderBench::onDraw(int n, SkCanvas* canvas) {
     for (int i = 0; i < n; i++) {
+        if (kFirstTile_Mode == fMode) {
+            fBRD.reset(this->createBRD());
+        }
         SkBitmap bm;
         SkAssertResult(fBRD->decodeRegion(&bm, nullptr, fSubset, fSampleSize, fColorType, false));
     }
@@ -23,9 +23,18 @@
  */
 class BitmapRegionDecoderBench : public Benchmark {
 public:
+    enum Mode {
+        // Decode the subset with a decoder that has already been created.
+        kNthTile_Mode,
+        // Create a decoder and then decode the subset, as for the first tile of an image.
+        kFirstTile_Mode,
+    };
+
     // Calls encoded->ref()
+    // If useIndex is true, the decoder calls buildIndex() when it is created.
     BitmapRegionDecoderBench(const char* basename, SkData* encoded, SkColorType colorType,
-            uint32_t sampleSize, const SkIRect& subset);
+            uint32_t sampleSize, const SkIRect& subset, Mode mode = kNthTile_Mode,
+            bool useIndex = false);
 
 protected:
     const char* onGetName() override;
@@ -34,12 +43,16 @@ protected:
     void onDelayedSetup() override;
 
 private:
+    SkBitmapRegionDecoder* createBRD();
+
     SkString                                       fName;
     SkAutoTDelete<SkBitmapRegionDecoder>           fBRD;
     SkAutoTUnref<SkData>                           fData;
     const SkColorType                              fColorType;
     const uint32_t                                 fSampleSize;
     const SkIRect                                  fSubset;
+    const Mode                                     fMode;
+    const bool                                     fUseIndex;
     typedef Benchmark INHERITED;
 };
 #endif // BitmapRegionDecoderBench_DEFINED
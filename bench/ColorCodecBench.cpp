@@ -17,6 +17,7 @@ DEFINE_bool(qcms,       false, "Bench qcms color conversion");
 DEFINE_bool(xform_only, false, "Only time the color xform, do not include the decode time");
 DEFINE_bool(srgb,       false, "Convert to srgb dst space");
 DEFINE_bool(half,       false, "Convert to half floats");
+DEFINE_bool(two_pass,   false, "Decode the whole image, then color xform it in a second pass");
 
 ColorCodecBench::ColorCodecBench(const char* name, sk_sp<SkData> encoded)
     : fEncoded(std::move(encoded))
@@ -25,6 +26,7 @@ ColorCodecBench::ColorCodecBench(const char* name, sk_sp<SkData> encoded)
 #endif
 {
     fName.appendf("Color%s", FLAGS_xform_only ? "Xform" : "Codec");
+    fName.appendf("%s", FLAGS_two_pass ? "TwoPass" : "");
 #if defined(SK_TEST_QCMS)
     fName.appendf("%s", FLAGS_qcms ? "QCMS" : "");
 #endif
@@ -43,6 +45,17 @@ void ColorCodecBench::decodeAndXform() {
     SkAutoTDelete<SkCodec> codec(SkCodec::NewFromData(fEncoded.get()));
     SkASSERT(codec);
 
+    if (FLAGS_two_pass) {
+        // This is what we did before the codecs transformed each row as they swizzled it.
+#ifdef SK_DEBUG
+        SkCodec::Result result =
+#endif
+        codec->getPixels(fSrcInfo, fSrc.get(), fSrcInfo.minRowBytes());
+        SkASSERT(SkCodec::kSuccess == result);
+        this->xformOnly();
+        return;
+    }
+
 #ifdef SK_DEBUG
     SkCodec::Result result =
 #endif
@@ -89,20 +102,16 @@ void ColorCodecBench::decodeAndXformQCMS() {
 #endif
 
 void ColorCodecBench::xformOnly() {
-    sk_sp<SkColorSpace> srcSpace = SkColorSpace::NewICC(fSrcData->data(), fSrcData->size());
-    if (!srcSpace) {
-        srcSpace = SkColorSpace::NewNamed(SkColorSpace::kSRGB_Named);
-    }
-    std::unique_ptr<SkColorSpaceXform> xform = SkColorSpaceXform::New(srcSpace, fDstSpace);
+    // Use the codec's color space, so that this works for images without ICC data too.
+    std::unique_ptr<SkColorSpaceXform> xform =
+            SkColorSpaceXform::New(sk_ref_sp(fSrcInfo.colorSpace()), fDstSpace);
     SkASSERT(xform);
 
     void* dst = fDst.get();
     void* src = fSrc.get();
     for (int y = 0; y < fSrcInfo.height(); y++) {
-        // Transform in place
-        FLAGS_half ?
-                xform->applyToF16((uint64_t*) dst, (uint32_t*) src, fSrcInfo.width()) :
-                xform->applyToRGBA((SkPMColor*) dst, (uint32_t*) src, fSrcInfo.width());
+        xform->apply(dst, (uint32_t*) src, fSrcInfo.width(), fDstInfo.colorType(),
+                     fDstInfo.alphaType());
         dst = SkTAddOffset<void>(dst, fDstInfo.minRowBytes());
         src = SkTAddOffset<void>(src, fSrcInfo.minRowBytes());
     }
@@ -173,6 +182,8 @@ void ColorCodecBench::onDelayedSetup() {
     if (FLAGS_xform_only) {
         fSrc.reset(fSrcInfo.getSafeSize(fSrcInfo.minRowBytes()));
         codec->getPixels(fSrcInfo, fSrc.get(), fSrcInfo.minRowBytes());
+    } else if (FLAGS_two_pass) {
+        fSrc.reset(fSrcInfo.getSafeSize(fSrcInfo.minRowBytes()));
     }
 #if defined(SK_TEST_QCMS)
     else if (FLAGS_qcms) {
@@ -10,13 +10,16 @@
 #include "SkBitmap.h"
 #include "SkData.h"
 #include "SkImageEncoder.h"
+#include "SkImageEncoderPriv.h"
 
 class EncodeBench : public Benchmark {
 public:
-    EncodeBench(const char* filename, SkImageEncoder::Type type, int quality)
+    EncodeBench(const char* filename, SkImageEncoder::Type type, int quality,
+                bool useThreads = false)
         : fFilename(filename)
         , fType(type)
         , fQuality(quality)
+        , fUseThreads(useThreads)
     {
         // Set the name of the bench
         SkString name("Encode_");
@@ -36,7 +39,10 @@ public:
                 name.append("Unknown");
                 break;
         }
-        
+        if (useThreads) {
+            name.append("_threads");
+        }
+
         fName = name;
     }
 
@@ -53,16 +59,19 @@ public:
     }
 
     void onDraw(int loops, SkCanvas*) override {
+        gSkPNGEncodeUseThreads = fUseThreads;
         for (int i = 0; i < loops; i++) {
             SkAutoTUnref<SkData> data(SkImageEncoder::EncodeData(fBitmap, fType, fQuality));
             SkASSERT(data);
         }
+        gSkPNGEncodeUseThreads = false;
     }
 
 private:
     const char*                fFilename;
     const SkImageEncoder::Type fType;
     const int                  fQuality;
+    const bool                 fUseThreads;
     SkString                   fName;
     SkBitmap                   fBitmap;
 };
@@ -76,6 +85,9 @@ DEF_BENCH(return new EncodeBench("color_wheel.jpg", SkImageEncoder::kJPEG_Type,
 DEF_BENCH(return new EncodeBench("mandrill_512.png", SkImageEncoder::kPNG_Type, 90));
 DEF_BENCH(return new EncodeBench("color_wheel.jpg", SkImageEncoder::kPNG_Type, 90));
 
+// Filter and deflate in chunks on SkTaskGroup's threads.
+DEF_BENCH(return new EncodeBench("mandrill_512.png", SkImageEncoder::kPNG_Type, 90, true));
+
 // TODO: What is the appropriate quality to use to benchmark WEBP encodes?
 DEF_BENCH(return new EncodeBench("mandrill_512.png", SkImageEncoder::kWEBP_Type, 90));
 DEF_BENCH(return new EncodeBench("color_wheel.jpg", SkImageEncoder::kWEBP_Type, 90));
@@ -7,6 +7,7 @@
 
 #include "Benchmark.h"
 #include "SkResourceCache.h"
+#include "SkTaskGroup.h"
 
 namespace {
 static void* gGlobalAddress;
@@ -72,6 +73,46 @@ private:
     typedef Benchmark INHERITED;
 };
 
+// Many threads looking up (and occasionally adding) recs in the global cache at once, like
+// decoders and rasterizers sharing bitmap, mipmap and mask caches.
+class ImageCacheContentionBench : public Benchmark {
+    enum {
+        CACHE_COUNT = 500,
+        THREADS     = 16,
+    };
+public:
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+
+protected:
+    const char* onGetName() override {
+        return "imagecache_contention";
+    }
+
+    void onDelayedSetup() override {
+        for (int i = 0; i < CACHE_COUNT; ++i) {
+            SkResourceCache::Add(new TestRec(TestKey(i), i));
+        }
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        SkTaskGroup().batch(THREADS, [&](int thread) {
+            for (int i = 0; i < loops; ++i) {
+                TestKey key((thread * 7919 + i) % CACHE_COUNT);
+                if (!SkResourceCache::Find(key, TestRec::Visitor, nullptr)) {
+                    // Purged (e.g. by another bench); put it back, like a cache user would.
+                    SkResourceCache::Add(new TestRec(key, key.fValue));
+                }
+            }
+        });
+    }
+
+private:
+    typedef Benchmark INHERITED;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 
 DEF_BENCH( return new ImageCacheBench(); )
+DEF_BENCH( return new ImageCacheContentionBench(); )
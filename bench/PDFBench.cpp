@@ -9,6 +9,7 @@
 #include "Resources.h"
 #include "SkAutoPixmapStorage.h"
 #include "SkData.h"
+#include "SkDocument.h"
 #include "SkGradientShader.h"
 #include "SkImage.h"
 #include "SkPDFBitmap.h"
@@ -243,6 +244,47 @@ struct WritePDFTextBenchmark : public Benchmark {
     }
 };
 
+// Write a document with many small objects: one graphic state per
+// alpha, and one page dictionary per page.
+struct PDFDocumentBench : public Benchmark {
+    bool fUseObjectStreams;
+    SkString fName;
+    size_t fBytesWritten;
+    PDFDocumentBench(bool useObjectStreams)
+        : fUseObjectStreams(useObjectStreams), fBytesWritten(0) {
+        fName.printf("PDFDocument%s", useObjectStreams ? "_objectstreams" : "");
+    }
+    const char* onGetName() override { return fName.c_str(); }
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+    void onDraw(int loops, SkCanvas*) override {
+        SkDocument::PDFMetadata metadata;
+        metadata.fUseObjectStreams = fUseObjectStreams;
+        while (loops-- > 0) {
+            NullWStream nullStream;
+            sk_sp<SkDocument> doc = SkDocument::MakePDF(
+                    &nullStream, SK_ScalarDefaultRasterDPI, metadata, nullptr, false);
+            for (int i = 0; i < 50; i++) {
+                SkCanvas* canvas = doc->beginPage(612, 792);
+                SkPaint paint;
+                for (int j = 0; j < 20; j++) {
+                    paint.setAlpha(SkToU8(i * 5 + j));
+                    canvas->drawRect(SkRect::MakeXYWH(SkIntToScalar(j * 30), 0, 30, 30),
+                                     paint);
+                }
+                doc->endPage();
+            }
+            doc->close();
+            fBytesWritten = nullStream.bytesWritten();
+        }
+    }
+    void onPerCanvasPostDraw(SkCanvas*) override {
+        // nanobench reports the time; the size is the other half of the trade-off.
+        SkDebugf("%s: " SK_SIZE_T_SPECIFIER " bytes\n", fName.c_str(), fBytesWritten);
+    }
+};
+
 }  // namespace
 DEF_BENCH(return new PDFImageBench;)
 DEF_BENCH(return new PDFJpegImageBench;)
@@ -252,3 +294,5 @@ DEF_BENCH(return new PDFColorComponentBench;)
 DEF_BENCH(return new PDFShaderBench;)
 DEF_BENCH(return new WStreamWriteTextBenchmark;)
 DEF_BENCH(return new WritePDFTextBenchmark;)
+DEF_BENCH(return new PDFDocumentBench(false);)
+DEF_BENCH(return new PDFDocumentBench(true);)
@@ -112,7 +112,52 @@ private:
     SkString fName;
 };
 
+// Many threads looking up many strikes, doing very little with each one, so most of the time is
+// spent finding strikes in the global cache and handing them back.
+class SkGlyphCacheLookupMT : public Benchmark {
+protected:
+    const char* onGetName() override {
+        return "SkGlyphCacheLookupMT";
+    }
+
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+
+    void onDelayedSetup() override {
+        const char* names[] = { "serif", "sans-serif", "monospace" };
+        for (const char* name : names) {
+            fTypefaces.push_back(sk_tool_utils::create_portable_typeface(name, SkFontStyle()));
+        }
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        for (int work = 0; work < loops; work++) {
+            SkTaskGroup().batch(16, [&](int threadIndex) {
+                SkPaint paint;
+                paint.setAntiAlias(true);
+                for (int i = 0; i < 10; i++) {
+                    for (const sk_sp<SkTypeface>& typeface : fTypefaces) {
+                        paint.setTypeface(typeface);
+                        for (SkScalar size = 8; size < 40; size++) {
+                            paint.setTextSize(size);
+                            SkAutoGlyphCacheNoGamma autoCache(paint, nullptr, nullptr);
+                            autoCache.getCache()->getGlyphIDMetrics(threadIndex);
+                        }
+                    }
+                }
+            });
+        }
+    }
+
+private:
+    SkTArray<sk_sp<SkTypeface>> fTypefaces;
+
+    typedef Benchmark INHERITED;
+};
+
 DEF_BENCH( return new SkGlyphCacheBasic(256 * 1024); )
 DEF_BENCH( return new SkGlyphCacheBasic(32 * 1024 * 1024); )
 DEF_BENCH( return new SkGlyphCacheStressTest(256 * 1024); )
 DEF_BENCH( return new SkGlyphCacheStressTest(32 * 1024 * 1024); )
+DEF_BENCH( return new SkGlyphCacheLookupMT; )
@@ -6,6 +6,7 @@
  */
 
 #include "Benchmark.h"
+#include "SkOpts.h"
 #include "SkRasterPipeline.h"
 #include "SkSRGB.h"
 
@@ -21,7 +22,8 @@ static uint8_t mask[N];
 //   - load srgb dst
 //   - src = srcover(dst, src)
 //   - store src back as srgb
-// Every stage except for srcover interacts with memory, and so will need _tail variants.
+// Every stage except for srcover interacts with memory, and so will need _tail variants
+// when we fuse them by hand.
 
 SK_RASTER_STAGE(load_s_srgb) {
     auto ptr = (const uint32_t*)ctx + x;
@@ -129,17 +131,36 @@ SK_RASTER_STAGE(store_srgb_tail) {
     SkNx_cast<uint8_t>(rgba).store(ptr);
 }
 
+// How we run the pipeline:
+//   - kFused runs the stages above by hand, with no pipeline at all;
+//   - kPipeline4 runs the equivalent stock stages 4 pixels at a time;
+//   - kPipeline runs the stock stages as wide as this CPU allows, e.g. 8 pixels with AVX2;
+//   - kCompiled builds an SkRasterPipeline of them each time, which finds their fused kernel.
+enum Mode { kFused, kPipeline4, kPipeline, kCompiled };
+
 class SkRasterPipelineBench : public Benchmark {
 public:
-    SkRasterPipelineBench(bool fused) : fFused(fused) {}
+    SkRasterPipelineBench(Mode mode) : fMode(mode) {}
 
     bool isSuitableFor(Backend backend) override { return backend == kNonRendering_Backend; }
-    const char* onGetName() override { return fFused ? "SkRasterPipelineBench_fused"
-                                                     : "SkRasterPipelineBench_pipeline"; }
+    const char* onGetName() override {
+        switch (fMode) {
+            case kFused:     return "SkRasterPipelineBench_fused";
+            case kPipeline4: return "SkRasterPipelineBench_pipeline_4";
+            case kPipeline:  return "SkRasterPipelineBench_pipeline";
+            case kCompiled:  return "SkRasterPipelineBench_compiled";
+        }
+        return "";
+    }
 
     void onDraw(int loops, SkCanvas*) override {
         while (loops --> 0) {
-            fFused ? this->runFused() : this->runPipeline();
+            switch (fMode) {
+                case kFused:     this->runFused();                          break;
+                case kPipeline4: this->runPipeline(SkOpts::run_pipeline_4); break;
+                case kPipeline:  this->runPipeline(SkOpts::run_pipeline);   break;
+                case kCompiled:  this->runCompiled();                       break;
+            }
         }
     }
 
@@ -147,40 +168,57 @@ public:
         Sk4f r,g,b,a, dr,dg,db,da;
         size_t x = 0, n = N;
         while (n >= 4) {
-            load_s_srgb(src    , x, r,g,b,a, dr,dg,db,da);
-            scale_u8   (mask   , x, r,g,b,a, dr,dg,da,da);
-            load_d_srgb(dst    , x, r,g,b,a, dr,dg,da,da);
-            srcover    (nullptr, x, r,g,b,a, dr,dg,da,da);
-            store_srgb (dst    , x, r,g,b,a, dr,dg,da,da);
+            load_s_srgb(src    , x,0, r,g,b,a, dr,dg,db,da);
+            scale_u8   (mask   , x,0, r,g,b,a, dr,dg,da,da);
+            load_d_srgb(dst    , x,0, r,g,b,a, dr,dg,da,da);
+            srcover    (nullptr, x,0, r,g,b,a, dr,dg,da,da);
+            store_srgb (dst    , x,0, r,g,b,a, dr,dg,da,da);
 
             x += 4;
             n -= 4;
         }
         while (n > 0) {
-            load_s_srgb_tail(src    , x, r,g,b,a, dr,dg,db,da);
-            scale_u8_tail   (mask   , x, r,g,b,a, dr,dg,da,da);
-            load_d_srgb_tail(dst    , x, r,g,b,a, dr,dg,da,da);
-            srcover         (nullptr, x, r,g,b,a, dr,dg,da,da);
-            store_srgb_tail (dst    , x, r,g,b,a, dr,dg,da,da);
+            load_s_srgb_tail(src    , x,1, r,g,b,a, dr,dg,db,da);
+            scale_u8_tail   (mask   , x,1, r,g,b,a, dr,dg,da,da);
+            load_d_srgb_tail(dst    , x,1, r,g,b,a, dr,dg,da,da);
+            srcover         (nullptr, x,1, r,g,b,a, dr,dg,da,da);
+            store_srgb_tail (dst    , x,1, r,g,b,a, dr,dg,da,da);
 
             x += 1;
             n -= 1;
         }
     }
 
-    void runPipeline() {
-        SkRasterPipeline p;
-        p.append<load_s_srgb, load_s_srgb_tail>( src);
-        p.append<   scale_u8,    scale_u8_tail>(mask);
-        p.append<load_d_srgb, load_d_srgb_tail>( dst);
-        p.append<srcover>();
-        p.append< store_srgb,  store_srgb_tail>( dst);
+    void runPipeline(SkOpts::RunPipeline run) {
+        const SkRasterPipeline::Stock stages[] = {
+            { SkRasterPipeline::load_s_srgb, &fSrcPtr  },
+            { SkRasterPipeline::scale_u8,    &fMaskPtr },
+            { SkRasterPipeline::load_d_srgb, &fDstPtr  },
+            { SkRasterPipeline::srcover,     nullptr   },
+            { SkRasterPipeline::store_srgb,  &fDstPtr  },
+        };
+        run(0, N, stages, SK_ARRAY_COUNT(stages));
+    }
 
+    // Build the pipeline each time, so we pay to find its fused kernel.
+    void runCompiled() {
+        SkRasterPipeline p;
+        p.append(SkRasterPipeline::load_s_srgb, &fSrcPtr);
+        p.append(SkRasterPipeline::scale_u8,    &fMaskPtr);
+        p.append(SkRasterPipeline::load_d_srgb, &fDstPtr);
+        p.append(SkRasterPipeline::srcover);
+        p.append(SkRasterPipeline::store_srgb,  &fDstPtr);
         p.run(N);
     }
 
-    bool fFused;
+    Mode fMode;
+    // The stock stages that touch memory take pointers to these.
+    uint32_t* fSrcPtr  = src;
+    uint8_t*  fMaskPtr = mask;
+    uint32_t* fDstPtr  = dst;
 };
 
-DEF_BENCH( return new SkRasterPipelineBench(true); )
-DEF_BENCH( return new SkRasterPipelineBench(false); )
+DEF_BENCH( return new SkRasterPipelineBench(kFused); )
+DEF_BENCH( return new SkRasterPipelineBench(kPipeline4); )
+DEF_BENCH( return new SkRasterPipelineBench(kPipeline); )
+DEF_BENCH( return new SkRasterPipelineBench(kCompiled); )
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "Benchmark.h"
+#include "SkAtomics.h"
+#include "SkString.h"
+#include "SkTaskGroup.h"
+
+// Measures SkTaskGroup's overhead per task, so the tasks themselves do almost nothing.
+// Run with different --threads values to see how task throughput scales with thread count.
+
+static const int kTasks = 10000;
+
+// One big batch() from the calling thread.
+class TaskGroupBatchBench : public Benchmark {
+public:
+    explicit TaskGroupBatchBench(int spin) : fSpin(spin) {
+        fName.printf("taskgroup_batch_spin%d", spin);
+    }
+
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+
+protected:
+    const char* onGetName() override { return fName.c_str(); }
+
+    void onDraw(int loops, SkCanvas*) override {
+        SkAtomic<int, sk_memory_order_relaxed> sum(0);
+        for (int i = 0; i < loops; i++) {
+            SkTaskGroup().batch(kTasks, [&](int task) {
+                int x = task;
+                for (int j = 0; j < fSpin; j++) {
+                    x = x * 1103515245 + 12345;
+                }
+                sum.fetch_add(x);
+            });
+        }
+    }
+
+private:
+    int      fSpin;
+    SkString fName;
+};
+
+// Tasks that add() more tasks and wait for them, like a recursive divide and conquer.
+class TaskGroupNestedBench : public Benchmark {
+public:
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+
+protected:
+    const char* onGetName() override { return "taskgroup_nested"; }
+
+    void onDraw(int loops, SkCanvas*) override {
+        for (int i = 0; i < loops; i++) {
+            // Each level splits in two, so this runs 2^14 - 2 tasks in all.
+            split(14);
+        }
+    }
+
+private:
+    static void split(int depth) {
+        if (depth > 1) {
+            SkTaskGroup tg;
+            tg.add([=] { split(depth - 1); });
+            tg.add([=] { split(depth - 1); });
+        }
+    }
+};
+
+DEF_BENCH( return new TaskGroupBatchBench(0); )
+DEF_BENCH( return new TaskGroupBatchBench(100); )
+DEF_BENCH( return new TaskGroupNestedBench; )
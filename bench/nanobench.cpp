@@ -38,6 +38,7 @@
 #include "SkOSFile.h"
 #include "SkPictureRecorder.h"
 #include "SkPictureUtils.h"
+#include "SkRasterPipeline.h"
 #include "SkString.h"
 #include "SkSurface.h"
 #include "SkTaskGroup.h"
@@ -155,6 +156,25 @@ bool Target::capturePixels(SkBitmap* bmp) {
     return true;
 }
 
+// Rasterizes in tiles on the SkTaskGroup thread pool.  Compare its times against 8888 across
+// --threads values to see how the raster backend scales with core count.
+struct ThreadedRasterTarget : public Target {
+    explicit ThreadedRasterTarget(const Config& c) : Target(c) { }
+
+    bool init(SkImageInfo info, Benchmark* bench) override {
+        this->surface = SkSurface::MakeRasterThreaded(info);
+        return this->surface != nullptr;
+    }
+    void endTiming() override {
+        // Draws are queued until the canvas is flushed, so include that in the timing.
+        this->surface->getCanvas()->flush();
+    }
+    void fillOptions(ResultsWriter* log) override {
+        int threads = FLAGS_threads < 0 ? sk_num_cores() : FLAGS_threads;
+        log->configOption("threads", SkStringPrintf("%d", threads).c_str());
+    }
+};
+
 #if SK_SUPPORT_GPU
 struct GPUTarget : public Target {
     explicit GPUTarget(const Config& c) : Target(c), context(nullptr) { }
@@ -464,6 +484,8 @@ static void create_config(const SkCommandLineConfig* config, SkTArray<Config>* c
 
         CPU_CONFIG(8888, kRaster_Backend,
                    kN32_SkColorType, kPremul_SkAlphaType, nullptr)
+        CPU_CONFIG(threaded8888, kRaster_Backend,
+                   kN32_SkColorType, kPremul_SkAlphaType, nullptr)
         CPU_CONFIG(565,  kRaster_Backend,
                    kRGB_565_SkColorType, kOpaque_SkAlphaType, nullptr)
         auto srgbColorSpace = SkColorSpace::NewNamed(SkColorSpace::kSRGB_Named);
@@ -517,7 +539,11 @@ static Target* is_enabled(Benchmark* bench, const Config& config) {
         break;
 #endif
     default:
-        target = new Target(config);
+        if (config.name.equals("threaded8888")) {
+            target = new ThreadedRasterTarget(config);
+        } else {
+            target = new Target(config);
+        }
         break;
     }
 
@@ -573,6 +599,8 @@ public:
                       , fCurrentCodec(0)
                       , fCurrentAndroidCodec(0)
                       , fCurrentBRDImage(0)
+                      , fCurrentBRDIndexImage(0)
+                      , fCurrentBRDIndexMode(0)
                       , fCurrentColorImage(0)
                       , fCurrentColorType(0)
                       , fCurrentAlphaType(0)
@@ -944,6 +972,46 @@ public:
             fCurrentColorType = 0;
         }
 
+        // Compare the latency of the first and of later tiles near the bottom of an image, with
+        // and without an index of where decoding can start.  The index only helps images that
+        // have one, so skip the rest.
+        for (; fCurrentBRDIndexImage < fImages.count(); fCurrentBRDIndexImage++) {
+            fSourceType = "image";
+            fBenchType = "BRD_index";
+
+            const SkString& path = fImages[fCurrentBRDIndexImage];
+            if (SkCommandLineFlags::ShouldSkip(FLAGS_match, path.c_str())) {
+                continue;
+            }
+
+            sk_sp<SkData> encoded(SkData::MakeFromFileName(path.c_str()));
+            int width = 0;
+            int height = 0;
+            if (!valid_brd_bench(encoded.get(), kN32_SkColorType, 1, minOutputSize, &width,
+                    &height)) {
+                continue;
+            }
+            SkAutoTDelete<SkBitmapRegionDecoder> brd(SkBitmapRegionDecoder::Create(encoded.get(),
+                    SkBitmapRegionDecoder::kAndroidCodec_Strategy));
+            if (!brd->buildIndex()) {
+                continue;
+            }
+
+            if (fCurrentBRDIndexMode < 4) {
+                const int mode = fCurrentBRDIndexMode++;
+                SkString basename = SkOSPath::Basename(path.c_str());
+                basename.append("_BottomRight");
+                const SkIRect subset = SkIRect::MakeXYWH(width - minOutputSize,
+                        height - minOutputSize, minOutputSize, minOutputSize);
+                return new BitmapRegionDecoderBench(basename.c_str(), encoded.get(),
+                        kN32_SkColorType, 1, subset,
+                        (mode & 1) ? BitmapRegionDecoderBench::kFirstTile_Mode
+                                   : BitmapRegionDecoderBench::kNthTile_Mode,
+                        SkToBool(mode & 2));
+            }
+            fCurrentBRDIndexMode = 0;
+        }
+
         while (fCurrentColorImage < fColorImages.count()) {
             fSourceType = "colorimage";
             fBenchType = "skcolorcodec";
@@ -1017,6 +1085,8 @@ private:
     int fCurrentCodec;
     int fCurrentAndroidCodec;
     int fCurrentBRDImage;
+    int fCurrentBRDIndexImage;
+    int fCurrentBRDIndexMode;
     int fCurrentColorImage;
     int fCurrentColorType;
     int fCurrentAlphaType;
@@ -1169,6 +1239,9 @@ int nanobench_main() {
                 }
             }
 
+            int pipelinesBefore, fusedBefore;
+            SkRasterPipeline::GetFuseStats(&pipelinesBefore, &fusedBefore);
+
             target->setup();
             bench->perCanvasPreDraw(canvas);
 
@@ -1202,6 +1275,11 @@ int nanobench_main() {
 
             bench->perCanvasPostDraw(canvas);
 
+            int pipelines, fused;
+            SkRasterPipeline::GetFuseStats(&pipelines, &fused);
+            pipelines -= pipelinesBefore;
+            fused     -= fusedBefore;
+
             if (Benchmark::kNonRendering_Backend != target->config.backend &&
                 !FLAGS_writePath.isEmpty() && FLAGS_writePath[0]) {
                 SkString pngFilename = SkOSPath::Join(FLAGS_writePath[0], config);
@@ -1222,6 +1300,9 @@ int nanobench_main() {
             benchStream.fillCurrentOptions(log.get());
             target->fillOptions(log.get());
             log->metric("min_ms",    stats.min);
+            if (pipelines > 0) {
+                log->metric("fused_pipelines_percent", 100.0 * fused / pipelines);
+            }
 #if SK_SUPPORT_GPU
             if (gpuStatsDump) {
                 // dump to json, only SKPBench currently returns valid keys / values
@@ -1279,6 +1360,13 @@ int nanobench_main() {
             }
 #endif
 
+            // How many of the raster pipelines this bench compiled have a fused kernel.
+            if (pipelines > 0 && kAutoTuneLoops == FLAGS_loops && !FLAGS_quiet) {
+                SkDebugf("\t%d of %d SkRasterPipelines fused (%.0f%%)\t%s\t%s\n",
+                         fused, pipelines, 100.0 * fused / pipelines,
+                         bench->getUniqueName(), config);
+            }
+
             if (FLAGS_verbose) {
                 SkDebugf("Samples:  ");
                 for (int i = 0; i < samples.count(); i++) {
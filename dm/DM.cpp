@@ -873,6 +873,7 @@ static Sink* create_sink(const SkCommandLineConfig* config) {
         SINK("null", NullSink);
         SINK("xps",  XPSSink);
         SINK("pdfa", PDFSink, true);
+        SINK("pdf15", PDFSink, false, true);
     }
 #undef SINK
     return nullptr;
@@ -33,6 +33,7 @@
 #include "SkRecorder.h"
 #include "SkSVGCanvas.h"
 #include "SkStream.h"
+#include "SkTime.h"
 #include "SkTLogic.h"
 #include "SkSwizzler.h"
 #include <functional>
@@ -1159,17 +1160,28 @@ static Error draw_skdocument(const Src& src, SkDocument* doc, SkWStream* dst) {
     return "";
 }
 
-Error PDFSink::draw(const Src& src, SkBitmap*, SkWStream* dst, SkString*) const {
+DEFINE_bool(pdfStats, false, "Append PDF size and generation time to the log for each PDF task?");
+
+Error PDFSink::draw(const Src& src, SkBitmap*, SkWStream* dst, SkString* log) const {
+    const size_t bytesBefore = dst->bytesWritten();
+    const double startMs = SkTime::GetMSecs();
     SkDocument::PDFMetadata metadata;
     metadata.fTitle = src.name();
     metadata.fSubject = "rendering correctness test";
     metadata.fCreator = "Skia/DM";
+    metadata.fUseObjectStreams = fUseObjectStreams;
     sk_sp<SkDocument> doc = SkDocument::MakePDF(dst, SK_ScalarDefaultRasterDPI,
                                                 metadata, nullptr, fPDFA);
     if (!doc) {
         return "SkDocument::MakePDF() returned nullptr";
     }
-    return draw_skdocument(src, doc.get(), dst);
+    Error err = draw_skdocument(src, doc.get(), dst);
+    if (err.isEmpty() && FLAGS_pdfStats) {
+        log->appendf("%s: " SK_SIZE_T_SPECIFIER " bytes in %.2f ms",
+                     fUseObjectStreams ? "object streams" : "classic xref",
+                     dst->bytesWritten() - bytesBefore, SkTime::GetMSecs() - startMs);
+    }
+    return err;
 }
 
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
@@ -301,11 +301,13 @@ private:
 
 class PDFSink : public Sink {
 public:
-    PDFSink(bool pdfa = false) : fPDFA(pdfa) {}
+    PDFSink(bool pdfa = false, bool useObjectStreams = false)
+        : fPDFA(pdfa), fUseObjectStreams(useObjectStreams) {}
     Error draw(const Src&, SkBitmap*, SkWStream*, SkString*) const override;
     const char* fileExtension() const override { return "pdf"; }
     SinkFlags flags() const override { return SinkFlags{ SinkFlags::kVector, SinkFlags::kDirect }; }
     bool fPDFA;
+    bool fUseObjectStreams;
 };
 
 class XPSSink : public Sink {
@@ -27,6 +27,7 @@
         'lua_app',
         'lua_pictures',
         'pinspect',
+        'render_skp_in_bands',
         'skdiff',
         'skhello',
         'skpinfo',
@@ -271,6 +272,17 @@
         'skia_lib.gyp:skia_lib',
       ],
     },
+    {
+      'target_name': 'render_skp_in_bands',
+      'type': 'executable',
+      'sources': [
+        '../tools/render_skp_in_bands.cpp',
+      ],
+      'dependencies': [
+        'flags.gyp:flags',
+        'skia_lib.gyp:skia_lib',
+      ],
+    },
     {
       'target_name': 'imgblur',
       'type': 'executable',
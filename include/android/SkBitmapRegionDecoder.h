@@ -67,6 +67,14 @@ public:
      */
     virtual bool conversionSupported(SkColorType colorType) = 0;
 
+    /*
+     * Spend a pass over the encoded data now, so that later calls to decodeRegion()
+     * can start decoding near the region, rather than at the top of the image.
+     *
+     * @return true if the index was built, false if it is not supported for this image
+     */
+    virtual bool buildIndex() { return false; }
+
     virtual SkEncodedFormat getEncodedFormat() = 0;
 
     int width() const { return fWidth; }
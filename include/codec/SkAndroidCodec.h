@@ -111,6 +111,12 @@ public:
     bool getSupportedSubset(SkIRect* desiredSubset) const;
     // TODO: Rename SkCodec::getValidSubset() to getSupportedSubset()
 
+    /**
+     *  Speeds up later subset decodes, at the cost of a pass over the encoded
+     *  data now.  See SkCodec::buildIndex().
+     */
+    bool buildIndex() { return fCodec->buildIndex(); }
+
     /**
      *  Returns the dimensions of the scaled, partial output image, for an
      *  input sampleSize and subset.
@@ -18,6 +18,8 @@
 #include "SkTypes.h"
 #include "SkYUVSizeInfo.h"
 
+#include <vector>
+
 class SkColorSpace;
 class SkData;
 class SkPngChunkReader;
@@ -169,6 +171,18 @@ public:
         return this->onGetValidSubset(desiredSubset);
     }
 
+    /**
+     *  Make a pass over the encoded data to record places, partway down the
+     *  image, where decoding can start.  After this, skipScanlines() can jump
+     *  close to its destination instead of decoding every row above it, which
+     *  speeds up decoding subsets near the bottom of large images.
+     *
+     *  This is optional, and only worthwhile for a codec that will decode
+     *  several subsets.  Returns false if this codec or image does not
+     *  support it.
+     */
+    bool buildIndex() { return this->onBuildIndex(); }
+
     /**
      *  Format of the encoded data.
      */
@@ -243,6 +257,9 @@ public:
         Options()
             : fZeroInitialized(kNo_ZeroInitialized)
             , fSubset(NULL)
+            , fFrameIndex(0)
+            , fHasPriorFrame(false)
+            , fUseThreads(false)
         {}
 
         ZeroInitialized fZeroInitialized;
@@ -264,6 +281,33 @@ public:
          *  to getScanlines().
          */
         SkIRect*        fSubset;
+
+        /**
+         *  The frame to decode, for codecs that support animation.  See getFrameInfo().
+         *
+         *  Only getPixels() supports frames other than the first, and only without
+         *  scaling or subsetting.
+         */
+        size_t          fFrameIndex;
+
+        /**
+         *  If true, the pixels passed to getPixels() already hold the frame that
+         *  fFrameIndex depends on (its FrameInfo::fRequiredFrame), as it was output
+         *  by an earlier call to getPixels().  The codec will draw the new frame on
+         *  top of it, rather than decoding the required frame again.
+         *
+         *  Ignored if fFrameIndex does not depend on another frame.
+         */
+        bool            fHasPriorFrame;
+
+        /**
+         *  If true, and buildIndex() has succeeded, getPixels() may split the
+         *  image into horizontal bands and decode them concurrently on
+         *  SkTaskGroup's threads.  The pixels are the same either way.
+         *
+         *  Leave this false when already running on one of those threads.
+         */
+        bool            fUseThreads;
     };
 
     /**
@@ -313,14 +357,91 @@ public:
      */
     Result getPixels(const SkImageInfo& info, void* pixels, size_t rowBytes);
 
+    /**
+     *  What to do with a frame's rectangle before the next frame is drawn.
+     */
+    enum DisposalMethod {
+        /**
+         *  Leave the frame in place.
+         */
+        kKeep_DisposalMethod,
+        /**
+         *  Clear the frame's rectangle to transparent.
+         */
+        kRestoreBGColor_DisposalMethod,
+        /**
+         *  Return the frame's rectangle to what it held before the frame was drawn.
+         */
+        kRestorePrevious_DisposalMethod,
+    };
+
+    /**
+     *  Value for FrameInfo::fRequiredFrame when a frame does not depend on any other.
+     */
+    static const size_t kNone = static_cast<size_t>(-1);
+
+    /**
+     *  Information about an individual frame of an animated image.
+     */
+    struct FrameInfo {
+        /**
+         *  The frame that must be drawn before this one, or kNone if this
+         *  frame can be decoded on its own.
+         */
+        size_t          fRequiredFrame;
+
+        /**
+         *  Number of milliseconds to show this frame.
+         */
+        size_t          fDuration;
+
+        /**
+         *  The part of the image that this frame draws.
+         */
+        SkIRect         fFrameRect;
+
+        /**
+         *  How this frame's rectangle is treated before the next frame is drawn.
+         */
+        DisposalMethod  fDisposalMethod;
+    };
+
+    /**
+     *  Return information about each frame of an animated image.
+     *
+     *  Returns an empty vector for an image that is not animated.  Some codecs
+     *  must read through the entire input to count the frames.  They do so
+     *  without disturbing a scanline or incremental decode in progress, unless
+     *  the stream cannot be duplicated; then they return an empty vector until
+     *  the next getPixels().
+     *
+     *  To decode frame i, set Options::fFrameIndex to i.  If the frame has a
+     *  fRequiredFrame, getPixels() decodes that frame first, unless the caller
+     *  passes its pixels in with Options::fHasPriorFrame.  A client stepping
+     *  through an animation can therefore keep a copy of each frame that a later
+     *  frame requires, instead of decoding from the first frame each time.
+     */
+    std::vector<FrameInfo> getFrameInfo() {
+        return this->onGetFrameInfo();
+    }
+
+    /**
+     *  Return the number of frames in the image.  This is one for images that are
+     *  not animated.
+     */
+    int getFrameCount() {
+        return SkTMax(1, SkToInt(this->getFrameInfo().size()));
+    }
+
     /**
      *  If decoding to YUV is supported, this returns true.  Otherwise, this
      *  returns false and does not modify any of the parameters.
      *
      *  @param sizeInfo   Output parameter indicating the sizes and required
      *                    allocation widths of the Y, U, and V planes.
-     *  @param colorSpace Output parameter.  If non-NULL this is set to kJPEG,
-     *                    otherwise this is ignored.
+     *  @param colorSpace Output parameter.  If non-NULL this is set to the
+     *                    color space of the planes (kJPEG for JPEG, kRec601
+     *                    for WebP), otherwise this is ignored.
      */
     bool queryYUV8(SkYUVSizeInfo* sizeInfo, SkYUVColorSpace* colorSpace) const {
         if (nullptr == sizeInfo) {
@@ -353,6 +474,67 @@ public:
         return this->onGetYUV8Planes(sizeInfo, planes);
     }
 
+    /**
+     *  Prepare for an incremental decode with the specified options.
+     *
+     *  This is useful when the encoded data is still arriving, e.g. over a
+     *  slow network connection.  The client owns a stream that it keeps
+     *  appending data to, and calls incrementalDecode() each time more data
+     *  is available.  The stream's read() should return fewer bytes than
+     *  requested (possibly zero) when it has run out of data for now.
+     *
+     *  This may require a rewind.
+     *
+     *  Not all SkCodecs support this.
+     *
+     *  @param dstInfo Info of the destination. If the dimensions do not match
+     *      those of getInfo, this implies a scale.
+     *  @param dst Memory to write to. Needs to be large enough to hold the subset,
+     *      if present, or the full image as described in dstInfo.  It must
+     *      remain valid until the decode is complete.
+     *  @param options Contains decoding options, including if memory is zero
+     *      initialized and whether to decode a subset.
+     *  @param ctable A pointer to a color table.  When dstInfo.colorType() is
+     *      kIndex8, this should be non-NULL and have enough storage for 256
+     *      colors.  The color table will be populated after decoding the palette.
+     *  @param ctableCount A pointer to the size of the color table.  When
+     *      dstInfo.colorType() is kIndex8, this should be non-NULL.  It will
+     *      be modified to the true size of the color table (<= 256) after
+     *      decoding the palette.
+     *  @return Enum representing success or reason for failure.
+     */
+    Result startIncrementalDecode(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
+            const SkCodec::Options*, SkPMColor* ctable, int* ctableCount);
+
+    /**
+     *  Simplified version of startIncrementalDecode() that asserts that info
+     *  is NOT kIndex8_SkColorType and uses the default Options.
+     */
+    Result startIncrementalDecode(const SkImageInfo& dstInfo, void* dst, size_t rowBytes);
+
+    /**
+     *  Decode as much of the image as the stream currently holds, picking up
+     *  where the previous call stopped.
+     *
+     *  Not valid to call before calling startIncrementalDecode().
+     *
+     *  Unlike getPixels(), this does not fill in rows that have not been
+     *  decoded yet.  The client may want to fill them itself, or only draw
+     *  the rows that are ready.
+     *
+     *  @param rowsDecoded Optional output variable returning the number of
+     *      rows that have been initialized so far.  Only meaningful when this
+     *      returns kIncompleteInput.  Rows are counted in the order they are
+     *      decoded; for kOutOfOrder_SkScanlineOrder images (e.g. interlaced
+     *      gifs), use outputScanline() to find where each one landed.  Rows of
+     *      an interlaced png may be initialized before they are finished,
+     *      showing a coarse version of the image.
+     *  @return kSuccess when the image is complete.  kIncompleteInput if the
+     *      stream ran out of data; call again once more data has arrived.
+     *      Any other value ends the incremental decode.
+     */
+    Result incrementalDecode(int* rowsDecoded = nullptr);
+
     /**
      * The remaining functions revolve around decoding scanlines.
      */
@@ -561,6 +743,8 @@ protected:
         return kUnimplemented;
     }
 
+    virtual bool onBuildIndex() { return false; }
+
     virtual bool onGetValidSubset(SkIRect* /*desiredSubset*/) const {
         // By default, subsets are not supported.
         return false;
@@ -663,10 +847,11 @@ private:
     bool                        fNeedsRewind;
     const Origin                fOrigin;
 
-    // These fields are only meaningful during scanline decodes.
+    // These fields are only meaningful during scanline and incremental decodes.
     SkImageInfo                 fDstInfo;
     SkCodec::Options            fOptions;
     int                         fCurrScanline;
+    bool                        fStartedIncrementalDecode;
 
     /**
      *  Return whether these dimensions are supported as a scale.
@@ -681,6 +866,18 @@ private:
         return dim == fSrcInfo.dimensions() || this->onDimensionsSupported(dim);
     }
 
+    virtual std::vector<FrameInfo> onGetFrameInfo() {
+        return std::vector<FrameInfo>();
+    }
+
+    /**
+     *  Called by getPixels() before decoding frame fFrameIndex on top of its
+     *  required frame.  Draws the required frame into dst if the caller did not
+     *  supply it, and disposes of it.
+     */
+    Result handleFrameIndex(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
+            const Options&);
+
     // Methods for scanline decoding.
     virtual SkCodec::Result onStartScanlineDecode(const SkImageInfo& /*dstInfo*/,
             const SkCodec::Options& /*options*/, SkPMColor* /*ctable*/, int* /*ctableCount*/) {
@@ -691,6 +888,19 @@ private:
 
     virtual int onGetScanlines(void* /*dst*/, int /*countLines*/, size_t /*rowBytes*/) { return 0; }
 
+    // Methods for incremental decoding.
+    virtual Result onStartIncrementalDecode(const SkImageInfo& /*dstInfo*/, void* /*dst*/,
+            size_t /*rowBytes*/, const SkCodec::Options&, SkPMColor* /*ctable*/,
+            int* /*ctableCount*/) {
+        return kUnimplemented;
+    }
+
+    /**
+     *  @param rowsDecoded Never NULL.  Set to the number of rows initialized
+     *                     when returning kIncompleteInput.
+     */
+    virtual Result onIncrementalDecode(int* /*rowsDecoded*/) { return kUnimplemented; }
+
     /**
      * On an incomplete decode, getPixels() and getScanlines() will call this function
      * to fill any uinitialized memory.
@@ -95,6 +95,13 @@ protected:
                           bool pathIsMutable = false) override;
     virtual void drawBitmap(const SkDraw&, const SkBitmap& bitmap,
                             const SkMatrix& matrix, const SkPaint& paint) override;
+    /**
+     *  Both drawBitmap() and drawBitmapRect() end up here, to draw the bitmap through matrix
+     *  (pre-concatenated with the draw's matrix). If dstOrNull is not null, it is the rect (in
+     *  local coordinates) to fill with the bitmap, otherwise the bitmap's mapped bounds are used.
+     */
+    virtual void onDrawBitmap(const SkDraw&, const SkBitmap&, const SkMatrix&,
+                              const SkRect* dstOrNull, const SkPaint&);
     virtual void drawSprite(const SkDraw&, const SkBitmap& bitmap,
                             int x, int y, const SkPaint& paint) override;
 
@@ -161,6 +168,7 @@ private:
     friend class SkDeviceFilteredPaint;
 
     friend class SkSurface_Raster;
+    friend class SkThreadedBMPDevice;
 
     // used to change the backend's pixels (and possibly config/rowbytes)
     // but cannot change the width/height, so there should be no change to
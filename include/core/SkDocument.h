@@ -84,6 +84,33 @@ public:
          * The date and time the document was most recently modified.
          */
         OptionalTimestamp fModified;
+        /**
+         * If true, objects other than streams are packed into compressed
+         * PDF 1.5 object streams, and the cross-reference table is
+         * written as a compressed stream too.  This makes documents with
+         * many small objects (fonts, graphic states, annotations) much
+         * smaller, but they need a PDF 1.5 reader.  Ignored for PDF/A.
+         */
+        bool fUseObjectStreams;
+        /**
+         * If true, images are also matched by a digest of their
+         * contents: the encoded data when the image has it, or else the
+         * pixels.  The same picture drawn from distinct SkImages or
+         * SkBitmaps is then embedded once.  This costs one hash of each
+         * new image.
+         */
+        bool fDeduplicateImages;
+        /**
+         * If true, the document is linearized ("fast web view"): the
+         * first page and everything it uses come first, with hint tables
+         * saying where the other pages are, so a viewer can show the
+         * first page before the whole file has arrived.  Pages are kept
+         * until close() instead of being written as they end, and
+         * fUseObjectStreams is ignored.
+         */
+        bool fLinearize;
+        PDFMetadata()
+            : fUseObjectStreams(false), fDeduplicateImages(false), fLinearize(false) {}
     };
 
     /**
@@ -88,6 +88,65 @@ protected:
     virtual bool onEncode(SkWStream* stream, const SkBitmap& bm, int quality) = 0;
 };
 
+/**
+ *  Encodes an image a band of rows at a time, so that the whole image never needs to be in
+ *  memory.  Call writeRows() until every row has been written, and then finish().
+ */
+class SkScanlineEncoder : SkNoncopyable {
+public:
+    /**
+     *  Returns an encoder that writes an image described by info to stream, at quality level
+     *  'quality' (which can be in range 0-100), or nullptr if there is no scanline encoder for
+     *  this type and color type.  PNG and JPEG are supported, for kN32, kRGB_565 and
+     *  kARGB_4444 pixels.  PNG also needs them to be opaque or premultiplied.
+     *
+     *  Does not take ownership of the stream, which must outlive the encoder.
+     */
+    static SkScanlineEncoder* Create(SkWStream* stream, const SkImageInfo& info,
+                                     SkImageEncoder::Type, int quality);
+
+    virtual ~SkScanlineEncoder() {}
+
+    const SkImageInfo& info() const { return fInfo; }
+
+    /**
+     *  The number of rows written so far.
+     */
+    int rowsWritten() const { return fRowsWritten; }
+
+    /**
+     *  Encode the next 'count' rows, read from 'src', whose pixels are described by info().
+     *  Returns false on failure, or if there are not that many rows left.
+     */
+    bool writeRows(const void* src, size_t rowBytes, int count);
+
+    /**
+     *  Finish the encoded image, once every row has been written.  Returns false on failure.
+     */
+    bool finish();
+
+protected:
+    SkScanlineEncoder(const SkImageInfo& info)
+        : fInfo(info)
+        , fRowsWritten(0)
+        , fState(kWriting_State)
+    {}
+
+    virtual bool onWriteRows(const void* src, size_t rowBytes, int count) = 0;
+    virtual bool onFinish() = 0;
+
+private:
+    enum State {
+        kWriting_State,
+        kFinished_State,
+        kFailed_State,
+    };
+
+    const SkImageInfo fInfo;
+    int               fRowsWritten;
+    State             fState;
+};
+
 // This macro declares a global (i.e., non-class owned) creation entry point
 // for each encoder (e.g., CreateJPEGImageEncoder)
 #define DECLARE_ENCODER_CREATOR(codec)          \
@@ -116,4 +175,6 @@ DECLARE_ENCODER_CREATOR(ImageEncoder_WIC);
 // Typedef to make registering encoder callback easier
 // This has to be defined outside SkImageEncoder. :(
 typedef SkTRegistry<SkImageEncoder*(*)(SkImageEncoder::Type)> SkImageEncoder_EncodeReg;
+typedef SkTRegistry<SkScanlineEncoder*(*)(SkWStream*, const SkImageInfo&, SkImageEncoder::Type,
+                                          int quality)> SkScanlineEncoder_Reg;
 #endif
@@ -79,6 +79,21 @@ public:
         return MakeRaster(SkImageInfo::MakeN32Premul(width, height), props);
     }
 
+    /**
+     *  Return a new raster surface, like MakeRaster(), whose canvas splits the pixels into
+     *  tileCount horizontal tiles and rasterizes them in parallel on the SkTaskGroup thread pool
+     *  (see SkTaskGroup::Enabler). If tileCount <= 0, a tile count is chosen from the height.
+     *
+     *  Draws to the canvas are queued, and run on all the tiles when the canvas is flushed, or
+     *  when the pixels are read back or snapped into an image. The resulting pixels are the same
+     *  as those drawn by a surface from MakeRaster().
+     *
+     *  If the requested surface cannot be created, or the request is not a
+     *  supported configuration, NULL will be returned.
+     */
+    static sk_sp<SkSurface> MakeRasterThreaded(const SkImageInfo&, int tileCount = 0,
+                                               const SkSurfaceProps* = nullptr);
+
     /**
      *  Return a new surface using the specified render target.
      */
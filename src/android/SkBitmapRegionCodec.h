@@ -26,6 +26,8 @@ public:
 
     bool conversionSupported(SkColorType colorType) override;
 
+    bool buildIndex() override { return fCodec->buildIndex(); }
+
     SkEncodedFormat getEncodedFormat() override { return fCodec->getEncodedFormat(); }
 
 private:
@@ -124,6 +124,7 @@ SkCodec::SkCodec(int width, int height, const SkEncodedInfo& info, SkStream* str
     , fDstInfo()
     , fOptions()
     , fCurrScanline(-1)
+    , fStartedIncrementalDecode(false)
 {}
 
 SkCodec::~SkCodec() {}
@@ -145,6 +146,8 @@ bool SkCodec::rewindIfNeeded() {
 
     // startScanlineDecode will need to be called before decoding scanlines.
     fCurrScanline = -1;
+    // startIncrementalDecode will need to be called before incrementalDecode.
+    fStartedIncrementalDecode = false;
 
     if (!fStream->rewind()) {
         return false;
@@ -200,6 +203,18 @@ SkCodec::Result SkCodec::getPixels(const SkImageInfo& info, void* pixels, size_t
         return kInvalidScale;
     }
 
+    if (options->fFrameIndex > 0) {
+        const Result frameResult = this->handleFrameIndex(info, pixels, rowBytes, *options);
+        if (kSuccess != frameResult) {
+            return frameResult;
+        }
+
+        // Decoding the required frame may have read from the stream.
+        if (!this->rewindIfNeeded()) {
+            return kCouldNotRewind;
+        }
+    }
+
     // On an incomplete decode, the subclass will specify the number of scanlines that it decoded
     // successfully.
     int rowsDecoded = 0;
@@ -215,7 +230,8 @@ SkCodec::Result SkCodec::getPixels(const SkImageInfo& info, void* pixels, size_t
     // Some subclasses will take care of filling any uninitialized memory on
     // their own.  They indicate that all of the memory has been filled by
     // setting rowsDecoded equal to the height.
-    if (kIncompleteInput == result && rowsDecoded != info.height()) {
+    // Later frames leave the frame beneath them in place of any rows that are missing.
+    if (kIncompleteInput == result && rowsDecoded != info.height() && 0 == options->fFrameIndex) {
         this->fillIncompleteImage(info, pixels, rowBytes, options->fZeroInitialized, info.height(),
                 rowsDecoded);
     }
@@ -227,6 +243,69 @@ SkCodec::Result SkCodec::getPixels(const SkImageInfo& info, void* pixels, size_t
     return this->getPixels(info, pixels, rowBytes, nullptr, nullptr, nullptr);
 }
 
+const size_t SkCodec::kNone;
+
+static void zero_rect(const SkImageInfo& info, void* pixels, size_t rowBytes, SkIRect rect) {
+    if (!rect.intersect(SkIRect::MakeSize(info.dimensions()))) {
+        return;
+    }
+
+    const size_t bpp = info.bytesPerPixel();
+    for (int y = rect.top(); y < rect.bottom(); y++) {
+        sk_bzero(SkTAddOffset<void>(pixels, y * rowBytes + rect.left() * bpp), rect.width() * bpp);
+    }
+}
+
+SkCodec::Result SkCodec::handleFrameIndex(const SkImageInfo& info, void* pixels, size_t rowBytes,
+                                          const Options& options) {
+    const std::vector<FrameInfo> frames = this->getFrameInfo();
+    const size_t index = options.fFrameIndex;
+    if (index >= frames.size()) {
+        return kInvalidParameters;
+    }
+
+    // Each frame is drawn on top of earlier ones, so they must all be decoded to the same size.
+    if (options.fSubset || info.dimensions() != fSrcInfo.dimensions()) {
+        return kInvalidParameters;
+    }
+
+    // Each frame may bring its own palette.
+    if (kIndex_8_SkColorType == info.colorType()) {
+        return kInvalidConversion;
+    }
+
+    const size_t requiredFrame = frames[index].fRequiredFrame;
+    if (kNone == requiredFrame) {
+        return kSuccess;
+    }
+    SkASSERT(requiredFrame < index);
+
+    if (!options.fHasPriorFrame) {
+        // Walk back to a frame that stands on its own, and draw forward from there.  Each
+        // call passes the frame below it as its prior frame, so this does not recurse.
+        std::vector<size_t> chain;
+        for (size_t i = requiredFrame; i != kNone; i = frames[i].fRequiredFrame) {
+            chain.push_back(i);
+        }
+
+        Options priorOptions(options);
+        priorOptions.fHasPriorFrame = true;
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            priorOptions.fFrameIndex = *it;
+            const Result result = this->getPixels(info, pixels, rowBytes, &priorOptions,
+                                                  nullptr, nullptr);
+            if (kSuccess != result) {
+                return result;
+            }
+        }
+    }
+
+    if (kRestoreBGColor_DisposalMethod == frames[requiredFrame].fDisposalMethod) {
+        zero_rect(info, pixels, rowBytes, frames[requiredFrame].fFrameRect);
+    }
+    return kSuccess;
+}
+
 SkCodec::Result SkCodec::startScanlineDecode(const SkImageInfo& dstInfo,
         const SkCodec::Options* options, SkPMColor ctable[], int* ctableCount) {
     // Reset fCurrScanline in case of failure.
@@ -270,6 +349,11 @@ SkCodec::Result SkCodec::startScanlineDecode(const SkImageInfo& dstInfo,
         return kInvalidScale;
     }
 
+    // Only getPixels() can draw a frame on top of another.
+    if (options->fFrameIndex > 0) {
+        return kUnimplemented;
+    }
+
     const Result result = this->onStartScanlineDecode(dstInfo, *options, ctable, ctableCount);
     if (result != SkCodec::kSuccess) {
         return result;
@@ -285,6 +369,86 @@ SkCodec::Result SkCodec::startScanlineDecode(const SkImageInfo& dstInfo) {
     return this->startScanlineDecode(dstInfo, nullptr, nullptr, nullptr);
 }
 
+SkCodec::Result SkCodec::startIncrementalDecode(const SkImageInfo& info, void* pixels,
+        size_t rowBytes, const SkCodec::Options* options, SkPMColor* ctable, int* ctableCount) {
+    fStartedIncrementalDecode = false;
+
+    if (kUnknown_SkColorType == info.colorType()) {
+        return kInvalidConversion;
+    }
+    if (nullptr == pixels) {
+        return kInvalidParameters;
+    }
+    if (rowBytes < info.minRowBytes()) {
+        return kInvalidParameters;
+    }
+
+    // Ensure that valid color ptrs are passed in for kIndex8 color type
+    if (kIndex_8_SkColorType == info.colorType()) {
+        if (nullptr == ctable || nullptr == ctableCount) {
+            return kInvalidParameters;
+        }
+    } else {
+        if (ctableCount) {
+            *ctableCount = 0;
+        }
+        ctableCount = nullptr;
+        ctable = nullptr;
+    }
+
+    if (!this->rewindIfNeeded()) {
+        return kCouldNotRewind;
+    }
+
+    // Set options.
+    Options optsStorage;
+    if (nullptr == options) {
+        options = &optsStorage;
+    } else if (options->fSubset) {
+        SkIRect subset(*options->fSubset);
+        if (!this->onGetValidSubset(&subset) || subset != *options->fSubset) {
+            return kUnimplemented;
+        }
+    }
+
+    if (!this->dimensionsSupported(info.dimensions())) {
+        return kInvalidScale;
+    }
+
+    if (options->fFrameIndex > 0) {
+        return kUnimplemented;
+    }
+
+    fDstInfo = info;
+    fOptions = *options;
+    const Result result = this->onStartIncrementalDecode(info, pixels, rowBytes, fOptions,
+            ctable, ctableCount);
+    fStartedIncrementalDecode = (kSuccess == result);
+    return result;
+}
+
+SkCodec::Result SkCodec::startIncrementalDecode(const SkImageInfo& info, void* pixels,
+        size_t rowBytes) {
+    return this->startIncrementalDecode(info, pixels, rowBytes, nullptr, nullptr, nullptr);
+}
+
+SkCodec::Result SkCodec::incrementalDecode(int* rowsDecoded) {
+    if (!fStartedIncrementalDecode) {
+        return kInvalidParameters;
+    }
+
+    int rows = 0;
+    const Result result = this->onIncrementalDecode(&rows);
+    if (kIncompleteInput != result) {
+        // The decode is either complete or has failed.  Either way, the client
+        // must start again.
+        fStartedIncrementalDecode = false;
+    } else if (rowsDecoded) {
+        *rowsDecoded = rows;
+    }
+    return result;
+}
+
 int SkCodec::getScanlines(void* dst, int countLines, size_t rowBytes) {
     if (fCurrScanline < 0) {
         return 0;
@@ -8,7 +8,9 @@
 #ifndef SkCodecPriv_DEFINED
 #define SkCodecPriv_DEFINED
 
+#include "SkCodec.h"
 #include "SkColorPriv.h"
+#include "SkColorSpace.h"
 #include "SkColorTable.h"
 #include "SkImageInfo.h"
 #include "SkTypes.h"
@@ -138,6 +140,16 @@ inline bool conversion_possible(const SkImageInfo& dst, const SkImageInfo& src)
     }
 }
 
+/*
+ * F16 is always linear, so decoding to it always requires a color xform, as does
+ * decoding to a color space other than the encoded one.
+ */
+inline bool needs_color_xform(const SkImageInfo& dstInfo, const SkImageInfo& srcInfo) {
+    return (kRGBA_F16_SkColorType == dstInfo.colorType()) ||
+           (dstInfo.colorSpace() && !SkColorSpace::Equals(srcInfo.colorSpace(),
+                                                          dstInfo.colorSpace()));
+}
+
 /*
  * If there is a color table, get a pointer to the colors, otherwise return nullptr
  */
@@ -316,4 +328,40 @@ inline PackColorProc choose_pack_color_proc(bool isPremul, SkColorType colorType
     }
 }
 
+/*
+ * Sets fRequiredFrame for the last of frames, which are the frames of an animation of the
+ * given size, in order.  The frame is independent if it replaces every pixel in its rect,
+ * i.e. it is opaque or it does not blend with what is beneath it.
+ */
+inline void set_required_frame(std::vector<SkCodec::FrameInfo>* frames, bool independent,
+                               const SkISize& size) {
+    SkASSERT(!frames->empty());
+    SkCodec::FrameInfo& frame = frames->back();
+    const SkIRect bounds = SkIRect::MakeSize(size);
+    frame.fRequiredFrame = SkCodec::kNone;
+    if (1 == frames->size() || (independent && frame.fFrameRect.contains(bounds))) {
+        return;
+    }
+
+    // Frames that restore the previous frame leave behind the frame before them.
+    size_t prev = frames->size() - 2;
+    while (SkCodec::kRestorePrevious_DisposalMethod == (*frames)[prev].fDisposalMethod) {
+        if (0 == prev) {
+            // Back to the empty canvas.
+            return;
+        }
+        prev--;
+    }
+
+    // A frame that clears itself leaves nothing behind if it covered the canvas, or if it
+    // was drawn onto an empty one.
+    const SkCodec::FrameInfo& prevFrame = (*frames)[prev];
+    if (SkCodec::kRestoreBGColor_DisposalMethod == prevFrame.fDisposalMethod &&
+            (prevFrame.fFrameRect.contains(bounds) || SkCodec::kNone == prevFrame.fRequiredFrame)) {
+        return;
+    }
+
+    frame.fRequiredFrame = prev;
+}
+
 #endif // SkCodecPriv_DEFINED
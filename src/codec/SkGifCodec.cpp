@@ -59,9 +59,17 @@ static GifFileType* open_gif(SkStream* stream) {
 }
 
 /*
- * Check if a there is an index of the color table for a transparent pixel
+ * Reads the graphics control extension for an image frame, which holds the index of the
+ * color table for a transparent pixel, if there is one, and animation instructions.
  */
-static uint32_t find_trans_index(const SavedImage& image) {
+static void read_graphics_control(const SavedImage& image, uint32_t* transIndex,
+                                  size_t* duration, SkCodec::DisposalMethod* disposal) {
+    // Use maximum unsigned int (surely an invalid index) to indicate that a valid
+    // index was not found.
+    *transIndex = SK_MaxU32;
+    *duration = 0;
+    *disposal = SkCodec::kKeep_DisposalMethod;
+
     // If there is a transparent index specified, it will be contained in an
     // extension block.  We will loop through extension blocks in reverse order
     // to check the most recent extension blocks first.
@@ -75,22 +83,50 @@ static uint32_t find_trans_index(const SavedImage& image) {
         // is the transparent index (if it exists), so we need at least four
         // bytes.
         if (GRAPHICS_EXT_FUNC_CODE == extBlock.Function && extBlock.ByteCount >= 4) {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(extBlock.Bytes);
+
             // Check the transparent color flag which indicates whether a
             // transparent index exists.  It is the least significant bit of
             // the first byte of the extension block.
-            if (1 == (extBlock.Bytes[0] & 1)) {
+            if (1 == (bytes[0] & 1)) {
                 // Use uint32_t to prevent sign extending
-                return extBlock.Bytes[3];
+                *transIndex = bytes[3];
             }
 
+            // Bits 2-4 of the first byte hold the disposal method.  Values other
+            // than these are reserved, and treated as "do not dispose".
+            switch ((bytes[0] >> 2) & 7) {
+                case 2:
+                    *disposal = SkCodec::kRestoreBGColor_DisposalMethod;
+                    break;
+                case 3:
+                    *disposal = SkCodec::kRestorePrevious_DisposalMethod;
+                    break;
+                default:
+                    break;
+            }
+
+            // The delay is stored little endian, in hundredths of a second.
+            *duration = (bytes[1] | (bytes[2] << 8)) * 10;
+
             // There should only be one graphics control extension for the image frame
             break;
         }
     }
+}
 
-    // Use maximum unsigned int (surely an invalid index) to indicate that a valid
-    // index was not found.
-    return SK_MaxU32;
+/*
+ * Copies the pixels of a swizzled row whose indices are not transparent, leaving
+ * the pixels beneath the transparent ones in place.
+ */
+static void blend_row(void* dst, const void* src, const uint8_t* indices, int width,
+                      uint32_t transIndex, size_t bytesPerPixel) {
+    for (int x = 0; x < width; x++) {
+        if (indices[x] != transIndex) {
+            memcpy(SkTAddOffset<void>(dst, x * bytesPerPixel),
+                   SkTAddOffset<const void>(src, x * bytesPerPixel), bytesPerPixel);
+        }
+    }
 }
 
 inline uint32_t ceil_div(uint32_t a, uint32_t b) {
@@ -177,7 +213,9 @@ bool SkGifCodec::ReadHeader(SkStream* stream, SkCodec** codecOut, GifFileType**
     // Read through gif extensions to get to the image data.  Set the
     // transparent index based on the extension data.
     uint32_t transIndex;
-    SkCodec::Result result = ReadUpToFirstImage(gif, &transIndex);
+    FrameInfo firstFrame;
+    SkCodec::Result result = ReadUpToNextImage(gif, &transIndex, &firstFrame.fDuration,
+                                               &firstFrame.fDisposalMethod);
     if (kSuccess != result){
         return false;
     }
@@ -192,12 +230,11 @@ bool SkGifCodec::ReadHeader(SkStream* stream, SkCodec** codecOut, GifFileType**
 
     if (nullptr != codecOut) {
         SkISize size;
-        SkIRect frameRect;
-        if (!GetDimensions(gif, &size, &frameRect)) {
+        if (!GetDimensions(gif, &size, &firstFrame.fFrameRect)) {
             gif_error("Invalid gif size.\n");
             return false;
         }
-        bool frameIsSubset = (size != frameRect.size());
+        firstFrame.fRequiredFrame = kNone;
 
         // Determine the encoded alpha type.  The transIndex might be valid if it less
         // than 256.  We are not certain that the index is valid until we process the color
@@ -215,7 +252,7 @@ bool SkGifCodec::ReadHeader(SkStream* stream, SkCodec** codecOut, GifFileType**
         // FIXME: Gifs can actually be encoded with 4-bits per pixel.  Can we support this?
         SkEncodedInfo info = SkEncodedInfo::Make(SkEncodedInfo::kPalette_Color, alpha, 8);
         *codecOut = new SkGifCodec(size.width(), size.height(), info, streamDeleter.release(),
-                gif.release(), transIndex, frameRect, frameIsSubset);
+                gif.release(), transIndex, firstFrame);
     } else {
         SkASSERT(nullptr != gifOut);
         streamDeleter.release();
@@ -238,24 +275,36 @@ SkCodec* SkGifCodec::NewFromStream(SkStream* stream) {
 }
 
 SkGifCodec::SkGifCodec(int width, int height, const SkEncodedInfo& info, SkStream* stream,
-        GifFileType* gif, uint32_t transIndex, const SkIRect& frameRect, bool frameIsSubset)
+        GifFileType* gif, uint32_t transIndex, const FrameInfo& firstFrame)
     : INHERITED(width, height, info, stream)
     , fGif(gif)
     , fSrcBuffer(new uint8_t[this->getInfo().width()])
-    , fFrameRect(frameRect)
+    , fFrameRect(firstFrame.fFrameRect)
     // If it is valid, fTransIndex will be used to set fFillIndex.  We don't know if
     // fTransIndex is valid until we process the color table, since fTransIndex may
     // be greater than the size of the color table.
     , fTransIndex(transIndex)
+    , fFirstTransIndex(transIndex)
     // Default fFillIndex is 0.  We will overwrite this if fTransIndex is valid, or if
     // there is a valid background color.
     , fFillIndex(0)
-    , fFrameIsSubset(frameIsSubset)
+    , fFrameIsSubset(firstFrame.fFrameRect != SkIRect::MakeWH(width, height))
+    , fInterlaced(gif->Image.Interlace)
+    , fFrames(1, firstFrame)
+    , fReadAllFrames(false)
     , fSwizzler(NULL)
     , fColorTable(NULL)
+    , fIncrementalDst(nullptr)
+    , fIncrementalRowBytes(0)
+    , fRowsDecoded(0)
+    , fRestartIncrementalDecode(false)
+    , fDecodeInProgress(false)
 {}
 
 bool SkGifCodec::onRewind() {
+    // Starting over ends any scanline or incremental decode.
+    fDecodeInProgress = false;
+
     GifFileType* gifOut = nullptr;
     if (!ReadHeader(this->stream(), nullptr, &gifOut)) {
         return false;
@@ -266,7 +315,8 @@ bool SkGifCodec::onRewind() {
     return true;
 }
 
-SkCodec::Result SkGifCodec::ReadUpToFirstImage(GifFileType* gif, uint32_t* transIndex) {
+SkCodec::Result SkGifCodec::ReadUpToNextImage(GifFileType* gif, uint32_t* transIndex,
+                                              size_t* duration, DisposalMethod* disposal) {
     // Use this as a container to hold information about any gif extension
     // blocks.  This generally stores transparency and animation instructions.
     SavedImage saveExt;
@@ -276,9 +326,7 @@ SkCodec::Result SkGifCodec::ReadUpToFirstImage(GifFileType* gif, uint32_t* trans
     GifByteType* extData;
     int32_t extFunction;
 
-    // We will loop over components of gif images until we find an image.  Once
-    // we find an image, we will decode and return it.  While many gif files
-    // contain more than one image, we will simply decode the first image.
+    // We will loop over components of gif images until we find an image.
     GifRecordType recordType;
     do {
         // Get the current record type
@@ -287,29 +335,14 @@ SkCodec::Result SkGifCodec::ReadUpToFirstImage(GifFileType* gif, uint32_t* trans
         }
         switch (recordType) {
             case IMAGE_DESC_RECORD_TYPE: {
-                *transIndex = find_trans_index(saveExt);
-
-                // FIXME: Gif files may have multiple images stored in a single
-                //        file.  This is most commonly used to enable
-                //        animations.  Since we are leaving animated gifs as a
-                //        TODO, we will return kSuccess after decoding the
-                //        first image in the file.  This is the same behavior
-                //        as SkImageDecoder_libgif.
-                //
-                //        Most times this works pretty well, but sometimes it
-                //        doesn't.  For example, I have an animated test image
-                //        where the first image in the file is 1x1, but the
-                //        subsequent images are meaningful.  This currently
-                //        displays the 1x1 image, which is not ideal.  Right
-                //        now I am leaving this as an issue that will be
-                //        addressed when we implement animated gifs.
-                //
-                //        It is also possible (not explicitly disallowed in the
+                read_graphics_control(saveExt, transIndex, duration, disposal);
+
+                // FIXME: It is possible (not explicitly disallowed in the
                 //        specification) that gif files provide multiple
                 //        images in a single file that are all meant to be
-                //        displayed in the same frame together.  I will
-                //        currently leave this unimplemented until I find a
-                //        test case that expects this behavior.
+                //        displayed in the same frame together.  We treat
+                //        each image as a frame of an animation, which is
+                //        what browsers do.
                 return kSuccess;
             }
             // Extensions are used to specify special properties of the image
@@ -354,7 +387,7 @@ SkCodec::Result SkGifCodec::ReadUpToFirstImage(GifFileType* gif, uint32_t* trans
         }
     } while (TERMINATE_RECORD_TYPE != recordType);
 
-    return gif_error("Could not find any images to decode in gif file.\n", kInvalidInput);
+    return gif_error("Could not find another image to decode in gif file.\n", kInvalidInput);
 }
 
 bool SkGifCodec::GetDimensions(GifFileType* gif, SkISize* size, SkIRect* frameRect) {
@@ -397,6 +430,9 @@ void SkGifCodec::initializeColorTable(const SkImageInfo& dstInfo, SkPMColor* inp
         *inputColorCount = maxColors;
     }
 
+    // Each frame chooses its own fill index.
+    fFillIndex = 0;
+
     // Get local color table
     ColorMapObject* colorMap = fGif->Image.ColorMap;
     // If there is no local color table, use the global color table
@@ -455,6 +491,11 @@ SkCodec::Result SkGifCodec::prepareToDecode(const SkImageInfo& dstInfo, SkPMColo
                 kInvalidConversion);
     }
 
+    Result result = this->seekToFrame(opts.fFrameIndex);
+    if (kSuccess != result) {
+        return result;
+    }
+
     // Initialize color table and copy to the client if necessary
     this->initializeColorTable(dstInfo, inputColorPtr, inputColorCount);
 
@@ -474,6 +515,109 @@ bool SkGifCodec::readRow() {
     return GIF_ERROR != DGifGetLine(fGif, fSrcBuffer.get(), fFrameRect.width());
 }
 
+bool SkGifCodec::SkipImageData(GifFileType* gif) {
+    int codeSize;
+    GifByteType* block;
+    if (GIF_ERROR == DGifGetCode(gif, &codeSize, &block)) {
+        return false;
+    }
+    while (nullptr != block) {
+        if (GIF_ERROR == DGifGetCodeNext(gif, &block)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SkCodec::Result SkGifCodec::seekToFrame(size_t index) {
+    SkASSERT(index < fFrames.size());
+    fTransIndex = fFirstTransIndex;
+    for (size_t i = 0; i < index; i++) {
+        if (!SkipImageData(fGif)) {
+            return gif_error("Could not skip image data.\n", kIncompleteInput);
+        }
+
+        size_t duration;
+        DisposalMethod disposal;
+        Result result = ReadUpToNextImage(fGif, &fTransIndex, &duration, &disposal);
+        if (kSuccess != result) {
+            return result;
+        }
+
+        if (GIF_ERROR == DGifGetImageDesc(fGif)) {
+            return gif_error("Could not read image descriptor.\n", kIncompleteInput);
+        }
+    }
+
+    fFrameRect = fFrames[index].fFrameRect;
+    fFrameIsSubset = fFrameRect != SkIRect::MakeSize(this->getInfo().dimensions());
+    fInterlaced = fGif->Image.Interlace;
+    return kSuccess;
+}
+
+std::vector<SkCodec::FrameInfo> SkGifCodec::onGetFrameInfo() {
+    if (!fReadAllFrames) {
+        fReadAllFrames = this->readFrames();
+    }
+
+    if (fFrames.size() < 2) {
+        // Not animated.
+        return std::vector<FrameInfo>();
+    }
+    return fFrames;
+}
+
+bool SkGifCodec::readFrames() {
+    // Reading past the first frame would lose our place in a scanline or incremental decode,
+    // so parse a duplicate of the stream if we can.
+    if (SkStream* duplicate = this->stream()->duplicate()) {
+        GifFileType* gif = nullptr;
+        if (!ReadHeader(duplicate, nullptr, &gif)) {
+            // ReadHeader() deleted the duplicate.
+            return true;
+        }
+        SkAutoTDelete<SkStream> streamDeleter(duplicate);
+        SkAutoTCallVProc<GifFileType, CloseGif> gifDeleter(gif);
+        this->readFrames(gif);
+        return true;
+    }
+
+    if (fDecodeInProgress) {
+        return false;
+    }
+
+    // This reads past the first frame, so the next decode will have to rewind.
+    if (!this->rewindIfNeeded()) {
+        return true;
+    }
+    this->readFrames(fGif);
+    return true;
+}
+
+void SkGifCodec::readFrames(GifFileType* gif) {
+    const SkISize size = this->getInfo().dimensions();
+    while (SkipImageData(gif)) {
+        FrameInfo frame;
+        uint32_t transIndex;
+        if (kSuccess != ReadUpToNextImage(gif, &transIndex, &frame.fDuration,
+                                          &frame.fDisposalMethod) ||
+                GIF_ERROR == DGifGetImageDesc(gif)) {
+            break;
+        }
+
+        // The image is sized to fit the first frame.  Treat a later frame that does not fit
+        // as the end of the animation, rather than drawing outside of the image.
+        const GifImageDesc& desc = gif->Image;
+        frame.fFrameRect.setXYWH(desc.Left, desc.Top, desc.Width, desc.Height);
+        if (frame.fFrameRect.isEmpty() || !SkIRect::MakeSize(size).contains(frame.fFrameRect)) {
+            break;
+        }
+
+        fFrames.push_back(frame);
+        set_required_frame(&fFrames, transIndex >= 256, size);
+    }
+}
+
 /*
  * Initiates the gif decode
  */
@@ -492,13 +636,21 @@ SkCodec::Result SkGifCodec::onGetPixels(const SkImageInfo& dstInfo,
         return gif_error("Scaling not supported.\n", kInvalidScale);
     }
 
-    // Initialize the swizzler
-    if (fFrameIsSubset) {
+    // A later frame is either drawn over the frame it requires, which is already in dst,
+    // or onto an empty canvas.
+    const bool blend = opts.fFrameIndex > 0 && kNone != fFrames[opts.fFrameIndex].fRequiredFrame;
+    if (fFrameIsSubset && !blend) {
         // Fill the background
-        SkSampler::Fill(dstInfo, dst, dstRowBytes, this->getFillValue(dstInfo.colorType()),
-                opts.fZeroInitialized);
+        const uint32_t fillValue = opts.fFrameIndex > 0 ? SK_ColorTRANSPARENT
+                                                        : this->getFillValue(dstInfo.colorType());
+        SkSampler::Fill(dstInfo, dst, dstRowBytes, fillValue, opts.fZeroInitialized);
     }
 
+    // When blending, rows are swizzled here first, so that only the pixels which are not
+    // transparent are copied over the required frame.
+    const size_t bpp = dstInfo.bytesPerPixel();
+    SkAutoTMalloc<uint8_t> blendRow(blend ? dstInfo.minRowBytes() : 0);
+
     // Iterate over rows of the input
     for (int y = fFrameRect.top(); y < fFrameRect.bottom(); y++) {
         if (!this->readRow()) {
@@ -506,7 +658,14 @@ SkCodec::Result SkGifCodec::onGetPixels(const SkImageInfo& dstInfo,
             return gif_error("Could not decode line.\n", kIncompleteInput);
         }
         void* dstRow = SkTAddOffset<void>(dst, dstRowBytes * this->outputScanline(y));
-        fSwizzler->swizzle(dstRow, fSrcBuffer.get());
+        if (blend) {
+            fSwizzler->swizzle(blendRow.get(), fSrcBuffer.get());
+            const size_t offset = fFrameRect.left() * bpp;
+            blend_row(SkTAddOffset<void>(dstRow, offset), blendRow.get() + offset,
+                      fSrcBuffer.get(), fFrameRect.width(), fTransIndex, bpp);
+        } else {
+            fSwizzler->swizzle(dstRow, fSrcBuffer.get());
+        }
     }
     return kSuccess;
 }
@@ -520,7 +679,9 @@ uint32_t SkGifCodec::onGetFillValue(SkColorType colorType) const {
 
 SkCodec::Result SkGifCodec::onStartScanlineDecode(const SkImageInfo& dstInfo,
         const SkCodec::Options& opts, SkPMColor inputColorPtr[], int* inputColorCount) {
-    return this->prepareToDecode(dstInfo, inputColorPtr, inputColorCount, opts);
+    Result result = this->prepareToDecode(dstInfo, inputColorPtr, inputColorCount, opts);
+    fDecodeInProgress = (kSuccess == result);
+    return result;
 }
 
 void SkGifCodec::handleScanlineFrame(int count, int* rowsBeforeFrame, int* rowsInFrame) {
@@ -588,15 +749,73 @@ bool SkGifCodec::onSkipScanlines(int count) {
     return true;
 }
 
+SkCodec::Result SkGifCodec::onStartIncrementalDecode(const SkImageInfo& dstInfo, void* dst,
+        size_t rowBytes, const SkCodec::Options& opts, SkPMColor* inputColorPtr,
+        int* inputColorCount) {
+    Result result = this->prepareToDecode(dstInfo, inputColorPtr, inputColorCount, opts);
+    if (kSuccess != result) {
+        return result;
+    }
+
+    if (dstInfo.dimensions() != this->getInfo().dimensions()) {
+        return gif_error("Scaling not supported.\n", kInvalidScale);
+    }
+
+    if (fFrameIsSubset) {
+        // Fill the background
+        SkSampler::Fill(dstInfo, dst, rowBytes, this->getFillValue(dstInfo.colorType()),
+                opts.fZeroInitialized);
+    }
+
+    fIncrementalDst = dst;
+    fIncrementalRowBytes = rowBytes;
+    fRowsDecoded = fFrameRect.top();
+    fRestartIncrementalDecode = false;
+    fDecodeInProgress = true;
+    return kSuccess;
+}
+
+SkCodec::Result SkGifCodec::onIncrementalDecode(int* rowsDecoded) {
+    // giflib cannot pick up where it left off once it runs out of data.  Instead, we start
+    // over from the beginning of the stream and skip the rows that earlier calls output.
+    int y = fFrameRect.top();
+    if (fRestartIncrementalDecode) {
+        if (!this->stream()->rewind() || !this->onRewind()) {
+            return gif_error("Could not rewind.\n", kCouldNotRewind);
+        }
+        fDecodeInProgress = true;
+
+        for (; y < fRowsDecoded; y++) {
+            if (!this->readRow()) {
+                *rowsDecoded = fRowsDecoded;
+                return kIncompleteInput;
+            }
+        }
+    }
+    fRestartIncrementalDecode = true;
+
+    for (; y < fFrameRect.bottom(); y++) {
+        if (!this->readRow()) {
+            fRowsDecoded = y;
+            *rowsDecoded = y;
+            return kIncompleteInput;
+        }
+        void* dstRow = SkTAddOffset<void>(fIncrementalDst,
+                fIncrementalRowBytes * this->outputScanline(y));
+        fSwizzler->swizzle(dstRow, fSrcBuffer.get());
+    }
+    return kSuccess;
+}
+
 SkCodec::SkScanlineOrder SkGifCodec::onGetScanlineOrder() const {
-    if (fGif->Image.Interlace) {
+    if (fInterlaced) {
         return kOutOfOrder_SkScanlineOrder;
     }
     return kTopDown_SkScanlineOrder;
 }
 
 int SkGifCodec::onOutputScanline(int inputScanline) const {
-    if (fGif->Image.Interlace) {
+    if (fInterlaced) {
         if (inputScanline < fFrameRect.top() || inputScanline >= fFrameRect.bottom()) {
             return inputScanline;
         }
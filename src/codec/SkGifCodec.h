@@ -70,19 +70,23 @@ protected:
 
     int onOutputScanline(int inputScanline) const override;
 
+    std::vector<FrameInfo> onGetFrameInfo() override;
+
 private:
 
     /*
-     * A gif can contain multiple image frames.  We will only decode the first
-     * frame.  This function reads up to the first image frame, processing
-     * transparency and/or animation information that comes before the image
-     * data.
+     * A gif can contain multiple image frames.  This function reads up to the
+     * next image frame, processing transparency and/or animation information
+     * that comes before the image data.
      *
      * @param gif        Pointer to the library type that manages the gif decode
      * @param transIndex This call will set the transparent index based on the
      *                   extension data.
+     * @param duration   Set to the number of milliseconds to show the frame.
+     * @param disposal   Set to the frame's disposal method.
      */
-     static Result ReadUpToFirstImage(GifFileType* gif, uint32_t* transIndex);
+     static Result ReadUpToNextImage(GifFileType* gif, uint32_t* transIndex,
+                                     size_t* duration, DisposalMethod* disposal);
 
      /*
       * A gif may contain many image frames, all of different sizes.
@@ -143,6 +147,33 @@ private:
      */
     bool readRow();
 
+    /*
+     * Reads past the image data of gif's current frame without decoding it.
+     *
+     * @return true if the read is successful and false if the read fails.
+     */
+    static bool SkipImageData(GifFileType* gif);
+
+    /*
+     * Moves from the first frame's image descriptor to the given frame's, and
+     * sets fFrameRect and fTransIndex to match it.
+     */
+    Result seekToFrame(size_t index);
+
+    /*
+     * Reads the descriptions of the frames after the first into fFrames, from a duplicate
+     * of the stream if possible.
+     *
+     * @return false if the frames could not be read without disturbing a scanline or
+     *         incremental decode, and should be read later.
+     */
+    bool readFrames();
+
+    /*
+     * Reads the descriptions of the frames after gif's first into fFrames.
+     */
+    void readFrames(GifFileType* gif);
+
     Result onStartScanlineDecode(const SkImageInfo& dstInfo, const Options& opts,
                    SkPMColor inputColorPtr[], int* inputColorCount) override;
 
@@ -166,6 +197,11 @@ private:
 
     SkScanlineOrder onGetScanlineOrder() const override;
 
+    Result onStartIncrementalDecode(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
+            const Options& opts, SkPMColor* inputColorPtr, int* inputColorCount) override;
+
+    Result onIncrementalDecode(int* rowsDecoded) override;
+
     /*
      * This function cleans up the gif object after the decode completes
      * It is used in a SkAutoTCallIProc template
@@ -188,18 +224,36 @@ private:
      *            takes ownership
      * @param transIndex  The transparent index.  An invalid value
      *            indicates that there is no transparent index.
+     * @param firstFrame  Describes the first image frame.
      */
     SkGifCodec(int width, int height, const SkEncodedInfo& info, SkStream* stream,
-            GifFileType* gif, uint32_t transIndex, const SkIRect& frameRect, bool frameIsSubset);
+            GifFileType* gif, uint32_t transIndex, const FrameInfo& firstFrame);
 
     SkAutoTCallVProc<GifFileType, CloseGif> fGif; // owned
     SkAutoTDeleteArray<uint8_t>             fSrcBuffer;
-    const SkIRect                           fFrameRect;
-    const uint32_t                          fTransIndex;
+
+    // These describe the frame being decoded.
+    SkIRect                                 fFrameRect;
+    uint32_t                                fTransIndex;
+    const uint32_t                          fFirstTransIndex;
     uint32_t                                fFillIndex;
-    const bool                              fFrameIsSubset;
+    bool                                    fFrameIsSubset;
+    bool                                    fInterlaced;
+
+    // Only the first frame is known until readFrames() is called.
+    std::vector<FrameInfo>                  fFrames;
+    bool                                    fReadAllFrames;
     SkAutoTDelete<SkSwizzler>               fSwizzler;
     SkAutoTUnref<SkColorTable>              fColorTable;
 
+    // These are only meaningful during incremental decodes.
+    void*                                   fIncrementalDst;
+    size_t                                  fIncrementalRowBytes;
+    int                                     fRowsDecoded;
+    bool                                    fRestartIncrementalDecode;
+
+    // Whether a scanline or incremental decode has started since the stream was last rewound.
+    bool                                    fDecodeInProgress;
+
     typedef SkCodec INHERITED;
 };
@@ -11,11 +11,14 @@
 #include "SkJpegDecoderMgr.h"
 #include "SkCodecPriv.h"
 #include "SkColorPriv.h"
+#include "SkData.h"
 #include "SkStream.h"
+#include "SkTaskGroup.h"
 #include "SkTemplates.h"
 #include "SkTypes.h"
 
 // stdio is needed for libjpeg-turbo
+#include <algorithm>
 #include <stdio.h>
 #include "SkJpegUtility.h"
 
@@ -272,6 +275,9 @@ SkJpegCodec::SkJpegCodec(int width, int height, const SkEncodedInfo& info, SkStr
     , fColorXformSrcRow(nullptr)
     , fSwizzlerSubset(SkIRect::MakeEmpty())
     , fICCData(std::move(iccData))
+    , fIncrementalDst(nullptr)
+    , fIncrementalRowBytes(0)
+    , fStartedDecompress(false)
 {}
 
 /*
@@ -478,12 +484,6 @@ bool SkJpegCodec::onDimensionsSupported(const SkISize& size) {
     return true;
 }
 
-static bool needs_color_xform(const SkImageInfo& dstInfo, const SkImageInfo& srcInfo) {
-    return (kRGBA_F16_SkColorType == dstInfo.colorType()) ||
-           (dstInfo.colorSpace() && !SkColorSpace::Equals(srcInfo.colorSpace(),
-                                                          dstInfo.colorSpace()));
-}
-
 int SkJpegCodec::readRows(const SkImageInfo& dstInfo, void* dst, size_t rowBytes, int count) {
     // Set the jump location for libjpeg-turbo errors
     if (setjmp(fDecoderMgr->getJmpBuf())) {
@@ -491,28 +491,21 @@ int SkJpegCodec::readRows(const SkImageInfo& dstInfo, void* dst, size_t rowBytes
     }
 
     // When fSwizzleSrcRow is non-null, it means that we need to swizzle.  In this case,
-    // we will always decode into fSwizzlerSrcRow before swizzling into the next buffer.
+    // we will always decode into fSwizzlerSrcRow before swizzling into the dst.
     // We can never swizzle "in place" because the swizzler may perform sampling and/or
-    // subsetting.
-    // When fColorXformSrcRow is non-null, it means that we need to color xform and that
-    // we cannot color xform "in place" (many times we can, but not when the dst is F16).
-    // In this case, we will color xform from fColorXformSrc into the dst.
+    // subsetting.  The swizzler also applies fColorXform, if there is one, as it writes
+    // each row.
+    // When fColorXformSrcRow is non-null, it means that we need to color xform without
+    // swizzling and that we cannot color xform "in place" (many times we can, but not
+    // when the dst is F16).  In this case, we will color xform from fColorXformSrc into
+    // the dst.
     JSAMPLE* decodeDst = (JSAMPLE*) dst;
-    uint32_t* swizzleDst = (uint32_t*) dst;
     size_t decodeDstRowBytes = rowBytes;
-    size_t swizzleDstRowBytes = rowBytes;
-    if (fSwizzleSrcRow && fColorXformSrcRow) {
+    if (fSwizzleSrcRow) {
         decodeDst = (JSAMPLE*) fSwizzleSrcRow;
-        swizzleDst = fColorXformSrcRow;
         decodeDstRowBytes = 0;
-        swizzleDstRowBytes = 0;
     } else if (fColorXformSrcRow) {
         decodeDst = (JSAMPLE*) fColorXformSrcRow;
-        swizzleDst = fColorXformSrcRow;
-        decodeDstRowBytes = 0;
-        swizzleDstRowBytes = 0;
-    } else if (fSwizzleSrcRow) {
-        decodeDst = (JSAMPLE*) fSwizzleSrcRow;
         decodeDstRowBytes = 0;
     }
 
@@ -525,31 +518,14 @@ int SkJpegCodec::readRows(const SkImageInfo& dstInfo, void* dst, size_t rowBytes
         }
 
         if (fSwizzler) {
-            fSwizzler->swizzle(swizzleDst, decodeDst);
-        }
-
-        if (fColorXform) {
-            int width = dstInfo.width();
-            switch (dstInfo.colorType()) {
-                case kRGBA_8888_SkColorType:
-                    fColorXform->applyToRGBA((uint32_t*) dst, swizzleDst, width);
-                    break;
-                case kBGRA_8888_SkColorType:
-                    fColorXform->applyToBGRA((uint32_t*) dst, swizzleDst, width);
-                    break;
-                case kRGBA_F16_SkColorType:
-                    fColorXform->applyToF16((uint64_t*) dst, swizzleDst, width);
-                    break;
-                default:
-                    SkASSERT(false);
-                    break;
-            }
-
-            dst = SkTAddOffset<void>(dst, rowBytes);
+            fSwizzler->swizzle(dst, decodeDst);
+        } else if (fColorXform) {
+            fColorXform->apply(dst, (const uint32_t*) decodeDst, dstInfo.width(),
+                               dstInfo.colorType(), kOpaque_SkAlphaType);
         }
 
         decodeDst = SkTAddOffset<JSAMPLE>(decodeDst, decodeDstRowBytes);
-        swizzleDst = SkTAddOffset<uint32_t>(swizzleDst, swizzleDstRowBytes);
+        dst = SkTAddOffset<void>(dst, rowBytes);
     }
 
     return count;
@@ -567,6 +543,10 @@ SkCodec::Result SkJpegCodec::onGetPixels(const SkImageInfo& dstInfo,
         return kUnimplemented;
     }
 
+    if (this->decodeInBands(dstInfo, dst, dstRowBytes, options)) {
+        return kSuccess;
+    }
+
     // Get a pointer to the decompress info since we will use it quite frequently
     jpeg_decompress_struct* dinfo = fDecoderMgr->dinfo();
 
@@ -609,15 +589,59 @@ SkCodec::Result SkJpegCodec::onGetPixels(const SkImageInfo& dstInfo,
     return kSuccess;
 }
 
+// Bands smaller than this are not worth a codec of their own.
+static const int kMinBandRows = 64;
+
+bool SkJpegCodec::decodeInBands(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
+        const Options& options) {
+    if (!options.fUseThreads || !fIndex) {
+        return false;
+    }
+    const int height = dstInfo.height();
+    const int bands = SkTMin(sk_num_cores(), height / kMinBandRows);
+    if (bands < 2) {
+        return false;
+    }
+
+    // Each band seeks as close to its top as the index allows, so the bands do not
+    // need to line up with the entries.  If any band fails, including one that runs out
+    // of data, we start over serially, which reports the error, and how many rows were
+    // decoded, as usual.
+    const int bandRows = (height + bands - 1) / bands;
+    SkAutoTMalloc<bool> succeeded(bands);
+    SkTaskGroup().batch(bands, [&](int i) {
+        const int top = i * bandRows;
+        const int rows = SkTMin(bandRows, height - top);
+        succeeded[i] = false;
+
+        SkAutoTDelete<SkCodec> codec(NewFromStream(new SkMemoryStream(fIndex->fData)));
+        if (!codec) {
+            return;
+        }
+        static_cast<SkJpegCodec*>(codec.get())->fIndex = fIndex;
+        succeeded[i] = kSuccess == codec->startScanlineDecode(dstInfo, &options, nullptr,
+                                                                  nullptr) &&
+                       codec->skipScanlines(top) &&
+                       rows == codec->getScanlines(SkTAddOffset<void>(dst, top * rowBytes), rows,
+                                                   rowBytes);
+    });
+
+    for (int i = 0; i < bands; i++) {
+        if (!succeeded[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void SkJpegCodec::allocateStorage(const SkImageInfo& dstInfo) {
     size_t swizzleBytes = 0;
     if (fSwizzler) {
         swizzleBytes = get_row_bytes(fDecoderMgr->dinfo());
-        SkASSERT(!fColorXform || SkIsAlign4(swizzleBytes));
     }
 
     size_t xformBytes = 0;
-    if (kRGBA_F16_SkColorType == dstInfo.colorType()) {
+    if (!fSwizzler && kRGBA_F16_SkColorType == dstInfo.colorType()) {
         SkASSERT(fColorXform);
         xformBytes = dstInfo.width() * sizeof(SkColorSpaceXform::RGBA32);
     }
@@ -663,7 +687,7 @@ void SkJpegCodec::initializeSwizzler(const SkImageInfo& dstInfo, const Options&
         swizzlerOptions.fSubset = &fSwizzlerSubset;
     }
     fSwizzler.reset(SkSwizzler::CreateSwizzler(swizzlerInfo, nullptr, dstInfo, swizzlerOptions,
-                                               nullptr, preSwizzled));
+                                               nullptr, preSwizzled, fColorXform.get()));
     SkASSERT(fSwizzler);
 }
 
@@ -714,6 +738,7 @@ SkCodec::Result SkJpegCodec::onStartScanlineDecode(const SkImageInfo& dstInfo,
     }
 
 #ifdef TURBO_HAS_CROP
+    fCropWidth = 0;
     if (options.fSubset) {
         uint32_t startX = options.fSubset->x();
         uint32_t width = options.fSubset->width();
@@ -724,6 +749,8 @@ SkCodec::Result SkJpegCodec::onStartScanlineDecode(const SkImageInfo& dstInfo,
         // of width so that the right edge of the requested subset remains
         // the same.
         jpeg_crop_scanline(fDecoderMgr->dinfo(), &startX, &width);
+        fCropX = startX;
+        fCropWidth = width;
 
         SkASSERT(startX <= (uint32_t) options.fSubset->x());
         SkASSERT(width >= (uint32_t) options.fSubset->width());
@@ -789,6 +816,10 @@ bool SkJpegCodec::onSkipScanlines(int count) {
         return fDecoderMgr->returnFalse("onSkipScanlines");
     }
 
+    if (fIndex && !this->seekWithIndex(this->currScanline() + count, &count)) {
+        return false;
+    }
+
 #ifdef TURBO_HAS_SKIP
     return (uint32_t) count == jpeg_skip_scanlines(fDecoderMgr->dinfo(), count);
 #else
@@ -807,6 +838,303 @@ bool SkJpegCodec::onSkipScanlines(int count) {
 #endif
 }
 
+static inline int read_be16(const uint8_t* ptr) {
+    return (ptr[0] << 8) | ptr[1];
+}
+
+/*
+ * libjpeg cannot hand out its Huffman decoder state, so it cannot resume at an arbitrary
+ * MCU.  It can resume just past a restart marker, where that state is reset anyway.  So
+ * the index records the restart markers that begin an MCU row.
+ *
+ * This supports baseline and extended sequential Huffman images with a single scan, held
+ * in memory.
+ */
+bool SkJpegCodec::onBuildIndex() {
+    if (fIndex) {
+        return true;
+    }
+
+    SkStream* stream = this->stream();
+    if (!stream->getMemoryBase() || !stream->hasLength()) {
+        return false;
+    }
+    sk_sp<SkData> data = SkData::MakeWithoutCopy(stream->getMemoryBase(), stream->getLength());
+    const uint8_t* bytes = data->bytes();
+    const size_t size = data->size();
+
+    // Read the markers up to the start of scan.  The codec has already checked for SOI.
+    size_t heightOffset = 0;
+    size_t headerSize = 0;
+    int components = 0;
+    int maxH = 1;
+    int maxV = 1;
+    int restartInterval = 0;
+    size_t pos = 2;
+    while (0 == headerSize) {
+        if (pos >= size || 0xFF != bytes[pos]) {
+            return false;
+        }
+        // Markers may be preceded by any number of fill bytes.
+        while (pos < size && 0xFF == bytes[pos]) {
+            pos++;
+        }
+        if (pos + 3 > size) {
+            return false;
+        }
+        const uint8_t marker = bytes[pos];
+        const size_t length = read_be16(&bytes[pos + 1]);
+        const uint8_t* segment = &bytes[pos + 3];
+        const size_t end = pos + 1 + length;
+        if (length < 2 || end > size) {
+            return false;
+        }
+
+        switch (marker) {
+            case 0xC0:  // SOF0: baseline
+            case 0xC1:  // SOF1: extended sequential, Huffman
+                if (length < 8) {
+                    return false;
+                }
+                heightOffset = pos + 4;
+                components = segment[5];
+                if (length < 8 + 3 * (size_t) components) {
+                    return false;
+                }
+                for (int i = 0; i < components; i++) {
+                    const uint8_t sampling = segment[7 + 3 * i];
+                    maxH = SkTMax(maxH, sampling >> 4);
+                    maxV = SkTMax(maxV, sampling & 0xF);
+                }
+                if (1 == components && (1 != maxH || 1 != maxV)) {
+                    // libjpeg ignores the sampling factors here, so our MCU rows would be wrong.
+                    return false;
+                }
+                break;
+            case 0xC4:  // DHT
+            case 0xC8:  // JPG
+            case 0xCC:  // DAC
+                break;
+            case 0xDA:  // SOS
+                if (0 == heightOffset || segment[0] != components) {
+                    return false;
+                }
+                headerSize = end;
+                break;
+            case 0xDD:  // DRI
+                if (length < 4) {
+                    return false;
+                }
+                restartInterval = read_be16(segment);
+                break;
+            case 0xD9:  // EOI
+                return false;
+            default:
+                if (marker >= 0xC2 && marker <= 0xCF) {
+                    // Progressive, lossless, and arithmetic coded frames
+                    return false;
+                }
+                break;
+        }
+        pos = end;
+    }
+
+    const int width = read_be16(&bytes[heightOffset + 2]);
+    const int height = read_be16(&bytes[heightOffset]);
+    if (0 == restartInterval || 0 == width || 0 == height) {
+        return false;
+    }
+    const int mcuHeight = 8 * maxV;
+    const int mcusPerRow = (width + 8 * maxH - 1) / (8 * maxH);
+    const int mcuRows = (height + mcuHeight - 1) / mcuHeight;
+
+    // Find the restart markers in the entropy-coded data.
+    std::vector<IndexEntry> entries;
+    int restarts = 0;
+    while (pos + 1 < size) {
+        const uint8_t* ff = (const uint8_t*) memchr(&bytes[pos], 0xFF, size - pos - 1);
+        if (!ff) {
+            break;
+        }
+        pos = ff - bytes;
+        const uint8_t next = bytes[pos + 1];
+        if (0xFF == next) {
+            // A fill byte
+            pos++;
+            continue;
+        }
+        if (0x00 == next) {
+            // A stuffed 0xFF data byte
+            pos += 2;
+            continue;
+        }
+        if (next < 0xD0 || next > 0xD7) {
+            // EOI, or the end of the scan
+            break;
+        }
+
+        pos += 2;
+        restarts++;
+        const int64_t mcus = (int64_t) restarts * restartInterval;
+        if (0 == mcus % mcusPerRow) {
+            const int mcuRow = (int) (mcus / mcusPerRow);
+            if (mcuRow >= mcuRows) {
+                break;
+            }
+            entries.push_back({ mcuRow, restarts % 8, pos });
+        }
+    }
+    if (entries.empty()) {
+        return false;
+    }
+
+    fIndex = sk_make_sp<Index>();
+    fIndex->fData = std::move(data);
+    fIndex->fHeader.reset(headerSize);
+    memcpy(fIndex->fHeader.get(), bytes, headerSize);
+    fIndex->fHeaderSize = headerSize;
+    fIndex->fHeightOffset = heightOffset;
+    fIndex->fMCUHeight = mcuHeight;
+    fIndex->fEntries = std::move(entries);
+    return true;
+}
+
+bool SkJpegCodec::seekWithIndex(int row, int* count) {
+    jpeg_decompress_struct* dinfo = fDecoderMgr->dinfo();
+#if JPEG_LIB_VERSION >= 70
+    const int rowsPerMCURow = dinfo->max_v_samp_factor * dinfo->min_DCT_v_scaled_size;
+#else
+    const int rowsPerMCURow = dinfo->max_v_samp_factor * dinfo->min_DCT_scaled_size;
+#endif
+
+    // Upsampling the first MCU row after a seek has no context from the row above, so
+    // resume at least one MCU row before row, and skip past it.
+    const int lastMCURow = row / rowsPerMCURow - 1;
+    const std::vector<IndexEntry>& entries = fIndex->fEntries;
+    auto entry = std::upper_bound(entries.begin(), entries.end(), lastMCURow,
+            [](int mcuRow, const IndexEntry& e) { return mcuRow < e.fMCURow; });
+    if (entry == entries.begin()) {
+        return true;
+    }
+    --entry;
+    const int startRow = entry->fMCURow * rowsPerMCURow;
+    if (startRow <= this->currScanline()) {
+        return true;
+    }
+
+    // Pretend that the image begins at the entry.
+    if (!fSeekHeader.get()) {
+        fSeekHeader.reset(fIndex->fHeaderSize);
+        memcpy(fSeekHeader.get(), fIndex->fHeader.get(), fIndex->fHeaderSize);
+    }
+    const int height = this->getInfo().height() - entry->fMCURow * fIndex->fMCUHeight;
+    uint8_t* header = fSeekHeader.get();
+    header[fIndex->fHeightOffset] = (uint8_t) (height >> 8);
+    header[fIndex->fHeightOffset + 1] = (uint8_t) height;
+
+    // Restart libjpeg with the same output settings.
+    const J_COLOR_SPACE outColorSpace = dinfo->out_color_space;
+    const unsigned int scaleNum = dinfo->scale_num;
+    const unsigned int scaleDenom = dinfo->scale_denom;
+    const J_DITHER_MODE ditherMode = dinfo->dither_mode;
+    jpeg_abort_decompress(dinfo);
+    fDecoderMgr->useSeekSource(header, fIndex->fHeaderSize,
+                               fIndex->fData->bytes() + entry->fOffset,
+                               fIndex->fData->size() - entry->fOffset, entry->fRestart);
+    if (JPEG_HEADER_OK != jpeg_read_header(dinfo, true)) {
+        return false;
+    }
+    dinfo->out_color_space = outColorSpace;
+    dinfo->scale_num = scaleNum;
+    dinfo->scale_denom = scaleDenom;
+    dinfo->dither_mode = ditherMode;
+    if (!jpeg_start_decompress(dinfo)) {
+        return false;
+    }
+#ifdef TURBO_HAS_CROP
+    if (fCropWidth) {
+        uint32_t startX = fCropX;
+        uint32_t width = fCropWidth;
+        jpeg_crop_scanline(dinfo, &startX, &width);
+        SkASSERT(startX == fCropX && width == fCropWidth);
+    }
+#endif
+
+    *count = row - startRow;
+    return true;
+}
+
+SkCodec::Result SkJpegCodec::onStartIncrementalDecode(const SkImageInfo& dstInfo, void* dst,
+        size_t rowBytes, const Options& options, SkPMColor*, int*) {
+    if (options.fSubset) {
+        // Subsets are not supported.
+        return kUnimplemented;
+    }
+
+    // Set the jump location for libjpeg errors
+    if (setjmp(fDecoderMgr->getJmpBuf())) {
+        return fDecoderMgr->returnFailure("setjmp", kInvalidInput);
+    }
+
+    // Check if we can decode to the requested destination and set the output color space
+    bool needsColorXform = needs_color_xform(dstInfo, this->getInfo());
+    if (!this->setOutputColorSpace(dstInfo, needsColorXform)) {
+        return fDecoderMgr->returnFailure("setOutputColorSpace", kInvalidConversion);
+    }
+
+    if (!this->initializeColorXform(dstInfo, needsColorXform)) {
+        return fDecoderMgr->returnFailure("initializeColorXform", kInvalidParameters);
+    }
+
+    fDecoderMgr->useIncrementalSource();
+    fIncrementalDst = dst;
+    fIncrementalRowBytes = rowBytes;
+    fStartedDecompress = false;
+    return kSuccess;
+}
+
+SkCodec::Result SkJpegCodec::onIncrementalDecode(int* rowsDecoded) {
+    jpeg_decompress_struct* dinfo = fDecoderMgr->dinfo();
+    const SkImageInfo& dstInfo = this->dstInfo();
+
+    // Set the jump location for libjpeg errors
+    if (setjmp(fDecoderMgr->getJmpBuf())) {
+        return fDecoderMgr->returnFailure("setjmp", kInvalidInput);
+    }
+
+    // Each time libjpeg suspends, append whatever data has arrived and resume.
+    do {
+        if (!fStartedDecompress) {
+            // This suspends until all of the data is in for progressive jpegs.
+            if (!jpeg_start_decompress(dinfo)) {
+                continue;
+            }
+            fStartedDecompress = true;
+
+            // The recommended output buffer height should always be 1 in high quality modes.
+            // If it's not, we want to know because it means our strategy is not optimal.
+            SkASSERT(1 == dinfo->rec_outbuf_height);
+
+            J_COLOR_SPACE colorSpace = dinfo->out_color_space;
+            if (JCS_CMYK == colorSpace || JCS_RGB == colorSpace) {
+                this->initializeSwizzler(dstInfo, this->options());
+            }
+
+            this->allocateStorage(dstInfo);
+        }
+
+        const int row = dinfo->output_scanline;
+        void* dst = SkTAddOffset<void>(fIncrementalDst, row * fIncrementalRowBytes);
+        this->readRows(dstInfo, dst, fIncrementalRowBytes, dstInfo.height() - row);
+        if ((int) dinfo->output_scanline == dstInfo.height()) {
+            return kSuccess;
+        }
+    } while (fDecoderMgr->appendIncrementalData());
+
+    *rowsDecoded = fStartedDecompress ? dinfo->output_scanline : 0;
+    return kIncompleteInput;
+}
+
 static bool is_yuv_supported(jpeg_decompress_struct* dinfo) {
     // Scaling is not supported in raw data mode.
     SkASSERT(dinfo->scale_num == dinfo->scale_denom);
@@ -68,6 +68,8 @@ protected:
 
     sk_sp<SkData> getICCData() const override { return fICCData; }
 
+    bool onBuildIndex() override;
+
 private:
 
     /*
@@ -127,6 +129,28 @@ private:
     int onGetScanlines(void* dst, int count, size_t rowBytes) override;
     bool onSkipScanlines(int count) override;
 
+    /*
+     * Incremental decoding.
+     */
+    Result onStartIncrementalDecode(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
+            const Options& options, SkPMColor* ctable, int* ctableCount) override;
+    Result onIncrementalDecode(int* rowsDecoded) override;
+
+    /*
+     * Restart the scanline decode at the last indexed MCU row that ends above row, if
+     * that is below the current scanline.  Sets count to the number of rows that then
+     * need to be skipped to reach row.
+     */
+    bool seekWithIndex(int row, int* count);
+
+    /*
+     * If the client asked for threads and built an index, and there are cores to spare,
+     * decode horizontal bands of the image concurrently, each with its own codec.  Returns
+     * false if the image should be decoded serially instead.
+     */
+    bool decodeInBands(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
+            const Options& options);
+
     SkAutoTDelete<JpegDecoderMgr>      fDecoderMgr;
 
     // We will save the state of the decompress struct after reading the header.
@@ -148,10 +172,45 @@ private:
     
     sk_sp<SkData>                      fICCData;
 
+    // These are only meaningful during incremental decodes.
+    void*                              fIncrementalDst;
+    size_t                             fIncrementalRowBytes;
+    bool                               fStartedDecompress;
+
 #if !defined(TURBO_HAS_SKIP)
     SkAutoTMalloc<uint8_t>             fSkipStorage;
 #endif
 
+    // A place where decoding can resume: just past a restart marker that begins an MCU row.
+    struct IndexEntry {
+        int    fMCURow;
+        // The number of the next restart marker, which libjpeg will expect to be RST0.
+        int    fRestart;
+        size_t fOffset;
+    };
+
+    // Built by onBuildIndex(), and shared with the codecs that decode bands in parallel.
+    struct Index : public SkNVRefCnt<Index> {
+        sk_sp<SkData>           fData;
+        // Everything up to the start of the entropy-coded data.
+        SkAutoTMalloc<uint8_t>  fHeader;
+        size_t                  fHeaderSize;
+        size_t                  fHeightOffset;
+        int                     fMCUHeight;
+        std::vector<IndexEntry> fEntries;
+    };
+    sk_sp<Index>                       fIndex;
+    // A copy of fIndex->fHeader, with the frame height rewritten for each seek, so
+    // that libjpeg sees an image that starts at the entry.
+    SkAutoTMalloc<uint8_t>             fSeekHeader;
+
+#ifdef TURBO_HAS_CROP
+    // The columns libjpeg-turbo is cropping to, so that a seek can crop the same way.
+    // fCropWidth is zero if the scanline decode is not cropped.
+    uint32_t                           fCropX;
+    uint32_t                           fCropWidth;
+#endif
+
     typedef SkCodec INHERITED;
 };
 
@@ -59,6 +59,7 @@ bool JpegDecoderMgr::getEncodedColor(SkEncodedInfo::Color* outColor) {
 
 JpegDecoderMgr::JpegDecoderMgr(SkStream* stream)
     : fSrcMgr(stream)
+    , fIncrementalSrcMgr(stream)
     , fInit(false)
 {
     // Error manager must be set before any calls to libjeg in order to handle failures
@@ -86,3 +87,19 @@ jmp_buf& JpegDecoderMgr::getJmpBuf() {
 jpeg_decompress_struct* JpegDecoderMgr::dinfo() {
     return &fDInfo;
 }
+
+void JpegDecoderMgr::useIncrementalSource() {
+    fIncrementalSrcMgr.init(fSrcMgr);
+    fDInfo.src = &fIncrementalSrcMgr;
+}
+
+bool JpegDecoderMgr::appendIncrementalData() {
+    SkASSERT(&fIncrementalSrcMgr == fDInfo.src);
+    return fIncrementalSrcMgr.appendData();
+}
+
+void JpegDecoderMgr::useSeekSource(const uint8_t* header, size_t headerSize, const uint8_t* data,
+                                   size_t dataSize, int firstRestart) {
+    fSeekSrcMgr.init(header, headerSize, data, dataSize, firstRestart);
+    fDInfo.src = &fSeekSrcMgr;
+}
@@ -63,12 +63,36 @@ public:
      */
     jpeg_decompress_struct* dinfo();
 
+    /*
+     * Switch to a source manager that suspends libjpeg, rather than failing,
+     * when the stream runs out of data.  Data that has already been read from
+     * the stream is carried over.
+     */
+    void useIncrementalSource();
+
+    /*
+     * During an incremental decode, append newly arrived data from the stream.
+     * Returns false if there is no more data for now.
+     */
+    bool appendIncrementalData();
+
+    /*
+     * Switch to a source manager that reads the headers, and then the
+     * entropy-coded data starting partway through the image, from memory.
+     * The caller must abort any decompression in progress, and call
+     * jpeg_read_header() again.  See skjpeg_seek_source_mgr::init().
+     */
+    void useSeekSource(const uint8_t* header, size_t headerSize, const uint8_t* data,
+                       size_t dataSize, int firstRestart);
+
 private:
 
-    jpeg_decompress_struct fDInfo;
-    skjpeg_source_mgr      fSrcMgr;
-    skjpeg_error_mgr       fErrorMgr;
-    bool                   fInit;
+    jpeg_decompress_struct        fDInfo;
+    skjpeg_source_mgr             fSrcMgr;
+    skjpeg_incremental_source_mgr fIncrementalSrcMgr;
+    skjpeg_seek_source_mgr        fSeekSrcMgr;
+    skjpeg_error_mgr              fErrorMgr;
+    bool                          fInit;
 };
 
 #endif
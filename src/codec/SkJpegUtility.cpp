@@ -83,6 +83,87 @@ skjpeg_source_mgr::skjpeg_source_mgr(SkStream* stream)
     term_source = sk_term_source;
 }
 
+/*
+ * The incremental source manager starts with data from another source manager
+ */
+static void sk_init_incremental_source(j_decompress_ptr dinfo) {}
+
+/*
+ * Suspend the decode until more data arrives
+ */
+static boolean sk_suspend_input(j_decompress_ptr dinfo) {
+    return false;
+}
+
+/*
+ * Skip a certain number of bytes, which may not have arrived yet
+ */
+static void sk_skip_incremental_input_data(j_decompress_ptr dinfo, long numBytes) {
+    skjpeg_incremental_source_mgr* src = (skjpeg_incremental_source_mgr*) dinfo->src;
+    size_t bytes = (size_t) numBytes;
+
+    if (bytes > src->bytes_in_buffer) {
+        // libjpeg does not allow suspending here, so we will skip the rest when we append.
+        src->fBytesToSkip += bytes - src->bytes_in_buffer;
+        src->next_input_byte += src->bytes_in_buffer;
+        src->bytes_in_buffer = 0;
+    } else {
+        src->next_input_byte += numBytes;
+        src->bytes_in_buffer -= numBytes;
+    }
+}
+
+/*
+ * Constructor for the incremental source manager
+ */
+skjpeg_incremental_source_mgr::skjpeg_incremental_source_mgr(SkStream* stream)
+    : fStream(stream)
+    , fCapacity(0)
+    , fBytesToSkip(0)
+{
+    // init_source is only called before reading the header, which we have already done.
+    init_source = sk_init_incremental_source;
+    fill_input_buffer = sk_suspend_input;
+    skip_input_data = sk_skip_incremental_input_data;
+    resync_to_restart = jpeg_resync_to_restart;
+    term_source = sk_term_source;
+    next_input_byte = nullptr;
+    bytes_in_buffer = 0;
+}
+
+void skjpeg_incremental_source_mgr::init(const jpeg_source_mgr& src) {
+    fBytesToSkip = 0;
+    fCapacity = src.bytes_in_buffer + kBufferSize;
+    fBuffer.reset(fCapacity);
+    memcpy(fBuffer.get(), src.next_input_byte, src.bytes_in_buffer);
+    next_input_byte = fBuffer.get();
+    bytes_in_buffer = src.bytes_in_buffer;
+}
+
+bool skjpeg_incremental_source_mgr::appendData() {
+    if (fBytesToSkip > 0) {
+        fBytesToSkip -= fStream->skip(fBytesToSkip);
+        if (fBytesToSkip > 0) {
+            return false;
+        }
+    }
+
+    // Move the data libjpeg will resume from to the front, making room if an MCU or marker
+    // has outgrown the buffer.
+    const size_t offset = next_input_byte - fBuffer.get();
+    const size_t unconsumed = bytes_in_buffer;
+    if (unconsumed + kBufferSize > fCapacity) {
+        fCapacity = 2 * fCapacity;
+        fBuffer.realloc(fCapacity);
+    }
+    memmove(fBuffer.get(), fBuffer.get() + offset, unconsumed);
+
+    const size_t bytes = fStream->read(fBuffer.get() + unconsumed, kBufferSize);
+    next_input_byte = fBuffer.get();
+    bytes_in_buffer = unconsumed + bytes;
+    return bytes > 0;
+}
+
 /*
  * Call longjmp to continue execution on an error
  */
@@ -93,3 +174,103 @@ void skjpeg_err_exit(j_common_ptr dinfo) {
     (*error->output_message) (dinfo);
     longjmp(error->fJmpBuf, 1);
 }
+
+/*
+ * Start with the headers
+ */
+static void sk_seek_init_source(j_decompress_ptr dinfo) {
+    skjpeg_seek_source_mgr* src = (skjpeg_seek_source_mgr*) dinfo->src;
+    src->next_input_byte = (const JOCTET*) src->fHeader;
+    src->bytes_in_buffer = src->fHeaderSize;
+    src->fDataPos = 0;
+}
+
+static inline bool is_restart_marker(const uint8_t* ptr) {
+    return 0xFF == ptr[0] && ptr[1] >= JPEG_RST0 && ptr[1] <= JPEG_RST0 + 7;
+}
+
+/*
+ * Follow the headers with the entropy-coded data.  libjpeg expects the first restart
+ * marker it sees to be RST0, so hand out the data in pieces, renumbering each marker.
+ */
+static boolean sk_seek_fill_input_buffer(j_decompress_ptr dinfo) {
+    skjpeg_seek_source_mgr* src = (skjpeg_seek_source_mgr*) dinfo->src;
+    const uint8_t* data = src->fData;
+    const size_t size = src->fDataSize;
+    size_t pos = src->fDataPos;
+    if (pos >= size) {
+        // Suspend like skjpeg_source_mgr, so a truncated image is reported as incomplete.
+        return false;
+    }
+
+    if (pos + 1 < size && is_restart_marker(&data[pos])) {
+        src->fMarker[0] = 0xFF;
+        src->fMarker[1] = JPEG_RST0 + ((data[pos + 1] - JPEG_RST0 - src->fFirstRestart) & 7);
+        src->next_input_byte = src->fMarker;
+        src->bytes_in_buffer = sizeof(src->fMarker);
+        src->fDataPos = pos + 2;
+        return true;
+    }
+
+    // Stop at the next restart marker.
+    size_t end = pos;
+    while (true) {
+        const uint8_t* ff = (const uint8_t*) memchr(&data[end], 0xFF, size - end - 1);
+        if (!ff) {
+            end = size;
+            break;
+        }
+        end = ff - data;
+        if (is_restart_marker(ff)) {
+            break;
+        }
+        end++;
+    }
+
+    src->next_input_byte = (const JOCTET*) &data[pos];
+    src->bytes_in_buffer = end - pos;
+    src->fDataPos = end;
+    return true;
+}
+
+static void sk_seek_skip_input_data(j_decompress_ptr dinfo, long numBytes) {
+    skjpeg_seek_source_mgr* src = (skjpeg_seek_source_mgr*) dinfo->src;
+    size_t bytes = (size_t) numBytes;
+    while (bytes > src->bytes_in_buffer) {
+        bytes -= src->bytes_in_buffer;
+        if (!sk_seek_fill_input_buffer(dinfo)) {
+            SkCodecPrintf("Failure to skip.\n");
+            dinfo->err->error_exit((j_common_ptr) dinfo);
+            return;
+        }
+    }
+
+    src->next_input_byte += bytes;
+    src->bytes_in_buffer -= bytes;
+}
+
+skjpeg_seek_source_mgr::skjpeg_seek_source_mgr()
+    : fHeader(nullptr)
+    , fHeaderSize(0)
+    , fData(nullptr)
+    , fDataSize(0)
+    , fDataPos(0)
+    , fFirstRestart(0)
+{
+    init_source = sk_seek_init_source;
+    fill_input_buffer = sk_seek_fill_input_buffer;
+    skip_input_data = sk_seek_skip_input_data;
+    resync_to_restart = jpeg_resync_to_restart;
+    term_source = sk_term_source;
+    next_input_byte = nullptr;
+    bytes_in_buffer = 0;
+}
+
+void skjpeg_seek_source_mgr::init(const uint8_t* header, size_t headerSize, const uint8_t* data,
+                                  size_t dataSize, int firstRestart) {
+    fHeader = header;
+    fHeaderSize = headerSize;
+    fData = data;
+    fDataSize = dataSize;
+    fFirstRestart = firstRestart;
+}
@@ -10,6 +10,7 @@
 #define SkJpegUtility_codec_DEFINED
 
 #include "SkStream.h"
+#include "SkTemplates.h"
 
 #include <setjmp.h>
 // stdio is needed for jpeglib
@@ -47,4 +48,58 @@ struct skjpeg_source_mgr : jpeg_source_mgr {
     uint8_t fBuffer[kBufferSize];
 };
 
+/*
+ * Source manager for incremental decodes.  Rather than reading from the stream, this suspends
+ * libjpeg whenever it runs out of data.  libjpeg then backs up to the start of the marker or MCU
+ * it was reading, and we keep the data from there on when appending more from the stream.
+ */
+struct skjpeg_incremental_source_mgr : jpeg_source_mgr {
+    skjpeg_incremental_source_mgr(SkStream* stream);
+
+    /*
+     * Take over from src, keeping any data that libjpeg has not consumed yet.
+     */
+    void init(const jpeg_source_mgr& src);
+
+    /*
+     * Append up to kBufferSize bytes from the stream to the unconsumed data.
+     * Returns false if the stream has no more data for now.
+     */
+    bool appendData();
+
+    SkStream* fStream; // unowned
+    enum {
+        kBufferSize = 4096
+    };
+    SkAutoTMalloc<uint8_t> fBuffer;
+    size_t                 fCapacity;
+    // Bytes that libjpeg asked to skip, but that have not arrived yet.
+    size_t                 fBytesToSkip;
+};
+
+/*
+ * Source manager that starts a decode partway down the image.  It hands libjpeg the
+ * headers, followed by the entropy-coded data from just after a restart marker.  Both
+ * are in memory, and are not owned.
+ */
+struct skjpeg_seek_source_mgr : jpeg_source_mgr {
+    skjpeg_seek_source_mgr();
+
+    /*
+     * firstRestart is the number (0-7) of the first restart marker in data.  It is
+     * renumbered to RST0, and the markers after it to match.
+     */
+    void init(const uint8_t* header, size_t headerSize, const uint8_t* data, size_t dataSize,
+              int firstRestart);
+
+    const uint8_t* fHeader;
+    size_t         fHeaderSize;
+    const uint8_t* fData;
+    size_t         fDataSize;
+    // How much of fData has been given to libjpeg.
+    size_t         fDataPos;
+    int            fFirstRestart;
+    uint8_t        fMarker[2];
+};
+
 #endif
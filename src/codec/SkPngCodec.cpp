@@ -9,6 +9,7 @@
 #include "SkCodecPriv.h"
 #include "SkColorPriv.h"
 #include "SkColorSpace_Base.h"
+#include "SkColorSpaceXform.h"
 #include "SkColorTable.h"
 #include "SkMath.h"
 #include "SkOpts.h"
@@ -341,6 +342,14 @@ static int bytes_per_pixel(int bitsPerPixel) {
     return bitsPerPixel / 8;
 }
 
+// Like conversion_possible(), but also allows F16, which we reach with a color xform.
+static bool png_conversion_possible(const SkImageInfo& dst, const SkImageInfo& src) {
+    if (kRGBA_F16_SkColorType == dst.colorType()) {
+        return valid_alpha(dst.alphaType(), src.alphaType());
+    }
+    return conversion_possible(dst, src);
+}
+
 // Subclass of SkPngCodec which supports scanline decoding
 class SkPngScanlineDecoder : public SkPngCodec {
 public:
@@ -354,7 +363,7 @@ public:
 
     Result onStartScanlineDecode(const SkImageInfo& dstInfo, const Options& options,
             SkPMColor ctable[], int* ctableCount) override {
-        if (!conversion_possible(dstInfo, this->getInfo())) {
+        if (!png_conversion_possible(dstInfo, this->getInfo())) {
             return kInvalidConversion;
         }
 
@@ -425,7 +434,7 @@ public:
 
     Result onStartScanlineDecode(const SkImageInfo& dstInfo, const Options& options,
             SkPMColor ctable[], int* ctableCount) override {
-        if (!conversion_possible(dstInfo, this->getInfo())) {
+        if (!png_conversion_possible(dstInfo, this->getInfo())) {
             return kInvalidConversion;
         }
 
@@ -476,7 +485,12 @@ public:
             // fail on the first pass, we can still report than some scanlines are initialized.
             return 0;
         }
-        SkAutoTMalloc<uint8_t> storage(count * fSrcRowBytes);
+        // When sampling, the caller only keeps every sampleY'th row, so we only store and
+        // swizzle those.  The rest are read into the garbage row, like the rows outside of
+        // [startRow, startRow + count).
+        const int sampleY = this->swizzler()->sampleY();
+        const int keptRows = (count + sampleY - 1) / sampleY;
+        SkAutoTMalloc<uint8_t> storage(keptRows * fSrcRowBytes);
         uint8_t* storagePtr = storage.get();
         uint8_t* srcRow;
         const int startRow = this->nextScanline();
@@ -488,8 +502,12 @@ public:
             // read rows we care about into buffer
             srcRow = storagePtr;
             for (int y = 0; y < count; y++) {
-                png_read_row(this->png_ptr(), srcRow, nullptr);
-                srcRow += fSrcRowBytes;
+                if (0 == y % sampleY) {
+                    png_read_row(this->png_ptr(), srcRow, nullptr);
+                    srcRow += fSrcRowBytes;
+                } else {
+                    png_read_row(this->png_ptr(), fGarbageRowPtr, nullptr);
+                }
             }
             // read rows we don't want into garbage buffer
             for (int y = 0; y < fHeight - startRow - count; y++) {
@@ -499,9 +517,10 @@ public:
         //swizzle the rows we care about
         srcRow = storagePtr;
         void* dstRow = dst;
-        for (int y = 0; y < count; y++) {
+        const size_t dstSampledRowBytes = sampleY * dstRowBytes;
+        for (int y = 0; y < keptRows; y++) {
             this->swizzler()->swizzle(dstRow, srcRow);
-            dstRow = SkTAddOffset<void>(dstRow, dstRowBytes);
+            dstRow = SkTAddOffset<void>(dstRow, dstSampledRowBytes);
             srcRow += fSrcRowBytes;
         }
 
@@ -535,65 +554,24 @@ private:
     typedef SkPngCodec INHERITED;
 };
 
-// Reads the header and initializes the output fields, if not NULL.
-//
-// @param stream Input data. Will be read to get enough information to properly
-//      setup the codec.
-// @param chunkReader SkPngChunkReader, for reading unknown chunks. May be NULL.
-//      If not NULL, png_ptr will hold an *unowned* pointer to it. The caller is
-//      expected to continue to own it for the lifetime of the png_ptr.
-// @param outCodec Optional output variable.  If non-NULL, will be set to a new
-//      SkPngCodec on success.
-// @param png_ptrp Optional output variable. If non-NULL, will be set to a new
-//      png_structp on success.
-// @param info_ptrp Optional output variable. If non-NULL, will be set to a new
-//      png_infop on success;
-// @return true on success, in which case the caller is responsible for calling
-//      png_destroy_read_struct(png_ptrp, info_ptrp).
-//      If it returns false, the passed in fields (except stream) are unchanged.
-static bool read_header(SkStream* stream, SkPngChunkReader* chunkReader, SkCodec** outCodec,
-                        png_structp* png_ptrp, png_infop* info_ptrp) {
-    // The image is known to be a PNG. Decode enough to know the SkImageInfo.
-    png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr,
-                                                 sk_error_fn, sk_warning_fn);
-    if (!png_ptr) {
-        return false;
-    }
-
-    AutoCleanPng autoClean(png_ptr);
-
-    png_infop info_ptr = png_create_info_struct(png_ptr);
-    if (info_ptr == nullptr) {
-        return false;
-    }
-
-    autoClean.setInfoPtr(info_ptr);
-
-    // FIXME: Could we use the return value of setjmp to specify the type of
-    // error?
-    if (setjmp(png_jmpbuf(png_ptr))) {
-        return false;
-    }
-
-    png_set_read_fn(png_ptr, static_cast<void*>(stream), sk_read_fn);
-
+// Hookup our chunkReader so we can see any user-chunks the caller may be interested in.
+// This needs to be installed before we read the png header.  Android may store ninepatch
+// chunks in the header.
+static void set_chunk_reader(png_structp png_ptr, SkPngChunkReader* chunkReader) {
 #ifdef PNG_READ_UNKNOWN_CHUNKS_SUPPORTED
-    // Hookup our chunkReader so we can see any user-chunks the caller may be interested in.
-    // This needs to be installed before we read the png header.  Android may store ninepatch
-    // chunks in the header.
     if (chunkReader) {
         png_set_keep_unknown_chunks(png_ptr, PNG_HANDLE_CHUNK_ALWAYS, (png_byte*)"", 0);
         png_set_read_user_chunk_fn(png_ptr, (png_voidp) chunkReader, sk_read_user_chunk);
     }
 #endif
+}
 
-    // The call to png_read_info() gives us all of the information from the
-    // PNG file before the first IDAT (image data chunk).
-    png_read_info(png_ptr, info_ptr);
-    png_uint_32 origWidth, origHeight;
-    int bitDepth, encodedColorType;
-    png_get_IHDR(png_ptr, info_ptr, &origWidth, &origHeight, &bitDepth,
-                 &encodedColorType, nullptr, nullptr, nullptr);
+// Sets the transforms we need from libpng, and reports the color and alpha of the rows it
+// will produce.  Returns the number of passes needed to read the image.
+static int set_transforms(png_structp png_ptr, png_infop info_ptr, SkEncodedInfo::Color* color,
+                          SkEncodedInfo::Alpha* alpha) {
+    int bitDepth = png_get_bit_depth(png_ptr, info_ptr);
+    int encodedColorType = png_get_color_type(png_ptr, info_ptr);
 
     // Tell libpng to strip 16 bit/color files down to 8 bits/color.
     // TODO: Should we handle this in SkSwizzler?  Could this also benefit
@@ -606,8 +584,6 @@ static bool read_header(SkStream* stream, SkPngChunkReader* chunkReader, SkCodec
     // Now determine the default colorType and alphaType and set the required transforms.
     // Often, we depend on SkSwizzler to perform any transforms that we need.  However, we
     // still depend on libpng for many of the rare and PNG-specific cases.
-    SkEncodedInfo::Color color;
-    SkEncodedInfo::Alpha alpha;
     switch (encodedColorType) {
         case PNG_COLOR_TYPE_PALETTE:
             // Extract multiple pixels with bit depths of 1, 2, and 4 from a single
@@ -617,20 +593,20 @@ static bool read_header(SkStream* stream, SkPngChunkReader* chunkReader, SkCodec
                 png_set_packing(png_ptr);
             }
 
-            color = SkEncodedInfo::kPalette_Color;
+            *color = SkEncodedInfo::kPalette_Color;
             // Set the alpha depending on if a transparency chunk exists.
-            alpha = png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS) ?
+            *alpha = png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS) ?
                     SkEncodedInfo::kUnpremul_Alpha : SkEncodedInfo::kOpaque_Alpha;
             break;
         case PNG_COLOR_TYPE_RGB:
             if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
                 // Convert to RGBA if transparency chunk exists.
                 png_set_tRNS_to_alpha(png_ptr);
-                color = SkEncodedInfo::kRGBA_Color;
-                alpha = SkEncodedInfo::kBinary_Alpha;
+                *color = SkEncodedInfo::kRGBA_Color;
+                *alpha = SkEncodedInfo::kBinary_Alpha;
             } else {
-                color = SkEncodedInfo::kRGB_Color;
-                alpha = SkEncodedInfo::kOpaque_Alpha;
+                *color = SkEncodedInfo::kRGB_Color;
+                *alpha = SkEncodedInfo::kOpaque_Alpha;
             }
             break;
         case PNG_COLOR_TYPE_GRAY:
@@ -642,29 +618,86 @@ static bool read_header(SkStream* stream, SkPngChunkReader* chunkReader, SkCodec
 
             if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
                 png_set_tRNS_to_alpha(png_ptr);
-                color = SkEncodedInfo::kGrayAlpha_Color;
-                alpha = SkEncodedInfo::kBinary_Alpha;
+                *color = SkEncodedInfo::kGrayAlpha_Color;
+                *alpha = SkEncodedInfo::kBinary_Alpha;
             } else {
-                color = SkEncodedInfo::kGray_Color;
-                alpha = SkEncodedInfo::kOpaque_Alpha;
+                *color = SkEncodedInfo::kGray_Color;
+                *alpha = SkEncodedInfo::kOpaque_Alpha;
             }
             break;
         case PNG_COLOR_TYPE_GRAY_ALPHA:
-            color = SkEncodedInfo::kGrayAlpha_Color;
-            alpha = SkEncodedInfo::kUnpremul_Alpha;
+            *color = SkEncodedInfo::kGrayAlpha_Color;
+            *alpha = SkEncodedInfo::kUnpremul_Alpha;
             break;
         case PNG_COLOR_TYPE_RGBA:
-            color = SkEncodedInfo::kRGBA_Color;
-            alpha = SkEncodedInfo::kUnpremul_Alpha;
+            *color = SkEncodedInfo::kRGBA_Color;
+            *alpha = SkEncodedInfo::kUnpremul_Alpha;
             break;
         default:
             // All the color types have been covered above.
             SkASSERT(false);
-            color = SkEncodedInfo::kRGBA_Color;
-            alpha = SkEncodedInfo::kUnpremul_Alpha;
+            *color = SkEncodedInfo::kRGBA_Color;
+            *alpha = SkEncodedInfo::kUnpremul_Alpha;
     }
 
-    int numberPasses = png_set_interlace_handling(png_ptr);
+    return png_set_interlace_handling(png_ptr);
+}
+
+// Reads the header and initializes the output fields, if not NULL.
+//
+// @param stream Input data. Will be read to get enough information to properly
+//      setup the codec.
+// @param chunkReader SkPngChunkReader, for reading unknown chunks. May be NULL.
+//      If not NULL, png_ptr will hold an *unowned* pointer to it. The caller is
+//      expected to continue to own it for the lifetime of the png_ptr.
+// @param outCodec Optional output variable.  If non-NULL, will be set to a new
+//      SkPngCodec on success.
+// @param png_ptrp Optional output variable. If non-NULL, will be set to a new
+//      png_structp on success.
+// @param info_ptrp Optional output variable. If non-NULL, will be set to a new
+//      png_infop on success;
+// @return true on success, in which case the caller is responsible for calling
+//      png_destroy_read_struct(png_ptrp, info_ptrp).
+//      If it returns false, the passed in fields (except stream) are unchanged.
+static bool read_header(SkStream* stream, SkPngChunkReader* chunkReader, SkCodec** outCodec,
+                        png_structp* png_ptrp, png_infop* info_ptrp) {
+    // The image is known to be a PNG. Decode enough to know the SkImageInfo.
+    png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr,
+                                                 sk_error_fn, sk_warning_fn);
+    if (!png_ptr) {
+        return false;
+    }
+
+    AutoCleanPng autoClean(png_ptr);
+
+    png_infop info_ptr = png_create_info_struct(png_ptr);
+    if (info_ptr == nullptr) {
+        return false;
+    }
+
+    autoClean.setInfoPtr(info_ptr);
+
+    // FIXME: Could we use the return value of setjmp to specify the type of
+    // error?
+    if (setjmp(png_jmpbuf(png_ptr))) {
+        return false;
+    }
+
+    png_set_read_fn(png_ptr, static_cast<void*>(stream), sk_read_fn);
+
+    set_chunk_reader(png_ptr, chunkReader);
+
+    // The call to png_read_info() gives us all of the information from the
+    // PNG file before the first IDAT (image data chunk).
+    png_read_info(png_ptr, info_ptr);
+    png_uint_32 origWidth, origHeight;
+    int bitDepth, encodedColorType;
+    png_get_IHDR(png_ptr, info_ptr, &origWidth, &origHeight, &bitDepth,
+                 &encodedColorType, nullptr, nullptr, nullptr);
+
+    SkEncodedInfo::Color color;
+    SkEncodedInfo::Alpha alpha;
+    int numberPasses = set_transforms(png_ptr, info_ptr, &color, &alpha);
 
     autoClean.release();
     if (png_ptrp) {
@@ -704,6 +737,14 @@ SkPngCodec::SkPngCodec(int width, int height, const SkEncodedInfo& info, SkStrea
     , fInfo_ptr(info_ptr)
     , fNumberPasses(numberPasses)
     , fBitDepth(bitDepth)
+    , fIncrementalDst(nullptr)
+    , fIncrementalRowBytes(0)
+    , fSrcRowBytes(0)
+    , fFirstChangedRow(0)
+    , fLastChangedRow(-1)
+    , fRowsDecoded(0)
+    , fReadInfo(false)
+    , fReadEnd(false)
 {}
 
 SkPngCodec::~SkPngCodec() {
@@ -736,9 +777,38 @@ SkCodec::Result SkPngCodec::initializeSwizzler(const SkImageInfo& requestedInfo,
     }
     png_read_update_info(fPng_ptr, fInfo_ptr);
 
+    return this->createSwizzler(requestedInfo, options, ctable, ctableCount);
+}
+
+SkCodec::Result SkPngCodec::createSwizzler(const SkImageInfo& requestedInfo,
+                                           const Options& options,
+                                           SkPMColor ctable[],
+                                           int* ctableCount) {
+    fColorXform = nullptr;
+    if (needs_color_xform(requestedInfo, this->getInfo())) {
+        switch (requestedInfo.colorType()) {
+            case kRGBA_8888_SkColorType:
+            case kBGRA_8888_SkColorType:
+            case kRGBA_F16_SkColorType:
+                break;
+            default:
+                return kInvalidConversion;
+        }
+
+        fColorXform = SkColorSpaceXform::New(sk_ref_sp(this->getInfo().colorSpace()),
+                                             sk_ref_sp(requestedInfo.colorSpace()));
+        if (!fColorXform && kRGBA_F16_SkColorType == requestedInfo.colorType()) {
+            return kInvalidConversion;
+        }
+    }
+
     if (SkEncodedInfo::kPalette_Color == this->getEncodedInfo().color()) {
-        if (!this->createColorTable(requestedInfo.colorType(),
-                kPremul_SkAlphaType == requestedInfo.alphaType(), ctableCount)) {
+        // The swizzler hands the color xform unpremultiplied RGBA.
+        const SkColorType ctableColorType = fColorXform ? kRGBA_8888_SkColorType
+                                                        : requestedInfo.colorType();
+        const bool premultiply = !fColorXform &&
+                kPremul_SkAlphaType == requestedInfo.alphaType();
+        if (!this->createColorTable(ctableColorType, premultiply, ctableCount)) {
             return kInvalidInput;
         }
     }
@@ -746,10 +816,11 @@ SkCodec::Result SkPngCodec::initializeSwizzler(const SkImageInfo& requestedInfo,
     // Copy the color table to the client if they request kIndex8 mode
     copy_color_table(requestedInfo, fColorTable, ctable, ctableCount);
 
-    // Create the swizzler.  SkPngCodec retains ownership of the color table.
+    // Create the swizzler.  SkPngCodec retains ownership of the color table.  The swizzler
+    // applies the color xform, if any, as it writes each row.
     const SkPMColor* colors = get_color_ptr(fColorTable.get());
     fSwizzler.reset(SkSwizzler::CreateSwizzler(this->getEncodedInfo(), colors, requestedInfo,
-            options));
+            options, nullptr, false, fColorXform.get()));
     SkASSERT(fSwizzler);
 
     return kSuccess;
@@ -779,7 +850,7 @@ SkCodec::Result SkPngCodec::onGetPixels(const SkImageInfo& requestedInfo, void*
                                         size_t dstRowBytes, const Options& options,
                                         SkPMColor ctable[], int* ctableCount,
                                         int* rowsDecoded) {
-    if (!conversion_possible(requestedInfo, this->getInfo())) {
+    if (!png_conversion_possible(requestedInfo, this->getInfo())) {
         return kInvalidConversion;
     }
     if (options.fSubset) {
@@ -806,7 +877,8 @@ SkCodec::Result SkPngCodec::onGetPixels(const SkImageInfo& requestedInfo, void*
     if (setjmp(png_jmpbuf(fPng_ptr))) {
         // Assume that any error that occurs while reading rows is caused by an incomplete input.
         if (fNumberPasses > 1) {
-            // FIXME (msarett): Handle incomplete interlaced pngs.
+            // FIXME (msarett): Handle incomplete interlaced pngs.  Clients that need them can
+            // use incrementalDecode(), which reports the rows from the passes it has read.
             return (row == height) ? kSuccess : kInvalidInput;
         }
         // FIXME: We do a poor job on incomplete pngs compared to other decoders (ex: Chromium,
@@ -861,9 +933,171 @@ SkCodec::Result SkPngCodec::onGetPixels(const SkImageInfo& requestedInfo, void*
     return kSuccess;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Incremental decoding
+///////////////////////////////////////////////////////////////////////////////
+
+// The amount of data we hand to libpng's progressive reader at a time.  This size is arbitrary.
+static const size_t kIncrementalBufferSize = 4096;
+
+void SkPngCodec::InfoCallback(png_structp png_ptr, png_infop info_ptr) {
+    SkPngCodec* codec = static_cast<SkPngCodec*>(png_get_progressive_ptr(png_ptr));
+
+    // These match the transforms read_header() set up when the codec was created.
+    SkEncodedInfo::Color color;
+    SkEncodedInfo::Alpha alpha;
+    set_transforms(png_ptr, info_ptr, &color, &alpha);
+    png_read_update_info(png_ptr, info_ptr);
+    codec->fReadInfo = true;
+
+    // Return to onStartIncrementalDecode() so it can set up the swizzler before any rows
+    // arrive.  libpng saves the rest of the data it was given for next time.
+    png_process_data_pause(png_ptr, 1);
+}
+
+void SkPngCodec::RowCallback(png_structp png_ptr, png_bytep row, png_uint_32 rowNum, int pass) {
+    SkPngCodec* codec = static_cast<SkPngCodec*>(png_get_progressive_ptr(png_ptr));
+
+    // Interlaced images have rows with no new data in some passes.
+    if (!row) {
+        return;
+    }
+
+    const int y = (int) rowNum;
+    if (codec->fNumberPasses > 1) {
+        // libpng fills in the pixels of later passes with blocks of this pass's pixels, so the
+        // rows we have so far show a coarse version of the image.
+        uint8_t* srcRow = codec->fInterlaceBuffer.get() + y * codec->fSrcRowBytes;
+        png_progressive_combine_row(png_ptr, srcRow, row);
+        codec->fFirstChangedRow = SkTMin(codec->fFirstChangedRow, y);
+        codec->fLastChangedRow = SkTMax(codec->fLastChangedRow, y);
+    } else {
+        void* dstRow = SkTAddOffset<void>(codec->fIncrementalDst, y * codec->fIncrementalRowBytes);
+        codec->fSwizzler->swizzle(dstRow, row);
+    }
+    codec->fRowsDecoded = SkTMax(codec->fRowsDecoded, y + 1);
+}
+
+void SkPngCodec::EndCallback(png_structp png_ptr, png_infop) {
+    SkPngCodec* codec = static_cast<SkPngCodec*>(png_get_progressive_ptr(png_ptr));
+    codec->fReadEnd = true;
+}
+
+SkCodec::Result SkPngCodec::onStartIncrementalDecode(const SkImageInfo& dstInfo, void* dst,
+                                                     size_t rowBytes, const Options& options,
+                                                     SkPMColor ctable[], int* ctableCount) {
+    if (!png_conversion_possible(dstInfo, this->getInfo())) {
+        return kInvalidConversion;
+    }
+    if (options.fSubset) {
+        // Subsets are not supported.
+        return kUnimplemented;
+    }
+
+    // The progressive reader needs to see the header, which read_header() has already read.
+    if (!this->stream()->rewind()) {
+        return kCouldNotRewind;
+    }
+
+    // If this fails, fPng_ptr and fInfo_ptr are left as nullptr, and onRewind() will create
+    // them again before the next decode.
+    this->destroyReadStruct();
+    png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr,
+                                                 sk_error_fn, sk_warning_fn);
+    if (!png_ptr) {
+        return kInvalidInput;
+    }
+    png_infop info_ptr = png_create_info_struct(png_ptr);
+    if (!info_ptr) {
+        png_destroy_read_struct(&png_ptr, nullptr, nullptr);
+        return kInvalidInput;
+    }
+    fPng_ptr = png_ptr;
+    fInfo_ptr = info_ptr;
+
+    if (setjmp(png_jmpbuf(fPng_ptr))) {
+        SkCodecPrintf("setjmp long jump!\n");
+        return kInvalidInput;
+    }
+
+    png_set_progressive_read_fn(fPng_ptr, this, InfoCallback, RowCallback, EndCallback);
+    set_chunk_reader(fPng_ptr, fPngChunkReader.get());
+
+    fIncrementalDst = dst;
+    fIncrementalRowBytes = rowBytes;
+    fFirstChangedRow = dstInfo.height();
+    fLastChangedRow = -1;
+    fRowsDecoded = 0;
+    fReadInfo = false;
+    fReadEnd = false;
+
+    // The header was all there when the codec was created.
+    uint8_t buffer[kIncrementalBufferSize];
+    while (!fReadInfo) {
+        const size_t bytes = this->stream()->read(buffer, sizeof(buffer));
+        if (0 == bytes) {
+            return kInvalidInput;
+        }
+        png_process_data(fPng_ptr, fInfo_ptr, buffer, bytes);
+    }
+
+    // Note that ctable and ctableCount may be modified if there is a color table
+    const Result result = this->createSwizzler(dstInfo, options, ctable, ctableCount);
+    if (result != kSuccess) {
+        return result;
+    }
+
+    if (fNumberPasses > 1) {
+        fSrcRowBytes = dstInfo.width() * bytes_per_pixel(this->getEncodedInfo().bitsPerPixel());
+        fInterlaceBuffer.reset(dstInfo.height() * fSrcRowBytes);
+    }
+    return kSuccess;
+}
+
+void SkPngCodec::processData() {
+    // Start with any data libpng saved when it paused after the header.
+    png_process_data(fPng_ptr, fInfo_ptr, nullptr, 0);
+
+    uint8_t buffer[kIncrementalBufferSize];
+    while (!fReadEnd) {
+        const size_t bytes = this->stream()->read(buffer, sizeof(buffer));
+        if (0 == bytes) {
+            // The stream has no more data for now.
+            break;
+        }
+        png_process_data(fPng_ptr, fInfo_ptr, buffer, bytes);
+    }
+}
+
+void SkPngCodec::swizzleInterlacedRows() {
+    for (int y = fFirstChangedRow; y <= fLastChangedRow; y++) {
+        void* dstRow = SkTAddOffset<void>(fIncrementalDst, y * fIncrementalRowBytes);
+        fSwizzler->swizzle(dstRow, fInterlaceBuffer.get() + y * fSrcRowBytes);
+    }
+    fFirstChangedRow = this->getInfo().height();
+    fLastChangedRow = -1;
+}
+
+SkCodec::Result SkPngCodec::onIncrementalDecode(int* rowsDecoded) {
+    if (setjmp(png_jmpbuf(fPng_ptr))) {
+        SkCodecPrintf("setjmp long jump!\n");
+        return kInvalidInput;
+    }
+
+    this->processData();
+    this->swizzleInterlacedRows();
+    if (fReadEnd) {
+        return kSuccess;
+    }
+
+    *rowsDecoded = fRowsDecoded;
+    return kIncompleteInput;
+}
+
 uint32_t SkPngCodec::onGetFillValue(SkColorType colorType) const {
     const SkPMColor* colorPtr = get_color_ptr(fColorTable.get());
-    if (colorPtr) {
+    // With a color xform, the color table holds untransformed, unpremultiplied colors.
+    if (colorPtr && !fColorXform) {
         return get_color_table_fill_value(colorType, colorPtr, 0);
     }
     return INHERITED::onGetFillValue(colorType);
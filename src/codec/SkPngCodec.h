@@ -6,12 +6,14 @@
  */
 
 #include "SkCodec.h"
+#include "SkColorSpaceXform.h"
 #include "SkColorTable.h"
 #include "SkPngChunkReader.h"
 #include "SkEncodedFormat.h"
 #include "SkImageInfo.h"
 #include "SkRefCnt.h"
 #include "SkSwizzler.h"
+#include "SkTemplates.h"
 
 #include "png.h"
 
@@ -36,6 +38,9 @@ protected:
     // Helper to set up swizzler and color table. Also calls png_read_update_info.
     Result initializeSwizzler(const SkImageInfo& requestedInfo, const Options&,
                               SkPMColor*, int* ctableCount);
+    // Same as above, for when png_read_update_info has already been called.
+    Result createSwizzler(const SkImageInfo& requestedInfo, const Options&,
+                          SkPMColor*, int* ctableCount);
     SkSampler* getSampler(bool createIfNecessary) override {
         SkASSERT(fSwizzler);
         return fSwizzler;
@@ -49,6 +54,20 @@ protected:
     int numberPasses() const { return fNumberPasses; }
 
 private:
+    Result onStartIncrementalDecode(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
+            const Options&, SkPMColor* ctable, int* ctableCount) override;
+    Result onIncrementalDecode(int* rowsDecoded) override;
+
+    // Hands whatever the stream currently holds to libpng's progressive reader.
+    void processData();
+    // Swizzles the interlaced rows that have changed since the last call.
+    void swizzleInterlacedRows();
+
+    // Callbacks for libpng's progressive reader.
+    static void InfoCallback(png_structp, png_infop);
+    static void RowCallback(png_structp, png_bytep row, png_uint_32 rowNum, int pass);
+    static void EndCallback(png_structp, png_infop);
+
     SkAutoTUnref<SkPngChunkReader>  fPngChunkReader;
     png_structp                     fPng_ptr;
     png_infop                       fInfo_ptr;
@@ -56,10 +75,24 @@ private:
     // These are stored here so they can be used both by normal decoding and scanline decoding.
     SkAutoTUnref<SkColorTable>      fColorTable;    // May be unpremul.
     SkAutoTDelete<SkSwizzler>       fSwizzler;
+    std::unique_ptr<SkColorSpaceXform> fColorXform;   // Used by fSwizzler.
 
     const int                       fNumberPasses;
     int                             fBitDepth;
 
+    // These are only meaningful during incremental decodes.
+    void*                           fIncrementalDst;
+    size_t                          fIncrementalRowBytes;
+    // Interlaced images are combined here, one row per source row, and
+    // swizzled to fIncrementalDst as rows change.
+    SkAutoTMalloc<uint8_t>          fInterlaceBuffer;
+    size_t                          fSrcRowBytes;
+    int                             fFirstChangedRow;
+    int                             fLastChangedRow;
+    int                             fRowsDecoded;
+    bool                            fReadInfo;
+    bool                            fReadEnd;
+
     bool createColorTable(SkColorType dstColorType, bool premultiply, int* ctableCount);
     void destroyReadStruct();
 
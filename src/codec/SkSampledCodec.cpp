@@ -269,6 +269,9 @@ SkCodec::Result SkSampledCodec::sampledDecode(const SkImageInfo& info, void* pix
         case SkCodec::kNone_SkScanlineOrder: {
             const int linesNeeded = subsetHeight - samplingOffsetY;
             SkAutoTMalloc<uint8_t> storage(linesNeeded * rowBytes);
+            // We only copy every sampleY'th line out of storage, so the codec need not write
+            // the others.
+            sampler->setSampleY(sampleY);
             uint8_t* storagePtr = storage.get();
 
             if (!this->codec()->skipScanlines(startY)) {
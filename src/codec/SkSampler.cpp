@@ -7,6 +7,7 @@
 
 #include "SkCodec.h"
 #include "SkCodecPriv.h"
+#include "SkPM4f.h"
 #include "SkSampler.h"
 #include "SkUtils.h"
 
@@ -77,6 +78,20 @@ void SkSampler::Fill(const SkImageInfo& info, void* dst, size_t rowBytes,
             }
             break;
         }
+        case kRGBA_F16_SkColorType: {
+            // The fill value is an SkPMColor.
+            if (SkCodec::kYes_ZeroInitialized == zeroInit && 0 == colorOrIndex) {
+                return;
+            }
+
+            const uint64_t color = SkPM4f::FromPMColor(colorOrIndex).toF16();
+            uint64_t* dstRow = (uint64_t*) dst;
+            for (int row = 0; row < numRows; row++) {
+                sk_memset64(dstRow, color, width);
+                dstRow = SkTAddOffset<uint64_t>(dstRow, rowBytes);
+            }
+            break;
+        }
         case kIndex_8_SkColorType:
             // On an index destination color type, always assume the input is an index.
             // Fall through
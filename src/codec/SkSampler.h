@@ -20,6 +20,18 @@ public:
         return this->onSetSampleX(sampleX);
     }
 
+    /**
+     *  Tell the sampler that of the rows written by a single getScanlines() call, only every
+     *  sampleY'th one, starting with the first, will be kept.  Codecs that must decode all of
+     *  those rows at once (kNone_SkScanlineOrder) may then skip writing the others.
+     *
+     *  Returns false if the sampler ignores this, in which case every row is written.
+     */
+    bool setSampleY(int sampleY) {
+        SkASSERT(sampleY > 0);
+        return this->onSetSampleY(sampleY);
+    }
+
     /**
      * Fill the remainder of the destination with a single color
      *
@@ -58,6 +70,7 @@ public:
 private:
 
     virtual int onSetSampleX(int) = 0;
+    virtual bool onSetSampleY(int) { return false; }
 };
 
 #endif // SkSampler_DEFINED
@@ -7,6 +7,7 @@
 
 #include "SkCodecPriv.h"
 #include "SkColorPriv.h"
+#include "SkColorSpaceXform.h"
 #include "SkOpts.h"
 #include "SkSwizzler.h"
 #include "SkTemplates.h"
@@ -652,15 +653,41 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                                        const SkImageInfo& dstInfo,
                                        const SkCodec::Options& options,
                                        const SkIRect* frame,
-                                       bool preSwizzled) {
+                                       bool preSwizzled,
+                                       SkColorSpaceXform* colorXform) {
     if (SkEncodedInfo::kPalette_Color == encodedInfo.color() && nullptr == ctable) {
         return nullptr;
     }
 
+    // With a color xform, the row procs write unpremultiplied RGBA for the xform to read,
+    // and the xform premultiplies as it stores.
+    SkImageInfo procInfo = dstInfo;
+    SkCodec::ZeroInitialized zeroInit = options.fZeroInitialized;
+    SkAlphaType xformAlphaType = kUnpremul_SkAlphaType;
+    if (colorXform) {
+        switch (dstInfo.colorType()) {
+            case kRGBA_8888_SkColorType:
+            case kBGRA_8888_SkColorType:
+            case kRGBA_F16_SkColorType:
+                break;
+            default:
+                return nullptr;
+        }
+
+        if (SkEncodedInfo::kOpaque_Alpha != encodedInfo.alpha() &&
+                kPremul_SkAlphaType == dstInfo.alphaType()) {
+            xformAlphaType = kPremul_SkAlphaType;
+        }
+        procInfo = dstInfo.makeColorType(kRGBA_8888_SkColorType)
+                          .makeAlphaType(kUnpremul_SkAlphaType);
+        // The procs write to a scratch row, so they cannot skip writing zeroes.
+        zeroInit = SkCodec::kNo_ZeroInitialized;
+    }
+
     RowProc fastProc = nullptr;
     RowProc proc = nullptr;
     if (preSwizzled) {
-        switch (dstInfo.colorType()) {
+        switch (procInfo.colorType()) {
             case kGray_8_SkColorType:
                 proc = &sample1;
                 fastProc = &copy;
@@ -678,15 +705,14 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                 return nullptr;
         }
     } else {
-        SkCodec::ZeroInitialized zeroInit = options.fZeroInitialized;
         const bool premultiply = (SkEncodedInfo::kOpaque_Alpha != encodedInfo.alpha()) &&
-                (kPremul_SkAlphaType == dstInfo.alphaType());
+                (kPremul_SkAlphaType == procInfo.alphaType());
 
         switch (encodedInfo.color()) {
             case SkEncodedInfo::kGray_Color:
                 switch (encodedInfo.bitsPerComponent()) {
                     case 1:
-                        switch (dstInfo.colorType()) {
+                        switch (procInfo.colorType()) {
                             case kRGBA_8888_SkColorType:
                             case kBGRA_8888_SkColorType:
                                 proc = &swizzle_bit_to_n32;
@@ -705,7 +731,7 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                         }
                         break;
                     case 8:
-                        switch (dstInfo.colorType()) {
+                        switch (procInfo.colorType()) {
                             case kRGBA_8888_SkColorType:
                             case kBGRA_8888_SkColorType:
                                 proc = &swizzle_gray_to_n32;
@@ -727,7 +753,7 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                 }
                 break;
             case SkEncodedInfo::kGrayAlpha_Color:
-                switch (dstInfo.colorType()) {
+                switch (procInfo.colorType()) {
                     case kRGBA_8888_SkColorType:
                     case kBGRA_8888_SkColorType:
                         if (premultiply) {
@@ -763,7 +789,7 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                     case 1:
                     case 2:
                     case 4:
-                        switch (dstInfo.colorType()) {
+                        switch (procInfo.colorType()) {
                             case kRGBA_8888_SkColorType:
                             case kBGRA_8888_SkColorType:
                                 proc = &swizzle_small_index_to_n32;
@@ -779,7 +805,7 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                         }
                         break;
                     case 8:
-                        switch (dstInfo.colorType()) {
+                        switch (procInfo.colorType()) {
                             case kRGBA_8888_SkColorType:
                             case kBGRA_8888_SkColorType:
                                 if (SkCodec::kYes_ZeroInitialized == zeroInit) {
@@ -804,7 +830,7 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                 }
                 break;
             case SkEncodedInfo::kRGB_Color:
-                switch (dstInfo.colorType()) {
+                switch (procInfo.colorType()) {
                     case kRGBA_8888_SkColorType:
                         proc = &swizzle_rgb_to_rgba;
                         fastProc = &fast_swizzle_rgb_to_rgba;
@@ -821,7 +847,7 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                 }
                 break;
             case SkEncodedInfo::kRGBA_Color:
-                switch (dstInfo.colorType()) {
+                switch (procInfo.colorType()) {
                     case kRGBA_8888_SkColorType:
                         if (premultiply) {
                             if (SkCodec::kYes_ZeroInitialized == zeroInit) {
@@ -868,7 +894,7 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                 }
                 break;
             case SkEncodedInfo::kBGR_Color:
-                switch (dstInfo.colorType()) {
+                switch (procInfo.colorType()) {
                     case kBGRA_8888_SkColorType:
                         proc = &swizzle_rgb_to_rgba;
                         fastProc = &fast_swizzle_rgb_to_rgba;
@@ -885,7 +911,7 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                 }
                 break;
             case SkEncodedInfo::kBGRX_Color:
-                switch (dstInfo.colorType()) {
+                switch (procInfo.colorType()) {
                     case kBGRA_8888_SkColorType:
                         proc = &swizzle_rgb_to_rgba;
                         break;
@@ -900,7 +926,7 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                 }
                 break;
             case SkEncodedInfo::kBGRA_Color:
-                switch (dstInfo.colorType()) {
+                switch (procInfo.colorType()) {
                     case kBGRA_8888_SkColorType:
                         if (premultiply) {
                             if (SkCodec::kYes_ZeroInitialized == zeroInit) {
@@ -947,7 +973,7 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
                 }
                 break;
             case SkEncodedInfo::kInvertedCMYK_Color:
-                switch (dstInfo.colorType()) {
+                switch (procInfo.colorType()) {
                     case kRGBA_8888_SkColorType:
                         proc = &swizzle_cmyk_to_rgba;
                         fastProc = &fast_swizzle_cmyk_to_rgba;
@@ -995,11 +1021,12 @@ SkSwizzler* SkSwizzler::CreateSwizzler(const SkEncodedInfo& encodedInfo,
     }
 
     return new SkSwizzler(fastProc, proc, ctable, srcOffset, srcWidth, dstOffset, dstWidth,
-            srcBPP, dstBPP);
+            srcBPP, dstBPP, colorXform, dstInfo.colorType(), xformAlphaType);
 }
 
 SkSwizzler::SkSwizzler(RowProc fastProc, RowProc proc, const SkPMColor* ctable, int srcOffset,
-        int srcWidth, int dstOffset, int dstWidth, int srcBPP, int dstBPP)
+        int srcWidth, int dstOffset, int dstWidth, int srcBPP, int dstBPP,
+        SkColorSpaceXform* colorXform, SkColorType xformColorType, SkAlphaType xformAlphaType)
     : fFastProc(fastProc)
     , fSlowProc(proc)
     , fActualProc(fFastProc ? fFastProc : fSlowProc)
@@ -1013,9 +1040,18 @@ SkSwizzler::SkSwizzler(RowProc fastProc, RowProc proc, const SkPMColor* ctable,
     , fSwizzleWidth(srcWidth)
     , fAllocatedWidth(dstWidth)
     , fSampleX(1)
+    , fSampleY(1)
     , fSrcBPP(srcBPP)
     , fDstBPP(dstBPP)
-{}
+    , fColorXform(colorXform)
+    , fXformColorType(xformColorType)
+    , fXformAlphaType(xformAlphaType)
+{
+    if (fColorXform) {
+        // Sampling only ever shrinks the number of pixels we swizzle.
+        fXformRow.reset(srcWidth);
+    }
+}
 
 int SkSwizzler::onSetSampleX(int sampleX) {
     SkASSERT(sampleX > 0);
@@ -1040,6 +1076,14 @@ int SkSwizzler::onSetSampleX(int sampleX) {
 
 void SkSwizzler::swizzle(void* dst, const uint8_t* SK_RESTRICT src) {
     SkASSERT(nullptr != dst && nullptr != src);
+    if (fColorXform) {
+        fActualProc(fXformRow.get(), src, fSwizzleWidth, fSrcBPP, fSampleX * fSrcBPP,
+                fSrcOffsetUnits, fColorTable);
+        fColorXform->apply(SkTAddOffset<void>(dst, fDstOffsetBytes), fXformRow.get(),
+                fSwizzleWidth, fXformColorType, fXformAlphaType);
+        return;
+    }
+
     fActualProc(SkTAddOffset<void>(dst, fDstOffsetBytes), src, fSwizzleWidth, fSrcBPP,
             fSampleX * fSrcBPP, fSrcOffsetUnits, fColorTable);
 }
@@ -12,6 +12,9 @@
 #include "SkColor.h"
 #include "SkImageInfo.h"
 #include "SkSampler.h"
+#include "SkTemplates.h"
+
+class SkColorSpaceXform;
 
 class SkSwizzler : public SkSampler {
 public:
@@ -29,7 +32,13 @@ public:
      *                 frame that is a subset of the full image.
      *  @param preSwizzled Indicates that the codec has already swizzled to the
      *                     destination format.  The swizzler only needs to sample
-     *                     and/or subset.
+     *                     and/or subset.  If colorXform is non-NULL, the codec has
+     *                     swizzled to RGBA 8888.
+     *  @param colorXform Unowned.  If non-NULL, each row is swizzled to
+     *                    unpremultiplied RGBA, then transformed, premultiplied
+     *                    (if the dst is premul) and stored to the destination,
+     *                    which must be kRGBA_8888, kBGRA_8888 or kRGBA_F16.  An
+     *                    index source's ctable must hold unpremultiplied RGBA.
      *
      *  Note that a deeper discussion of partial scanline subsets and image frame
      *  subsets is below.  Currently, we do not support both simultaneously.  If
@@ -39,7 +48,8 @@ public:
      */
     static SkSwizzler* CreateSwizzler(const SkEncodedInfo& encodedInfo, const SkPMColor* ctable,
                                       const SkImageInfo& dstInfo, const SkCodec::Options&,
-                                      const SkIRect* frame = nullptr, bool preSwizzled = false);
+                                      const SkIRect* frame = nullptr, bool preSwizzled = false,
+                                      SkColorSpaceXform* colorXform = nullptr);
 
     /**
      *  Swizzle a line. Generally this will be called height times, once
@@ -72,6 +82,12 @@ public:
      */
     int sampleX() const { return fSampleX; }
 
+    /**
+     *  If fSampleY > 1, the caller will keep only every fSampleY'th row of each batch of
+     *  scanlines, so codecs that decode a batch at once need not swizzle the others.
+     */
+    int sampleY() const { return fSampleY; }
+
 private:
 
     /**
@@ -188,6 +204,7 @@ private:
     int                 fAllocatedWidth;
 
     int                 fSampleX;         // Step between X samples
+    int                 fSampleY;         // Step between rows the caller keeps
     const int           fSrcBPP;          // Bits/bytes per pixel for the SrcConfig
                                           // if bitsPerPixel % 8 == 0
                                           //     fBPP is bytesPerPixel
@@ -195,10 +212,24 @@ private:
                                           //     fBPP is bitsPerPixel
     const int           fDstBPP;          // Bytes per pixel for the destination color type
 
+    // If non-NULL, the RowProc writes unpremultiplied RGBA to fXformRow, which
+    // fColorXform then transforms into the destination.  The row stays in cache, so
+    // the destination is only written once.
+    SkColorSpaceXform*      fColorXform;      // Unowned pointer
+    const SkColorType       fXformColorType;
+    const SkAlphaType       fXformAlphaType;
+    SkAutoTMalloc<uint32_t> fXformRow;
+
     SkSwizzler(RowProc fastProc, RowProc proc, const SkPMColor* ctable, int srcOffset,
-            int srcWidth, int dstOffset, int dstWidth, int srcBPP, int dstBPP);
+            int srcWidth, int dstOffset, int dstWidth, int srcBPP, int dstBPP,
+            SkColorSpaceXform* colorXform, SkColorType xformColorType,
+            SkAlphaType xformAlphaType);
 
     int onSetSampleX(int) override;
+    bool onSetSampleY(int sampleY) override {
+        fSampleY = sampleY;
+        return true;
+    }
 
 };
 #endif // SkSwizzler_DEFINED
@@ -6,6 +6,9 @@
  */
 
 #include "SkCodecPriv.h"
+#include "SkData.h"
+#include "SkSampler.h"
+#include "SkStreamPriv.h"
 #include "SkWebpCodec.h"
 #include "SkTemplates.h"
 
@@ -18,6 +21,7 @@
 // If moving libwebp out of skia source tree, path for webp headers must be
 // updated accordingly. Here, we enforce using local copy in webp sub-directory.
 #include "webp/decode.h"
+#include "webp/demux.h"
 #include "webp/encode.h"
 
 bool SkWebpCodec::IsWebp(const void* buf, size_t bytesRead) {
@@ -101,7 +105,8 @@ SkCodec* SkWebpCodec::NewFromStream(SkStream* stream) {
     }
 
     SkEncodedInfo info = SkEncodedInfo::Make(color, alpha, 8);
-    return new SkWebpCodec(features.width, features.height, info, streamDeleter.release());
+    return new SkWebpCodec(features.width, features.height, info, streamDeleter.release(),
+                           SkToBool(features.has_animation));
 }
 
 // This version is slightly different from SkCodecPriv's version of conversion_possible. It
@@ -180,23 +185,37 @@ bool SkWebpCodec::onGetValidSubset(SkIRect* desiredSubset) const {
     return true;
 }
 
-SkCodec::Result SkWebpCodec::onGetPixels(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
-                                         const Options& options, SkPMColor*, int*,
-                                         int* rowsDecoded) {
+// libwebp holds on to the config while decoding, so they live together.
+struct SkWebpCodec::Decoder {
+    Decoder() : fIDec(nullptr) {
+        sk_bzero(&fConfig, sizeof(fConfig));
+    }
+
+    ~Decoder() {
+        WebPIDelete(fIDec);
+        // Free any memory associated with the buffer. Must be called last.
+        WebPFreeDecBuffer(&fConfig.output);
+    }
+
+    WebPDecoderConfig fConfig;
+    WebPIDecoder*     fIDec;
+};
+
+SkCodec::Result SkWebpCodec::startDecoder(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
+                                          const Options& options) {
     if (!webp_conversion_possible(dstInfo, this->getInfo())) {
         return kInvalidConversion;
     }
 
-    WebPDecoderConfig config;
+    fDecoder.reset(nullptr);
+    SkAutoTDelete<Decoder> decoder(new Decoder);
+    WebPDecoderConfig& config = decoder->fConfig;
     if (0 == WebPInitDecoderConfig(&config)) {
         // ABI mismatch.
         // FIXME: New enum for this?
         return kInvalidInput;
     }
 
-    // Free any memory associated with the buffer. Must be called last, so we declare it first.
-    SkAutoTCallVProc<WebPDecBuffer, WebPFreeDecBuffer> autoFree(&(config.output));
-
     SkIRect bounds = SkIRect::MakeSize(this->getInfo().dimensions());
     if (options.fSubset) {
         // Caller is requesting a subset.
@@ -248,11 +267,19 @@ SkCodec::Result SkWebpCodec::onGetPixels(const SkImageInfo& dstInfo, void* dst,
     config.output.u.RGBA.size = dstInfo.getSafeSize(rowBytes);
     config.output.is_external_memory = 1;
 
-    SkAutoTCallVProc<WebPIDecoder, WebPIDelete> idec(WebPIDecode(nullptr, 0, &config));
-    if (!idec) {
+    decoder->fIDec = WebPIDecode(nullptr, 0, &config);
+    if (!decoder->fIDec) {
         return kInvalidInput;
     }
 
+    fDecoder.reset(decoder.release());
+    return kSuccess;
+}
+
+SkCodec::Result SkWebpCodec::feedDecoder(int* rowsDecoded) {
+    SkASSERT(fDecoder);
+    WebPIDecoder* idec = fDecoder->fIDec;
+
     SkAutoTMalloc<uint8_t> storage(BUFFER_SIZE);
     uint8_t* buffer = storage.get();
     while (true) {
@@ -264,17 +291,279 @@ SkCodec::Result SkWebpCodec::onGetPixels(const SkImageInfo& dstInfo, void* dst,
 
         switch (WebPIAppend(idec, buffer, bytesRead)) {
             case VP8_STATUS_OK:
+                fDecoder.reset(nullptr);
                 return kSuccess;
             case VP8_STATUS_SUSPENDED:
                 // Break out of the switch statement. Continue the loop.
                 break;
             default:
+                fDecoder.reset(nullptr);
                 return kInvalidInput;
         }
     }
 }
 
-SkWebpCodec::SkWebpCodec(int width, int height, const SkEncodedInfo& info, SkStream* stream)
+SkCodec::Result SkWebpCodec::onGetPixels(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
+                                         const Options& options, SkPMColor*, int*,
+                                         int* rowsDecoded) {
+    if (fIsAnimated) {
+        return this->decodeFrame(dstInfo, dst, rowBytes, options);
+    }
+
+    const Result result = this->startDecoder(dstInfo, dst, rowBytes, options);
+    if (kSuccess != result) {
+        return result;
+    }
+
+    const Result decodeResult = this->feedDecoder(rowsDecoded);
+    fDecoder.reset(nullptr);
+    return decodeResult;
+}
+
+bool SkWebpCodec::onQueryYUV8(SkYUVSizeInfo* sizeInfo, SkYUVColorSpace* colorSpace) const {
+    // libwebp decodes lossy images to YUV 4:2:0 before converting them to RGB, so we can hand
+    // out its planes directly.  Lossless images are RGB, and there is no plane for alpha.
+    if (SkEncodedInfo::kYUV_Color != this->getEncodedInfo().color() || fIsAnimated) {
+        return false;
+    }
+
+    const int width = this->getInfo().width();
+    const int height = this->getInfo().height();
+    sizeInfo->fSizes[SkYUVSizeInfo::kY].set(width, height);
+    sizeInfo->fSizes[SkYUVSizeInfo::kU].set((width + 1) / 2, (height + 1) / 2);
+    sizeInfo->fSizes[SkYUVSizeInfo::kV].set((width + 1) / 2, (height + 1) / 2);
+    // libwebp does not need the rows padded, but recommend the same alignment as
+    // SkJpegCodec, since clients may assume it.
+    for (int i = 0; i < 3; i++) {
+        sizeInfo->fWidthBytes[i] = SkAlign8(sizeInfo->fSizes[i].width());
+    }
+
+    if (colorSpace) {
+        // VP8 uses the Rec. 601 "studio swing" conversion.
+        *colorSpace = kRec601_SkYUVColorSpace;
+    }
+
+    return true;
+}
+
+SkCodec::Result SkWebpCodec::onGetYUV8Planes(const SkYUVSizeInfo& sizeInfo, void* planes[3]) {
+    SkYUVSizeInfo defaultInfo;
+    if (!this->onQueryYUV8(&defaultInfo, nullptr)) {
+        return kInvalidInput;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (sizeInfo.fSizes[i] != defaultInfo.fSizes[i] ||
+                sizeInfo.fWidthBytes[i] < defaultInfo.fWidthBytes[i]) {
+            return kInvalidInput;
+        }
+    }
+
+    fDecoder.reset(nullptr);
+    SkAutoTDelete<Decoder> decoder(new Decoder);
+    WebPDecoderConfig& config = decoder->fConfig;
+    if (0 == WebPInitDecoderConfig(&config)) {
+        // ABI mismatch.
+        return kInvalidInput;
+    }
+
+    // Have libwebp write each plane straight into the client's memory, skipping its
+    // conversion to RGB.
+    WebPYUVABuffer& yuv = config.output.u.YUVA;
+    yuv.y = (uint8_t*) planes[SkYUVSizeInfo::kY];
+    yuv.u = (uint8_t*) planes[SkYUVSizeInfo::kU];
+    yuv.v = (uint8_t*) planes[SkYUVSizeInfo::kV];
+    yuv.y_stride = (int) sizeInfo.fWidthBytes[SkYUVSizeInfo::kY];
+    yuv.u_stride = (int) sizeInfo.fWidthBytes[SkYUVSizeInfo::kU];
+    yuv.v_stride = (int) sizeInfo.fWidthBytes[SkYUVSizeInfo::kV];
+    yuv.y_size = sizeInfo.fWidthBytes[SkYUVSizeInfo::kY] *
+                 sizeInfo.fSizes[SkYUVSizeInfo::kY].height();
+    yuv.u_size = sizeInfo.fWidthBytes[SkYUVSizeInfo::kU] *
+                 sizeInfo.fSizes[SkYUVSizeInfo::kU].height();
+    yuv.v_size = sizeInfo.fWidthBytes[SkYUVSizeInfo::kV] *
+                 sizeInfo.fSizes[SkYUVSizeInfo::kV].height();
+    config.output.colorspace = MODE_YUV;
+    config.output.is_external_memory = 1;
+
+    decoder->fIDec = WebPIDecode(nullptr, 0, &config);
+    if (!decoder->fIDec) {
+        return kInvalidInput;
+    }
+    fDecoder.reset(decoder.release());
+
+    // libwebp does not report how many rows of a YUV decode are done, and getYUV8Planes()
+    // has no way to say so anyway.
+    int rowsDecoded = 0;
+    const Result result = this->feedDecoder(&rowsDecoded);
+    fDecoder.reset(nullptr);
+    return result;
+}
+
+// The demuxer refers to the data, so they live together.
+struct SkWebpCodec::Animation {
+    explicit Animation(sk_sp<SkData> data) : fData(std::move(data)), fDemux(nullptr) {}
+
+    ~Animation() {
+        WebPDemuxDelete(fDemux);
+    }
+
+    sk_sp<SkData>          fData;
+    WebPDemuxer*           fDemux;
+    std::vector<FrameInfo> fFrames;
+    // Whether each frame is blended with what is beneath it, rather than replacing it.
+    std::vector<bool>      fBlends;
+};
+
+bool SkWebpCodec::readAnimation() {
+    SkAutoTDelete<Animation> animation(new Animation(SkCopyStreamToData(this->stream())));
+    const WebPData data = { animation->fData->bytes(), animation->fData->size() };
+    animation->fDemux = WebPDemux(&data);
+    if (!animation->fDemux) {
+        return false;
+    }
+
+    const SkISize size = this->getInfo().dimensions();
+    const int frameCount = (int) WebPDemuxGetI(animation->fDemux, WEBP_FF_FRAME_COUNT);
+    // WebPDemux numbers frames from one.
+    for (int i = 1; i <= frameCount; i++) {
+        WebPIterator iter;
+        if (!WebPDemuxGetFrame(animation->fDemux, i, &iter)) {
+            break;
+        }
+
+        FrameInfo frame;
+        frame.fDuration = iter.duration;
+        frame.fFrameRect.setXYWH(iter.x_offset, iter.y_offset, iter.width, iter.height);
+        frame.fDisposalMethod = WEBP_MUX_DISPOSE_BACKGROUND == iter.dispose_method
+                ? kRestoreBGColor_DisposalMethod : kKeep_DisposalMethod;
+        const bool blend = WEBP_MUX_BLEND == iter.blend_method && iter.has_alpha;
+        WebPDemuxReleaseIterator(&iter);
+
+        animation->fFrames.push_back(frame);
+        animation->fBlends.push_back(blend);
+        set_required_frame(&animation->fFrames, !blend, size);
+    }
+
+    if (animation->fFrames.empty()) {
+        return false;
+    }
+
+    fAnimation.reset(animation.release());
+    return true;
+}
+
+std::vector<SkCodec::FrameInfo> SkWebpCodec::onGetFrameInfo() {
+    if (!fIsAnimated) {
+        return std::vector<FrameInfo>();
+    }
+
+    if (!fAnimation && (!this->rewindIfNeeded() || !this->readAnimation())) {
+        return std::vector<FrameInfo>();
+    }
+    return fAnimation->fFrames;
+}
+
+SkCodec::Result SkWebpCodec::decodeFrame(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
+                                         const Options& options) {
+    if (!webp_conversion_possible(dstInfo, this->getInfo())) {
+        return kInvalidConversion;
+    }
+
+    // Frames are drawn on top of each other at full size.
+    if (options.fSubset) {
+        return kUnimplemented;
+    }
+    if (dstInfo.dimensions() != this->getInfo().dimensions()) {
+        return kInvalidScale;
+    }
+
+    // getPixels() has already rewound the stream.
+    if (!fAnimation && !this->readAnimation()) {
+        return kInvalidInput;
+    }
+
+    const size_t index = options.fFrameIndex;
+    if (index >= fAnimation->fFrames.size()) {
+        return kInvalidParameters;
+    }
+
+    const FrameInfo& frame = fAnimation->fFrames[index];
+    const bool blend = fAnimation->fBlends[index] && kNone != frame.fRequiredFrame;
+    if (blend && kPremul_SkAlphaType != dstInfo.alphaType()) {
+        // We blend premultiplied pixels.
+        return kInvalidConversion;
+    }
+
+    WebPIterator iter;
+    if (!WebPDemuxGetFrame(fAnimation->fDemux, SkToInt(index) + 1, &iter)) {
+        return kInvalidInput;
+    }
+    SkAutoTCallVProc<WebPIterator, WebPDemuxReleaseIterator> autoIter(&iter);
+
+    const SkIRect& rect = frame.fFrameRect;
+    if (kNone == frame.fRequiredFrame && rect != SkIRect::MakeSize(dstInfo.dimensions())) {
+        SkSampler::Fill(dstInfo, dst, rowBytes, SK_ColorTRANSPARENT, options.fZeroInitialized);
+    }
+
+    // Decode straight into the frame's rect, unless it has to be blended with what is there.
+    const size_t bpp = dstInfo.bytesPerPixel();
+    SkAutoTMalloc<uint8_t> storage;
+    uint8_t* pixels = SkTAddOffset<uint8_t>(dst, rect.top() * rowBytes + rect.left() * bpp);
+    size_t pixelsRowBytes = rowBytes;
+    if (blend) {
+        pixelsRowBytes = rect.width() * bpp;
+        pixels = storage.reset(pixelsRowBytes * rect.height());
+    }
+
+    WebPDecoderConfig config;
+    if (0 == WebPInitDecoderConfig(&config)) {
+        // ABI mismatch.
+        return kInvalidInput;
+    }
+    config.output.colorspace = webp_decode_mode(dstInfo.colorType(),
+            dstInfo.alphaType() == kPremul_SkAlphaType);
+    config.output.u.RGBA.rgba = pixels;
+    config.output.u.RGBA.stride = (int) pixelsRowBytes;
+    config.output.u.RGBA.size = (rect.height() - 1) * pixelsRowBytes + rect.width() * bpp;
+    config.output.is_external_memory = 1;
+    SkAutoTCallVProc<WebPDecBuffer, WebPFreeDecBuffer> autoFree(&config.output);
+
+    if (VP8_STATUS_OK != WebPDecode(iter.fragment.bytes, iter.fragment.size, &config)) {
+        return kInvalidInput;
+    }
+
+    if (blend) {
+        SkASSERT(4 == bpp);
+        for (int y = 0; y < rect.height(); y++) {
+            const SkPMColor* src = SkTAddOffset<const SkPMColor>(pixels, y * pixelsRowBytes);
+            SkPMColor* dstRow = SkTAddOffset<SkPMColor>(dst, (rect.top() + y) * rowBytes +
+                                                             rect.left() * bpp);
+            for (int x = 0; x < rect.width(); x++) {
+                dstRow[x] = SkPMSrcOver(src[x], dstRow[x]);
+            }
+        }
+    }
+    return kSuccess;
+}
+
+SkCodec::Result SkWebpCodec::onStartIncrementalDecode(const SkImageInfo& dstInfo, void* dst,
+        size_t rowBytes, const Options& options, SkPMColor*, int*) {
+    if (fIsAnimated) {
+        // WebPDemux needs all of the data up front.
+        return kUnimplemented;
+    }
+    return this->startDecoder(dstInfo, dst, rowBytes, options);
+}
+
+SkCodec::Result SkWebpCodec::onIncrementalDecode(int* rowsDecoded) {
+    return this->feedDecoder(rowsDecoded);
+}
+
+SkWebpCodec::SkWebpCodec(int width, int height, const SkEncodedInfo& info, SkStream* stream,
+                         bool isAnimated)
     // The spec says an unmarked image is sRGB, so we return that space here.
     // TODO: Add support for parsing ICC profiles from webps.
-    : INHERITED(width, height, info, stream, SkColorSpace::NewNamed(SkColorSpace::kSRGB_Named)) {}
+    : INHERITED(width, height, info, stream, SkColorSpace::NewNamed(SkColorSpace::kSRGB_Named))
+    , fIsAnimated(isAnimated)
+{}
+
+SkWebpCodec::~SkWebpCodec() {}
@@ -12,6 +12,7 @@
 #include "SkColorSpace.h"
 #include "SkEncodedFormat.h"
 #include "SkImageInfo.h"
+#include "SkTemplates.h"
 #include "SkTypes.h"
 
 class SkStream;
@@ -23,6 +24,8 @@ public:
     // Assumes IsWebp was called and returned true.
     static SkCodec* NewFromStream(SkStream*);
     static bool IsWebp(const void*, size_t);
+
+    ~SkWebpCodec() override;
 protected:
     Result onGetPixels(const SkImageInfo&, void*, size_t, const Options&, SkPMColor*, int*, int*)
             override;
@@ -33,8 +36,40 @@ protected:
     bool onDimensionsSupported(const SkISize&) override;
 
     bool onGetValidSubset(SkIRect* /* desiredSubset */) const override;
+
+    Result onStartIncrementalDecode(const SkImageInfo& dstInfo, void* dst, size_t rowBytes,
+            const Options&, SkPMColor*, int*) override;
+    Result onIncrementalDecode(int* rowsDecoded) override;
+
+    std::vector<FrameInfo> onGetFrameInfo() override;
+
+    bool onQueryYUV8(SkYUVSizeInfo* sizeInfo, SkYUVColorSpace* colorSpace) const override;
+
+    Result onGetYUV8Planes(const SkYUVSizeInfo& sizeInfo, void* planes[3]) override;
 private:
-    SkWebpCodec(int width, int height, const SkEncodedInfo&, SkStream*);
+    SkWebpCodec(int width, int height, const SkEncodedInfo&, SkStream*, bool isAnimated);
+
+    // Sets up fDecoder to decode into dst.
+    Result startDecoder(const SkImageInfo& dstInfo, void* dst, size_t rowBytes, const Options&);
+
+    // Hands whatever the stream currently holds to fDecoder.
+    Result feedDecoder(int* rowsDecoded);
+
+    // Reads the rest of the stream, which must be at its start, and splits it into frames.
+    bool readAnimation();
+
+    // Draws options.fFrameIndex of an animated image into dst.
+    Result decodeFrame(const SkImageInfo& dstInfo, void* dst, size_t rowBytes, const Options&);
+
+    // A decode in progress.  Defined in SkWebpCodec.cpp, to keep libwebp out of this header.
+    struct Decoder;
+    SkAutoTDelete<Decoder> fDecoder;
+
+    // The frames of an animated image, once they have been read.  Also defined in
+    // SkWebpCodec.cpp.
+    struct Animation;
+    const bool               fIsAnimated;
+    SkAutoTDelete<Animation> fAnimation;
 
     typedef SkCodec INHERITED;
 };
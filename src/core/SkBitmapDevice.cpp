@@ -232,7 +232,13 @@ void SkBitmapDevice::drawPath(const SkDraw& draw, const SkPath& path,
 void SkBitmapDevice::drawBitmap(const SkDraw& draw, const SkBitmap& bitmap,
                                 const SkMatrix& matrix, const SkPaint& paint) {
     LogDrawScaleFactor(SkMatrix::Concat(*draw.fMatrix, matrix), paint.getFilterQuality());
-    draw.drawBitmap(bitmap, matrix, nullptr, paint);
+    this->onDrawBitmap(draw, bitmap, matrix, nullptr, paint);
+}
+
+void SkBitmapDevice::onDrawBitmap(const SkDraw& draw, const SkBitmap& bitmap,
+                                  const SkMatrix& matrix, const SkRect* dstOrNull,
+                                  const SkPaint& paint) {
+    draw.drawBitmap(bitmap, matrix, dstOrNull, paint);
 }
 
 void SkBitmapDevice::drawBitmapRect(const SkDraw& draw, const SkBitmap& bitmap,
@@ -317,7 +323,7 @@ void SkBitmapDevice::drawBitmapRect(const SkDraw& draw, const SkBitmap& bitmap,
         // We can go faster by just calling drawBitmap, which will concat the
         // matrix with the CTM, and try to call drawSprite if it can. If not,
         // it will make a shader and call drawRect, as we do below.
-        draw.drawBitmap(*bitmapPtr, matrix, dstPtr, paint);
+        this->onDrawBitmap(draw, *bitmapPtr, matrix, dstPtr, paint);
         return;
     }
 
@@ -1422,7 +1422,13 @@ void* SkCanvas::accessTopLayerPixels(SkImageInfo* info, size_t* rowBytes, SkIPoi
 
 bool SkCanvas::onAccessTopLayerPixels(SkPixmap* pmap) {
     SkBaseDevice* dev = this->getTopDevice();
-    return dev && dev->accessPixels(pmap);
+    if (!dev || !dev->accessPixels(pmap)) {
+        return false;
+    }
+    // Devices that defer their drawing (e.g. SkThreadedBMPDevice) must catch up before the
+    // caller touches the pixels.
+    dev->flush();
+    return true;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -9,6 +9,7 @@
 #include "SkColorSpace_Base.h"
 #include "SkColorSpaceXform.h"
 #include "SkColorSpaceXformOpts.h"
+#include "SkOpts.h"
 #include "SkSRGB.h"
 
 static constexpr float sk_linear_from_2dot2[256] = {
@@ -711,23 +712,70 @@ void SkColorSpaceXform_Base<SkColorSpace::kNonStandard_GammaNamed>
             (dst, src, len, fSrcGammaTables, fSrcToDst, fDstGammaTables);
 }
 
-template <SkColorSpace::GammaNamed T>
-void SkColorSpaceXform_Base<T>
-::applyToF16(RGBAF16* dst, const RGBA32* src, int len) const
-{
-    if (fColorLUT) {
-        size_t storageBytes = len * sizeof(RGBA32);
+template <bool kPremul>
+static void apply_to_f16(uint64_t* dst, const uint32_t* src, int len,
+                         SkColorLookUpTable* colorLUT, const float* const srcTables[3],
+                         const float matrix[16], const uint8_t* const dstTables[3]) {
+    if (colorLUT) {
+        size_t storageBytes = len * sizeof(uint32_t);
 #if defined(GOOGLE3)
         // Stack frame size is limited in GOOGLE3.
-        SkAutoSMalloc<256 * sizeof(RGBA32)> storage(storageBytes);
+        SkAutoSMalloc<256 * sizeof(uint32_t)> storage(storageBytes);
 #else
-        SkAutoSMalloc<1024 * sizeof(RGBA32)> storage(storageBytes);
+        SkAutoSMalloc<1024 * sizeof(uint32_t)> storage(storageBytes);
 #endif
 
-        handle_color_lut((RGBA32*) storage.get(), src, len, fColorLUT.get());
-        src = (const RGBA32*) storage.get();
+        handle_color_lut((uint32_t*) storage.get(), src, len, colorLUT);
+        src = (const uint32_t*) storage.get();
     }
 
-    color_xform_RGBA<SkColorSpace::kLinear_GammaNamed, false, false>
-            (dst, src, len, fSrcGammaTables, fSrcToDst, fDstGammaTables);
+    color_xform_RGBA<SkColorSpace::kLinear_GammaNamed, kPremul, false>
+            (dst, src, len, srcTables, matrix, dstTables);
+}
+
+template <SkColorSpace::GammaNamed T>
+void SkColorSpaceXform_Base<T>
+::applyToF16(RGBAF16* dst, const RGBA32* src, int len) const
+{
+    apply_to_f16<false>(dst, src, len, fColorLUT.get(), fSrcGammaTables, fSrcToDst,
+                        fDstGammaTables);
+}
+
+template <SkColorSpace::GammaNamed T>
+void SkColorSpaceXform_Base<T>
+::applyToPremulF16(RGBAF16* dst, const RGBA32* src, int len) const
+{
+    apply_to_f16<true>(dst, src, len, fColorLUT.get(), fSrcGammaTables, fSrcToDst,
+                       fDstGammaTables);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SkColorSpaceXform::apply(void* dst, const RGBA32* src, int len, SkColorType dstColorType,
+                              SkAlphaType dstAlphaType) const {
+    const bool premul = kPremul_SkAlphaType == dstAlphaType;
+    switch (dstColorType) {
+        case kRGBA_8888_SkColorType:
+            this->applyToRGBA((RGBA32*) dst, src, len);
+            break;
+        case kBGRA_8888_SkColorType:
+            this->applyToBGRA((BGRA32*) dst, src, len);
+            break;
+        case kRGBA_F16_SkColorType:
+            if (premul) {
+                this->applyToPremulF16((RGBAF16*) dst, src, len);
+            } else {
+                this->applyToF16((RGBAF16*) dst, src, len);
+            }
+            return;
+        default:
+            SkASSERT(false);
+            return;
+    }
+
+    // 8888 pixels are premultiplied in their encoded space, so this has to follow the store.
+    // The row is still in cache, so this is much cheaper than another pass over the image.
+    if (premul) {
+        SkOpts::RGBA_to_rgbA((uint32_t*) dst, dst, len);
+    }
 }
@@ -10,6 +10,7 @@
 
 #include "SkColorSpace.h"
 #include "SkColorSpace_Base.h"
+#include "SkImageInfo.h"
 
 class SkColorSpaceXform : SkNoncopyable {
 public:
@@ -37,6 +38,20 @@ public:
     virtual void applyToBGRA(BGRA32* dst, const RGBA32* src, int len) const = 0;
     virtual void applyToF16(RGBAF16* dst, const RGBA32* src, int len) const = 0;
 
+    /**
+     *  Like applyToF16(), but treats the src alpha as unpremultiplied and multiplies the
+     *  linear output by it.
+     */
+    virtual void applyToPremulF16(RGBAF16* dst, const RGBA32* src, int len) const = 0;
+
+    /**
+     *  Apply the color conversion to a row of unpremultiplied RGBA src, storing it in dst as
+     *  dstColorType, which must be kRGBA_8888, kBGRA_8888 or kRGBA_F16.  If dstAlphaType is
+     *  kPremul, the output is premultiplied before it is stored.
+     */
+    void apply(void* dst, const RGBA32* src, int len, SkColorType dstColorType,
+               SkAlphaType dstAlphaType) const;
+
     virtual ~SkColorSpaceXform() {}
 };
 
@@ -47,6 +62,7 @@ public:
     void applyToRGBA(RGBA32* dst, const RGBA32* src, int len) const override;
     void applyToBGRA(BGRA32* dst, const RGBA32* src, int len) const override;
     void applyToF16(RGBAF16* dst, const RGBA32* src, int len) const override;
+    void applyToPremulF16(RGBAF16* dst, const RGBA32* src, int len) const override;
 
     static constexpr int      kDstGammaTableSize = 1024;
 
@@ -368,6 +368,10 @@ static void color_xform_RGBA(void* dst, const uint32_t* src, int len,
 
         translate_gamut_1(rTgTbT, rgba);
 
+        if (kPremul) {
+            premultiply_1(a, rgba);
+        }
+
         store_1(dst, src, rgba, a, dstTables, kSwapRB);
 
         src += 1;
@@ -471,18 +471,15 @@ void SkGlyphCache::invokeAndRemoveAuxProcs() {
 ///////////////////////////////////////////////////////////////////////////////
 
 size_t SkGlyphCache_Globals::getTotalMemoryUsed() const {
-    SkAutoExclusive ac(fLock);
-    return fTotalMemoryUsed;
+    return fTotalMemoryUsed.load();
 }
 
 int SkGlyphCache_Globals::getCacheCountUsed() const {
-    SkAutoExclusive ac(fLock);
-    return fCacheCount;
+    return fCacheCount.load();
 }
 
 int SkGlyphCache_Globals::getCacheCountLimit() const {
-    SkAutoExclusive ac(fLock);
-    return fCacheCountLimit;
+    return fCacheCountLimit.load();
 }
 
 size_t SkGlyphCache_Globals::setCacheSizeLimit(size_t newLimit) {
@@ -491,17 +488,14 @@ size_t SkGlyphCache_Globals::setCacheSizeLimit(size_t newLimit) {
         newLimit = minLimit;
     }
 
-    SkAutoExclusive ac(fLock);
-
-    size_t prevLimit = fCacheSizeLimit;
-    fCacheSizeLimit = newLimit;
-    this->internalPurge();
+    size_t prevLimit = fCacheSizeLimit.load();
+    fCacheSizeLimit.store(newLimit);
+    this->purge();
     return prevLimit;
 }
 
 size_t  SkGlyphCache_Globals::getCacheSizeLimit() const {
-    SkAutoExclusive ac(fLock);
-    return fCacheSizeLimit;
+    return fCacheSizeLimit.load();
 }
 
 int SkGlyphCache_Globals::setCacheCountLimit(int newCount) {
@@ -509,20 +503,17 @@ int SkGlyphCache_Globals::setCacheCountLimit(int newCount) {
         newCount = 0;
     }
 
-    SkAutoExclusive ac(fLock);
-
-    int prevCount = fCacheCountLimit;
-    fCacheCountLimit = newCount;
-    this->internalPurge();
+    int prevCount = fCacheCountLimit.load();
+    fCacheCountLimit.store(newCount);
+    this->purge();
     return prevCount;
 }
 
 void SkGlyphCache_Globals::purgeAll() {
-    SkAutoExclusive ac(fLock);
-    this->internalPurge(fTotalMemoryUsed);
+    this->purge(fTotalMemoryUsed.load());
 }
 
-/*  This guy calls the visitor from within the mutext lock, so the visitor
+/*  This guy calls the visitor from within the lock of the strike's stripe, so the visitor
     cannot:
     - take too much time
     - try to acquire the mutext again
@@ -551,21 +542,8 @@ SkGlyphCache* SkGlyphCache::VisitCache(SkTypeface* typeface,
     SkGlyphCache_Globals& globals = get_globals();
     SkGlyphCache*         cache;
 
-    {
-        SkAutoExclusive ac(globals.fLock);
-
-        globals.validate();
-
-        for (cache = globals.internalGetHead(); cache != nullptr; cache = cache->fNext) {
-            if (*cache->fDesc == *desc) {
-                globals.internalDetachCache(cache);
-                if (!proc(cache, context)) {
-                    globals.internalAttachCacheToHead(cache);
-                    cache = nullptr;
-                }
-                return cache;
-            }
-        }
+    if (globals.findAndDetachCache(*desc, proc, context, &cache)) {
+        return cache;
     }
 
     // Check if we can create a scaler-context before creating the glyphcache.
@@ -664,57 +642,73 @@ void SkGlyphCache::DumpMemoryStatistics(SkTraceMemoryDump* dump) {
 }
 
 void SkGlyphCache::VisitAll(Visitor visitor, void* context) {
-    SkGlyphCache_Globals& globals = get_globals();
-    SkAutoExclusive ac(globals.fLock);
-    SkGlyphCache*         cache;
+    get_globals().visitAll(visitor, context);
+}
 
-    globals.validate();
+///////////////////////////////////////////////////////////////////////////////
 
-    for (cache = globals.internalGetHead(); cache != nullptr; cache = cache->fNext) {
-        visitor(*cache, context);
+bool SkGlyphCache_Globals::findAndDetachCache(const SkDescriptor& desc,
+                                              bool (*proc)(const SkGlyphCache*, void*),
+                                              void* context, SkGlyphCache** result) {
+    Stripe& stripe = this->stripeFor(desc);
+    SkAutoExclusive ac(stripe.fLock);
+
+    for (SkGlyphCache* cache = stripe.fHead; cache != nullptr; cache = cache->fNext) {
+        if (*cache->fDesc == desc) {
+            this->internalDetachCache(&stripe, cache);
+            if (!proc(cache, context)) {
+                this->internalAttachCacheToHead(&stripe, cache);
+                cache = nullptr;
+            }
+            *result = cache;
+            return true;
+        }
     }
+    return false;
 }
 
-///////////////////////////////////////////////////////////////////////////////
-
 void SkGlyphCache_Globals::attachCacheToHead(SkGlyphCache* cache) {
-    SkAutoExclusive ac(fLock);
-
-    this->validate();
     cache->validate();
-
-    this->internalAttachCacheToHead(cache);
-    this->internalPurge();
+    {
+        Stripe& stripe = this->stripeFor(*cache->fDesc);
+        SkAutoExclusive ac(stripe.fLock);
+        this->internalAttachCacheToHead(&stripe, cache);
+    }
+    this->purge();
 }
 
-SkGlyphCache* SkGlyphCache_Globals::internalGetTail() const {
-    SkGlyphCache* cache = fHead;
-    if (cache) {
-        while (cache->fNext) {
-            cache = cache->fNext;
+void SkGlyphCache_Globals::visitAll(SkGlyphCache::Visitor visitor, void* context) {
+    this->validate();
+
+    for (Stripe& stripe : fStripes) {
+        SkAutoExclusive ac(stripe.fLock);
+        for (SkGlyphCache* cache = stripe.fHead; cache != nullptr; cache = cache->fNext) {
+            visitor(*cache, context);
         }
     }
-    return cache;
 }
 
-size_t SkGlyphCache_Globals::internalPurge(size_t minBytesNeeded) {
-    this->validate();
+size_t SkGlyphCache_Globals::purge(size_t minBytesNeeded) {
+    size_t totalMemoryUsed = fTotalMemoryUsed.load(),
+           cacheSizeLimit  = fCacheSizeLimit.load();
+    int    cacheCount      = fCacheCount.load(),
+           cacheCountLimit = fCacheCountLimit.load();
 
     size_t bytesNeeded = 0;
-    if (fTotalMemoryUsed > fCacheSizeLimit) {
-        bytesNeeded = fTotalMemoryUsed - fCacheSizeLimit;
+    if (totalMemoryUsed > cacheSizeLimit) {
+        bytesNeeded = totalMemoryUsed - cacheSizeLimit;
     }
     bytesNeeded = SkTMax(bytesNeeded, minBytesNeeded);
     if (bytesNeeded) {
         // no small purges!
-        bytesNeeded = SkTMax(bytesNeeded, fTotalMemoryUsed >> 2);
+        bytesNeeded = SkTMax(bytesNeeded, totalMemoryUsed >> 2);
     }
 
     int countNeeded = 0;
-    if (fCacheCount > fCacheCountLimit) {
-        countNeeded = fCacheCount - fCacheCountLimit;
+    if (cacheCount > cacheCountLimit) {
+        countNeeded = cacheCount - cacheCountLimit;
         // no small purges!
-        countNeeded = SkMax32(countNeeded, fCacheCount >> 2);
+        countNeeded = SkMax32(countNeeded, cacheCount >> 2);
     }
 
     // early exit
@@ -722,25 +716,41 @@ size_t SkGlyphCache_Globals::internalPurge(size_t minBytesNeeded) {
         return 0;
     }
 
+    SkAutoExclusive purgeLock(fPurgeLock);
+
     size_t  bytesFreed = 0;
     int     countFreed = 0;
 
-    // we start at the tail and proceed backwards, as the linklist is in LRU
-    // order, with unimportant entries at the tail.
-    SkGlyphCache* cache = this->internalGetTail();
-    while (cache != nullptr &&
+    // Each stripe's list is in LRU order, with unimportant entries at the tail.  Taking one tail
+    // from each stripe in turn approximates purging the least recently used strikes overall.
+    int emptyStripes = 0;
+    while (emptyStripes < SK_FONT_CACHE_STRIPE_COUNT &&
            (bytesFreed < bytesNeeded || countFreed < countNeeded)) {
-        SkGlyphCache* prev = cache->fPrev;
+        Stripe& stripe = fStripes[fNextPurgeStripe];
+        fNextPurgeStripe = (fNextPurgeStripe + 1) % SK_FONT_CACHE_STRIPE_COUNT;
+
+        SkGlyphCache* cache;
+        {
+            SkAutoExclusive ac(stripe.fLock);
+            cache = stripe.fHead;
+            if (cache) {
+                while (cache->fNext) {
+                    cache = cache->fNext;
+                }
+                this->internalDetachCache(&stripe, cache);
+            }
+        }
+
+        if (!cache) {
+            emptyStripes++;
+            continue;
+        }
+        emptyStripes = 0;
         bytesFreed += cache->fMemoryUsed;
         countFreed += 1;
-
-        this->internalDetachCache(cache);
         delete cache;
-        cache = prev;
     }
 
-    this->validate();
-
 #ifdef SPEW_PURGE_STATUS
     if (countFreed) {
         SkDebugf("purging %dK from font cache [%d entries]\n",
@@ -751,27 +761,27 @@ size_t SkGlyphCache_Globals::internalPurge(size_t minBytesNeeded) {
     return bytesFreed;
 }
 
-void SkGlyphCache_Globals::internalAttachCacheToHead(SkGlyphCache* cache) {
+void SkGlyphCache_Globals::internalAttachCacheToHead(Stripe* stripe, SkGlyphCache* cache) {
     SkASSERT(nullptr == cache->fPrev && nullptr == cache->fNext);
-    if (fHead) {
-        fHead->fPrev = cache;
-        cache->fNext = fHead;
+    if (stripe->fHead) {
+        stripe->fHead->fPrev = cache;
+        cache->fNext = stripe->fHead;
     }
-    fHead = cache;
+    stripe->fHead = cache;
 
-    fCacheCount += 1;
-    fTotalMemoryUsed += cache->fMemoryUsed;
+    fCacheCount.fetch_add(1);
+    fTotalMemoryUsed.fetch_add(cache->fMemoryUsed);
 }
 
-void SkGlyphCache_Globals::internalDetachCache(SkGlyphCache* cache) {
-    SkASSERT(fCacheCount > 0);
-    fCacheCount -= 1;
-    fTotalMemoryUsed -= cache->fMemoryUsed;
+void SkGlyphCache_Globals::internalDetachCache(Stripe* stripe, SkGlyphCache* cache) {
+    SkASSERT(fCacheCount.load() > 0);
+    fCacheCount.fetch_sub(1);
+    fTotalMemoryUsed.fetch_sub(cache->fMemoryUsed);
 
     if (cache->fPrev) {
         cache->fPrev->fNext = cache->fNext;
     } else {
-        fHead = cache->fNext;
+        stripe->fHead = cache->fNext;
     }
     if (cache->fNext) {
         cache->fNext->fPrev = cache->fPrev;
@@ -800,17 +810,24 @@ void SkGlyphCache_Globals::validate() const {
     size_t computedBytes = 0;
     int computedCount = 0;
 
-    const SkGlyphCache* head = fHead;
-    while (head != nullptr) {
-        computedBytes += head->fMemoryUsed;
-        computedCount += 1;
-        head = head->fNext;
+    // The totals only change with a stripe locked, so they're stable while we hold every lock.
+    // Nobody else holds more than one at a time, so taking them all in order can't deadlock.
+    for (const Stripe& stripe : fStripes) {
+        stripe.fLock.acquire();
+        for (const SkGlyphCache* cache = stripe.fHead; cache != nullptr; cache = cache->fNext) {
+            computedBytes += cache->fMemoryUsed;
+            computedCount += 1;
+        }
     }
 
-    SkASSERTF(fCacheCount == computedCount, "fCacheCount: %d, computedCount: %d", fCacheCount,
-              computedCount);
-    SkASSERTF(fTotalMemoryUsed == computedBytes, "fTotalMemoryUsed: %d, computedBytes: %d",
-              fTotalMemoryUsed, computedBytes);
+    SkASSERTF(fCacheCount.load() == computedCount, "fCacheCount: %d, computedCount: %d",
+              fCacheCount.load(), computedCount);
+    SkASSERTF(fTotalMemoryUsed.load() == computedBytes, "fTotalMemoryUsed: %d, computedBytes: %d",
+              fTotalMemoryUsed.load(), computedBytes);
+
+    for (const Stripe& stripe : fStripes) {
+        stripe.fLock.release();
+    }
 }
 
 #endif
@@ -8,10 +8,10 @@
 #ifndef SkGlyphCache_Globals_DEFINED
 #define SkGlyphCache_Globals_DEFINED
 
+#include "SkAtomics.h"
 #include "SkGlyphCache.h"
 #include "SkMutex.h"
 #include "SkSpinlock.h"
-#include "SkTLS.h"
 
 #ifndef SK_DEFAULT_FONT_CACHE_COUNT_LIMIT
     #define SK_DEFAULT_FONT_CACHE_COUNT_LIMIT   2048
@@ -21,32 +21,39 @@
     #define SK_DEFAULT_FONT_CACHE_LIMIT     (2 * 1024 * 1024)
 #endif
 
+#ifndef SK_FONT_CACHE_STRIPE_COUNT
+    #define SK_FONT_CACHE_STRIPE_COUNT   32
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 
+/*  The global list of strikes is split into stripes by descriptor checksum.  Each stripe has its
+    own lock and its own LRU list, so threads looking up different strikes rarely contend, and
+    each lookup only has to search the strikes in one stripe.
+
+    The memory and count budgets are shared by all the stripes.  When we go over budget, we purge
+    from the tails of the stripes in turn, locking one stripe at a time.
+*/
 class SkGlyphCache_Globals {
 public:
-    SkGlyphCache_Globals() {
-        fHead = nullptr;
-        fTotalMemoryUsed = 0;
-        fCacheSizeLimit = SK_DEFAULT_FONT_CACHE_LIMIT;
-        fCacheCount = 0;
-        fCacheCountLimit = SK_DEFAULT_FONT_CACHE_COUNT_LIMIT;
-    }
+    SkGlyphCache_Globals()
+        : fTotalMemoryUsed(0)
+        , fCacheSizeLimit(SK_DEFAULT_FONT_CACHE_LIMIT)
+        , fCacheCountLimit(SK_DEFAULT_FONT_CACHE_COUNT_LIMIT)
+        , fCacheCount(0)
+        , fNextPurgeStripe(0) {}
 
     ~SkGlyphCache_Globals() {
-        SkGlyphCache* cache = fHead;
-        while (cache) {
-            SkGlyphCache* next = cache->fNext;
-            delete cache;
-            cache = next;
+        for (Stripe& stripe : fStripes) {
+            SkGlyphCache* cache = stripe.fHead;
+            while (cache) {
+                SkGlyphCache* next = cache->fNext;
+                delete cache;
+                cache = next;
+            }
         }
     }
 
-    mutable SkSpinlock     fLock;
-
-    SkGlyphCache* internalGetHead() const { return fHead; }
-    SkGlyphCache* internalGetTail() const;
-
     size_t getTotalMemoryUsed() const;
     int getCacheCountUsed() const;
 
@@ -64,24 +71,49 @@ public:
 
     void purgeAll(); // does not change budget
 
+    // If a strike matching desc is cached, detach it and pass it to proc.  If proc returns false,
+    // reattach it and set *result to nullptr, otherwise set *result to the strike.
+    // Returns false if there's no matching strike.
+    bool findAndDetachCache(const SkDescriptor& desc, bool (*proc)(const SkGlyphCache*, void*),
+                            void* context, SkGlyphCache** result);
+
     // call when a glyphcache is available for caching (i.e. not in use)
     void attachCacheToHead(SkGlyphCache*);
 
-    // can only be called when the mutex is already held
-    void internalDetachCache(SkGlyphCache*);
-    void internalAttachCacheToHead(SkGlyphCache*);
+    void visitAll(SkGlyphCache::Visitor, void* context);
 
 private:
-    SkGlyphCache* fHead;
-    size_t  fTotalMemoryUsed;
-    size_t  fCacheSizeLimit;
-    int32_t fCacheCountLimit;
-    int32_t fCacheCount;
+    struct Stripe {
+        Stripe() : fHead(nullptr) {}
+
+        mutable SkSpinlock fLock;
+        SkGlyphCache*      fHead;    // Most recently used first.  Must hold fLock.
+    };
+
+    Stripe& stripeFor(const SkDescriptor& desc) {
+        // Use the high bits, in case the low ones are correlated with anything else.
+        return fStripes[((uint64_t)desc.getChecksum() * SK_FONT_CACHE_STRIPE_COUNT) >> 32];
+    }
+
+    // must hold stripe.fLock
+    void internalDetachCache(Stripe*, SkGlyphCache*);
+    void internalAttachCacheToHead(Stripe*, SkGlyphCache*);
 
     // Checkout budgets, modulated by the specified min-bytes-needed-to-purge,
     // and attempt to purge caches to match.
     // Returns number of bytes freed.
-    size_t internalPurge(size_t minBytesNeeded = 0);
+    size_t purge(size_t minBytesNeeded = 0);
+
+    Stripe fStripes[SK_FONT_CACHE_STRIPE_COUNT];
+
+    SkAtomic<size_t>  fTotalMemoryUsed;
+    SkAtomic<size_t>  fCacheSizeLimit;
+    SkAtomic<int32_t> fCacheCountLimit;
+    SkAtomic<int32_t> fCacheCount;
+
+    // Only one thread purges at a time.  It starts with fNextPurgeStripe.
+    SkSpinlock fPurgeLock;
+    int        fNextPurgeStripe;
 };
 
 #endif
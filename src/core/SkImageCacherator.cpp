@@ -5,6 +5,7 @@
  * found in the LICENSE file.
  */
 
+#include "SkAtomics.h"
 #include "SkBitmap.h"
 #include "SkBitmapCache.h"
 #include "SkImage_Base.h"
@@ -133,14 +134,33 @@ bool SkImageCacherator::lockAsBitmapOnlyIfAlreadyCached(SkBitmap* bitmap) {
     return SkBitmapCache::Find(fUniqueID, bitmap) && check_output_bitmap(*bitmap, fUniqueID);
 }
 
+static SkAtomic<int> gDecodes{0}, gAvoidedDecodes{0}, gCacheHits{0};
+
+void SkImageCacherator::GetDecodeStats(int* decodes, int* avoidedDecodes, int* cacheHits) {
+    *decodes        = gDecodes.load(sk_memory_order_relaxed);
+    *avoidedDecodes = gAvoidedDecodes.load(sk_memory_order_relaxed);
+    *cacheHits      = gCacheHits.load(sk_memory_order_relaxed);
+}
+
 bool SkImageCacherator::tryLockAsBitmap(SkBitmap* bitmap, const SkImage* client,
                                         SkImage::CachingHint chint) {
     if (this->lockAsBitmapOnlyIfAlreadyCached(bitmap)) {
+        gCacheHits.fetch_add(1, sk_memory_order_relaxed);
+        return true;
+    }
+
+    // If another thread is already decoding this image, wait for it and then use what it
+    // cached.  With kDisallow_CachingHint there is nothing to share, so we decode again, but
+    // the generator would have serialized us anyway.
+    SkAutoMutexAcquire decodeLock(fMutexForDecode);
+    if (this->lockAsBitmapOnlyIfAlreadyCached(bitmap)) {
+        gAvoidedDecodes.fetch_add(1, sk_memory_order_relaxed);
         return true;
     }
     if (!this->generateBitmap(bitmap)) {
         return false;
     }
+    gDecodes.fetch_add(1, sk_memory_order_relaxed);
 
     bitmap->pixelRef()->setImmutableWithID(fUniqueID);
     if (SkImage::kAllow_CachingHint == chint) {
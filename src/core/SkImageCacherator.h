@@ -67,6 +67,13 @@ public:
     bool directGeneratePixels(const SkImageInfo& dstInfo, void* dstPixels, size_t dstRB,
                               int srcX, int srcY);
 
+    /**
+     *  Returns how many times lockAsBitmap() has decoded, how many times it instead waited
+     *  for another thread's decode of the same image and used the bitmap that one cached, and
+     *  how many times it found the bitmap already cached without waiting.
+     */
+    static void GetDecodeStats(int* decodes, int* avoidedDecodes, int* cacheHits);
+
 private:
     SkImageCacherator(SkImageGenerator*, const SkImageInfo&, const SkIPoint&, uint32_t uniqueID);
 
@@ -92,6 +99,9 @@ private:
         operator SkImageGenerator*() const { return fCacher->fNotThreadSafeGenerator; }
     };
 
+    // Held while decoding in tryLockAsBitmap(), so that other threads that miss in the cache
+    // wait for that decode to land there instead of starting their own.
+    SkMutex                         fMutexForDecode;
     SkMutex                         fMutexForGenerator;
     SkAutoTDelete<SkImageGenerator> fNotThreadSafeGenerator;
 
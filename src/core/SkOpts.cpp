@@ -26,8 +26,10 @@
 #include "SkBlitMask_opts.h"
 #include "SkBlitRow_opts.h"
 #include "SkBlurImageFilter_opts.h"
+#include "SkBlurMask_opts.h"
 #include "SkColorCubeFilter_opts.h"
 #include "SkMorphologyImageFilter_opts.h"
+#include "SkRasterPipeline_opts.h"
 #include "SkSwizzler_opts.h"
 #include "SkTextureCompressor_opts.h"
 #include "SkXfermode_opts.h"
@@ -44,6 +46,8 @@ namespace SkOpts {
     DEFINE_DEFAULT(box_blur_xx);
     DEFINE_DEFAULT(box_blur_xy);
     DEFINE_DEFAULT(box_blur_yx);
+    DEFINE_DEFAULT(box_blur_a8);
+    DEFINE_DEFAULT(box_blur_a8_interp);
 
     DEFINE_DEFAULT(dilate_x);
     DEFINE_DEFAULT(dilate_y);
@@ -70,14 +74,22 @@ namespace SkOpts {
     DEFINE_DEFAULT(inverted_CMYK_to_BGR1);
 
     DEFINE_DEFAULT(srcover_srgb_srgb);
+
+    DEFINE_DEFAULT(stages_4);
+    DEFINE_DEFAULT(run_pipeline_4);
 #undef DEFINE_DEFAULT
 
+    RunPipeline     run_pipeline     = SK_OPTS_NS::run_pipeline_4;
+    FusePipeline    fuse_pipeline    = SK_OPTS_NS::fuse_pipeline_4;
+    CompilePipeline compile_pipeline = SK_OPTS_NS::compile_pipeline_4;
+    RunProgram      run_program      = SK_OPTS_NS::run_program_4;
+
     // Each Init_foo() is defined in src/opts/SkOpts_foo.cpp.
     void Init_ssse3();
     void Init_sse41();
     void Init_sse42() {}
     void Init_avx();
-    void Init_avx2() {}
+    void Init_avx2();
 
     static void init() {
     #if defined(SK_CPU_X86) && !defined(SK_BUILD_NO_OPTS)
@@ -8,6 +8,7 @@
 #ifndef SkOpts_DEFINED
 #define SkOpts_DEFINED
 
+#include "SkRasterPipeline.h"
 #include "SkTextureCompressor.h"
 #include "SkTypes.h"
 #include "SkXfermode.h"
@@ -28,6 +29,17 @@ namespace SkOpts {
     typedef void (*BoxBlur)(const SkPMColor*, int, const SkIRect& srcBounds, SkPMColor*, int, int, int, int, int);
     extern BoxBlur box_blur_xx, box_blur_xy, box_blur_yx;
 
+    // Box blur rows [y0,y1) of an A8 mask as SkBlurMask does, returning how many rows from y0
+    // were blurred.  The rest are left to the caller.
+    typedef int (*BoxBlurA8)(const uint8_t* src, int srcRowBytes, uint8_t* dst,
+                             int leftRadius, int rightRadius, int width, int height,
+                             bool transpose, int y0, int y1);
+    typedef int (*BoxBlurA8Interp)(const uint8_t* src, int srcRowBytes, uint8_t* dst,
+                                   int radius, int width, int height,
+                                   bool transpose, uint8_t outerWeight, int y0, int y1);
+    extern BoxBlurA8       box_blur_a8;
+    extern BoxBlurA8Interp box_blur_a8_interp;
+
     typedef void (*Morph)(const SkPMColor*, SkPMColor*, int, int, int, int, int);
     extern Morph dilate_x, dilate_y, erode_x, erode_y;
 
@@ -65,6 +77,30 @@ namespace SkOpts {
     // Blend ndst src pixels over dst, where both src and dst point to sRGB pixels (RGBA or BGRA).
     // If nsrc < ndst, we loop over src to create a pattern.
     extern void (*srcover_srgb_srgb)(uint32_t* dst, const uint32_t* src, int ndst, int nsrc);
+
+    // SkRasterPipeline's stock stages as 4-pixel Fns, indexed by StockStage.
+    extern const SkRasterPipeline::Fn* stages_4;
+
+    // Run a pipeline of stock stages over [x,x+n).  run_pipeline works as many pixels at a time
+    // as this CPU allows (8 with AVX2); run_pipeline_4 always works 4 at a time.
+    typedef SkRasterPipeline::RunStockFn RunPipeline;
+    extern RunPipeline run_pipeline, run_pipeline_4;
+
+    // Look up a kernel with this exact list of stock stages fused together, or return null.
+    // The kernel ignores run_pipeline's count argument.
+    typedef RunPipeline (*FusePipeline)(const SkRasterPipeline::Stock*, int count);
+    extern FusePipeline fuse_pipeline;
+
+    // What run_pipeline does, in two steps, so a pipeline run many times is only laid out once.
+    // compile_pipeline chains count stock stages together in program, which must have room for
+    // count Stages, and returns the Fn to start it with.  run_program runs that over [x,x+n).
+    // The Fns are as wide as run_pipeline's, so only run_program may call them.
+    typedef SkRasterPipeline::Fn (*CompilePipeline)(const SkRasterPipeline::Stock*, int count,
+                                                    SkRasterPipeline::Stage* program);
+    typedef void (*RunProgram)(size_t x, size_t n, SkRasterPipeline::Fn start,
+                               SkRasterPipeline::Stage* program);
+    extern CompilePipeline compile_pipeline;
+    extern RunProgram      run_program;
 }
 
 #endif//SkOpts_DEFINED
@@ -5,51 +5,110 @@
  * found in the LICENSE file.
  */
 
+#include "SkAtomics.h"
+#include "SkOpts.h"
 #include "SkRasterPipeline.h"
 
+static SkAtomic<int> gCompiled{0},
+                     gFused{0};
+
 SkRasterPipeline::SkRasterPipeline() {}
 
-void SkRasterPipeline::append(SkRasterPipeline::Fn body_fn, const void* body_ctx,
-                              SkRasterPipeline::Fn tail_fn, const void* tail_ctx) {
+void SkRasterPipeline::appendFn(SkRasterPipeline::Fn fn, const void* ctx) {
     // Each stage holds its own context and the next function to call.
     // So the pipeline itself has to hold onto the first function that starts the pipeline.
-    (fBody.empty() ? fBodyStart : fBody.back().fNext) = body_fn;
-    (fTail.empty() ? fTailStart : fTail.back().fNext) = tail_fn;
+    (fStages.empty() ? fStart : fStages.back().fNext) = fn;
 
     // Each last stage starts with its next function set to JustReturn as a safety net.
     // It'll be overwritten by the next call to append().
-    fBody.push_back({ &JustReturn, const_cast<void*>(body_ctx) });
-    fTail.push_back({ &JustReturn, const_cast<void*>(tail_ctx) });
+    fStages.push_back({ &JustReturn, const_cast<void*>(ctx) });
+    fCompiled = false;
+}
+
+void SkRasterPipeline::append(SkRasterPipeline::StockStage stage, const void* ctx) {
+    if (fAllStock) {
+        fStock.push_back({ stage, const_cast<void*>(ctx) });
+        fCompiled = false;
+    } else {
+        this->appendFn(SkOpts::stages_4[stage], ctx);
+    }
+}
+
+void SkRasterPipeline::append(SkRasterPipeline::Fn fn, const void* ctx) {
+    if (fAllStock) {
+        // From here on we run 4 pixels at a time through fStages, stock stages included.
+        fAllStock = false;
+        fStages.reset();
+        fStart = &JustReturn;
+        for (const Stock& stock : fStock) {
+            this->appendFn(SkOpts::stages_4[stock.fStage], stock.fCtx);
+        }
+        fStock.reset();
+    }
+    this->appendFn(fn, ctx);
 }
 
 void SkRasterPipeline::extend(const SkRasterPipeline& src) {
-    SkASSERT(src.fBody.count() == src.fTail.count());
+    if (src.fAllStock) {
+        for (const Stock& stock : src.fStock) {
+            this->append(stock.fStage, stock.fCtx);
+        }
+        return;
+    }
 
-    Fn body_fn = src.fBodyStart,
-       tail_fn = src.fTailStart;
-    for (int i = 0; i < src.fBody.count(); i++) {
-        this->append(body_fn, src.fBody[i].fCtx,
-                     tail_fn, src.fTail[i].fCtx);
-        body_fn = src.fBody[i].fNext;
-        tail_fn = src.fTail[i].fNext;
+    Fn fn = src.fStart;
+    for (const Stage& stage : src.fStages) {
+        this->append(fn, stage.fCtx);
+        fn = stage.fNext;
     }
 }
 
+void SkRasterPipeline::compile() {
+    fRun = nullptr;
+    if (fAllStock) {
+        fRun = SkOpts::fuse_pipeline(fStock.begin(), fStock.count());
+        if (fRun) {
+            gFused.fetch_add(1, sk_memory_order_relaxed);
+        } else {
+            fStages.reset();
+            fStages.push_back_n(fStock.count());
+            fStart = SkOpts::compile_pipeline(fStock.begin(), fStock.count(), fStages.begin());
+        }
+    }
+    gCompiled.fetch_add(1, sk_memory_order_relaxed);
+    fCompiled = true;
+}
+
+void SkRasterPipeline::GetFuseStats(int* compiled, int* fused) {
+    *compiled = gCompiled.load(sk_memory_order_relaxed);
+    *fused    = gFused   .load(sk_memory_order_relaxed);
+}
+
 void SkRasterPipeline::run(size_t x, size_t n) {
+    if (!fCompiled) {
+        this->compile();
+    }
+    if (fRun) {
+        fRun(x, n, fStock.begin(), fStock.count());
+        return;
+    }
+    if (fAllStock) {
+        SkOpts::run_program(x, n, fStart, fStages.begin());
+        return;
+    }
+
     // It's fastest to start uninitialized if the compilers all let us.  If not, next fastest is 0.
     Sk4f v;
 
     while (n >= 4) {
-        fBodyStart(fBody.begin(), x, v,v,v,v, v,v,v,v);
+        fStart(fStages.begin(), x,0, v,v,v,v, v,v,v,v);
         x += 4;
         n -= 4;
     }
-    while (n > 0) {
-        fTailStart(fTail.begin(), x, v,v,v,v, v,v,v,v);
-        x += 1;
-        n -= 1;
+    if (n > 0) {
+        fStart(fStages.begin(), x,n, v,v,v,v, v,v,v,v);
     }
 }
 
-void SK_VECTORCALL SkRasterPipeline::JustReturn(Stage*, size_t, Sk4f,Sk4f,Sk4f,Sk4f,
-                                                                Sk4f,Sk4f,Sk4f,Sk4f) {}
+void SK_VECTORCALL SkRasterPipeline::JustReturn(Stage*, size_t, size_t, Sk4f,Sk4f,Sk4f,Sk4f,
+                                                                        Sk4f,Sk4f,Sk4f,Sk4f) {}
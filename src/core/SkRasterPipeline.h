@@ -28,7 +28,10 @@
  *
  * The meaning of the arguments to Fn are sometimes fixed...
  *    - The Stage* always represents the current stage, mainly providing access to ctx().
- *    - The size_t is always the destination x coordinate.  If you need y, put it in your context.
+ *    - The first size_t is always the destination x coordinate.
+ *      If you need y, put it in your context.
+ *    - The second size_t is the tail: 0 when working with a full 4 pixels, otherwise the number
+ *      of pixels (1-3) that are actually there.  Only stages that touch memory need to care.
  *    - By the time the shader's done, the first four vectors should hold source red,
  *      green, blue, and alpha, up to 4 pixels' worth each.
  *
@@ -46,26 +49,41 @@
  * Some obvious stages that typically return are those that write a color to a destination pointer,
  * but any stage can short-circuit the rest of the pipeline by returning instead of calling next().
  *
+ * Most stages in practice are stock stages, named by StockStage and implemented in
+ * SkRasterPipeline_opts.h for any vector width.  A pipeline made only of stock stages is run like
+ * SkOpts::run_pipeline, with the widest vectors the CPU has (8 pixels at a time with AVX2).
+ * Custom Fn stages only come in a 4-pixel flavor, so any pipeline using them runs 4 at a time.
+ *
+ * Stock stages that read or write memory take a pointer to the pointer to pixel 0 of the row,
+ * so a pipeline can be built once and pointed at each row in turn.
+ *
  * TODO: explain EasyFn and SK_RASTER_STAGE
  */
 
+#define SK_RASTER_PIPELINE_STAGES(M)                             \
+    M(store_565) M(store_srgb) M(store_f16)                      \
+    M(load_s_srgb) M(load_d_srgb) M(load_d_565) M(load_d_f16)   \
+    M(scale_u8)                                                  \
+    M(lerp_u8) M(lerp_565) M(lerp_constant_float)                \
+    M(constant_color) M(srcover) M(clamp_01_premul)
+
 class SkRasterPipeline {
 public:
     struct Stage;
-    using Fn = void(SK_VECTORCALL *)(Stage*, size_t, Sk4f,Sk4f,Sk4f,Sk4f,
-                                                     Sk4f,Sk4f,Sk4f,Sk4f);
-    using EasyFn = void(void*, size_t, Sk4f&, Sk4f&, Sk4f&, Sk4f&,
-                                       Sk4f&, Sk4f&, Sk4f&, Sk4f&);
+    using Fn = void(SK_VECTORCALL *)(Stage*, size_t, size_t, Sk4f,Sk4f,Sk4f,Sk4f,
+                                                             Sk4f,Sk4f,Sk4f,Sk4f);
+    using EasyFn = void(void*, size_t, size_t, Sk4f&, Sk4f&, Sk4f&, Sk4f&,
+                                               Sk4f&, Sk4f&, Sk4f&, Sk4f&);
 
     struct Stage {
         template <typename T>
         T ctx() { return static_cast<T>(fCtx); }
 
-        void SK_VECTORCALL next(size_t x, Sk4f v0, Sk4f v1, Sk4f v2, Sk4f v3,
-                                          Sk4f v4, Sk4f v5, Sk4f v6, Sk4f v7) {
+        void SK_VECTORCALL next(size_t x, size_t tail, Sk4f v0, Sk4f v1, Sk4f v2, Sk4f v3,
+                                                       Sk4f v4, Sk4f v5, Sk4f v6, Sk4f v7) {
             // Stages are logically a pipeline, and physically are contiguous in an array.
             // To get to the next stage, we just increment our pointer to the next array element.
-            fNext(this+1, x, v0,v1,v2,v3, v4,v5,v6,v7);
+            fNext(this+1, x,tail, v0,v1,v2,v3, v4,v5,v6,v7);
         }
 
         // It makes next() a good bit cheaper if we hold the next function to call here,
@@ -74,77 +92,90 @@ public:
         void* fCtx;
     };
 
+    enum StockStage {
+    #define M(stage) stage,
+        SK_RASTER_PIPELINE_STAGES(M)
+    #undef M
+        kNumStockStages
+    };
+
+    // A stock stage and its context, as handed to SkOpts::run_pipeline.
+    struct Stock {
+        StockStage fStage;
+        void*      fCtx;
+    };
+
+    // Runs a list of stock stages over [x,x+n), e.g. SkOpts::run_pipeline.
+    using RunStockFn = void(*)(size_t x, size_t n, const Stock*, int count);
+
 
     SkRasterPipeline();
 
     // Run the pipeline constructed with append(), walking x through [x,x+n),
-    // generally in 4 pixel steps, but sometimes 1 pixel at a time.
+    // generally in 4 or 8 pixel steps, finishing with a single partial step if needed.
     void run(size_t x, size_t n);
     void run(size_t n) { this->run(0, n); }
 
-    // Use this append() if your stage is sensitive to the number of pixels you're working with:
-    //   - body will always be called for a full 4 pixels
-    //   - tail will always be called for a single pixel
-    // Typically this is only an essential distintion for stages that read or write memory.
-    void append(Fn body, const void* body_ctx,
-                Fn tail, const void* tail_ctx);
-
-    // Most stages don't actually care if they're working on 4 or 1 pixel.
-    void append(Fn fn, const void* ctx = nullptr) {
-        this->append(fn, ctx, fn, ctx);
-    }
-
-    // Most 4 pixel or 1 pixel variants share the same context pointer.
-    void append(Fn body, Fn tail, const void* ctx = nullptr) {
-        this->append(body, ctx, tail, ctx);
-    }
+    void append(StockStage, const void* ctx = nullptr);
 
+    // A custom stage.  If fn reads or writes memory, it must respect the tail.
+    void append(Fn fn, const void* ctx = nullptr);
 
-    // Versions of append that can be used with static EasyFns (see SK_RASTER_STAGE).
-    template <EasyFn body, EasyFn tail>
-    void append(const void* body_ctx, const void* tail_ctx) {
-        this->append(Easy<body>, body_ctx,
-                     Easy<tail>, tail_ctx);
-    }
-
+    // Version of append that can be used with static EasyFns (see SK_RASTER_STAGE).
     template <EasyFn fn>
-    void append(const void* ctx = nullptr) { this->append<fn, fn>(ctx, ctx); }
-
-    template <EasyFn body, EasyFn tail>
-    void append(const void* ctx = nullptr) { this->append<body, tail>(ctx, ctx); }
+    void append(const void* ctx = nullptr) { this->append(Easy<fn>, ctx); }
 
 
     // Append all stages to this pipeline.
     void extend(const SkRasterPipeline&);
 
+    // Compiling a pipeline finds how to run it: if it's made of stock stages in an order SkOpts
+    // has a fused kernel for, we run that kernel instead of calling through stages.  run()
+    // compiles a pipeline first if it has changed since it was last compiled.
+    void compile();
+
+    // How many pipelines have been compiled, and how many of them got a fused kernel.
+    // Pipelines are compiled once per blitter, not per span, so counting is cheap.
+    static void GetFuseStats(int* compiled, int* fused);
+
 private:
     using Stages = SkSTArray<10, Stage, /*MEM_COPY=*/true>;
 
-    // This no-op default makes fBodyStart and fTailStart unconditionally safe to call,
+    void appendFn(Fn, const void* ctx);
+
+    // This no-op default makes fStart unconditionally safe to call,
     // and is always the last stage's fNext as a sort of safety net to make sure even a
     // buggy pipeline can't walk off its own end.
-    static void SK_VECTORCALL JustReturn(Stage*, size_t, Sk4f,Sk4f,Sk4f,Sk4f,
-                                                         Sk4f,Sk4f,Sk4f,Sk4f);
+    static void SK_VECTORCALL JustReturn(Stage*, size_t, size_t, Sk4f,Sk4f,Sk4f,Sk4f,
+                                                                 Sk4f,Sk4f,Sk4f,Sk4f);
 
     template <EasyFn kernel>
-    static void SK_VECTORCALL Easy(SkRasterPipeline::Stage* st, size_t x,
+    static void SK_VECTORCALL Easy(SkRasterPipeline::Stage* st, size_t x, size_t tail,
                                    Sk4f  r, Sk4f  g, Sk4f  b, Sk4f  a,
                                    Sk4f dr, Sk4f dg, Sk4f db, Sk4f da) {
-        kernel(st->ctx<void*>(), x, r,g,b,a, dr,dg,db,da);
-        st->next(x, r,g,b,a, dr,dg,db,da);
+        kernel(st->ctx<void*>(), x,tail, r,g,b,a, dr,dg,db,da);
+        st->next(x,tail, r,g,b,a, dr,dg,db,da);
     }
 
-    Stages fBody,
-           fTail;
-    Fn fBodyStart = &JustReturn,
-       fTailStart = &JustReturn;
+    // While this pipeline is made only of stock stages, they are listed in fStock, and compile()
+    // lays them out in fStages with SkOpts::compile_pipeline, for SkOpts::run_program.  Once a
+    // custom stage is appended, fStages holds every stage, stock or custom, as a 4-pixel Fn.
+    Stages fStages;
+    Fn fStart = &JustReturn;
+
+    SkSTArray<10, Stock, /*MEM_COPY=*/true> fStock;
+    bool fAllStock = true;
+
+    // Set by compile(): a fused kernel to run fStock with, or null.
+    RunStockFn fRun = nullptr;
+    bool fCompiled = false;
 };
 
 // These are always static, and we _really_ want them to inline.
 // If you find yourself wanting a non-inline stage, write a SkRasterPipeline::Fn directly.
-#define SK_RASTER_STAGE(name)                                       \
-    static SK_ALWAYS_INLINE void name(void* ctx, size_t x,          \
-                            Sk4f&  r, Sk4f&  g, Sk4f&  b, Sk4f&  a, \
+#define SK_RASTER_STAGE(name)                                           \
+    static SK_ALWAYS_INLINE void name(void* ctx, size_t x, size_t tail, \
+                            Sk4f&  r, Sk4f&  g, Sk4f&  b, Sk4f&  a,     \
                             Sk4f& dr, Sk4f& dg, Sk4f& db, Sk4f& da)
 
 #endif//SkRasterPipeline_DEFINED
@@ -8,11 +8,9 @@
 #include "SkBlitter.h"
 #include "SkColor.h"
 #include "SkColorFilter.h"
-#include "SkHalf.h"
 #include "SkPM4f.h"
 #include "SkRasterPipeline.h"
 #include "SkShader.h"
-#include "SkSRGB.h"
 #include "SkXfermode.h"
 
 
@@ -41,13 +39,23 @@ public:
     // blits using something like a SkRasterPipeline::runFew() method.
 
 private:
-    void append_load_d(SkRasterPipeline*, const void*) const;
-    void append_store (SkRasterPipeline*,       void*) const;
+    void append_load_d(SkRasterPipeline*) const;
+    void append_store (SkRasterPipeline*) const;
+
+    // Builds and compiles the blit pipelines below once, for every span to share.
+    void buildPipelines();
 
     SkPixmap         fDst;
     SkRasterPipeline fShader, fColorFilter, fXfermode;
     SkPM4f           fPaintColor;
 
+    // The memory stages of these pipelines read the pointers below, which are set per span.
+    SkRasterPipeline fBlitH, fBlitAntiH, fBlitMaskA8, fBlitMaskLCD16;
+
+    void*       fDstPtr   = nullptr;
+    const void* fMaskPtr  = nullptr;
+    float       fCoverage = 0.0f;
+
     typedef SkBlitter INHERITED;
 };
 
@@ -57,229 +65,6 @@ SkBlitter* SkCreateRasterPipelineBlitter(const SkPixmap& dst,
     return SkRasterPipelineBlitter::Create(dst, paint, alloc);
 }
 
-// Clamp colors into [0,1] premul (e.g. just before storing back to memory).
-SK_RASTER_STAGE(clamp_01_premul) {
-    a = Sk4f::Max(a, 0.0f);
-    r = Sk4f::Max(r, 0.0f);
-    g = Sk4f::Max(g, 0.0f);
-    b = Sk4f::Max(b, 0.0f);
-
-    a = Sk4f::Min(a, 1.0f);
-    r = Sk4f::Min(r, a);
-    g = Sk4f::Min(g, a);
-    b = Sk4f::Min(b, a);
-}
-
-// The default shader produces a constant color (from the SkPaint).
-SK_RASTER_STAGE(constant_color) {
-    auto color = (const SkPM4f*)ctx;
-    r = color->r();
-    g = color->g();
-    b = color->b();
-    a = color->a();
-}
-
-// The default transfer mode is srcover, s' = s + d*(1-sa).
-SK_RASTER_STAGE(srcover) {
-    r += dr*(1.0f - a);
-    g += dg*(1.0f - a);
-    b += db*(1.0f - a);
-    a += da*(1.0f - a);
-}
-
-static Sk4f lerp(const Sk4f& from, const Sk4f& to, const Sk4f& cov) {
-    return from + (to-from)*cov;
-}
-
-// s' = d(1-c) + sc, for a constant c.
-SK_RASTER_STAGE(lerp_constant_float) {
-    Sk4f c = *(const float*)ctx;
-
-    r = lerp(dr, r, c);
-    g = lerp(dg, g, c);
-    b = lerp(db, b, c);
-    a = lerp(da, a, c);
-}
-
-// s' = d(1-c) + sc, 4 pixels at a time for 8-bit coverage.
-SK_RASTER_STAGE(lerp_a8) {
-    auto ptr = (const uint8_t*)ctx + x;
-    Sk4f c = SkNx_cast<float>(Sk4b::Load(ptr)) * (1/255.0f);
-
-    r = lerp(dr, r, c);
-    g = lerp(dg, g, c);
-    b = lerp(db, b, c);
-    a = lerp(da, a, c);
-}
-
-// Tail variant of lerp_a8() handling 1 pixel at a time.
-SK_RASTER_STAGE(lerp_a8_1) {
-    auto ptr = (const uint8_t*)ctx + x;
-    Sk4f c = *ptr * (1/255.0f);
-
-    r = lerp(dr, r, c);
-    g = lerp(dg, g, c);
-    b = lerp(db, b, c);
-    a = lerp(da, a, c);
-}
-
-static void from_565(const Sk4h& _565, Sk4f* r, Sk4f* g, Sk4f* b) {
-    Sk4i _32_bit = SkNx_cast<int>(_565);
-
-    *r = SkNx_cast<float>(_32_bit & SK_R16_MASK_IN_PLACE) * (1.0f / SK_R16_MASK_IN_PLACE);
-    *g = SkNx_cast<float>(_32_bit & SK_G16_MASK_IN_PLACE) * (1.0f / SK_G16_MASK_IN_PLACE);
-    *b = SkNx_cast<float>(_32_bit & SK_B16_MASK_IN_PLACE) * (1.0f / SK_B16_MASK_IN_PLACE);
-}
-
-static Sk4h to_565(const Sk4f& r, const Sk4f& g, const Sk4f& b) {
-    return SkNx_cast<uint16_t>( Sk4f_round(r * SK_R16_MASK) << SK_R16_SHIFT
-                              | Sk4f_round(g * SK_G16_MASK) << SK_G16_SHIFT
-                              | Sk4f_round(b * SK_B16_MASK) << SK_B16_SHIFT);
-}
-
-// s' = d(1-c) + sc, 4 pixels at a time for 565 coverage.
-SK_RASTER_STAGE(lerp_lcd16) {
-    auto ptr = (const uint16_t*)ctx + x;
-    Sk4f cr, cg, cb;
-    from_565(Sk4h::Load(ptr), &cr, &cg, &cb);
-
-    r = lerp(dr, r, cr);
-    g = lerp(dg, g, cg);
-    b = lerp(db, b, cb);
-    a = 1.0f;
-}
-
-// Tail variant of lerp_lcd16() handling 1 pixel at a time.
-SK_RASTER_STAGE(lerp_lcd16_1) {
-    auto ptr = (const uint16_t*)ctx + x;
-    Sk4f cr, cg, cb;
-    from_565({*ptr,0,0,0}, &cr, &cg, &cb);
-
-    r = lerp(dr, r, cr);
-    g = lerp(dg, g, cg);
-    b = lerp(db, b, cb);
-    a = 1.0f;
-}
-
-// Load 4 565 dst pixels.
-SK_RASTER_STAGE(load_d_565) {
-    auto ptr = (const uint16_t*)ctx + x;
-
-    from_565(Sk4h::Load(ptr), &dr,&dg,&db);
-    da = 1.0f;
-}
-
-// Load 1 565 dst pixel.
-SK_RASTER_STAGE(load_d_565_1) {
-    auto ptr = (const uint16_t*)ctx + x;
-
-    from_565({*ptr,0,0,0}, &dr,&dg,&db);
-    da = 1.0f;
-}
-
-// Store 4 565 pixels.
-SK_RASTER_STAGE(store_565) {
-    auto ptr = (uint16_t*)ctx + x;
-    to_565(r,g,b).store(ptr);
-}
-
-// Store 1 565 pixel.
-SK_RASTER_STAGE(store_565_1) {
-    auto ptr = (uint16_t*)ctx + x;
-    *ptr = to_565(r,g,b)[0];
-}
-
-// Load 4 F16 pixels.
-SK_RASTER_STAGE(load_d_f16) {
-    auto ptr = (const uint64_t*)ctx + x;
-
-    Sk4h rh, gh, bh, ah;
-    Sk4h_load4(ptr, &rh, &gh, &bh, &ah);
-
-    dr = SkHalfToFloat_finite(rh);
-    dg = SkHalfToFloat_finite(gh);
-    db = SkHalfToFloat_finite(bh);
-    da = SkHalfToFloat_finite(ah);
-}
-
-// Load 1 F16 pixel.
-SK_RASTER_STAGE(load_d_f16_1) {
-    auto ptr = (const uint64_t*)ctx + x;
-
-    auto p0 = SkHalfToFloat_finite(ptr[0]);
-    dr = { p0[0],0,0,0 };
-    dg = { p0[1],0,0,0 };
-    db = { p0[2],0,0,0 };
-    da = { p0[3],0,0,0 };
-}
-
-// Store 4 F16 pixels.
-SK_RASTER_STAGE(store_f16) {
-    auto ptr = (uint64_t*)ctx + x;
-
-    Sk4h_store4(ptr, SkFloatToHalf_finite(r), SkFloatToHalf_finite(g),
-                     SkFloatToHalf_finite(b), SkFloatToHalf_finite(a));
-}
-
-// Store 1 F16 pixel.
-SK_RASTER_STAGE(store_f16_1) {
-    auto ptr = (uint64_t*)ctx + x;
-
-    SkFloatToHalf_finite({r[0], g[0], b[0], a[0]}).store(ptr);
-}
-
-// Load 4 8-bit sRGB pixels from SkPMColor order to RGBA.
-SK_RASTER_STAGE(load_d_srgb) {
-    auto ptr = (const uint32_t*)ctx + x;
-
-    dr = { sk_linear_from_srgb[(ptr[0] >> SK_R32_SHIFT) & 0xff],
-           sk_linear_from_srgb[(ptr[1] >> SK_R32_SHIFT) & 0xff],
-           sk_linear_from_srgb[(ptr[2] >> SK_R32_SHIFT) & 0xff],
-           sk_linear_from_srgb[(ptr[3] >> SK_R32_SHIFT) & 0xff] };
-
-    dg = { sk_linear_from_srgb[(ptr[0] >> SK_G32_SHIFT) & 0xff],
-           sk_linear_from_srgb[(ptr[1] >> SK_G32_SHIFT) & 0xff],
-           sk_linear_from_srgb[(ptr[2] >> SK_G32_SHIFT) & 0xff],
-           sk_linear_from_srgb[(ptr[3] >> SK_G32_SHIFT) & 0xff] };
-
-    db = { sk_linear_from_srgb[(ptr[0] >> SK_B32_SHIFT) & 0xff],
-           sk_linear_from_srgb[(ptr[1] >> SK_B32_SHIFT) & 0xff],
-           sk_linear_from_srgb[(ptr[2] >> SK_B32_SHIFT) & 0xff],
-           sk_linear_from_srgb[(ptr[3] >> SK_B32_SHIFT) & 0xff] };
-
-    da = SkNx_cast<float>(Sk4u::Load(ptr) >> SK_A32_SHIFT) * (1/255.0f);
-}
-
-// Tail variant of load_d_srgb() handling 1 pixel at a time.
-SK_RASTER_STAGE(load_d_srgb_1) {
-    auto ptr = (const uint32_t*)ctx + x;
-
-    dr = { sk_linear_from_srgb[(*ptr >> SK_R32_SHIFT) & 0xff], 0,0,0 };
-    dg = { sk_linear_from_srgb[(*ptr >> SK_G32_SHIFT) & 0xff], 0,0,0 };
-    db = { sk_linear_from_srgb[(*ptr >> SK_B32_SHIFT) & 0xff], 0,0,0 };
-    da = {        (1/255.0f) * (*ptr >> SK_A32_SHIFT)        , 0,0,0 };
-}
-
-// Write out 4 pixels as 8-bit SkPMColor-order sRGB.
-SK_RASTER_STAGE(store_srgb) {
-    auto ptr = (uint32_t*)ctx + x;
-    ( sk_linear_to_srgb_noclamp(r) << SK_R32_SHIFT
-    | sk_linear_to_srgb_noclamp(g) << SK_G32_SHIFT
-    | sk_linear_to_srgb_noclamp(b) << SK_B32_SHIFT
-    |       Sk4f_round(255.0f * a) << SK_A32_SHIFT).store(ptr);
-}
-
-// Tail variant of store_srgb() handling 1 pixel at a time.
-SK_RASTER_STAGE(store_srgb_1) {
-    auto ptr = (uint32_t*)ctx + x;
-    Sk4i rgb = sk_linear_to_srgb_noclamp(swizzle_rb_if_bgra({ r[0], g[0], b[0], 0.0f }));
-
-    uint32_t rgba;
-    SkNx_cast<uint8_t>(rgb).store(&rgba);
-    rgba |= (uint32_t)(255.0f * a[0] + 0.5f) << 24;
-    *ptr = rgba;
-}
-
 static bool supported(const SkImageInfo& info) {
     switch (info.colorType()) {
         case kN32_SkColorType:      return info.gammaCloseToSRGB();
@@ -326,82 +111,95 @@ SkBlitter* SkRasterPipelineBlitter::Create(const SkPixmap& dst,
             color.premul());
 
     if (!paint.getShader()) {
-        blitter->fShader.append<constant_color>(&blitter->fPaintColor);
+        blitter->fShader.append(SkRasterPipeline::constant_color, &blitter->fPaintColor);
     }
     if (!paint.getXfermode()) {
-        blitter->fXfermode.append<srcover>();
+        blitter->fXfermode.append(SkRasterPipeline::srcover);
     }
+    blitter->buildPipelines();
 
     return blitter;
 }
 
-void SkRasterPipelineBlitter::append_load_d(SkRasterPipeline* p, const void* dst) const {
+void SkRasterPipelineBlitter::buildPipelines() {
+    SkRasterPipeline common;
+    common.extend(fShader);
+    common.extend(fColorFilter);
+    this->append_load_d(&common);
+    common.extend(fXfermode);
+
+    fBlitH.extend(common);
+    this->append_store(&fBlitH);
+
+    fBlitAntiH.extend(common);
+    fBlitAntiH.append(SkRasterPipeline::lerp_constant_float, &fCoverage);
+    this->append_store(&fBlitAntiH);
+
+    fBlitMaskA8.extend(common);
+    fBlitMaskA8.append(SkRasterPipeline::lerp_u8, &fMaskPtr);
+    this->append_store(&fBlitMaskA8);
+
+    fBlitMaskLCD16.extend(common);
+    fBlitMaskLCD16.append(SkRasterPipeline::lerp_565, &fMaskPtr);
+    this->append_store(&fBlitMaskLCD16);
+
+    fBlitH        .compile();
+    fBlitAntiH    .compile();
+    fBlitMaskA8   .compile();
+    fBlitMaskLCD16.compile();
+}
+
+void SkRasterPipelineBlitter::append_load_d(SkRasterPipeline* p) const {
     SkASSERT(supported(fDst.info()));
+    const void* dst = &fDstPtr;
 
     switch (fDst.info().colorType()) {
         case kN32_SkColorType:
             if (fDst.info().gammaCloseToSRGB()) {
-                p->append<load_d_srgb, load_d_srgb_1>(dst);
+                p->append(SkRasterPipeline::load_d_srgb, dst);
             }
             break;
         case kRGBA_F16_SkColorType:
-            p->append<load_d_f16, load_d_f16_1>(dst);
+            p->append(SkRasterPipeline::load_d_f16, dst);
             break;
         case kRGB_565_SkColorType:
-            p->append<load_d_565, load_d_565_1>(dst);
+            p->append(SkRasterPipeline::load_d_565, dst);
             break;
         default: break;
     }
 }
 
-void SkRasterPipelineBlitter::append_store(SkRasterPipeline* p, void* dst) const {
+void SkRasterPipelineBlitter::append_store(SkRasterPipeline* p) const {
     SkASSERT(supported(fDst.info()));
+    const void* dst = &fDstPtr;
 
-    p->append<clamp_01_premul>();
+    p->append(SkRasterPipeline::clamp_01_premul);
     switch (fDst.info().colorType()) {
         case kN32_SkColorType:
             if (fDst.info().gammaCloseToSRGB()) {
-                p->append<store_srgb, store_srgb_1>(dst);
+                p->append(SkRasterPipeline::store_srgb, dst);
             }
             break;
         case kRGBA_F16_SkColorType:
-            p->append<store_f16, store_f16_1>(dst);
+            p->append(SkRasterPipeline::store_f16, dst);
             break;
         case kRGB_565_SkColorType:
-            p->append<store_565, store_565_1>(dst);
+            p->append(SkRasterPipeline::store_565, dst);
             break;
         default: break;
     }
 }
 
 void SkRasterPipelineBlitter::blitH(int x, int y, int w) {
-    auto dst = fDst.writable_addr(0,y);
-
-    SkRasterPipeline p;
-    p.extend(fShader);
-    p.extend(fColorFilter);
-    this->append_load_d(&p, dst);
-    p.extend(fXfermode);
-    this->append_store(&p, dst);
-
-    p.run(x, w);
+    fDstPtr = fDst.writable_addr(0,y);
+    fBlitH.run(x, w);
 }
 
 void SkRasterPipelineBlitter::blitAntiH(int x, int y, const SkAlpha aa[], const int16_t runs[]) {
-    auto dst = fDst.writable_addr(0,y);
-    float coverage;
-
-    SkRasterPipeline p;
-    p.extend(fShader);
-    p.extend(fColorFilter);
-    this->append_load_d(&p, dst);
-    p.extend(fXfermode);
-    p.append<lerp_constant_float>(&coverage);
-    this->append_store(&p, dst);
-
+    fDstPtr = fDst.writable_addr(0,y);
     for (int16_t run = *runs; run > 0; run = *runs) {
-        coverage = *aa * (1/255.0f);
-        p.run(x, run);
+        fCoverage = *aa * (1/255.0f);
+        fBlitAntiH.run(x, run);
 
         x    += run;
         runs += run;
@@ -417,24 +215,18 @@ void SkRasterPipelineBlitter::blitMask(const SkMask& mask, const SkIRect& clip)
 
     int x = clip.left();
     for (int y = clip.top(); y < clip.bottom(); y++) {
-        auto dst = fDst.writable_addr(0,y);
+        fDstPtr = fDst.writable_addr(0,y);
 
-        SkRasterPipeline p;
-        p.extend(fShader);
-        p.extend(fColorFilter);
-        this->append_load_d(&p, dst);
-        p.extend(fXfermode);
         switch (mask.fFormat) {
             case SkMask::kA8_Format:
-                p.append<lerp_a8, lerp_a8_1>(mask.getAddr8(x,y)-x);
+                fMaskPtr = mask.getAddr8(x,y)-x;
+                fBlitMaskA8.run(x, clip.width());
                 break;
             case SkMask::kLCD16_Format:
-                p.append<lerp_lcd16, lerp_lcd16_1>(mask.getAddrLCD16(x,y)-x);
+                fMaskPtr = mask.getAddrLCD16(x,y)-x;
+                fBlitMaskLCD16.run(x, clip.width());
                 break;
             default: break;
         }
-        this->append_store(&p, dst);
-
-        p.run(x, clip.width());
     }
 }
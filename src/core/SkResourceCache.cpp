@@ -5,6 +5,7 @@
  * found in the LICENSE file.
  */
 
+#include "SkAtomics.h"
 #include "SkChecksum.h"
 #include "SkMessageBus.h"
 #include "SkMipMap.h"
@@ -29,6 +30,12 @@ DECLARE_SKMESSAGEBUS_MESSAGE(SkResourceCache::PurgeSharedIDMessage)
     #define SK_DEFAULT_IMAGE_CACHE_LIMIT     (32 * 1024 * 1024)
 #endif
 
+// How many independently locked pieces the global cache is split into.
+#ifndef SK_RESOURCE_CACHE_SHARD_COUNT
+    #define SK_RESOURCE_CACHE_SHARD_COUNT    8
+#endif
+static const int kShardCount = SK_RESOURCE_CACHE_SHARD_COUNT;
+
 void SkResourceCache::Key::init(void* nameSpace, uint64_t sharedID, size_t dataSize) {
     SkASSERT(SkAlign4(dataSize) == dataSize);
 
@@ -66,6 +73,7 @@ void SkResourceCache::init() {
     fTotalBytesUsed = 0;
     fCount = 0;
     fSingleAllocationByteLimit = 0;
+    fDiscardableCountLimit = SK_DISCARDABLEMEMORY_SCALEDIMAGECACHE_COUNT_LIMIT;
     fAllocator = nullptr;
 
     // One of these should be explicit set by the caller after we return.
@@ -301,7 +309,7 @@ void SkResourceCache::purgeAsNeeded(bool forcePurge) {
     int    countLimit;
 
     if (fDiscardableFactory) {
-        countLimit = SK_DISCARDABLEMEMORY_SCALEDIMAGECACHE_COUNT_LIMIT;
+        countLimit = fDiscardableCountLimit;
         byteLimit = SK_MaxU32;  // no limit based on bytes
     } else {
         countLimit = SK_MaxS32; // no limit based on count
@@ -542,91 +550,198 @@ void SkResourceCache::checkMessages() {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-SK_DECLARE_STATIC_MUTEX(gMutex);
-static SkResourceCache* gResourceCache = nullptr;
+// The global cache is split into shards, each with its own mutex and LRU list.  Recs are
+// assigned to shards by their Key's hash, so threads working on unrelated resources rarely wait
+// on each other.
+//
+// The byte budget is not split: the shards never purge on their own, and instead count their
+// bytes in gBytesUsed.  Whoever takes that over gByteLimit purges the oldest Recs of each shard
+// in turn until it fits again, so one shard can use the whole budget.
+#ifdef SK_USE_DISCARDABLE_SCALEDIMAGECACHE
+    static SkAtomic<size_t, sk_memory_order_relaxed> gByteLimit(0);
+#else
+    static SkAtomic<size_t, sk_memory_order_relaxed> gByteLimit(SK_DEFAULT_IMAGE_CACHE_LIMIT);
+#endif
+static SkAtomic<size_t, sk_memory_order_relaxed> gBytesUsed(0);
 
-/** Must hold gMutex when calling. */
-static SkResourceCache* get_cache() {
-    // gMutex is always held when this is called, so we don't need to be fancy in here.
-    gMutex.assertHeld();
-    if (nullptr == gResourceCache) {
+struct SkResourceCacheShard {
+    SkBaseMutex      fMutex;
+    SkResourceCache* fCache = nullptr;  // Created on first use.  Must hold fMutex.
+
+    SkResourceCache* cache() {
+        // fMutex is always held when this is called, so we don't need to be fancy in here.
+        fMutex.assertHeld();
+        if (nullptr == fCache) {
 #ifdef SK_USE_DISCARDABLE_SCALEDIMAGECACHE
-        gResourceCache = new SkResourceCache(SkDiscardableMemory::Create);
+            fCache = new SkResourceCache(SkDiscardableMemory::Create);
+            fCache->fDiscardableCountLimit =
+                    SkTMax(1, SK_DISCARDABLEMEMORY_SCALEDIMAGECACHE_COUNT_LIMIT / kShardCount);
 #else
-        gResourceCache = new SkResourceCache(SK_DEFAULT_IMAGE_CACHE_LIMIT);
+            fCache = new SkResourceCache(SIZE_MAX);
 #endif
+        }
+        return fCache;
+    }
+
+    // Calls fn(cache()) with fMutex held, and counts any bytes it adds or removes in gBytesUsed.
+    template <typename Fn>
+    auto locked(Fn&& fn) -> decltype(fn((SkResourceCache*)nullptr)) {
+        SkAutoMutexAcquire am(fMutex);
+        struct Counter {
+            SkResourceCache* fCache;
+            size_t           fBefore;
+            ~Counter() { gBytesUsed.fetch_add(fCache->getTotalBytesUsed() - fBefore); }
+        } counter = { this->cache(), this->cache()->getTotalBytesUsed() };
+        return fn(counter.fCache);
+    }
+
+    // Removes this shard's least recently used Rec, if it has more than keep of them.
+    bool purgeOldest(int keep) {
+        return this->locked([keep](SkResourceCache* cache) {
+            if (cache->fCount <= keep) {
+                return false;
+            }
+            cache->remove(cache->fTail);
+            return true;
+        });
+    }
+};
+
+static SkResourceCacheShard gShards[kShardCount];
+
+static SkResourceCacheShard& shard_for(uint32_t hash) {
+    // Use the high bits of the hash: each shard's SkTDynamicHash indexes with the low bits.
+    return gShards[((uint64_t)hash * kShardCount) >> 32];
+}
+
+// Recs that don't have a Key yet (e.g. SkCachedData) are spread over the shards round-robin.
+static SkResourceCacheShard& next_shard() {
+    static SkAtomic<uint32_t, sk_memory_order_relaxed> gNext(0);
+    return gShards[gNext.fetch_add(1) % kShardCount];
+}
+
+static bool over_budget() {
+#ifdef SK_USE_DISCARDABLE_SCALEDIMAGECACHE
+    return false;  // Discardable shards each limit how many Recs they hold instead.
+#else
+    return gBytesUsed.load() > gByteLimit.load();
+#endif
+}
+
+// Purges until the shards fit in gByteLimit again, taking one Rec at a time from each shard so
+// that none of them pays for the others.  We hold one shard's mutex at a time.  The Rec just
+// added to 'adder' is at the head of its list, so that shard keeps its last Rec until every
+// other shard is empty: a Rec only goes right away if it is bigger than the whole budget.
+static void purge_to_budget(SkResourceCacheShard* adder) {
+    bool purged = true;
+    while (purged && over_budget()) {
+        purged = false;
+        for (SkResourceCacheShard& shard : gShards) {
+            if (!over_budget()) {
+                return;
+            }
+            purged |= shard.purgeOldest(&shard == adder ? 1 : 0);
+        }
+    }
+    if (adder) {
+        while (over_budget() && adder->purgeOldest(0)) {}
     }
-    return gResourceCache;
 }
 
 size_t SkResourceCache::GetTotalBytesUsed() {
-    SkAutoMutexAcquire am(gMutex);
-    return get_cache()->getTotalBytesUsed();
+    return gBytesUsed.load();
 }
 
 size_t SkResourceCache::GetTotalByteLimit() {
-    SkAutoMutexAcquire am(gMutex);
-    return get_cache()->getTotalByteLimit();
+    return gByteLimit.load();
 }
 
 size_t SkResourceCache::SetTotalByteLimit(size_t newLimit) {
-    SkAutoMutexAcquire am(gMutex);
-    return get_cache()->setTotalByteLimit(newLimit);
+    size_t prevLimit = gByteLimit.load();
+    while (!gByteLimit.compare_exchange(&prevLimit, newLimit)) {}
+    if (newLimit < prevLimit) {
+        purge_to_budget(nullptr);
+    }
+    return prevLimit;
 }
 
 SkResourceCache::DiscardableFactory SkResourceCache::GetDiscardableFactory() {
-    SkAutoMutexAcquire am(gMutex);
-    return get_cache()->discardableFactory();
+    // All the shards share the same settings, so we can ask any one of them.
+    SkAutoMutexAcquire am(gShards[0].fMutex);
+    return gShards[0].cache()->discardableFactory();
 }
 
 SkBitmap::Allocator* SkResourceCache::GetAllocator() {
-    SkAutoMutexAcquire am(gMutex);
-    return get_cache()->allocator();
+    SkAutoMutexAcquire am(gShards[0].fMutex);
+    return gShards[0].cache()->allocator();
 }
 
 SkCachedData* SkResourceCache::NewCachedData(size_t bytes) {
-    SkAutoMutexAcquire am(gMutex);
-    return get_cache()->newCachedData(bytes);
+    return next_shard().locked([bytes](SkResourceCache* cache) {
+        return cache->newCachedData(bytes);
+    });
 }
 
 void SkResourceCache::Dump() {
-    SkAutoMutexAcquire am(gMutex);
-    get_cache()->dump();
+    for (SkResourceCacheShard& shard : gShards) {
+        SkAutoMutexAcquire am(shard.fMutex);
+        shard.cache()->dump();
+    }
 }
 
 size_t SkResourceCache::SetSingleAllocationByteLimit(size_t size) {
-    SkAutoMutexAcquire am(gMutex);
-    return get_cache()->setSingleAllocationByteLimit(size);
+    size_t prevLimit = 0;
+    for (SkResourceCacheShard& shard : gShards) {
+        SkAutoMutexAcquire am(shard.fMutex);
+        prevLimit = shard.cache()->setSingleAllocationByteLimit(size);
+    }
+    return prevLimit;
 }
 
 size_t SkResourceCache::GetSingleAllocationByteLimit() {
-    SkAutoMutexAcquire am(gMutex);
-    return get_cache()->getSingleAllocationByteLimit();
+    SkAutoMutexAcquire am(gShards[0].fMutex);
+    return gShards[0].cache()->getSingleAllocationByteLimit();
 }
 
 size_t SkResourceCache::GetEffectiveSingleAllocationByteLimit() {
-    SkAutoMutexAcquire am(gMutex);
-    return get_cache()->getEffectiveSingleAllocationByteLimit();
+    // Like getEffectiveSingleAllocationByteLimit(), capped by the whole budget, which any one
+    // shard may use.
+    size_t limit;
+    bool discardable;
+    {
+        SkAutoMutexAcquire am(gShards[0].fMutex);
+        limit = gShards[0].cache()->getSingleAllocationByteLimit();
+        discardable = nullptr != gShards[0].cache()->discardableFactory();
+    }
+    if (!discardable) {
+        limit = 0 == limit ? GetTotalByteLimit() : SkTMin(limit, GetTotalByteLimit());
+    }
+    return limit;
 }
 
 void SkResourceCache::PurgeAll() {
-    SkAutoMutexAcquire am(gMutex);
-    return get_cache()->purgeAll();
+    for (SkResourceCacheShard& shard : gShards) {
+        shard.locked([](SkResourceCache* cache) { cache->purgeAll(); });
+    }
 }
 
 bool SkResourceCache::Find(const Key& key, FindVisitor visitor, void* context) {
-    SkAutoMutexAcquire am(gMutex);
-    return get_cache()->find(key, visitor, context);
+    return shard_for(key.hash()).locked([&](SkResourceCache* cache) {
+        return cache->find(key, visitor, context);
+    });
 }
 
 void SkResourceCache::Add(Rec* rec) {
-    SkAutoMutexAcquire am(gMutex);
-    get_cache()->add(rec);
+    SkResourceCacheShard& shard = shard_for(rec->getHash());
+    shard.locked([rec](SkResourceCache* cache) { cache->add(rec); });
+    purge_to_budget(&shard);
 }
 
 void SkResourceCache::VisitAll(Visitor visitor, void* context) {
-    SkAutoMutexAcquire am(gMutex);
-    get_cache()->visitAll(visitor, context);
+    for (SkResourceCacheShard& shard : gShards) {
+        SkAutoMutexAcquire am(shard.fMutex);
+        shard.cache()->visitAll(visitor, context);
+    }
 }
 
 void SkResourceCache::PostPurgeSharedID(uint64_t sharedID) {
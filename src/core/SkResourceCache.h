@@ -25,6 +25,8 @@ class SkTraceMemoryDump;
  *
  *  As a convenience, a global instance is also defined, which can be safely
  *  access across threads via the static methods (e.g. FindAndLock, etc.).
+ *  The global instance is split into shards by Key::hash(), each with its own
+ *  lock and LRU list.  The shards share one byte budget.
  */
 class SkResourceCache {
 public:
@@ -266,6 +268,7 @@ private:
     size_t  fTotalBytesUsed;
     size_t  fTotalByteLimit;
     size_t  fSingleAllocationByteLimit;
+    int     fDiscardableCountLimit;     // only used with fDiscardableFactory
     int     fCount;
 
     SkMessageBus<PurgeSharedIDMessage>::Inbox fPurgeSharedIDInbox;
@@ -281,6 +284,8 @@ private:
 
     void init();    // called by constructors
 
+    friend struct SkResourceCacheShard;
+
 #ifdef SK_DEBUG
     void validate() const;
 #else
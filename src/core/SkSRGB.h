@@ -30,7 +30,9 @@ static inline Sk4f sk_clamp_0_255(const Sk4f& x) {
 
 // This should probably only be called from sk_linear_to_srgb() or sk_linear_to_srgb_noclamp().
 // It generally doesn't make sense to work with sRGB floats.
-static inline Sk4f sk_linear_to_srgb_needs_trunc(const Sk4f& x) {
+// F is Sk4f, or any other vector of floats with the same methods (see SkRasterPipeline_opts.h).
+template <typename F>
+static inline F sk_linear_to_srgb_needs_trunc(const F& x) {
     // Approximation of the sRGB gamma curve (within 1 when scaled to 8-bit pixels).
     //
     // Constants tuned by brute force to minimize (in order of importance) after truncation:
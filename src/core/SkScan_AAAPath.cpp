@@ -0,0 +1,421 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkScanPriv.h"
+#include "SkEdgeClipper.h"
+#include "SkGeometry.h"
+#include "SkLineClipper.h"
+#include "SkMathPriv.h"
+#include "SkPath.h"
+#include "SkTDArray.h"
+#include "SkTSort.h"
+#include "SkTemplates.h"
+
+/** @file
+    Analytic antialiasing: rather than scan converting the path SCALE times per row and
+    averaging, we compute each pixel's coverage directly from the area its edges sweep.
+
+    Every line segment of the (flattened, clipped) path adds its signed area to the pixels it
+    crosses, and the coverage it leaves to their right to the first pixel past it.  A running
+    sum along each row then gives every pixel's winding-weighted area, which the fill rule
+    folds into [0,1].  That's exact wherever the path doesn't overlap itself; where it does,
+    overlapping partial coverage is summed rather than unioned, just as in FreeType.
+
+    Accumulation works on a band of rows at a time, so memory stays bounded however tall the
+    path is.  Segments are sorted by their top, and each band only visits those crossing it.
+    We remember which chunks of cells each band touched, and coverage is constant between them,
+    so summing a row costs time in proportion to its edges, not its width.
+ */
+
+// Curves are flattened until the chord is within this many pixels of the curve.
+// (Conics get the same treatment on their way to quads.)
+static const SkScalar kFlattenTolerance = SK_Scalar1 / 16;
+static const int      kMaxCurveLines    = 256;
+
+// Size of the coverage accumulation buffer, in floats.
+static const int kMaxBandFloats = 16 * 1024;
+
+namespace {
+
+// A line segment in bounds-relative coordinates, pointing down (fY0 < fY1).
+struct Segment {
+    float fX0, fY0, fX1, fY1;
+    float fWinding;     // +1 if the path runs down this segment, -1 if it runs up.
+};
+
+// Flattens the path into Segments, clipped to bounds.  Anything left or right of bounds
+// becomes a vertical segment along the edge, so it still contributes to the rows it crosses.
+class SegmentBuilder {
+public:
+    SegmentBuilder(const SkIRect& bounds)
+        : fClip(SkRect::Make(bounds))
+        , fOriginX(SkIntToScalar(bounds.fLeft))
+        , fOriginY(SkIntToScalar(bounds.fTop)) {}
+
+    void build(const SkPath& path) {
+        SkAutoConicToQuads quadder;
+
+        // Paths entirely inside bounds can be flattened as they are; the segments needn't be
+        // monotonic, only straight.
+        const bool    unclipped = fClip.contains(path.getBounds());
+        fSegments.setReserve(4 * path.countPoints());
+        SkEdgeClipper clipper(false);
+        SkPath::Iter  iter(path, true);
+        SkPoint       pts[4];
+        SkPath::Verb  verb;
+        while ((verb = iter.next(pts, false)) != SkPath::kDone_Verb) {
+            switch (verb) {
+                case SkPath::kMove_Verb:
+                case SkPath::kClose_Verb:
+                    // Iter closes contours for us with a line verb.
+                    break;
+                case SkPath::kLine_Verb: {
+                    if (unclipped) {
+                        this->addLine(pts[0], pts[1]);
+                        break;
+                    }
+                    SkPoint lines[SkLineClipper::kMaxPoints];
+                    int lineCount = SkLineClipper::ClipLine(pts, fClip, lines, false);
+                    for (int i = 0; i < lineCount; i++) {
+                        this->addLine(lines[i], lines[i+1]);
+                    }
+                    break;
+                }
+                case SkPath::kQuad_Verb:
+                    if (unclipped) {
+                        this->addQuad(pts);
+                    } else if (clipper.clipQuad(pts, fClip)) {
+                        this->addClipper(&clipper);
+                    }
+                    break;
+                case SkPath::kConic_Verb: {
+                    const SkPoint* quadPts = quadder.computeQuads(pts, iter.conicWeight(),
+                                                                  kFlattenTolerance);
+                    for (int i = 0; i < quadder.countQuads(); ++i) {
+                        if (unclipped) {
+                            this->addQuad(quadPts);
+                        } else if (clipper.clipQuad(quadPts, fClip)) {
+                            this->addClipper(&clipper);
+                        }
+                        quadPts += 2;
+                    }
+                    break;
+                }
+                case SkPath::kCubic_Verb:
+                    if (unclipped) {
+                        this->addCubic(pts);
+                    } else if (clipper.clipCubic(pts, fClip)) {
+                        this->addClipper(&clipper);
+                    }
+                    break;
+                default:
+                    SkDEBUGFAIL("unexpected verb");
+                    break;
+            }
+        }
+    }
+
+    SkTDArray<Segment>& segments() { return fSegments; }
+
+private:
+    void addClipper(SkEdgeClipper* clipper) {
+        SkPoint      pts[4];
+        SkPath::Verb verb;
+        while ((verb = clipper->next(pts)) != SkPath::kDone_Verb) {
+            switch (verb) {
+                case SkPath::kLine_Verb:  this->addLine(pts[0], pts[1]); break;
+                case SkPath::kQuad_Verb:  this->addQuad(pts);            break;
+                case SkPath::kCubic_Verb: this->addCubic(pts);           break;
+                default: break;
+            }
+        }
+    }
+
+    void addLine(const SkPoint& p0, const SkPoint& p1) {
+        float x0 = p0.fX - fOriginX, y0 = p0.fY - fOriginY,
+              x1 = p1.fX - fOriginX, y1 = p1.fY - fOriginY;
+        if (y0 == y1) {
+            return;     // Horizontal segments cover no area.
+        }
+        float winding = 1;
+        if (y0 > y1) {
+            SkTSwap(x0, x1);
+            SkTSwap(y0, y1);
+            winding = -1;
+        }
+        *fSegments.append() = { x0, y0, x1, y1, winding };
+    }
+
+    static int lines_for(SkScalar secondDifference) {
+        int n = SkScalarCeilToInt(SkScalarSqrt(secondDifference));
+        return SkTPin(n, 1, kMaxCurveLines);
+    }
+
+    void addQuad(const SkPoint pts[3]) {
+        // Flattening a quad into n lines is off by at most |p0 - 2p1 + p2| / 4n^2.
+        SkVector dd = pts[0] - pts[1] - pts[1] + pts[2];
+        int n = lines_for(dd.length() / (4 * kFlattenTolerance));
+
+        SkPoint prev = pts[0];
+        for (int i = 1; i < n; i++) {
+            SkScalar t = SkIntToScalar(i) / n, s = 1 - t;
+            SkPoint pt = { s*s*pts[0].fX + 2*s*t*pts[1].fX + t*t*pts[2].fX,
+                           s*s*pts[0].fY + 2*s*t*pts[1].fY + t*t*pts[2].fY };
+            this->addLine(prev, pt);
+            prev = pt;
+        }
+        this->addLine(prev, pts[2]);
+    }
+
+    void addCubic(const SkPoint pts[4]) {
+        // A cubic's second derivative is at most 6 times its largest second difference,
+        // and n lines are off by at most 1/8n^2 of that.
+        SkVector dd0 = pts[0] - pts[1] - pts[1] + pts[2],
+                 dd1 = pts[1] - pts[2] - pts[2] + pts[3];
+        SkScalar dd  = SkTMax(dd0.length(), dd1.length());
+        int n = lines_for(dd * 3 / (4 * kFlattenTolerance));
+
+        SkPoint prev = pts[0];
+        for (int i = 1; i < n; i++) {
+            SkScalar t = SkIntToScalar(i) / n, s = 1 - t;
+            SkScalar a = s*s*s, b = 3*s*s*t, c = 3*s*t*t, d = t*t*t;
+            SkPoint pt = { a*pts[0].fX + b*pts[1].fX + c*pts[2].fX + d*pts[3].fX,
+                           a*pts[0].fY + b*pts[1].fY + c*pts[2].fY + d*pts[3].fY };
+            this->addLine(prev, pt);
+            prev = pt;
+        }
+        this->addLine(prev, pts[3]);
+    }
+
+    const SkRect       fClip;
+    const SkScalar     fOriginX, fOriginY;
+    SkTDArray<Segment> fSegments;
+};
+
+}  // namespace
+
+// A band of rows of coverage accumulators, and a bit for each 8 of them marking which we've
+// touched, so we can skip the rest.  Each row is width+2 cells: the pixels, then room for
+// coverage carried past the right edge.
+class Cells {
+public:
+    static const int kChunkShift = 3;
+
+    Cells(int width, int rows)
+        : fStride(width + 2)
+        , fMaskStride((((fStride - 1) >> kChunkShift) >> 5) + 1)
+        , fAcc (fStride     * rows)
+        , fMask(fMaskStride * rows) {
+        sk_bzero(fAcc .get(), fStride     * rows * sizeof(float));
+        sk_bzero(fMask.get(), fMaskStride * rows * sizeof(uint32_t));
+    }
+
+    int stride() const { return fStride; }
+
+    float* row(int y) { return fAcc.get() + y * fStride; }
+    uint32_t* mask(int y) { return fMask.get() + y * fMaskStride; }
+    int maskStride() const { return fMaskStride; }
+
+    // Mark cells [x0,x1] of row y as touched.
+    void mark(int y, int x0, int x1) {
+        uint32_t* mask = this->mask(y);
+        for (int c = x0 >> kChunkShift; c <= x1 >> kChunkShift; c++) {
+            mask[c >> 5] |= 1u << (c & 31);
+        }
+    }
+
+private:
+    const int                      fStride, fMaskStride;
+    SkAutoSTMalloc<1024, float>    fAcc;
+    SkAutoSTMalloc<32,   uint32_t> fMask;
+};
+
+// Add seg's contribution to rows [bandTop, bandBottom), the rows of cells.
+static void accumulate(const Segment& seg, Cells* cells, int width, int bandTop, int bandBottom) {
+    const float y0 = SkTMax(seg.fY0, (float)bandTop),
+                y1 = SkTMin(seg.fY1, (float)bandBottom);
+    if (y0 >= y1) {
+        return;
+    }
+    const float dxdy = (seg.fX1 - seg.fX0) / (seg.fY1 - seg.fY0);
+
+    float x = seg.fX0 + (y0 - seg.fY0) * dxdy;
+    for (int y = (int)y0; y < y1; y++) {
+        const float dy    = SkTMin(y + 1.0f, y1) - SkTMax((float)y, y0);
+        const float xnext = x + dxdy * dy;
+        const float d     = dy * seg.fWinding;
+
+        // The clipper keeps us within [0,width], but stepping can wander a hair past either end.
+        const float xa = SkTPin(SkTMin(x, xnext), 0.0f, (float)width),
+                    xb = SkTPin(SkTMax(x, xnext), 0.0f, (float)width);
+        const int   ia = (int)xa,
+                    ib = (int)ceilf(xb);
+
+        float* row = cells->row(y - bandTop);
+        if (ib <= ia + 1) {
+            // Within one pixel: split d by where the segment crosses it on average.
+            const float xm = 0.5f * (xa + xb) - ia;
+            row[ia  ] += d - d * xm;
+            row[ia+1] += d * xm;
+            cells->mark(y - bandTop, ia, ia+1);
+        } else {
+            // Across several pixels: the area to the right of the segment within each pixel
+            // grows linearly from a triangle at the first to full coverage past the last.
+            const float s  = 1.0f / (xb - xa),
+                        fa = xa - ia,
+                        fb = xb - ib + 1,
+                        a0 = 0.5f * s * (1 - fa) * (1 - fa),
+                        am = 0.5f * s * fb * fb;
+            row[ia] += d * a0;
+            if (ib == ia + 2) {
+                row[ia+1] += d * (1 - a0 - am);
+            } else {
+                const float a1 = s * (1.5f - fa);
+                row[ia+1] += d * (a1 - a0);
+                for (int xi = ia + 2; xi < ib - 1; xi++) {
+                    row[xi] += d * s;
+                }
+                const float a2 = a1 + (ib - ia - 3) * s;
+                row[ib-1] += d * (1 - a2 - am);
+            }
+            row[ib] += d * am;
+            cells->mark(y - bandTop, ia, ib);
+        }
+        x = xnext;
+    }
+}
+
+static inline SkAlpha coverage_to_alpha(float winding, bool evenOdd, bool inverse) {
+    float coverage = fabsf(winding);
+    if (evenOdd) {
+        coverage -= 2 * floorf(coverage * 0.5f);
+        coverage  = coverage > 1 ? 2 - coverage : coverage;
+    } else {
+        coverage  = SkTMin(coverage, 1.0f);
+    }
+    if (inverse) {
+        coverage = 1 - coverage;
+    }
+    return (SkAlpha)(coverage * 255 + 0.5f);
+}
+
+// Builds one row of blitAntiH() runs, trimming zero coverage off the ends.
+class RowBuilder {
+public:
+    RowBuilder(int width) : fAlpha(width + 1), fRuns(width + 1) {}
+
+    void reset() {
+        fFirst = -1;
+    }
+
+    void append(int x, int n, SkAlpha alpha) {
+        if (n > 0) {
+            fRuns [x] = SkToS16(n);
+            fAlpha[x] = alpha;
+            if (alpha) {
+                fFirst = fFirst < 0 ? x : fFirst;
+                fEnd   = x + n;
+            }
+        }
+    }
+
+    void blit(SkBlitter* blitter, int left, int y) {
+        if (fFirst >= 0) {
+            fRuns[fEnd] = 0;
+            blitter->blitAntiH(left + fFirst, y, fAlpha.get() + fFirst, fRuns.get() + fFirst);
+        }
+    }
+
+private:
+    SkAutoSTMalloc<256, SkAlpha> fAlpha;
+    SkAutoSTMalloc<256, int16_t> fRuns;
+    int fFirst, fEnd;
+};
+
+// Sum up and blit each row of the band, clearing the cells we touched as we go.
+static void blit_band(Cells* cells, int width, int rows, bool evenOdd, bool inverse,
+                      SkBlitter* blitter, int left, int top, RowBuilder* builder) {
+    const int chunk = 1 << Cells::kChunkShift;
+    for (int y = 0; y < rows; y++) {
+        float*    row  = cells->row(y);
+        uint32_t* mask = cells->mask(y);
+
+        // Coverage is constant across untouched chunks.
+        builder->reset();
+        float winding = 0;
+        int x = 0;
+        for (int i = 0; i < cells->maskStride(); i++) {
+            for (uint32_t bits = mask[i]; bits; bits &= bits - 1) {
+                const int c     = (i << 5) + (31 - SkCLZ(bits & (0 - bits))),
+                          start = c << Cells::kChunkShift,
+                          stop  = SkTMin(start + chunk, cells->stride());
+                builder->append(x, SkTMin(start, width) - x,
+                                coverage_to_alpha(winding, evenOdd, inverse));
+                for (int px = start; px < stop; px++) {
+                    winding += row[px];
+                    row[px]  = 0;
+                    if (px < width) {
+                        builder->append(px, 1, coverage_to_alpha(winding, evenOdd, inverse));
+                    }
+                }
+                x = SkTMin(stop, width);
+            }
+            mask[i] = 0;
+        }
+        builder->append(x, width - x, coverage_to_alpha(winding, evenOdd, inverse));
+        builder->blit(blitter, left, top + y);
+    }
+}
+
+void sk_fill_path_analytic(const SkPath& path, const SkIRect& bounds, SkBlitter* blitter) {
+    if (bounds.isEmpty()) {
+        return;
+    }
+
+    SegmentBuilder segmentBuilder(bounds);
+    segmentBuilder.build(path);
+    SkTDArray<Segment>& segments = segmentBuilder.segments();
+    if (segments.count() > 1) {
+        SkTQSort(segments.begin(), segments.end() - 1, [](const Segment& a, const Segment& b) {
+            return a.fY0 < b.fY0;
+        });
+    }
+
+    const int  width   = bounds.width(),
+               height  = bounds.height(),
+               stride  = width + 2;
+    const bool evenOdd = SkToBool(path.getFillType() & 1),
+               inverse = path.isInverseFillType();
+    const int  bandHeight = SkTPin(kMaxBandFloats / stride, 1, height);
+
+    Cells      cells(width, bandHeight);
+    RowBuilder rowBuilder(width);
+
+    SkTDArray<const Segment*> active;
+    int next = 0;
+    for (int bandTop = 0; bandTop < height; bandTop += bandHeight) {
+        const int bandBottom = SkTMin(bandTop + bandHeight, height);
+
+        while (next < segments.count() && segments[next].fY0 < bandBottom) {
+            *active.append() = &segments[next++];
+        }
+        int kept = 0;
+        for (const Segment* seg : active) {
+            accumulate(*seg, &cells, width, bandTop, bandBottom);
+            if (seg->fY1 > bandBottom) {
+                active[kept++] = seg;
+            }
+        }
+        active.setCount(kept);
+
+        blit_band(&cells, width, bandBottom - bandTop, evenOdd, inverse,
+                  blitter, bounds.fLeft, bounds.fTop + bandTop, &rowBuilder);
+        if (!inverse && active.isEmpty() && next == segments.count()) {
+            break;  // Nothing left to draw below this band.
+        }
+    }
+}
@@ -647,7 +647,7 @@ void SkScan::AntiFillPath(const SkPath& path, const SkRegion& origClip,
 
     // If the intersection of the path bounds and the clip bounds
     // will overflow 32767 when << by SHIFT, we can't supersample,
-    // so draw without antialiasing.
+    // so antialias analytically instead, which has no such limit.
     SkIRect clippedIR;
     if (isInverse) {
        // If the path is an inverse fill, it's going to fill the entire
@@ -658,10 +658,7 @@ void SkScan::AntiFillPath(const SkPath& path, const SkRegion& origClip,
            return;
        }
     }
-    if (rect_overflows_short_shift(clippedIR, SHIFT)) {
-        SkScan::FillPath(path, origClip, blitter);
-        return;
-    }
+    const bool analytic = rect_overflows_short_shift(clippedIR, SHIFT);
 
     // Our antialiasing can't handle a clip larger than 32767, so we restrict
     // the clip to that limit here. (the runs[] uses int16_t for its index).
@@ -699,6 +696,23 @@ void SkScan::AntiFillPath(const SkPath& path, const SkRegion& origClip,
         sk_blit_above(blitter, ir, *clipRgn);
     }
 
+    if (analytic) {
+        // Inverse fills cover the whole width of the clip; sk_blit_above/below did the rest.
+        SkIRect bounds = ir;
+        if (isInverse) {
+            bounds.fLeft  = clipRgn->getBounds().fLeft;
+            bounds.fRight = clipRgn->getBounds().fRight;
+        }
+        if (clipRect && !bounds.intersect(*clipRect)) {
+            bounds.setEmpty();
+        }
+        sk_fill_path_analytic(path, bounds, blitter);
+        if (isInverse) {
+            sk_blit_below(blitter, ir, *clipRgn);
+        }
+        return;
+    }
+
     SkIRect superRect, *superClipRect = nullptr;
 
     if (clipRect) {
@@ -128,6 +128,12 @@ typedef void (*PrePostProc)(SkBlitter* blitter, int y, bool isStartOfScanline);
 #define PREPOST_START   true
 #define PREPOST_END     false
 
+// The active edges stay in a linked list, stepped and re-sorted one at a time as we walk them.
+// Keeping them in arrays instead (stepping x in one vectorized pass, merging new edges in as a
+// batch, insertion sorting the row) produced identical spans.  With thousands of active edges it
+// ran 1.3-1.9x faster on rows of glyph outlines and long cubic chains, but 10-40% slower on dense
+// straight hatching and polygons, and about even on bigpath and rows of circles.  With no clear
+// win across the board, the list stays.
 static void walk_edges(SkEdge* prevHead, SkPath::FillType fillType,
                        SkBlitter* blitter, int start_y, int stop_y,
                        PrePostProc proc, int rightClip) {
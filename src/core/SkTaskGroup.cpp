@@ -27,8 +27,8 @@
     }
 #endif
 
-static int num_cores() {
-    // We cache num_cores() so we only query the OS once.
+int sk_num_cores() {
+    // We cache sk_num_cores() so we only query the OS once.
     static int cores = 0;
     static SkOnce once;
     once(query_num_cores, &cores);
@@ -38,6 +38,117 @@ static int num_cores() {
 
 namespace {
 
+// A Chase-Lev work-stealing deque of T*.  Only the thread that owns the deque may push() and
+// pop(), both at the bottom.  Any thread may steal() from the top.  See "Dynamic Circular
+// Work-Stealing Deque" (Chase and Lev, 2005) and "Correct and Efficient Work-Stealing for Weak
+// Memory Models" (Le et al., 2013).
+template <typename T>
+class SkWorkStealingDeque : SkNoncopyable {
+public:
+    SkWorkStealingDeque() : fTop(0), fBottom(0), fBuffer(new Buffer(kInitialCapacity)) {
+        fRetired.push(fBuffer.load(sk_memory_order_relaxed));
+    }
+
+    ~SkWorkStealingDeque() {
+        SkASSERT(this->looksEmpty());
+        fRetired.deleteAll();
+    }
+
+    // Owner only.
+    void push(T* item) {
+        int64_t b = fBottom.load(sk_memory_order_relaxed);
+        int64_t t = fTop.load(sk_memory_order_acquire);
+        Buffer* buffer = fBuffer.load(sk_memory_order_relaxed);
+        if (b - t >= buffer->fCapacity) {
+            buffer = this->grow(buffer, t, b);
+        }
+        buffer->put(b, item);
+        // Release publishes item to thieves who acquire fBottom.
+        fBottom.store(b + 1, sk_memory_order_release);
+    }
+
+    // Owner only.  Returns nullptr if the deque is empty.
+    T* pop() {
+        int64_t b = fBottom.load(sk_memory_order_relaxed) - 1;
+        Buffer* buffer = fBuffer.load(sk_memory_order_relaxed);
+        // This store and the load of fTop below must not be reordered, or a thief and the owner
+        // could both take the last item.  Both being seq_cst is what keeps them in order.
+        fBottom.store(b, sk_memory_order_seq_cst);
+        int64_t t = fTop.load(sk_memory_order_seq_cst);
+
+        if (t > b) {
+            // Empty.
+            fBottom.store(b + 1, sk_memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = buffer->get(b);
+        if (t == b) {
+            // The last item.  Race any thieves for it.
+            if (!fTop.compare_exchange(&t, t + 1, sk_memory_order_seq_cst,
+                                                  sk_memory_order_relaxed)) {
+                item = nullptr;
+            }
+            fBottom.store(b + 1, sk_memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread.  Returns nullptr if the deque is empty or we lost a race for its top item.
+    T* steal() {
+        int64_t t = fTop.load(sk_memory_order_seq_cst);
+        int64_t b = fBottom.load(sk_memory_order_seq_cst);
+        if (t >= b) {
+            return nullptr;
+        }
+        // Retired buffers are never freed while we live, so even if the owner grows the deque
+        // right now, this buffer still holds the item at t.
+        T* item = fBuffer.load(sk_memory_order_acquire)->get(t);
+        if (!fTop.compare_exchange(&t, t + 1, sk_memory_order_seq_cst,
+                                              sk_memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // Any thread.  Only a hint, as the deque may change the moment we return.
+    bool looksEmpty() const {
+        return fTop.load(sk_memory_order_relaxed) >= fBottom.load(sk_memory_order_relaxed);
+    }
+
+private:
+    static const int kInitialCapacity = 64;
+
+    struct Buffer {
+        explicit Buffer(int64_t capacity)
+            : fCapacity(capacity)
+            , fItems(SkToInt(capacity)) {}
+
+        T*   get(int64_t i) const  { return fItems[i & (fCapacity - 1)].load(); }
+        void put(int64_t i, T* item) { fItems[i & (fCapacity - 1)].store(item); }
+
+        const int64_t fCapacity;  // Always a power of 2.
+        SkAutoTArray<SkAtomic<T*, sk_memory_order_relaxed>> fItems;
+    };
+
+    Buffer* grow(Buffer* buffer, int64_t t, int64_t b) {
+        Buffer* bigger = new Buffer(2 * buffer->fCapacity);
+        for (int64_t i = t; i < b; i++) {
+            bigger->put(i, buffer->get(i));
+        }
+        fRetired.push(bigger);
+        fBuffer.store(bigger, sk_memory_order_release);
+        return bigger;
+    }
+
+    SkAtomic<int64_t> fTop;
+    SkAtomic<int64_t> fBottom;
+    SkAtomic<Buffer*> fBuffer;
+
+    // Every Buffer we've ever used, owned here so thieves can keep reading old ones.
+    // Only the owner touches this.
+    SkTDArray<Buffer*> fRetired;
+};
+
 class ThreadPool : SkNoncopyable {
 public:
     static void Add(std::function<void(void)> fn, SkAtomic<int32_t>* pending) {
@@ -60,27 +171,26 @@ public:
             SkASSERT(pending->load(sk_memory_order_relaxed) == 0);
             return;
         }
-        // Acquire pairs with decrement release here or in Loop.
+        Worker* self = gSelf;
+        // Acquire pairs with decrement release in run().
         while (pending->load(sk_memory_order_acquire) > 0) {
             // Lend a hand until our SkTaskGroup of interest is done.
-            Work work;
-            {
-                // We're stealing work opportunistically,
-                // so we never call fWorkAvailable.wait(), which could sleep us if there's no work.
-                // This means fWorkAvailable is only an upper bound on fWork.count().
-                AutoLock lock(&gGlobal->fWorkLock);
-                if (gGlobal->fWork.empty()) {
-                    // Someone has picked up all the work (including ours).  How nice of them!
-                    // (They may still be working on it, so we can't assert *pending == 0 here.)
-                    continue;
-                }
-                work = gGlobal->fWork.back();
-                gGlobal->fWork.pop_back();
-            }
+            //
+            // We're taking work opportunistically,
+            // so we never call fWorkAvailable.wait(), which could sleep us if there's no work.
+            // This means fWorkAvailable is only an upper bound on the work queued.
+            //
+            // If we find nothing, someone has picked up all the work (including ours).
+            // How nice of them!  (They may still be working on it, so we can't assert
+            // *pending == 0 here.)
+            //
             // This Work isn't necessarily part of our SkTaskGroup of interest, but that's fine.
             // We threads gotta stick together.  We're always making forward progress.
-            work.fn();
-            work.pending->fetch_add(-1, sk_memory_order_release);  // Pairs with load above.
+            // When we're a worker waiting from inside a task, this is what makes nested
+            // SkTaskGroups safe: we run tasks instead of blocking our thread.
+            if (Work* work = gGlobal->findWork(self)) {
+                Run(work);
+            }
         }
     }
 
@@ -92,88 +202,209 @@ private:
         SkSpinlock* fLock;
     };
 
+    struct Block;
+
+    // One unit of work: call its Block's function, then decrement pending afterwards.
     struct Work {
-        std::function<void(void)> fn; // A function to call
-        SkAtomic<int32_t>* pending;   // then decrement pending afterwards.
+        Block* fBlock;
+        int    fIndex;   // Passed to a batch() function.
+    };
+
+    // The Work from one add() or batch() is allocated in one Block, after what it shares.
+    // The last Work to run frees the Block.
+    struct Block {
+        std::function<void(void)> fFn;       // From add(),
+        std::function<void(int)>  fBatchFn;  // or from batch().
+        SkAtomic<int32_t>*        fPending;
+        SkAtomic<int32_t>         fUnfinished;
+
+        Work* works() { return reinterpret_cast<Work*>(this + 1); }
+
+        static Block* Make(int N, SkAtomic<int32_t>* pending) {
+            static_assert(alignof(Block) >= alignof(Work), "");
+            Block* block = new (sk_malloc_throw(sizeof(Block) + N * sizeof(Work))) Block;
+            block->fPending = pending;
+            block->fUnfinished.store(N, sk_memory_order_relaxed);
+            for (int i = 0; i < N; i++) {
+                block->works()[i] = Work{ block, i };
+            }
+            return block;
+        }
     };
 
-    explicit ThreadPool(int threads) {
+    // Each worker thread owns a deque.  Work added from a worker (i.e. nested in another task)
+    // goes onto that worker's deque, where it can pop it back off without any contention.
+    // Idle threads steal from the other end.
+    struct Worker {
+        SkWorkStealingDeque<Work> fDeque;
+    };
+
+    struct LoopArgs {
+        ThreadPool* fPool;
+        Worker*     fWorker;
+    };
+
+    explicit ThreadPool(int threads) : fShuttingDown(false) {
         if (threads == -1) {
-            threads = num_cores();
+            threads = sk_num_cores();
         }
+        fWorkers.reset(threads);
+        fLoopArgs.reset(threads);
+        fWorkerCount = threads;
         for (int i = 0; i < threads; i++) {
-            fThreads.push(new SkThread(&ThreadPool::Loop, this));
+            fLoopArgs[i] = { this, &fWorkers[i] };
+            fThreads.push(new SkThread(&ThreadPool::Loop, &fLoopArgs[i]));
             fThreads.top()->start();
         }
     }
 
     ~ThreadPool() {
-        SkASSERT(fWork.empty());  // All SkTaskGroups should be destroyed by now.
+        // All SkTaskGroups should be destroyed by now.
+        SkASSERT(fInbox.empty());
 
-        // Send a poison pill to each thread.
-        SkAtomic<int> dummy(0);
-        for (int i = 0; i < fThreads.count(); i++) {
-            this->add(nullptr, &dummy);
-        }
-        // Wait for them all to swallow the pill and die.
+        // Wake every thread to notice we're shutting down.
+        fShuttingDown.store(true, sk_memory_order_release);
+        fWorkAvailable.signal(fThreads.count());
+        // Wait for them all to die.
         for (int i = 0; i < fThreads.count(); i++) {
             fThreads[i]->join();
         }
-        SkASSERT(fWork.empty());  // Can't hurt to double check.
+        SkASSERT(fInbox.empty());  // Can't hurt to double check.
         fThreads.deleteAll();
     }
 
+    static void Run(Work* work) {
+        Block* block = work->fBlock;
+        if (block->fFn) {
+            block->fFn();
+        } else {
+            block->fBatchFn(work->fIndex);
+        }
+        block->fPending->fetch_add(-1, sk_memory_order_release);  // Pairs with load in Wait().
+        if (1 == block->fUnfinished.fetch_add(-1, sk_memory_order_acq_rel)) {
+            block->~Block();
+            sk_free(block);
+        }
+    }
+
     void add(std::function<void(void)> fn, SkAtomic<int32_t>* pending) {
-        Work work = { fn, pending };
         pending->fetch_add(+1, sk_memory_order_relaxed);  // No barrier needed.
-        {
-            AutoLock lock(&fWorkLock);
-            fWork.push_back(work);
-        }
-        fWorkAvailable.signal(1);
+        Block* block = Block::Make(1, pending);
+        block->fFn = std::move(fn);
+        this->push(block->works(), 1);
     }
 
     void batch(int N, std::function<void(int)> fn, SkAtomic<int32_t>* pending) {
+        if (N <= 0) {
+            return;
+        }
         pending->fetch_add(+N, sk_memory_order_relaxed);  // No barrier needed.
-        {
-            AutoLock lock(&fWorkLock);
+        Block* block = Block::Make(N, pending);
+        block->fBatchFn = std::move(fn);
+        this->push(block->works(), N);
+    }
+
+    // Queues N units of Work: on our own deque if we're a worker, otherwise in the inbox.
+    void push(Work* works, int N) {
+        if (Worker* self = gSelf) {
+            for (int i = 0; i < N; i++) {
+                self->fDeque.push(&works[i]);
+            }
+        } else {
+            AutoLock lock(&fInboxLock);
             for (int i = 0; i < N; i++) {
-                Work work = { [i, fn]() { fn(i); }, pending };
-                fWork.push_back(work);
+                fInbox.push_back(&works[i]);
             }
         }
         fWorkAvailable.signal(N);
     }
 
+    // Find one unit of Work for self (which may be nullptr if we're not a worker), or nullptr
+    // if there seems to be none left.  Looks in our own deque first, then the inbox, then tries
+    // to steal from the other workers.
+    Work* findWork(Worker* self) {
+        if (self) {
+            if (Work* work = self->fDeque.pop()) {
+                return work;
+            }
+        }
+
+        if (Work* work = this->takeFromInbox(self)) {
+            return work;
+        }
+
+        // Start stealing from our neighbor so that thieves spread out over the victims.
+        const int start = self ? SkToInt(self - fWorkers.get()) + 1 : 0;
+        for (int i = 0; i < fWorkerCount; i++) {
+            Worker* victim = &fWorkers[(start + i) % fWorkerCount];
+            if (victim != self) {
+                if (Work* work = victim->fDeque.steal()) {
+                    return work;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    // Work added by threads outside the pool lands in fInbox.  Workers move it onto their own
+    // deques a chunk at a time, so it can be spread out by stealing rather than by everyone
+    // going back to fInboxLock for each unit.
+    Work* takeFromInbox(Worker* self) {
+        AutoLock lock(&fInboxLock);
+        if (fInbox.empty()) {
+            return nullptr;
+        }
+        Work* work = fInbox.back();
+        fInbox.pop_back();
+        if (self) {
+            int chunk = fInbox.count() / (fWorkerCount + 1);
+            for (int i = 0; i < chunk; i++) {
+                self->fDeque.push(fInbox.back());
+                fInbox.pop_back();
+            }
+        }
+        return work;
+    }
+
+    bool looksLikeWorkRemains() {
+        for (int i = 0; i < fWorkerCount; i++) {
+            if (!fWorkers[i].fDeque.looksEmpty()) {
+                return true;
+            }
+        }
+        AutoLock lock(&fInboxLock);
+        return !fInbox.empty();
+    }
+
     static void Loop(void* arg) {
-        ThreadPool* pool = (ThreadPool*)arg;
-        Work work;
+        LoopArgs* args = (LoopArgs*)arg;
+        ThreadPool* pool = args->fPool;
+        Worker*     self = args->fWorker;
+        gSelf = self;
+
         while (true) {
             // Sleep until there's work available, and claim one unit of Work as we wake.
             pool->fWorkAvailable.wait();
-            {
-                AutoLock lock(&pool->fWorkLock);
-                if (pool->fWork.empty()) {
-                    // Someone in Wait() stole our work (fWorkAvailable is an upper bound).
-                    // Well, that's fine, back to sleep for us.
-                    continue;
-                }
-                work = pool->fWork.back();
-                pool->fWork.pop_back();
-            }
-            if (!work.fn) {
-                return;  // Poison pill.  Time... to die.
+
+            if (Work* work = pool->findWork(self)) {
+                Run(work);
+            } else if (pool->fShuttingDown.load(sk_memory_order_acquire)) {
+                return;  // Time... to die.
+            } else if (pool->looksLikeWorkRemains()) {
+                // We lost a race for it, so our claim may have been the only one left for some
+                // Work still queued.  Hand it back and wait our turn again.
+                pool->fWorkAvailable.signal(1);
             }
-            work.fn();
-            work.pending->fetch_add(-1, sk_memory_order_release);  // Pairs with load in Wait().
+            // Otherwise someone in Wait() took our work (fWorkAvailable is an upper bound).
+            // Well, that's fine, back to sleep for us.
         }
     }
 
-    // fWorkLock must be held when reading or modifying fWork.
-    SkSpinlock      fWorkLock;
-    SkTArray<Work>  fWork;
+    // fInboxLock must be held when reading or modifying fInbox.
+    SkSpinlock      fInboxLock;
+    SkTArray<Work*> fInbox;
 
-    // A thread-safe upper bound for fWork.count().
+    // A thread-safe upper bound for the Work queued in fInbox and all the deques.
     //
     // We'd have it be an exact count but for the loop in Wait():
     // we never want that to block, so it can't call fWorkAvailable.wait(),
@@ -182,13 +413,22 @@ private:
     // We make do, but this means some worker threads may wake spuriously.
     SkSemaphore fWorkAvailable;
 
+    SkAtomic<bool> fShuttingDown;
+
     // These are only changed in a single-threaded context.
-    SkTDArray<SkThread*> fThreads;
+    SkAutoTArray<Worker>   fWorkers;
+    SkAutoTArray<LoopArgs> fLoopArgs;
+    int                    fWorkerCount;
+    SkTDArray<SkThread*>   fThreads;
     static ThreadPool* gGlobal;
 
+    // The Worker for this thread, or nullptr if it's not one of our threads.
+    static thread_local Worker* gSelf;
+
     friend struct SkTaskGroup::Enabler;
 };
 ThreadPool* ThreadPool::gGlobal = nullptr;
+thread_local ThreadPool::Worker* ThreadPool::gSelf = nullptr;
 
 }  // namespace
 
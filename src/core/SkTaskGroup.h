@@ -39,4 +39,7 @@ private:
     SkAtomic<int32_t> fPending;
 };
 
+// Returns the number of cores the OS reports, which is how many threads Enabler(-1) starts.
+int sk_num_cores();
+
 #endif//SkTaskGroup_DEFINED
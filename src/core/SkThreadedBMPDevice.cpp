@@ -0,0 +1,377 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkThreadedBMPDevice.h"
+
+#include "SkData.h"
+#include "SkDraw.h"
+#include "SkPath.h"
+#include "SkPixmap.h"
+#include "SkRRect.h"
+#include "SkSpecialImage.h"
+#include "SkTLazy.h"
+#include "SkTaskGroup.h"
+#include "SkXfermode.h"
+
+// Without an explicit tile count, we aim for tiles about this many rows tall.
+static const int kDefaultTileHeight = 64;
+
+// We flush whenever this many draws are queued, to keep the memory they hold bounded.
+static const int kMaxQueuedDraws = 4096;
+
+// Map local-space bounds r through matrix, accounting for the paint's stroke, mask filter, etc.
+// Returns false if the paint's effects make that impossible to compute cheaply.
+static bool compute_dev_bounds(const SkRect& r, const SkMatrix& matrix, const SkPaint& paint,
+                               SkRect* devBounds) {
+    if (!paint.canComputeFastBounds()) {
+        return false;
+    }
+    SkRect storage;
+    matrix.mapRect(devBounds, paint.computeFastBounds(r, &storage));
+    // Antialiasing and hairlines can touch one pixel past the geometry.
+    devBounds->outset(1, 1);
+    return devBounds->isFinite();
+}
+
+static sk_sp<SkData> copy_or_null(const void* src, size_t bytes) {
+    return src ? SkData::MakeWithCopy(src, bytes) : nullptr;
+}
+
+template <typename T>
+static const T* data_or_null(const sk_sp<SkData>& data) {
+    return data ? static_cast<const T*>(data->data()) : nullptr;
+}
+
+SkThreadedBMPDevice::DrawElement::DrawElement(const SkIRect& bounds, bool tileable,
+                                              const SkDraw& draw,
+                                              std::function<void(const SkDraw&)> fn)
+    : fBounds(bounds)
+    , fTileable(tileable)
+    , fMatrix(*draw.fMatrix)
+    , fRC(*draw.fRC)
+    , fDraw(std::move(fn)) {
+    // The matrix caches its type lazily; compute it now so tiles don't race to do it.
+    (void)fMatrix.getType();
+}
+
+SkThreadedBMPDevice::SkThreadedBMPDevice(const SkBitmap& bitmap, int tileCount,
+                                         const SkSurfaceProps& props)
+    : INHERITED(bitmap, props) {
+    const int width  = bitmap.width(),
+              height = bitmap.height();
+    if (tileCount <= 0) {
+        tileCount = height / kDefaultTileHeight;
+    }
+    tileCount = SkTPin(tileCount, 1, SkTMax(height, 1));
+
+    for (int i = 0; i < tileCount; i++) {
+        fTileBounds.push_back(SkIRect::MakeLTRB(0,     (int)((int64_t)height *  i      / tileCount),
+                                                width, (int)((int64_t)height * (i + 1) / tileCount)));
+    }
+}
+
+SkThreadedBMPDevice::~SkThreadedBMPDevice() {
+    this->flush();
+}
+
+void SkThreadedBMPDevice::enqueue(const SkDraw& draw, const SkRect* devBounds, bool clipsExactly,
+                                  std::function<void(const SkDraw&)> fn) {
+    SkIRect bounds = draw.fRC->getBounds();
+    if (devBounds) {
+        SkRect clipped = *devBounds;
+        if (!clipped.intersect(SkRect::Make(bounds))) {
+            return;  // Nothing we'd draw is inside the clip.
+        }
+        bounds = clipped.roundOut();
+    }
+    if (bounds.isEmpty()) {
+        return;
+    }
+
+    // A draw that lands entirely inside one tile never sees the tile boundaries, so it's always
+    // safe to split up, whether or not it would clip exactly.
+    bool tileable = clipsExactly;
+    for (int i = 0; !tileable && i < fTileBounds.count(); i++) {
+        tileable = fTileBounds[i].contains(bounds);
+    }
+
+    fQueue.emplace_back(bounds, tileable, draw, std::move(fn));
+    if (fQueue.count() >= kMaxQueuedDraws) {
+        this->flush();
+    }
+}
+
+void SkThreadedBMPDevice::flush() {
+    if (fQueue.empty()) {
+        return;
+    }
+
+    // SkDraw sometimes calls back into its device, e.g. for text or dashed points.  The tiles
+    // must not reach our queue that way, so they see a plain SkBitmapDevice on the same pixels.
+    SkAutoTUnref<SkBitmapDevice> device(new SkBitmapDevice(fBitmap, this->surfaceProps()));
+
+    SkPixmap dst;
+    if (!device->onPeekPixels(&dst)) {
+        fQueue.reset();
+        return;
+    }
+
+    auto replay = [&](const DrawElement& element, const SkRasterClip& rc) {
+        SkDraw draw;
+        draw.fDst       = dst;
+        draw.fMatrix    = &element.fMatrix;
+        draw.fRC        = &rc;
+        draw.fClipStack = nullptr;
+        draw.fDevice    = device;
+        element.fDraw(draw);
+    };
+
+    int start = 0;
+    while (start < fQueue.count()) {
+        // Replay the longest run of draws we can split across tiles in parallel...
+        int end = start;
+        while (end < fQueue.count() && fQueue[end].fTileable) {
+            end++;
+        }
+        if (end > start) {
+            SkTaskGroup().batch(fTileBounds.count(), [&](int i) {
+                const SkIRect& tile = fTileBounds[i];
+                for (int j = start; j < end; j++) {
+                    const DrawElement& element = fQueue[j];
+                    if (!SkIRect::Intersects(tile, element.fBounds)) {
+                        continue;
+                    }
+                    if (tile.contains(element.fBounds)) {
+                        replay(element, element.fRC);
+                    } else {
+                        SkRasterClip tileRC(element.fRC);
+                        tileRC.op(tile, SkRegion::kIntersect_Op);
+                        replay(element, tileRC);
+                    }
+                }
+            });
+        }
+        // ... then the draw that stopped it, on this thread with its original clip.
+        if (end < fQueue.count()) {
+            replay(fQueue[end], fQueue[end].fRC);
+            end++;
+        }
+        start = end;
+    }
+    fQueue.reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SkThreadedBMPDevice::drawPaint(const SkDraw& draw, const SkPaint& paint) {
+    this->enqueue(draw, nullptr, true, [paint](const SkDraw& d) {
+        d.drawPaint(paint);
+    });
+}
+
+void SkThreadedBMPDevice::drawPoints(const SkDraw& draw, SkCanvas::PointMode mode, size_t count,
+                                     const SkPoint pts[], const SkPaint& paint) {
+    SkRect bounds;
+    bounds.set(pts, SkToInt(count));
+    SkRect devStorage;
+    const SkRect* devBounds = nullptr;
+    if (paint.canComputeFastBounds()) {
+        SkRect storage;
+        draw.fMatrix->mapRect(&devStorage, paint.computeFastStrokeBounds(bounds, &storage));
+        devStorage.outset(1, 1);
+        if (devStorage.isFinite()) {
+            devBounds = &devStorage;
+        }
+    }
+
+    sk_sp<SkData> points = SkData::MakeWithCopy(pts, count * sizeof(SkPoint));
+    // Hairlines and strokes are chopped against the clip, which would shift them slightly.
+    this->enqueue(draw, devBounds, false, [mode, count, points, paint](const SkDraw& d) {
+        d.drawPoints(mode, count, data_or_null<SkPoint>(points), paint);
+    });
+}
+
+void SkThreadedBMPDevice::drawRect(const SkDraw& draw, const SkRect& r, const SkPaint& paint) {
+    SkRect devBounds;
+    bool hasBounds = compute_dev_bounds(r, *draw.fMatrix, paint, &devBounds);
+    // Rects we can't scan directly turn into paths, and antialiased rects compute their edge
+    // coverage from the rect after it's been clipped.
+    SkPoint strokeSize;
+    bool clipsExactly = !paint.isAntiAlias() && !paint.getMaskFilter() &&
+            SkDraw::kPath_RectType != SkDraw::ComputeRectType(paint, *draw.fMatrix, &strokeSize);
+    this->enqueue(draw, hasBounds ? &devBounds : nullptr, clipsExactly,
+                  [r, paint](const SkDraw& d) {
+        d.drawRect(r, paint);
+    });
+}
+
+void SkThreadedBMPDevice::drawRRect(const SkDraw& draw, const SkRRect& rrect,
+                                    const SkPaint& paint) {
+#ifdef SK_IGNORE_BLURRED_RRECT_OPT
+    this->INHERITED::drawRRect(draw, rrect, paint);
+#else
+    SkRect devBounds;
+    bool hasBounds = compute_dev_bounds(rrect.getBounds(), *draw.fMatrix, paint, &devBounds);
+    this->enqueue(draw, hasBounds ? &devBounds : nullptr, false, [rrect, paint](const SkDraw& d) {
+        d.drawRRect(rrect, paint);
+    });
+#endif
+}
+
+void SkThreadedBMPDevice::drawPath(const SkDraw& draw, const SkPath& src, const SkPaint& paint,
+                                   const SkMatrix* prePathMatrix, bool) {
+    SkPath path(src);
+    // Like SkRecords::PreCachedPath, make sure the tiles never race to compute these.
+    path.updateBoundsCache();
+
+    SkRect devBounds;
+    bool hasBounds = false;
+    if (!path.isInverseFillType()) {
+        // SkDraw applies prePathMatrix before any stroking or path effects.
+        SkRect bounds = path.getBounds();
+        if (prePathMatrix) {
+            prePathMatrix->mapRect(&bounds);
+        }
+        hasBounds = compute_dev_bounds(bounds, *draw.fMatrix, paint, &devBounds);
+    }
+
+    SkTLazy<SkMatrix> preMatrix;
+    if (prePathMatrix) {
+        preMatrix.init(*prePathMatrix);
+        (void)preMatrix.get()->getType();
+    }
+    // Edges are chopped against the clip bounds, so paths must not cross tiles to match.
+    this->enqueue(draw, hasBounds ? &devBounds : nullptr, false,
+                  [path, preMatrix, paint](const SkDraw& d) {
+        // Every tile shares our copy of the path, so none of them may modify it.
+        d.drawPath(path, paint, preMatrix.getMaybeNull(), false);
+    });
+}
+
+void SkThreadedBMPDevice::onDrawBitmap(const SkDraw& draw, const SkBitmap& bitmap,
+                                       const SkMatrix& prematrix, const SkRect* dstOrNull,
+                                       const SkPaint& paint) {
+    SkRect devBounds;
+    const SkRect localBounds = dstOrNull ? *dstOrNull : SkRect::MakeIWH(bitmap.width(),
+                                                                        bitmap.height());
+    bool hasBounds = compute_dev_bounds(localBounds,
+                                        dstOrNull ? *draw.fMatrix
+                                                  : SkMatrix::Concat(*draw.fMatrix, prematrix),
+                                        paint, &devBounds);
+
+    SkMatrix matrix(prematrix);
+    (void)matrix.getType();
+    SkTLazy<SkRect> dst;
+    if (dstOrNull) {
+        dst.init(*dstOrNull);
+    }
+    // Rotated, skewed and alpha-only bitmaps are drawn as paths, antialiased ones as AA rects.
+    bool clipsExactly = !paint.isAntiAlias() && !paint.getMaskFilter() &&
+                        kAlpha_8_SkColorType != bitmap.colorType() &&
+                        draw.fMatrix->isScaleTranslate() && matrix.isScaleTranslate();
+    this->enqueue(draw, hasBounds ? &devBounds : nullptr, clipsExactly,
+                  [bitmap, matrix, dst, paint](const SkDraw& d) {
+        d.drawBitmap(bitmap, matrix, dst.getMaybeNull(), paint);
+    });
+}
+
+void SkThreadedBMPDevice::drawSprite(const SkDraw& draw, const SkBitmap& bitmap,
+                                     int x, int y, const SkPaint& paint) {
+    SkRect devBounds;
+    bool hasBounds = compute_dev_bounds(SkRect::MakeXYWH(x, y, bitmap.width(), bitmap.height()),
+                                        SkMatrix::I(), paint, &devBounds);
+    this->enqueue(draw, hasBounds ? &devBounds : nullptr, true,
+                  [bitmap, x, y, paint](const SkDraw& d) {
+        d.drawSprite(bitmap, x, y, paint);
+    });
+}
+
+void SkThreadedBMPDevice::drawText(const SkDraw& draw, const void* text, size_t len,
+                                   SkScalar x, SkScalar y, const SkPaint& paint) {
+    sk_sp<SkData> glyphs = SkData::MakeWithCopy(text, len);
+    bool clipsExactly = !paint.getMaskFilter() &&
+                        !SkDraw::ShouldDrawTextAsPaths(paint, *draw.fMatrix);
+    this->enqueue(draw, nullptr, clipsExactly, [glyphs, x, y, paint](const SkDraw& d) {
+        d.drawText(data_or_null<char>(glyphs), glyphs->size(), x, y, paint);
+    });
+}
+
+void SkThreadedBMPDevice::drawPosText(const SkDraw& draw, const void* text, size_t len,
+                                      const SkScalar xpos[], int scalarsPerPos,
+                                      const SkPoint& offset, const SkPaint& paint) {
+    const int glyphCount = paint.textToGlyphs(text, len, nullptr);
+    sk_sp<SkData> glyphs = SkData::MakeWithCopy(text, len);
+    sk_sp<SkData> pos    = SkData::MakeWithCopy(xpos, glyphCount * scalarsPerPos * sizeof(SkScalar));
+    bool clipsExactly = !paint.getMaskFilter() &&
+                        !SkDraw::ShouldDrawTextAsPaths(paint, *draw.fMatrix);
+    this->enqueue(draw, nullptr, clipsExactly,
+                  [glyphs, pos, scalarsPerPos, offset, paint](const SkDraw& d) {
+        d.drawPosText(data_or_null<char>(glyphs), glyphs->size(), data_or_null<SkScalar>(pos),
+                      scalarsPerPos, offset, paint);
+    });
+}
+
+void SkThreadedBMPDevice::drawVertices(const SkDraw& draw, SkCanvas::VertexMode vmode,
+                                       int vertexCount,
+                                       const SkPoint verts[], const SkPoint texs[],
+                                       const SkColor colors[], SkXfermode* xmode,
+                                       const uint16_t indices[], int indexCount,
+                                       const SkPaint& paint) {
+    sk_sp<SkData> vertData  = copy_or_null(verts,   vertexCount * sizeof(SkPoint)),
+                  texData   = copy_or_null(texs,    vertexCount * sizeof(SkPoint)),
+                  colorData = copy_or_null(colors,  vertexCount * sizeof(SkColor)),
+                  indexData = copy_or_null(indices, indexCount  * sizeof(uint16_t));
+    sk_sp<SkXfermode> mode = sk_ref_sp(xmode);
+    this->enqueue(draw, nullptr, false, [=](const SkDraw& d) {
+        d.drawVertices(vmode, vertexCount, data_or_null<SkPoint>(vertData),
+                       data_or_null<SkPoint>(texData), data_or_null<SkColor>(colorData),
+                       mode.get(), data_or_null<uint16_t>(indexData), indexCount, paint);
+    });
+}
+
+void SkThreadedBMPDevice::drawDevice(const SkDraw& draw, SkBaseDevice* device,
+                                     int x, int y, const SkPaint& paint) {
+    SkASSERT(!paint.getImageFilter());
+    // Hold a ref so the layer's pixels outlive the layer itself.
+    sk_sp<SkBaseDevice> src = sk_ref_sp(device);
+    SkRect devBounds;
+    bool hasBounds = compute_dev_bounds(SkRect::MakeXYWH(x, y, device->width(), device->height()),
+                                        SkMatrix::I(), paint, &devBounds);
+    this->enqueue(draw, hasBounds ? &devBounds : nullptr, true,
+                  [this, src, x, y, paint](const SkDraw& d) {
+        this->INHERITED::drawDevice(d, src.get(), x, y, paint);
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+sk_sp<SkSpecialImage> SkThreadedBMPDevice::snapSpecial() {
+    this->flush();
+    return this->INHERITED::snapSpecial();
+}
+
+bool SkThreadedBMPDevice::onReadPixels(const SkImageInfo& info, void* pixels, size_t rowBytes,
+                                       int x, int y) {
+    this->flush();
+    return this->INHERITED::onReadPixels(info, pixels, rowBytes, x, y);
+}
+
+bool SkThreadedBMPDevice::onWritePixels(const SkImageInfo& info, const void* pixels,
+                                        size_t rowBytes, int x, int y) {
+    this->flush();
+    return this->INHERITED::onWritePixels(info, pixels, rowBytes, x, y);
+}
+
+bool SkThreadedBMPDevice::onPeekPixels(SkPixmap* pmap) {
+    this->flush();
+    return this->INHERITED::onPeekPixels(pmap);
+}
+
+void SkThreadedBMPDevice::replaceBitmapBackendForRasterSurface(const SkBitmap& bm) {
+    this->flush();
+    this->INHERITED::replaceBitmapBackendForRasterSurface(bm);
+}
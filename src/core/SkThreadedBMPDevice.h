@@ -0,0 +1,105 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkThreadedBMPDevice_DEFINED
+#define SkThreadedBMPDevice_DEFINED
+
+#include "SkBitmapDevice.h"
+#include "SkMatrix.h"
+#include "SkRasterClip.h"
+#include "SkTArray.h"
+
+#include <functional>
+
+/**
+ *  A raster device that splits its bitmap into horizontal tiles and rasterizes them in parallel
+ *  on the SkTaskGroup thread pool.
+ *
+ *  Draws are not executed when they are issued.  Instead we capture the matrix, clip, paint and
+ *  geometry of each draw, and replay the queue once per tile when the device is flushed.  Each
+ *  tile draws with its clip intersected with the tile bounds, always in the same order the draws
+ *  were issued, so the pixels written match what SkBitmapDevice would produce.
+ *
+ *  Paths, hairlines and the like are chopped against the clip bounds before they're scan
+ *  converted, so a tighter clip can move their edges by a fraction of a pixel.  When one of
+ *  those crosses a tile boundary, we finish the tiles' work so far and draw it alone with its
+ *  original clip.
+ *
+ *  Anything that reads or replaces our pixels (readPixels, peekPixels, snapSpecial, ...) flushes
+ *  first.  accessPixels() itself does not, since SkCanvas calls it to set up every draw; when a
+ *  caller asks for the pixels through SkCanvas::accessTopLayerPixels(), the canvas flushes us.
+ */
+class SkThreadedBMPDevice : public SkBitmapDevice {
+public:
+    // tileCount <= 0 picks a tile count from the bitmap height.
+    SkThreadedBMPDevice(const SkBitmap& bitmap, int tileCount, const SkSurfaceProps& props);
+    ~SkThreadedBMPDevice() override;
+
+    int tileCount() const { return fTileBounds.count(); }
+
+    // Rasterize all queued draws into our bitmap, blocking until every tile is done.
+    void flush() override;
+
+protected:
+    void drawPaint(const SkDraw&, const SkPaint&) override;
+    void drawPoints(const SkDraw&, SkCanvas::PointMode, size_t count,
+                    const SkPoint[], const SkPaint&) override;
+    void drawRect(const SkDraw&, const SkRect&, const SkPaint&) override;
+    void drawRRect(const SkDraw&, const SkRRect&, const SkPaint&) override;
+    void drawPath(const SkDraw&, const SkPath&, const SkPaint&,
+                  const SkMatrix* prePathMatrix, bool pathIsMutable) override;
+    void onDrawBitmap(const SkDraw&, const SkBitmap&, const SkMatrix&,
+                      const SkRect* dstOrNull, const SkPaint&) override;
+    void drawSprite(const SkDraw&, const SkBitmap&, int x, int y, const SkPaint&) override;
+    void drawText(const SkDraw&, const void* text, size_t len,
+                  SkScalar x, SkScalar y, const SkPaint&) override;
+    void drawPosText(const SkDraw&, const void* text, size_t len,
+                     const SkScalar pos[], int scalarsPerPos,
+                     const SkPoint& offset, const SkPaint&) override;
+    void drawVertices(const SkDraw&, SkCanvas::VertexMode, int vertexCount,
+                      const SkPoint verts[], const SkPoint texs[],
+                      const SkColor colors[], SkXfermode* xmode,
+                      const uint16_t indices[], int indexCount,
+                      const SkPaint&) override;
+    void drawDevice(const SkDraw&, SkBaseDevice*, int x, int y, const SkPaint&) override;
+
+    sk_sp<SkSpecialImage> snapSpecial() override;
+
+    bool onReadPixels(const SkImageInfo&, void*, size_t, int x, int y) override;
+    bool onWritePixels(const SkImageInfo&, const void*, size_t, int x, int y) override;
+    bool onPeekPixels(SkPixmap*) override;
+
+private:
+    // A queued draw.  If fTileable, fDraw is called once for each tile intersecting fBounds,
+    // with an SkDraw whose matrix is fMatrix and whose clip is fRC restricted to that tile.
+    // Otherwise it's called once, with fRC as is.
+    struct DrawElement {
+        DrawElement(const SkIRect& bounds, bool tileable, const SkDraw&,
+                    std::function<void(const SkDraw&)> fn);
+
+        SkIRect                              fBounds;
+        bool                                 fTileable;
+        SkMatrix                             fMatrix;
+        SkRasterClip                         fRC;
+        std::function<void(const SkDraw&)>   fDraw;
+    };
+
+    // Queue fn to be called with each tile's SkDraw.  devBounds are the draw's device-space
+    // bounds before clipping, or nullptr if they're unknown.  clipsExactly means the draw writes
+    // the same pixels no matter how its clip is split up.
+    void enqueue(const SkDraw&, const SkRect* devBounds, bool clipsExactly,
+                 std::function<void(const SkDraw&)> fn);
+
+    void replaceBitmapBackendForRasterSurface(const SkBitmap&) override;
+
+    SkTArray<SkIRect>       fTileBounds;
+    SkTArray<DrawElement>   fQueue;
+
+    typedef SkBitmapDevice INHERITED;
+};
+
+#endif // SkThreadedBMPDevice_DEFINED
@@ -8,9 +8,13 @@
 
 #include "SkBlurMask.h"
 #include "SkMath.h"
+#include "SkOpts.h"
+#include "SkTaskGroup.h"
 #include "SkTemplates.h"
 #include "SkEndian.h"
 
+#include <functional>
+
 
 // This constant approximates the scaling done in the software path's
 // "high quality" mode, in SkBlurMask::Blur() (1 / sqrt(3)).
@@ -31,12 +35,33 @@ SkScalar SkBlurMask::ConvertSigmaToRadius(SkScalar sigma) {
 
 #define UNROLL_SEPARABLE_LOOPS
 
+bool gSkBlurMaskUseThreads = false;
+
+// Masks with at least this many pixels are blurred in bands of at least kMinBandRows rows.
+static const int kMinThreadedPixels = 512 * 512;
+static const int kMinBandRows       = 64;
+
+// Calls rows(y0, y1) over bands covering [0, height), splitting them across threads if
+// gSkBlurMaskUseThreads is set and the pass is big enough to be worth it.  Bands are a
+// multiple of 16 rows so SkOpts' kernels can do all but the last one's remainder.
+static void for_each_band(int width, int height, const std::function<void(int, int)>& rows) {
+    if (!gSkBlurMaskUseThreads || width * height < kMinThreadedPixels) {
+        rows(0, height);
+        return;
+    }
+    const int bandRows = SkAlign16(SkTMax(kMinBandRows, height / sk_num_cores()));
+    SkTaskGroup().batch((height + bandRows - 1) / bandRows, [&](int i) {
+        rows(i * bandRows, SkTMin((i + 1) * bandRows, height));
+    });
+}
+
 /**
- * This function performs a box blur in X, of the given radius.  If the
- * "transpose" parameter is true, it will transpose the pixels on write,
+ * This function performs a box blur in X, of the given radius, on rows [y0, y1).
+ * If the "transpose" parameter is true, it will transpose the pixels on write,
  * such that X and Y are swapped. Reads are always performed from contiguous
  * memory in X, for speed. The destination buffer (dst) must be at least
- * (width + leftRadius + rightRadius) * height bytes in size.
+ * (width + leftRadius + rightRadius) * height bytes in size.  SkOpts::box_blur_a8
+ * does what it can of [y0, y1) 16 rows at a time, and we finish the rest.
  *
  * This is what the inner loop looks like before unrolling, and with the two
  * cases broken out separately (width < diameter, width >= diameter):
@@ -75,10 +100,12 @@ SkScalar SkBlurMask::ConvertSigmaToRadius(SkScalar sigma) {
  *          }
  *      }
  */
-static int boxBlur(const uint8_t* src, int src_y_stride, uint8_t* dst,
-                   int leftRadius, int rightRadius, int width, int height,
-                   bool transpose)
+static void boxBlurRows(const uint8_t* src, int src_y_stride, uint8_t* dst,
+                        int leftRadius, int rightRadius, int width, int height,
+                        bool transpose, int y0, int y1)
 {
+    y0 += SkOpts::box_blur_a8(src, src_y_stride, dst, leftRadius, rightRadius, width, height,
+                              transpose, y0, y1);
     int diameter = leftRadius + rightRadius;
     int kernelSize = diameter + 1;
     int border = SkMin32(width, diameter);
@@ -87,7 +114,7 @@ static int boxBlur(const uint8_t* src, int src_y_stride, uint8_t* dst,
     int dst_x_stride = transpose ? height : 1;
     int dst_y_stride = transpose ? 1 : new_width;
     uint32_t half = 1 << 23;
-    for (int y = 0; y < height; ++y) {
+    for (int y = y0; y < y1; ++y) {
         uint32_t sum = 0;
         uint8_t* dptr = dst + y * dst_y_stride;
         const uint8_t* right = src + y * src_y_stride;
@@ -221,7 +248,17 @@ static int boxBlur(const uint8_t* src, int src_y_stride, uint8_t* dst,
         }
         SkASSERT(sum == 0);
     }
-    return new_width;
+}
+
+static int boxBlur(const uint8_t* src, int src_y_stride, uint8_t* dst,
+                   int leftRadius, int rightRadius, int width, int height,
+                   bool transpose)
+{
+    for_each_band(width, height, [&](int y0, int y1) {
+        boxBlurRows(src, src_y_stride, dst, leftRadius, rightRadius, width, height,
+                    transpose, y0, y1);
+    });
+    return width + SkMax32(leftRadius, rightRadius) * 2;
 }
 
 /**
@@ -277,10 +314,12 @@ static int boxBlur(const uint8_t* src, int src_y_stride, uint8_t* dst,
  *  return new_width;
  */
 
-static int boxBlurInterp(const uint8_t* src, int src_y_stride, uint8_t* dst,
-                         int radius, int width, int height,
-                         bool transpose, uint8_t outer_weight)
+static void boxBlurInterpRows(const uint8_t* src, int src_y_stride, uint8_t* dst,
+                              int radius, int width, int height,
+                              bool transpose, uint8_t outer_weight, int y0, int y1)
 {
+    y0 += SkOpts::box_blur_a8_interp(src, src_y_stride, dst, radius, width, height,
+                                     transpose, outer_weight, y0, y1);
     int diameter = radius * 2;
     int kernelSize = diameter + 1;
     int border = SkMin32(width, diameter);
@@ -293,7 +332,7 @@ static int boxBlurInterp(const uint8_t* src, int src_y_stride, uint8_t* dst,
     int new_width = width + diameter;
     int dst_x_stride = transpose ? height : 1;
     int dst_y_stride = transpose ? 1 : new_width;
-    for (int y = 0; y < height; ++y) {
+    for (int y = y0; y < y1; ++y) {
         uint32_t outer_sum = 0, inner_sum = 0;
         uint8_t* dptr = dst + y * dst_y_stride;
         const uint8_t* right = src + y * src_y_stride;
@@ -402,7 +441,17 @@ static int boxBlurInterp(const uint8_t* src, int src_y_stride, uint8_t* dst,
 #undef RIGHT_BORDER_ITER
         SkASSERT(outer_sum == 0 && inner_sum == 0);
     }
-    return new_width;
+}
+
+static int boxBlurInterp(const uint8_t* src, int src_y_stride, uint8_t* dst,
+                         int radius, int width, int height,
+                         bool transpose, uint8_t outer_weight)
+{
+    for_each_band(width, height, [&](int y0, int y1) {
+        boxBlurInterpRows(src, src_y_stride, dst, radius, width, height,
+                          transpose, outer_weight, y0, y1);
+    });
+    return width + radius * 2;
 }
 
 static void get_adjusted_radii(SkScalar passRadius, int *loRadius, int *hiRadius)
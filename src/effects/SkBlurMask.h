@@ -13,6 +13,10 @@
 #include "SkMask.h"
 #include "SkRRect.h"
 
+// If true, BoxBlur() splits the passes over big masks across SkTaskGroup's threads.
+// False by default.  The result is the same either way.
+extern bool gSkBlurMaskUseThreads;
+
 class SkBlurMask {
 public:
     static bool SK_WARN_UNUSED_RESULT BlurRect(SkScalar sigma, SkMask *dst, const SkRect &src,
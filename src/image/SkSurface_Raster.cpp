@@ -10,6 +10,7 @@
 #include "SkCanvas.h"
 #include "SkDevice.h"
 #include "SkMallocPixelRef.h"
+#include "SkThreadedBMPDevice.h"
 
 static const size_t kIgnoreRowBytesValue = (size_t)~0;
 
@@ -20,7 +21,7 @@ public:
     SkSurface_Raster(const SkImageInfo&, void*, size_t rb,
                      void (*releaseProc)(void* pixels, void* context), void* context,
                      const SkSurfaceProps*);
-    SkSurface_Raster(SkPixelRef*, const SkSurfaceProps*);
+    SkSurface_Raster(SkPixelRef*, const SkSurfaceProps*, int threadedTileCount = -1);
 
     SkCanvas* onNewCanvas() override;
     sk_sp<SkSurface> onNewSurface(const SkImageInfo&) override;
@@ -33,6 +34,11 @@ private:
     SkBitmap    fBitmap;
     size_t      fRowBytes;
     bool        fWeOwnThePixels;
+    // If >= 0, our canvas draws through an SkThreadedBMPDevice with this many tiles.
+    int         fThreadedTileCount;
+
+    // Our canvas may have draws queued that haven't reached fBitmap yet.
+    void flushThreadedDraws();
 
     typedef SkSurface_Base INHERITED;
 };
@@ -94,9 +100,11 @@ SkSurface_Raster::SkSurface_Raster(const SkImageInfo& info, void* pixels, size_t
     fBitmap.installPixels(info, pixels, rb, nullptr, releaseProc, context);
     fRowBytes = 0;              // don't need to track the rowbytes
     fWeOwnThePixels = false;    // We are "Direct"
+    fThreadedTileCount = -1;
 }
 
-SkSurface_Raster::SkSurface_Raster(SkPixelRef* pr, const SkSurfaceProps* props)
+SkSurface_Raster::SkSurface_Raster(SkPixelRef* pr, const SkSurfaceProps* props,
+                                   int threadedTileCount)
     : INHERITED(pr->info().width(), pr->info().height(), props)
 {
     const SkImageInfo& info = pr->info();
@@ -105,20 +113,40 @@ SkSurface_Raster::SkSurface_Raster(SkPixelRef* pr, const SkSurfaceProps* props)
     fBitmap.setPixelRef(pr);
     fRowBytes = pr->rowBytes(); // we track this, so that subsequent re-allocs will match
     fWeOwnThePixels = true;
+    fThreadedTileCount = threadedTileCount;
 }
 
-SkCanvas* SkSurface_Raster::onNewCanvas() { return new SkCanvas(fBitmap, this->props()); }
+SkCanvas* SkSurface_Raster::onNewCanvas() {
+    if (fThreadedTileCount >= 0) {
+        SkAutoTUnref<SkBaseDevice> device(new SkThreadedBMPDevice(fBitmap, fThreadedTileCount,
+                                                                  this->props()));
+        return new SkCanvas(device);
+    }
+    return new SkCanvas(fBitmap, this->props());
+}
+
+void SkSurface_Raster::flushThreadedDraws() {
+    if (fThreadedTileCount >= 0) {
+        this->getCachedCanvas()->flush();
+    }
+}
 
 sk_sp<SkSurface> SkSurface_Raster::onNewSurface(const SkImageInfo& info) {
+    if (fThreadedTileCount >= 0) {
+        return SkSurface::MakeRasterThreaded(info, fThreadedTileCount, &this->props());
+    }
     return SkSurface::MakeRaster(info, &this->props());
 }
 
 void SkSurface_Raster::onDraw(SkCanvas* canvas, SkScalar x, SkScalar y,
                               const SkPaint* paint) {
+    this->flushThreadedDraws();
     canvas->drawBitmap(fBitmap, x, y, paint);
 }
 
 sk_sp<SkImage> SkSurface_Raster::onNewImageSnapshot(SkBudgeted, ForceCopyMode forceCopyMode) {
+    this->flushThreadedDraws();
+
     if (fWeOwnThePixels) {
         // SkImage_raster requires these pixels are immutable for its full lifetime.
         // We'll undo this via onRestoreBackingMutability() if we can avoid the COW.
@@ -205,3 +233,16 @@ sk_sp<SkSurface> SkSurface::MakeRaster(const SkImageInfo& info, size_t rowBytes,
     }
     return sk_make_sp<SkSurface_Raster>(pr, props);
 }
+
+sk_sp<SkSurface> SkSurface::MakeRasterThreaded(const SkImageInfo& info, int tileCount,
+                                               const SkSurfaceProps* props) {
+    if (!SkSurface_Raster::Valid(info)) {
+        return nullptr;
+    }
+
+    SkAutoTUnref<SkPixelRef> pr(SkMallocPixelRef::NewZeroed(info, 0, nullptr));
+    if (nullptr == pr.get()) {
+        return nullptr;
+    }
+    return sk_make_sp<SkSurface_Raster>(pr, props, SkTMax(tileCount, 0));
+}
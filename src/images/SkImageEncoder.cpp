@@ -7,13 +7,38 @@
 
 #include "SkImageEncoder.h"
 #include "SkBitmap.h"
+#include "SkImageEncoderPriv.h"
 #include "SkPixelSerializer.h"
 #include "SkPixmap.h"
 #include "SkStream.h"
 #include "SkTemplates.h"
 
+// Read by SkPNGImageEncoder, which is not built everywhere.
+bool gSkPNGEncodeUseThreads = false;
+
 SkImageEncoder::~SkImageEncoder() {}
 
+bool SkScanlineEncoder::writeRows(const void* src, size_t rowBytes, int count) {
+    if (kWriting_State != fState || count < 0 || count > fInfo.height() - fRowsWritten ||
+            rowBytes < fInfo.minRowBytes()) {
+        return false;
+    }
+    if (!this->onWriteRows(src, rowBytes, count)) {
+        fState = kFailed_State;
+        return false;
+    }
+    fRowsWritten += count;
+    return true;
+}
+
+bool SkScanlineEncoder::finish() {
+    if (kWriting_State != fState || fRowsWritten != fInfo.height()) {
+        return false;
+    }
+    fState = this->onFinish() ? kFinished_State : kFailed_State;
+    return kFinished_State == fState;
+}
+
 bool SkImageEncoder::encodeStream(SkWStream* stream, const SkBitmap& bm,
                                   int quality) {
     quality = SkMin32(100, SkMax32(0, quality));
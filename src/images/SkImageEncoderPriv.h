@@ -0,0 +1,16 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkImageEncoderPriv_DEFINED
+#define SkImageEncoderPriv_DEFINED
+
+// If true, big images are filtered and deflated in chunks on SkTaskGroup's threads, like pigz
+// does, rather than by libpng on one thread.  False by default.  The chunks do not depend on
+// the number of threads, so neither does the output.
+extern bool gSkPNGEncodeUseThreads;
+
+#endif
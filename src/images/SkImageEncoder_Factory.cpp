@@ -8,6 +8,7 @@
 #include "SkImageEncoder.h"
 
 template SkImageEncoder_EncodeReg* SkImageEncoder_EncodeReg::gHead;
+template SkScanlineEncoder_Reg* SkScanlineEncoder_Reg::gHead;
 
 SkImageEncoder* SkImageEncoder::Create(Type t) {
     SkImageEncoder* codec = nullptr;
@@ -20,3 +21,19 @@ SkImageEncoder* SkImageEncoder::Create(Type t) {
     }
     return nullptr;
 }
+
+SkScanlineEncoder* SkScanlineEncoder::Create(SkWStream* stream, const SkImageInfo& info,
+                                             SkImageEncoder::Type t, int quality) {
+    if (info.isEmpty()) {
+        return nullptr;
+    }
+    quality = SkMin32(100, SkMax32(0, quality));
+    const SkScanlineEncoder_Reg* curr = SkScanlineEncoder_Reg::Head();
+    while (curr) {
+        if (SkScanlineEncoder* encoder = curr->factory()(stream, info, t, quality)) {
+            return encoder;
+        }
+        curr = curr->next();
+    }
+    return nullptr;
+}
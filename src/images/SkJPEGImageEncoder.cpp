@@ -174,6 +174,102 @@ protected:
     }
 };
 
+///////////////////////////////////////////////////////////////////////////////
+
+class SkJPEGScanlineEncoder : public SkScanlineEncoder {
+public:
+    static SkScanlineEncoder* Create(SkWStream* stream, const SkImageInfo& info, int quality) {
+        WriteScanline writer;
+        switch (info.colorType()) {
+            case kN32_SkColorType:
+                writer = Write_32_RGB;
+                break;
+            case kRGB_565_SkColorType:
+                writer = Write_16_RGB;
+                break;
+            case kARGB_4444_SkColorType:
+                writer = Write_4444_RGB;
+                break;
+            default:
+                return nullptr;
+        }
+
+        SkAutoTDelete<SkJPEGScanlineEncoder> encoder(
+                new SkJPEGScanlineEncoder(info, stream, writer));
+        jpeg_compress_struct* cinfo = &encoder->fCInfo;
+        if (setjmp(encoder->fErrorMgr.fJmpBuf)) {
+            return nullptr;
+        }
+
+        jpeg_create_compress(cinfo);
+        encoder->fCreated = true;
+        cinfo->dest = &encoder->fDestMgr;
+        cinfo->image_width = info.width();
+        cinfo->image_height = info.height();
+        cinfo->input_components = 3;
+        cinfo->in_color_space = JCS_RGB;
+        cinfo->input_gamma = 1;
+        jpeg_set_defaults(cinfo);
+
+        // Unlike SkJPEGImageEncoder, do not compute optimal Huffman tables.  That
+        // would make libjpeg-turbo buffer the whole image.
+        jpeg_set_quality(cinfo, quality, TRUE /* limit to baseline-JPEG values */);
+        jpeg_start_compress(cinfo, TRUE);
+        return encoder.release();
+    }
+
+    ~SkJPEGScanlineEncoder() override {
+        if (fCreated) {
+            jpeg_destroy_compress(&fCInfo);
+        }
+    }
+
+protected:
+    bool onWriteRows(const void* src, size_t rowBytes, int count) override {
+        if (setjmp(fErrorMgr.fJmpBuf)) {
+            return false;
+        }
+        const char* srcRow = (const char*)src;
+        for (int y = 0; y < count; y++) {
+            JSAMPROW row_pointer[1];
+            fWriter(fRow.get(), srcRow, this->info().width(), nullptr);
+            row_pointer[0] = fRow.get();
+            (void) jpeg_write_scanlines(&fCInfo, row_pointer, 1);
+            srcRow += rowBytes;
+        }
+        return true;
+    }
+
+    bool onFinish() override {
+        if (setjmp(fErrorMgr.fJmpBuf)) {
+            return false;
+        }
+        jpeg_finish_compress(&fCInfo);
+        return true;
+    }
+
+private:
+    SkJPEGScanlineEncoder(const SkImageInfo& info, SkWStream* stream, WriteScanline writer)
+        : INHERITED(info)
+        , fDestMgr(stream)
+        , fWriter(writer)
+        , fRow(info.width() * 3)
+        , fCreated(false)
+    {
+        fCInfo.err = jpeg_std_error(&fErrorMgr);
+        fErrorMgr.error_exit = skjpeg_error_exit;
+    }
+
+    jpeg_compress_struct   fCInfo;
+    skjpeg_error_mgr       fErrorMgr;
+    skjpeg_destination_mgr fDestMgr;
+    const WriteScanline    fWriter;
+    SkAutoTMalloc<uint8_t> fRow;
+    bool                   fCreated;
+
+    typedef SkScanlineEncoder INHERITED;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 DEFINE_ENCODER_CREATOR(JPEGImageEncoder);
 ///////////////////////////////////////////////////////////////////////////////
@@ -182,4 +278,12 @@ static SkImageEncoder* sk_libjpeg_efactory(SkImageEncoder::Type t) {
     return (SkImageEncoder::kJPEG_Type == t) ? new SkJPEGImageEncoder : nullptr;
 }
 
+static SkScanlineEncoder* sk_libjpeg_scanline_efactory(SkWStream* stream,
+                                                       const SkImageInfo& info,
+                                                       SkImageEncoder::Type t, int quality) {
+    return (SkImageEncoder::kJPEG_Type == t) ? SkJPEGScanlineEncoder::Create(stream, info, quality)
+                                             : nullptr;
+}
+
 static SkImageEncoder_EncodeReg gEReg(sk_libjpeg_efactory);
+static SkScanlineEncoder_Reg gScanlineReg(sk_libjpeg_scanline_efactory);
@@ -9,15 +9,23 @@
 #include "SkColor.h"
 #include "SkColorPriv.h"
 #include "SkDither.h"
+#include "SkImageEncoderPriv.h"
 #include "SkMath.h"
 #include "SkRTConf.h"
 #include "SkStream.h"
+#include "SkTaskGroup.h"
 #include "SkTemplates.h"
 #include "SkUtils.h"
 #include "transform_scanline.h"
 
 #include "png.h"
 
+#ifdef ZLIB_INCLUDE
+    #include ZLIB_INCLUDE
+#else
+    #include "zlib.h"
+#endif
+
 /* These were dropped in libpng >= 1.4 */
 #ifndef png_infopp_NULL
 #define png_infopp_NULL nullptr
@@ -162,6 +170,199 @@ static inline int pack_palette(SkColorTable* ctable,
     return num_trans;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+// Each chunk is about this many bytes of filtered rows.
+static const size_t kChunkBytes  = 256 * 1024;
+// deflate's window.  Each chunk's dictionary is the end of the chunk before it.
+static const size_t kWindowBytes = 32 * 1024;
+
+static inline uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+    const int p  = a + b - c,
+              pa = SkTAbs(p - a),
+              pb = SkTAbs(p - b),
+              pc = SkTAbs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+// Writes the filter type and then the filtered row to out.  If allFilters is false, the
+// filter is None; otherwise it is whichever of the five gives the smallest sum of absolute
+// values, as signed bytes.  That is libpng's heuristic, and its choice of filters.
+static void filter_row(const uint8_t* row, const uint8_t* prev, size_t rowBytes, size_t bpp,
+                       bool allFilters, uint8_t* scratch, uint8_t* out) {
+    if (!allFilters) {
+        out[0] = PNG_FILTER_VALUE_NONE;
+        memcpy(out + 1, row, rowBytes);
+        return;
+    }
+
+    int best = 0;
+    uint32_t bestSum = 0xFFFFFFFF;
+    for (int filter = PNG_FILTER_VALUE_NONE; filter < PNG_FILTER_VALUE_LAST; filter++) {
+        uint8_t* dst = scratch + filter * rowBytes;
+        uint32_t sum = 0;
+        for (size_t i = 0; i < rowBytes; i++) {
+            const uint8_t a = i >= bpp ? row[i - bpp] : 0,
+                          b = prev[i],
+                          c = i >= bpp ? prev[i - bpp] : 0;
+            uint8_t predictor = 0;
+            switch (filter) {
+                case PNG_FILTER_VALUE_SUB:   predictor = a;               break;
+                case PNG_FILTER_VALUE_UP:    predictor = b;               break;
+                case PNG_FILTER_VALUE_AVG:   predictor = (a + b) >> 1;    break;
+                case PNG_FILTER_VALUE_PAETH: predictor = paeth(a, b, c);  break;
+            }
+            dst[i] = row[i] - predictor;
+            sum += SkTAbs((int) (int8_t) dst[i]);
+        }
+        if (sum < bestSum) {
+            best = filter;
+            bestSum = sum;
+        }
+    }
+    out[0] = best;
+    memcpy(out + 1, scratch + best * rowBytes, rowBytes);
+}
+
+// One chunk of rows, filtered and deflated.
+struct PNGChunk {
+    SkAutoTMalloc<uint8_t> fData;
+    size_t                 fSize;
+    uLong                  fAdler;
+    uLong                  fFilteredSize;
+    bool                   fSucceeded;
+};
+
+/*
+ *  Filters and deflates rows [y0, y1) into chunk.  Unless it is the first chunk, the rows
+ *  before y0 are filtered too, to make the dictionary.  The result is a run of raw deflate
+ *  blocks that ends on a byte boundary, or ends the stream if y1 is the last row.
+ */
+static void deflate_chunk(const SkBitmap& bitmap, transform_scanline_proc proc, size_t rowBytes,
+                          size_t bpp, bool allFilters, int y0, int y1, PNGChunk* chunk) {
+    chunk->fSucceeded = false;
+    const size_t filteredRowBytes = rowBytes + 1;
+    const int primeRows = SkTMin(y0, SkToInt((kWindowBytes + filteredRowBytes - 1) /
+                                             filteredRowBytes));
+    const int firstRow = y0 - primeRows;
+
+    // prev and row are the unfiltered rows, which png starts off with a row of zeros.
+    SkAutoTMalloc<uint8_t> storage(2 * rowBytes + 5 * rowBytes +
+                                   (y1 - firstRow) * filteredRowBytes);
+    uint8_t* prev     = storage.get();
+    uint8_t* row      = prev + rowBytes;
+    uint8_t* scratch  = row + rowBytes;
+    uint8_t* filtered = scratch + 5 * rowBytes;
+    sk_bzero(prev, rowBytes);
+    if (firstRow > 0) {
+        proc((const char*) bitmap.getAddr(0, firstRow - 1), bitmap.width(), (char*) prev);
+    }
+    for (int y = firstRow; y < y1; y++) {
+        proc((const char*) bitmap.getAddr(0, y), bitmap.width(), (char*) row);
+        filter_row(row, prev, rowBytes, bpp, allFilters,
+                   scratch, filtered + (y - firstRow) * filteredRowBytes);
+        SkTSwap(prev, row);
+    }
+
+    // The same settings libpng uses by default.
+    z_stream stream;
+    sk_bzero(&stream, sizeof(stream));
+    if (Z_OK != deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                             allFilters ? Z_FILTERED : Z_DEFAULT_STRATEGY)) {
+        return;
+    }
+    const size_t primeBytes = primeRows * filteredRowBytes;
+    if (primeBytes > 0) {
+        const size_t dictionaryBytes = SkTMin(primeBytes, kWindowBytes);
+        deflateSetDictionary(&stream, filtered + primeBytes - dictionaryBytes,
+                             SkToUInt(dictionaryBytes));
+    }
+
+    const bool last = y1 == bitmap.height();
+    const uLong inputBytes = (y1 - y0) * filteredRowBytes;
+    // A sync flush adds an empty stored block to what deflateBound() allows for.
+    const uLong outputBytes = deflateBound(&stream, inputBytes) + 16;
+    chunk->fData.reset(outputBytes);
+    stream.next_in = filtered + primeBytes;
+    stream.avail_in = SkToUInt(inputBytes);
+    stream.next_out = chunk->fData.get();
+    stream.avail_out = SkToUInt(outputBytes);
+    const int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    chunk->fSize = stream.total_out;
+    deflateEnd(&stream);
+    if ((last ? Z_STREAM_END : Z_OK) != result || stream.avail_in != 0) {
+        return;
+    }
+
+    chunk->fAdler = adler32(adler32(0, nullptr, 0), filtered + primeBytes, SkToUInt(inputBytes));
+    chunk->fFilteredSize = inputBytes;
+    chunk->fSucceeded = true;
+}
+
+static void write_be32(uint8_t* ptr, uint32_t value) {
+    ptr[0] = value >> 24;
+    ptr[1] = value >> 16;
+    ptr[2] = value >> 8;
+    ptr[3] = value;
+}
+
+/*
+ *  Writes the image data as one IDAT per chunk.  Their contents, concatenated, are a zlib
+ *  stream like the one libpng would write.  Returns false, without writing anything, if the
+ *  image is too small to be worth splitting, or if compression fails.
+ */
+static bool write_chunked_idats(png_structp png_ptr, const SkBitmap& bitmap,
+                                transform_scanline_proc proc, size_t rowBytes, size_t bpp,
+                                bool allFilters) {
+    const int height = bitmap.height();
+    const int chunkRows = SkTMax(1, SkToInt(kChunkBytes / (rowBytes + 1)));
+    const int chunkCount = (height + chunkRows - 1) / chunkRows;
+    if (chunkCount < 2) {
+        return false;
+    }
+
+    SkAutoTArray<PNGChunk> chunks(chunkCount);
+    SkTaskGroup().batch(chunkCount, [&](int i) {
+        deflate_chunk(bitmap, proc, rowBytes, bpp, allFilters,
+                      i * chunkRows, SkTMin((i + 1) * chunkRows, height), &chunks[i]);
+    });
+
+    uLong adler = adler32(0, nullptr, 0);
+    for (int i = 0; i < chunkCount; i++) {
+        if (!chunks[i].fSucceeded) {
+            return false;
+        }
+        adler = adler32_combine(adler, chunks[i].fAdler, chunks[i].fFilteredSize);
+    }
+
+    // A zlib header for a 32K window and the default compression level.
+    const uint8_t header[] = { 0x78, 0x9C };
+    uint8_t trailer[4];
+    write_be32(trailer, SkToU32(adler));
+
+    for (int i = 0; i < chunkCount; i++) {
+        const bool first = 0 == i,
+                   last  = chunkCount - 1 == i;
+        const size_t size = (first ? sizeof(header) : 0) + chunks[i].fSize +
+                            (last ? sizeof(trailer) : 0);
+        png_write_chunk_start(png_ptr, (png_const_bytep) "IDAT", SkToU32(size));
+        if (first) {
+            png_write_chunk_data(png_ptr, header, sizeof(header));
+        }
+        png_write_chunk_data(png_ptr, chunks[i].fData.get(), chunks[i].fSize);
+        if (last) {
+            png_write_chunk_data(png_ptr, trailer, sizeof(trailer));
+        }
+        png_write_chunk_end(png_ptr);
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 class SkPNGImageEncoder : public SkImageEncoder {
 protected:
     bool onEncode(SkWStream* stream, const SkBitmap& bm, int quality) override;
@@ -314,10 +515,24 @@ bool SkPNGImageEncoder::doEncode(SkWStream* stream, const SkBitmap& bitmap,
 #endif
     png_write_info(png_ptr, info_ptr);
 
+    transform_scanline_proc proc = choose_proc(ct, hasAlpha);
+
+    if (gSkPNGEncodeUseThreads) {
+        const size_t bpp = png_get_channels(png_ptr, info_ptr) * bitDepth / 8;
+        // Like libpng, do not filter palette images.
+        const bool allFilters = !(colorType & PNG_COLOR_MASK_PALETTE);
+        if (write_chunked_idats(png_ptr, bitmap, proc, png_get_rowbytes(png_ptr, info_ptr), bpp,
+                                allFilters)) {
+            // png_write_end() would complain that libpng wrote no IDATs.
+            png_write_chunk(png_ptr, (png_const_bytep) "IEND", nullptr, 0);
+            png_destroy_write_struct(&png_ptr, &info_ptr);
+            return true;
+        }
+    }
+
     const char* srcImage = (const char*)bitmap.getPixels();
     SkAutoSTMalloc<1024, char> rowStorage(bitmap.width() << 2);
     char* storage = rowStorage.get();
-    transform_scanline_proc proc = choose_proc(ct, hasAlpha);
 
     for (int y = 0; y < bitmap.height(); y++) {
         png_bytep row_ptr = (png_bytep)storage;
@@ -333,6 +548,112 @@ bool SkPNGImageEncoder::doEncode(SkWStream* stream, const SkBitmap& bitmap,
     return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+class SkPNGScanlineEncoder : public SkScanlineEncoder {
+public:
+    static SkScanlineEncoder* Create(SkWStream* stream, const SkImageInfo& info) {
+        // Our procs unpremultiply as they go, so unpremul pixels would be unpremultiplied twice.
+        if (kUnpremul_SkAlphaType == info.alphaType()) {
+            return nullptr;
+        }
+        const bool hasAlpha = !info.isOpaque();
+        int colorType = PNG_COLOR_TYPE_RGB;
+        png_color_8 sig_bit;
+        switch (info.colorType()) {
+            case kN32_SkColorType:
+                sig_bit.red = sig_bit.green = sig_bit.blue = sig_bit.alpha = 8;
+                break;
+            case kARGB_4444_SkColorType:
+                sig_bit.red = sig_bit.green = sig_bit.blue = sig_bit.alpha = 4;
+                break;
+            case kRGB_565_SkColorType:
+                sig_bit.red = 5;
+                sig_bit.green = 6;
+                sig_bit.blue = 5;
+                sig_bit.alpha = 0;
+                break;
+            default:
+                return nullptr;
+        }
+        if (hasAlpha) {
+            colorType |= PNG_COLOR_MASK_ALPHA;
+        } else {
+            sig_bit.alpha = 0;
+        }
+
+        png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr,
+                                                      sk_error_fn, nullptr);
+        if (nullptr == png_ptr) {
+            return nullptr;
+        }
+        png_infop info_ptr = png_create_info_struct(png_ptr);
+        if (nullptr == info_ptr) {
+            png_destroy_write_struct(&png_ptr, png_infopp_NULL);
+            return nullptr;
+        }
+        if (setjmp(png_jmpbuf(png_ptr))) {
+            png_destroy_write_struct(&png_ptr, &info_ptr);
+            return nullptr;
+        }
+
+        png_set_write_fn(png_ptr, (void*)stream, sk_write_fn, png_flush_ptr_NULL);
+        png_set_IHDR(png_ptr, info_ptr, info.width(), info.height(), 8, colorType,
+                     PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+#ifdef PNG_sBIT_SUPPORTED
+        png_set_sBIT(png_ptr, info_ptr, &sig_bit);
+#endif
+        png_write_info(png_ptr, info_ptr);
+
+        return new SkPNGScanlineEncoder(info, png_ptr, info_ptr,
+                                        choose_proc(info.colorType(), hasAlpha));
+    }
+
+    ~SkPNGScanlineEncoder() override {
+        png_destroy_write_struct(&fPng, &fInfo);
+    }
+
+protected:
+    bool onWriteRows(const void* src, size_t rowBytes, int count) override {
+        if (setjmp(png_jmpbuf(fPng))) {
+            return false;
+        }
+        const char* srcRow = (const char*)src;
+        for (int y = 0; y < count; y++) {
+            png_bytep row_ptr = (png_bytep)fStorage.get();
+            fProc(srcRow, this->info().width(), fStorage.get());
+            png_write_rows(fPng, &row_ptr, 1);
+            srcRow += rowBytes;
+        }
+        return true;
+    }
+
+    bool onFinish() override {
+        if (setjmp(png_jmpbuf(fPng))) {
+            return false;
+        }
+        png_write_end(fPng, fInfo);
+        return true;
+    }
+
+private:
+    SkPNGScanlineEncoder(const SkImageInfo& info, png_structp png, png_infop pngInfo,
+                         transform_scanline_proc proc)
+        : INHERITED(info)
+        , fPng(png)
+        , fInfo(pngInfo)
+        , fProc(proc)
+        , fStorage(info.width() << 2)
+    {}
+
+    png_structp                   fPng;
+    png_infop                     fInfo;
+    const transform_scanline_proc fProc;
+    SkAutoTMalloc<char>           fStorage;
+
+    typedef SkScanlineEncoder INHERITED;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 DEFINE_ENCODER_CREATOR(PNGImageEncoder);
 ///////////////////////////////////////////////////////////////////////////////
@@ -341,4 +662,11 @@ SkImageEncoder* sk_libpng_efactory(SkImageEncoder::Type t) {
     return (SkImageEncoder::kPNG_Type == t) ? new SkPNGImageEncoder : nullptr;
 }
 
+static SkScanlineEncoder* sk_libpng_scanline_efactory(SkWStream* stream, const SkImageInfo& info,
+                                                      SkImageEncoder::Type t, int /*quality*/) {
+    return (SkImageEncoder::kPNG_Type == t) ? SkPNGScanlineEncoder::Create(stream, info)
+                                            : nullptr;
+}
+
 static SkImageEncoder_EncodeReg gEReg(sk_libpng_efactory);
+static SkScanlineEncoder_Reg gScanlineReg(sk_libpng_scanline_efactory);
@@ -0,0 +1,295 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkBlurMask_opts_DEFINED
+#define SkBlurMask_opts_DEFINED
+
+#include "SkTemplates.h"
+#include "SkTypes.h"
+
+#if SK_CPU_SSE_LEVEL >= SK_CPU_SSE_LEVEL_SSE2
+    #include <immintrin.h>
+#endif
+
+// These are SkBlurMask's boxBlur() and boxBlurInterp() passes, working 16 rows at a time.
+// Each row's running sums live in their own lane, so the arithmetic (and the result) is exactly
+// what the scalar code does one row at a time.
+//
+// Written out without the scalar code's phases, each pass's output is
+//     box:    out[pre + i] = (S(i-diameter, i) * scale + half) >> 24
+//     interp: out[i]       = (S(i-diameter, i) * outer_scale +
+//                             S(i-diameter+1, i-1) * inner_scale + half) >> 24
+// where S(a,b) sums the source row from a to b inclusive, reading zero outside [0,width).
+// (The scalar boxBlurInterp() differs from this when width < diameter, so we leave that to it.)
+//
+// Both return how many rows starting at y0 they blurred, always a multiple of 16, leaving the
+// rest for the caller.
+
+namespace SK_OPTS_NS {
+
+#if SK_CPU_SSE_LEVEL >= SK_CPU_SSE_LEVEL_SSE2
+
+// Transposes a 16x16 block of bytes, one row per vector.
+static inline void mask_transpose16x16(__m128i m[16]) {
+    for (int round = 0; round < 4; round++) {
+        __m128i t[16];
+        for (int i = 0; i < 8; i++) {
+            t[2*i+0] = _mm_unpacklo_epi8(m[i], m[i+8]);
+            t[2*i+1] = _mm_unpackhi_epi8(m[i], m[i+8]);
+        }
+        memcpy(m, t, sizeof(t));
+    }
+}
+
+// Gathers 16 rows of width bytes into cols, 16 bytes per column.
+static inline void mask_load_columns(const uint8_t* src, int rowBytes, int width, uint8_t* cols) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i m[16];
+        for (int j = 0; j < 16; j++) {
+            m[j] = _mm_loadu_si128((const __m128i*)(src + j*rowBytes + x));
+        }
+        mask_transpose16x16(m);
+        for (int k = 0; k < 16; k++) {
+            _mm_storeu_si128((__m128i*)(cols + 16*(x+k)), m[k]);
+        }
+    }
+    for (; x < width; x++) {
+        for (int j = 0; j < 16; j++) {
+            cols[16*x + j] = src[j*rowBytes + x];
+        }
+    }
+}
+
+// The inverse of mask_load_columns().
+static inline void mask_store_columns(const uint8_t* cols, int width, uint8_t* dst, int rowBytes) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i m[16];
+        for (int k = 0; k < 16; k++) {
+            m[k] = _mm_loadu_si128((const __m128i*)(cols + 16*(x+k)));
+        }
+        mask_transpose16x16(m);
+        for (int j = 0; j < 16; j++) {
+            _mm_storeu_si128((__m128i*)(dst + j*rowBytes + x), m[j]);
+        }
+    }
+    for (; x < width; x++) {
+        for (int j = 0; j < 16; j++) {
+            dst[j*rowBytes + x] = cols[16*x + j];
+        }
+    }
+}
+
+#if SK_CPU_SSE_LEVEL >= SK_CPU_SSE_LEVEL_AVX2
+    // 16 uint32_t running sums, rows 0-7 in lo and 8-15 in hi.
+    struct MaskSums {
+        MaskSums() {}
+        MaskSums(uint32_t v) : lo(_mm256_set1_epi32(v)), hi(lo) {}
+        MaskSums(__m256i lo, __m256i hi) : lo(lo), hi(hi) {}
+
+        // The 16-bit a op b, widened to 32 bits.
+        static MaskSums Add(__m128i a, __m128i b) {
+            __m256i s = _mm256_add_epi16(_mm256_cvtepu8_epi16(a), _mm256_cvtepu8_epi16(b));
+            return { _mm256_cvtepu16_epi32(_mm256_castsi256_si128(s)),
+                     _mm256_cvtepu16_epi32(_mm256_extracti128_si256(s, 1)) };
+        }
+        static MaskSums Sub(__m128i a, __m128i b) {
+            __m256i d = _mm256_sub_epi16(_mm256_cvtepu8_epi16(a), _mm256_cvtepu8_epi16(b));
+            return { _mm256_cvtepi16_epi32(_mm256_castsi256_si128(d)),
+                     _mm256_cvtepi16_epi32(_mm256_extracti128_si256(d, 1)) };
+        }
+
+        MaskSums operator+(const MaskSums& o) const {
+            return { _mm256_add_epi32(lo, o.lo), _mm256_add_epi32(hi, o.hi) };
+        }
+        MaskSums operator-(const MaskSums& o) const {
+            return { _mm256_sub_epi32(lo, o.lo), _mm256_sub_epi32(hi, o.hi) };
+        }
+        MaskSums operator*(const MaskSums& o) const {
+            return { _mm256_mullo_epi32(lo, o.lo), _mm256_mullo_epi32(hi, o.hi) };
+        }
+
+        // Each sum >> 24, as 16 bytes.
+        __m128i top8() const {
+            __m256i w = _mm256_packus_epi32(_mm256_srli_epi32(lo, 24), _mm256_srli_epi32(hi, 24));
+            w = _mm256_permute4x64_epi64(w, _MM_SHUFFLE(3,1,2,0));
+            return _mm_packus_epi16(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1));
+        }
+
+        __m256i lo, hi;
+    };
+#else
+    // 16 uint32_t running sums, rows 0-3 in v0, 4-7 in v1, and so on.
+    struct MaskSums {
+        MaskSums() {}
+        MaskSums(uint32_t v) { v0 = v1 = v2 = v3 = _mm_set1_epi32(v); }
+        MaskSums(__m128i v0, __m128i v1, __m128i v2, __m128i v3)
+            : v0(v0), v1(v1), v2(v2), v3(v3) {}
+
+        // The 16-bit a op b, widened to 32 bits.
+        static MaskSums Add(__m128i a, __m128i b) {
+            const __m128i zero = _mm_setzero_si128();
+            __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+                    hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+            return { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                     _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+        }
+        static MaskSums Sub(__m128i a, __m128i b) {
+            const __m128i zero = _mm_setzero_si128();
+            __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+                    hi = _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+            // Sign extend by shifting each 16-bit value into the top of a 32-bit lane.
+            return { _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16),
+                     _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16),
+                     _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16),
+                     _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16) };
+        }
+
+        MaskSums operator+(const MaskSums& o) const {
+            return { _mm_add_epi32(v0, o.v0), _mm_add_epi32(v1, o.v1),
+                     _mm_add_epi32(v2, o.v2), _mm_add_epi32(v3, o.v3) };
+        }
+        MaskSums operator-(const MaskSums& o) const {
+            return { _mm_sub_epi32(v0, o.v0), _mm_sub_epi32(v1, o.v1),
+                     _mm_sub_epi32(v2, o.v2), _mm_sub_epi32(v3, o.v3) };
+        }
+        MaskSums operator*(const MaskSums& o) const {
+            return { mul(v0, o.v0), mul(v1, o.v1), mul(v2, o.v2), mul(v3, o.v3) };
+        }
+
+        // Each sum >> 24, as 16 bytes.  They're all <= 255, so the signed pack can't saturate.
+        __m128i top8() const {
+            __m128i lo = _mm_packs_epi32(_mm_srli_epi32(v0, 24), _mm_srli_epi32(v1, 24)),
+                    hi = _mm_packs_epi32(_mm_srli_epi32(v2, 24), _mm_srli_epi32(v3, 24));
+            return _mm_packus_epi16(lo, hi);
+        }
+
+        static __m128i mul(__m128i a, __m128i b) {
+        #if SK_CPU_SSE_LEVEL >= SK_CPU_SSE_LEVEL_SSE41
+            return _mm_mullo_epi32(a, b);
+        #else
+            __m128i p02 = _mm_mul_epu32(a, b),
+                    p13 = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+            return _mm_unpacklo_epi32(_mm_shuffle_epi32(p02, _MM_SHUFFLE(0,0,2,0)),
+                                      _mm_shuffle_epi32(p13, _MM_SHUFFLE(0,0,2,0)));
+        #endif
+        }
+
+        __m128i v0, v1, v2, v3;
+    };
+#endif
+
+// Runs blur(cols, out, outStride) over each group of 16 rows in [y0,y1).  cols holds their
+// source columns, 16 bytes each, with pad zero columns before and after.  Output column x goes
+// to out + x*outStride.
+template <typename Blur>
+static int mask_blur_rows(const uint8_t* src, int srcRowBytes, uint8_t* dst,
+                          int width, int height, int newWidth, bool transpose,
+                          int pad, int y0, int y1, const Blur& blur) {
+    const int rows = (y1 - y0) & ~15;
+    if (rows == 0) {
+        return 0;
+    }
+    SkAutoTMalloc<uint8_t> cols(16 * (pad + width + pad)),
+                           tmp(transpose ? 0 : 16 * newWidth);
+    sk_bzero(cols.get(),                       16 * pad);
+    sk_bzero(cols.get() + 16 * (pad + width),  16 * pad);
+
+    for (int y = y0; y < y0 + rows; y += 16) {
+        mask_load_columns(src + y * srcRowBytes, srcRowBytes, width, cols.get() + 16 * pad);
+        if (transpose) {
+            // Each output column is 16 contiguous bytes of a transposed dst row.
+            blur(cols.get() + 16 * pad, dst + y, height);
+        } else {
+            blur(cols.get() + 16 * pad, tmp.get(), 16);
+            mask_store_columns(tmp.get(), newWidth, dst + y * newWidth, newWidth);
+        }
+    }
+    return rows;
+}
+
+static inline __m128i mask_column(const uint8_t* cols, int x) {
+    return _mm_loadu_si128((const __m128i*)(cols + 16 * x));
+}
+
+static inline void mask_store(uint8_t* out, int outStride, int x, __m128i v) {
+    _mm_storeu_si128((__m128i*)(out + x * outStride), v);
+}
+
+static int box_blur_a8(const uint8_t* src, int srcRowBytes, uint8_t* dst,
+                       int leftRadius, int rightRadius, int width, int height,
+                       bool transpose, int y0, int y1) {
+    const int diameter  = leftRadius + rightRadius,
+              pre       = SkTMax(rightRadius - leftRadius, 0),
+              post      = SkTMax(leftRadius - rightRadius, 0),
+              newWidth  = width + SkTMax(leftRadius, rightRadius) * 2;
+    const MaskSums scale = (1 << 24) / (diameter + 1),
+                   half  = 1 << 23;
+
+    auto blur = [&](const uint8_t* cols, uint8_t* out, int outStride) {
+        for (int x = 0; x < pre; x++) {
+            mask_store(out, outStride, x, _mm_setzero_si128());
+        }
+        MaskSums sum = 0;
+        for (int i = 0; i < width + diameter; i++) {
+            sum = sum + MaskSums::Sub(mask_column(cols, i), mask_column(cols, i - diameter - 1));
+            mask_store(out, outStride, pre + i, (sum * scale + half).top8());
+        }
+        for (int x = 0; x < post; x++) {
+            mask_store(out, outStride, pre + width + diameter + x, _mm_setzero_si128());
+        }
+    };
+    return mask_blur_rows(src, srcRowBytes, dst, width, height, newWidth, transpose,
+                          diameter + 1, y0, y1, blur);
+}
+
+static int box_blur_a8_interp(const uint8_t* src, int srcRowBytes, uint8_t* dst,
+                              int radius, int width, int height,
+                              bool transpose, uint8_t outerWeight, int y0, int y1) {
+    const int diameter = radius * 2;
+    if (width < diameter) {
+        return 0;
+    }
+    // Just as boxBlurInterp() does, down to outer staying a uint8_t.
+    int innerWeight = 255 - outerWeight;
+    uint8_t outer = outerWeight + (outerWeight >> 7);
+    int     inner = innerWeight + (innerWeight >> 7);
+    const MaskSums outerScale = (outer << 16) / (diameter + 1),
+                   innerScale = (inner << 16) / (diameter - 1),
+                   half       = 1 << 23;
+
+    auto blur = [&](const uint8_t* cols, uint8_t* out, int outStride) {
+        MaskSums outerSum = 0;
+        for (int i = 0; i < width + diameter; i++) {
+            __m128i right = mask_column(cols, i);
+            outerSum = outerSum + MaskSums::Sub(right, mask_column(cols, i - diameter - 1));
+            MaskSums innerSum = outerSum - MaskSums::Add(right, mask_column(cols, i - diameter));
+            mask_store(out, outStride, i,
+                       (outerSum * outerScale + innerSum * innerScale + half).top8());
+        }
+    };
+    return mask_blur_rows(src, srcRowBytes, dst, width, height, width + diameter, transpose,
+                          diameter + 1, y0, y1, blur);
+}
+
+#else
+
+static int box_blur_a8(const uint8_t*, int, uint8_t*, int, int, int, int, bool, int, int) {
+    return 0;
+}
+
+static int box_blur_a8_interp(const uint8_t*, int, uint8_t*, int, int, int, bool, uint8_t,
+                              int, int) {
+    return 0;
+}
+
+#endif
+
+}  // namespace SK_OPTS_NS
+
+#endif//SkBlurMask_opts_DEFINED
@@ -0,0 +1,24 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkOpts.h"
+
+#define SK_OPTS_NS avx2
+#include "SkBlurMask_opts.h"
+#include "SkRasterPipeline_opts.h"
+
+namespace SkOpts {
+    void Init_avx2() {
+        run_pipeline     = avx2::run_pipeline_8;
+        fuse_pipeline    = avx2::fuse_pipeline_8;
+        compile_pipeline = avx2::compile_pipeline_8;
+        run_program      = avx2::run_program_8;
+
+        box_blur_a8        = avx2::box_blur_a8;
+        box_blur_a8_interp = avx2::box_blur_a8_interp;
+    }
+}
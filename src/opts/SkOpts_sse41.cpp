@@ -9,6 +9,7 @@
 
 #define SK_OPTS_NS sse41
 #include "SkBlurImageFilter_opts.h"
+#include "SkBlurMask_opts.h"
 #include "SkBlitRow_opts.h"
 #include "SkBlend_opts.h"
 
@@ -17,6 +18,8 @@ namespace SkOpts {
         box_blur_xx          = sse41::box_blur_xx;
         box_blur_xy          = sse41::box_blur_xy;
         box_blur_yx          = sse41::box_blur_yx;
+        box_blur_a8          = sse41::box_blur_a8;
+        box_blur_a8_interp   = sse41::box_blur_a8_interp;
         srcover_srgb_srgb    = sse41::srcover_srgb_srgb;
         blit_row_s32a_opaque = sse41::blit_row_s32a_opaque;
     }
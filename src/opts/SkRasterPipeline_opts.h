@@ -0,0 +1,626 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkRasterPipeline_opts_DEFINED
+#define SkRasterPipeline_opts_DEFINED
+
+#include "SkHalf.h"
+#include "SkPM4f.h"
+#include "SkRasterPipeline.h"
+#include "SkSRGB.h"
+
+#if SK_CPU_SSE_LEVEL >= SK_CPU_SSE_LEVEL_AVX2
+    #include <immintrin.h>
+#endif
+
+namespace SK_OPTS_NS {
+
+// The stock stages are written once, against a width W, which provides
+//    - N, the number of pixels we work on at a time;
+//    - F and I, vectors of N floats and N int32_ts;
+//    - Stage, the stage type its Fns chain through;
+//    - the few operations that depend on the width, mostly loads and stores.
+// Loads and stores take the tail: 0 means all N pixels are there, otherwise only the first tail.
+// Loads fill the missing pixels with zeros, and stores leave them alone.
+
+// Copies the first tail Ts from ptr into buf, zeroing the rest, and returns buf.
+// If tail is 0, just returns ptr.
+template <int N, typename T>
+static inline const T* load_tail(const T* ptr, size_t tail, T buf[N]) {
+    if (!tail) {
+        return ptr;
+    }
+    memset(buf, 0, N*sizeof(T));
+    memcpy(buf, ptr, tail*sizeof(T));
+    return buf;
+}
+
+// Returns a buffer to store N Ts into: ptr if tail is 0, buf otherwise.  Call store_tail() after.
+template <typename T>
+static inline T* store_ptr(T* ptr, size_t tail, T* buf) {
+    return tail ? buf : ptr;
+}
+template <typename T>
+static inline void store_tail(T* ptr, size_t tail, const T* buf) {
+    if (tail) {
+        memcpy(ptr, buf, tail*sizeof(T));
+    }
+}
+
+struct W4 {
+    static const int N = 4;
+    using F = Sk4f;
+    using I = Sk4i;
+    using Stage = SkRasterPipeline::Stage;
+
+    static F to_float(const I& v) { return SkNx_cast<float>(v); }
+    static I    trunc(const F& v) { return SkNx_cast<int>(v); }
+    static I    round(const F& v) { return Sk4f_round(v); }
+
+    static F gather(const float table[], const I& ix) {
+        return { table[ix[0]], table[ix[1]], table[ix[2]], table[ix[3]] };
+    }
+
+    static I load_8888(const uint32_t* ptr, size_t tail) {
+        uint32_t buf[N];
+        return I::Load(load_tail<N>(ptr, tail, buf));
+    }
+    static void store_8888(uint32_t* ptr, size_t tail, const I& v) {
+        uint32_t buf[N];
+        v.store(store_ptr(ptr, tail, buf));
+        store_tail(ptr, tail, buf);
+    }
+
+    static I load_565(const uint16_t* ptr, size_t tail) {
+        uint16_t buf[N];
+        return SkNx_cast<int>(Sk4h::Load(load_tail<N>(ptr, tail, buf)));
+    }
+    static void store_565(uint16_t* ptr, size_t tail, const I& v) {
+        uint16_t buf[N];
+        SkNx_cast<uint16_t>(v).store(store_ptr(ptr, tail, buf));
+        store_tail(ptr, tail, buf);
+    }
+
+    // Returns the bytes as floats, still in [0,255].
+    static F load_u8(const uint8_t* ptr, size_t tail) {
+        uint8_t buf[N];
+        return SkNx_cast<float>(Sk4b::Load(load_tail<N>(ptr, tail, buf)));
+    }
+
+    static void load_f16(const uint64_t* ptr, size_t tail, F* r, F* g, F* b, F* a) {
+        uint64_t buf[N];
+        Sk4h rh, gh, bh, ah;
+        Sk4h_load4(load_tail<N>(ptr, tail, buf), &rh, &gh, &bh, &ah);
+        *r = SkHalfToFloat_finite(rh);
+        *g = SkHalfToFloat_finite(gh);
+        *b = SkHalfToFloat_finite(bh);
+        *a = SkHalfToFloat_finite(ah);
+    }
+    static void store_f16(uint64_t* ptr, size_t tail, const F& r, const F& g, const F& b,
+                          const F& a) {
+        uint64_t buf[N];
+        Sk4h_store4(store_ptr(ptr, tail, buf), SkFloatToHalf_finite(r), SkFloatToHalf_finite(g),
+                                               SkFloatToHalf_finite(b), SkFloatToHalf_finite(a));
+        store_tail(ptr, tail, buf);
+    }
+};
+
+#if SK_CPU_SSE_LEVEL >= SK_CPU_SSE_LEVEL_AVX2
+    // These are deliberately not SkNx<8,...> specializations: SkNx's generic 8-wide types are
+    // used from code compiled for any CPU, and we must not replace them with AVX2-only code.
+    struct F8 {
+        F8() {}
+        F8(const __m256& vec) : fVec(vec) {}
+        F8(float val) : fVec(_mm256_set1_ps(val)) {}
+
+        static F8 Min(const F8& x, const F8& y) { return _mm256_min_ps(x.fVec, y.fVec); }
+        static F8 Max(const F8& x, const F8& y) { return _mm256_max_ps(x.fVec, y.fVec); }
+
+        F8  rsqrt() const { return _mm256_rsqrt_ps(fVec); }
+        F8 invert() const { return _mm256_rcp_ps(fVec); }
+
+        F8 thenElse(const F8& t, const F8& e) const {
+            return _mm256_blendv_ps(e.fVec, t.fVec, fVec);
+        }
+
+        __m256 fVec;
+    };
+
+    static inline F8 operator+(const F8& x, const F8& y) { return _mm256_add_ps(x.fVec, y.fVec); }
+    static inline F8 operator-(const F8& x, const F8& y) { return _mm256_sub_ps(x.fVec, y.fVec); }
+    static inline F8 operator*(const F8& x, const F8& y) { return _mm256_mul_ps(x.fVec, y.fVec); }
+    static inline F8 operator/(const F8& x, const F8& y) { return _mm256_div_ps(x.fVec, y.fVec); }
+    static inline F8 operator<(const F8& x, const F8& y) {
+        return _mm256_cmp_ps(x.fVec, y.fVec, _CMP_LT_OQ);
+    }
+    static inline F8& operator+=(F8& x, const F8& y) { return (x = x + y); }
+    static inline F8& operator*=(F8& x, const F8& y) { return (x = x * y); }
+
+    struct I8 {
+        I8() {}
+        I8(const __m256i& vec) : fVec(vec) {}
+        I8(int32_t val) : fVec(_mm256_set1_epi32(val)) {}
+
+        __m256i fVec;
+    };
+
+    static inline I8 operator&(const I8& x, const I8& y) { return _mm256_and_si256(x.fVec, y.fVec); }
+    static inline I8 operator|(const I8& x, const I8& y) { return _mm256_or_si256(x.fVec, y.fVec); }
+    static inline I8 operator<<(const I8& x, int bits) { return _mm256_slli_epi32(x.fVec, bits); }
+    static inline I8 operator>>(const I8& x, int bits) { return _mm256_srai_epi32(x.fVec, bits); }
+
+    struct W8 {
+        static const int N = 8;
+        using F = F8;
+        using I = I8;
+
+        struct Stage {
+            void (SK_VECTORCALL *fNext)(Stage*, size_t, size_t, F,F,F,F, F,F,F,F);
+            void* fCtx;
+        };
+
+        static F to_float(const I& v) { return _mm256_cvtepi32_ps(v.fVec); }
+        static I    trunc(const F& v) { return _mm256_cvttps_epi32(v.fVec); }
+        static I    round(const F& v) { return _mm256_cvtps_epi32(v.fVec); }
+
+        static F gather(const float table[], const I& ix) {
+            return _mm256_i32gather_ps(table, ix.fVec, 4);
+        }
+
+        // 32-bit pixels can use AVX2's masked loads and stores directly.
+        static __m256i mask(size_t tail) {
+            return _mm256_cmpgt_epi32(_mm256_set1_epi32((int)tail),
+                                      _mm256_setr_epi32(0,1,2,3, 4,5,6,7));
+        }
+        static I load_8888(const uint32_t* ptr, size_t tail) {
+            return tail ? _mm256_maskload_epi32((const int*)ptr, mask(tail))
+                        : _mm256_loadu_si256((const __m256i*)ptr);
+        }
+        static void store_8888(uint32_t* ptr, size_t tail, const I& v) {
+            if (tail) {
+                _mm256_maskstore_epi32((int*)ptr, mask(tail), v.fVec);
+            } else {
+                _mm256_storeu_si256((__m256i*)ptr, v.fVec);
+            }
+        }
+
+        static I load_565(const uint16_t* ptr, size_t tail) {
+            uint16_t buf[N];
+            return _mm256_cvtepu16_epi32(
+                    _mm_loadu_si128((const __m128i*)load_tail<N>(ptr, tail, buf)));
+        }
+        static void store_565(uint16_t* ptr, size_t tail, const I& v) {
+            uint16_t buf[N];
+            __m128i packed = _mm_packus_epi32(_mm256_extracti128_si256(v.fVec, 0),
+                                              _mm256_extracti128_si256(v.fVec, 1));
+            _mm_storeu_si128((__m128i*)store_ptr(ptr, tail, buf), packed);
+            store_tail(ptr, tail, buf);
+        }
+
+        static F load_u8(const uint8_t* ptr, size_t tail) {
+            uint8_t buf[N];
+            return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
+                    _mm_loadl_epi64((const __m128i*)load_tail<N>(ptr, tail, buf))));
+        }
+
+        // F16 works on each half with the 4-wide code.
+        static F join(const Sk4f& lo, const Sk4f& hi) {
+            return _mm256_insertf128_ps(_mm256_castps128_ps256(lo.fVec), hi.fVec, 1);
+        }
+        static Sk4f lo(const F& v) { return _mm256_castps256_ps128(v.fVec); }
+        static Sk4f hi(const F& v) { return _mm256_extractf128_ps(v.fVec, 1); }
+
+        static void load_f16(const uint64_t* ptr, size_t tail, F* r, F* g, F* b, F* a) {
+            uint64_t buf[N];
+            ptr = load_tail<N>(ptr, tail, buf);
+
+            Sk4f r0,g0,b0,a0, r1,g1,b1,a1;
+            W4::load_f16(ptr+0, 0, &r0,&g0,&b0,&a0);
+            W4::load_f16(ptr+4, 0, &r1,&g1,&b1,&a1);
+            *r = join(r0, r1);
+            *g = join(g0, g1);
+            *b = join(b0, b1);
+            *a = join(a0, a1);
+        }
+        static void store_f16(uint64_t* ptr, size_t tail, const F& r, const F& g, const F& b,
+                              const F& a) {
+            uint64_t buf[N];
+            uint64_t* dst = store_ptr(ptr, tail, buf);
+            W4::store_f16(dst+0, 0, lo(r), lo(g), lo(b), lo(a));
+            W4::store_f16(dst+4, 0, hi(r), hi(g), hi(b), hi(a));
+            store_tail(ptr, tail, buf);
+        }
+    };
+#endif
+
+namespace stock {
+
+    #define STAGE(name)                                                              \
+        template <typename W, typename F = typename W::F>                            \
+        static SK_ALWAYS_INLINE void name(void* ctx, size_t x, size_t tail,         \
+                                          F&  r, F&  g, F&  b, F&  a,                \
+                                          F& dr, F& dg, F& db, F& da)
+
+    template <typename F>
+    static inline F lerp(const F& from, const F& to, const F& cov) {
+        return from + (to-from)*cov;
+    }
+
+    template <typename W>
+    static inline void from_565(const typename W::I& _565,
+                                typename W::F* r, typename W::F* g, typename W::F* b) {
+        *r = W::to_float(_565 & SK_R16_MASK_IN_PLACE) * (1.0f / SK_R16_MASK_IN_PLACE);
+        *g = W::to_float(_565 & SK_G16_MASK_IN_PLACE) * (1.0f / SK_G16_MASK_IN_PLACE);
+        *b = W::to_float(_565 & SK_B16_MASK_IN_PLACE) * (1.0f / SK_B16_MASK_IN_PLACE);
+    }
+
+    template <typename W>
+    static inline void from_srgb(const typename W::I& px,
+                                 typename W::F* r, typename W::F* g, typename W::F* b,
+                                 typename W::F* a) {
+        *r = W::gather(sk_linear_from_srgb, (px >> SK_R32_SHIFT) & 0xff);
+        *g = W::gather(sk_linear_from_srgb, (px >> SK_G32_SHIFT) & 0xff);
+        *b = W::gather(sk_linear_from_srgb, (px >> SK_B32_SHIFT) & 0xff);
+        *a = W::to_float((px >> SK_A32_SHIFT) & 0xff) * (1/255.0f);
+    }
+
+    // Clamp colors into [0,1] premul (e.g. just before storing back to memory).
+    STAGE(clamp_01_premul) {
+        a = F::Max(a, 0.0f);
+        r = F::Max(r, 0.0f);
+        g = F::Max(g, 0.0f);
+        b = F::Max(b, 0.0f);
+
+        a = F::Min(a, 1.0f);
+        r = F::Min(r, a);
+        g = F::Min(g, a);
+        b = F::Min(b, a);
+    }
+
+    // The default shader produces a constant color (from the SkPaint).
+    STAGE(constant_color) {
+        auto color = (const SkPM4f*)ctx;
+        r = color->r();
+        g = color->g();
+        b = color->b();
+        a = color->a();
+    }
+
+    // The default transfer mode is srcover, s' = s + d*(1-sa).
+    STAGE(srcover) {
+        F A = 1.0f - a;
+        r += dr*A;
+        g += dg*A;
+        b += db*A;
+        a += da*A;
+    }
+
+    // s' = d(1-c) + sc, for a constant c.
+    STAGE(lerp_constant_float) {
+        F c = *(const float*)ctx;
+
+        r = lerp(dr, r, c);
+        g = lerp(dg, g, c);
+        b = lerp(db, b, c);
+        a = lerp(da, a, c);
+    }
+
+    // s' = sc for 8-bit c.
+    STAGE(scale_u8) {
+        auto ptr = *(const uint8_t**)ctx + x;
+        F c = W::load_u8(ptr, tail) * (1/255.0f);
+
+        r *= c;
+        g *= c;
+        b *= c;
+        a *= c;
+    }
+
+    // s' = d(1-c) + sc for 8-bit c.
+    STAGE(lerp_u8) {
+        auto ptr = *(const uint8_t**)ctx + x;
+        F c = W::load_u8(ptr, tail) * (1/255.0f);
+
+        r = lerp(dr, r, c);
+        g = lerp(dg, g, c);
+        b = lerp(db, b, c);
+        a = lerp(da, a, c);
+    }
+
+    // s' = d(1-c) + sc for 565 c.
+    STAGE(lerp_565) {
+        auto ptr = *(const uint16_t**)ctx + x;
+        F cr, cg, cb;
+        from_565<W>(W::load_565(ptr, tail), &cr, &cg, &cb);
+
+        r = lerp(dr, r, cr);
+        g = lerp(dg, g, cg);
+        b = lerp(db, b, cb);
+        a = 1.0f;
+    }
+
+    STAGE(load_d_565) {
+        auto ptr = *(const uint16_t**)ctx + x;
+        from_565<W>(W::load_565(ptr, tail), &dr,&dg,&db);
+        da = 1.0f;
+    }
+
+    STAGE(store_565) {
+        auto ptr = *(uint16_t**)ctx + x;
+        W::store_565(ptr, tail, W::round(r * SK_R16_MASK) << SK_R16_SHIFT
+                              | W::round(g * SK_G16_MASK) << SK_G16_SHIFT
+                              | W::round(b * SK_B16_MASK) << SK_B16_SHIFT);
+    }
+
+    STAGE(load_d_f16) {
+        auto ptr = *(const uint64_t**)ctx + x;
+        W::load_f16(ptr, tail, &dr,&dg,&db,&da);
+    }
+
+    STAGE(store_f16) {
+        auto ptr = *(uint64_t**)ctx + x;
+        W::store_f16(ptr, tail, r,g,b,a);
+    }
+
+    // Load 8-bit SkPMColor-order sRGB.
+    STAGE(load_d_srgb) {
+        auto ptr = *(const uint32_t**)ctx + x;
+        from_srgb<W>(W::load_8888(ptr, tail), &dr,&dg,&db,&da);
+    }
+
+    STAGE(load_s_srgb) {
+        auto ptr = *(const uint32_t**)ctx + x;
+        from_srgb<W>(W::load_8888(ptr, tail), &r,&g,&b,&a);
+    }
+
+    // Write out 8-bit SkPMColor-order sRGB.
+    STAGE(store_srgb) {
+        auto ptr = *(uint32_t**)ctx + x;
+        W::store_8888(ptr, tail, W::trunc(sk_linear_to_srgb_needs_trunc(r)) << SK_R32_SHIFT
+                               | W::trunc(sk_linear_to_srgb_needs_trunc(g)) << SK_G32_SHIFT
+                               | W::trunc(sk_linear_to_srgb_needs_trunc(b)) << SK_B32_SHIFT
+                               | W::round(255.0f * a)                       << SK_A32_SHIFT);
+    }
+
+    #undef STAGE
+
+}  // namespace stock
+
+template <typename W>
+using Kernel = void(*)(void*, size_t, size_t, typename W::F&, typename W::F&,
+                                              typename W::F&, typename W::F&,
+                                              typename W::F&, typename W::F&,
+                                              typename W::F&, typename W::F&);
+
+template <typename W>
+using Fn = decltype(W::Stage::fNext);
+
+// Wraps a kernel up as a stage: call the kernel, then the next stage.
+template <typename W, Kernel<W> kernel, typename F = typename W::F>
+static void SK_VECTORCALL stage_fn(typename W::Stage* st, size_t x, size_t tail,
+                                   F  r, F  g, F  b, F  a,
+                                   F dr, F dg, F db, F da) {
+    kernel(st->fCtx, x,tail, r,g,b,a, dr,dg,db,da);
+    st->fNext(st+1, x,tail, r,g,b,a, dr,dg,db,da);
+}
+
+template <typename W, typename F = typename W::F>
+static void SK_VECTORCALL just_return(typename W::Stage*, size_t, size_t, F,F,F,F, F,F,F,F) {}
+
+// Each stock stage as a W-wide Fn, indexed by SkRasterPipeline::StockStage.
+template <typename W>
+struct StockFns {
+    static const Fn<W> kFns[SkRasterPipeline::kNumStockStages];
+};
+template <typename W>
+const Fn<W> StockFns<W>::kFns[] = {
+#define M(stage) stage_fn<W, stock::stage<W>>,
+    SK_RASTER_PIPELINE_STAGES(M)
+#undef M
+};
+
+// Lays out count stock stages as a chain of W::Stages in storage, and returns the Fn to start
+// with.  Like SkRasterPipeline::fStages, each stage holds the function to call after it.
+// Every W::Stage is laid out like SkRasterPipeline::Stage, so that SkRasterPipeline can hold
+// the program without knowing how wide it is.
+template <typename W>
+static SkRasterPipeline::Fn compile_pipeline_W(const SkRasterPipeline::Stock* stock, int count,
+                                               SkRasterPipeline::Stage* storage) {
+    using Stage = typename W::Stage;
+    static_assert(sizeof(Stage) == sizeof(SkRasterPipeline::Stage), "");
+
+    Stage* program = reinterpret_cast<Stage*>(storage);
+    Fn<W> start = &just_return<W>;
+    for (int i = 0; i < count; i++) {
+        (i == 0 ? start : program[i-1].fNext) = StockFns<W>::kFns[stock[i].fStage];
+        new (program + i) Stage{ &just_return<W>, stock[i].fCtx };
+    }
+    return reinterpret_cast<SkRasterPipeline::Fn>(start);
+}
+
+// Runs a program laid out by compile_pipeline_W over [x,x+n).
+template <typename W>
+static void run_program_W(size_t x, size_t n, SkRasterPipeline::Fn compiledStart,
+                          SkRasterPipeline::Stage* storage) {
+    Fn<W> start = reinterpret_cast<Fn<W>>(compiledStart);
+    auto program = reinterpret_cast<typename W::Stage*>(storage);
+
+    typename W::F v;
+    while (n >= W::N) {
+        start(program, x,0, v,v,v,v, v,v,v,v);
+        x += W::N;
+        n -= W::N;
+    }
+    if (n > 0) {
+        start(program, x,n, v,v,v,v, v,v,v,v);
+    }
+}
+
+template <typename W>
+static void run_pipeline_W(size_t x, size_t n, const SkRasterPipeline::Stock* stock, int count) {
+    SkSTArray<10, SkRasterPipeline::Stage, /*MEM_COPY=*/true> program;
+    program.push_back_n(count);
+    SkRasterPipeline::Fn start = compile_pipeline_W<W>(stock, count, program.begin());
+    run_program_W<W>(x, n, start, program.begin());
+}
+
+// Stock stages by StockStage value, so fused kernels can be spelled with the same names
+// SkRasterPipeline uses.
+template <typename W, SkRasterPipeline::StockStage>
+struct KernelFor;
+#define M(stage)                                                            \
+    template <typename W>                                                   \
+    struct KernelFor<W, SkRasterPipeline::stage> {                          \
+        static constexpr Kernel<W> Get() { return stock::stage<W>; }        \
+    };
+    SK_RASTER_PIPELINE_STAGES(M)
+#undef M
+
+// Calls each kernel in turn, passing each its own context.  Everything here inlines,
+// so a fused pipeline compiles down to one loop with no indirect calls.
+template <typename W, SkRasterPipeline::StockStage... stages>
+struct Fused;
+
+template <typename W>
+struct Fused<W> {
+    using F = typename W::F;
+    static SK_ALWAYS_INLINE void call(const SkRasterPipeline::Stock*, size_t, size_t,
+                                      F&, F&, F&, F&, F&, F&, F&, F&) {}
+    static const uint64_t kKey = 0;
+};
+
+template <typename W, SkRasterPipeline::StockStage stage, SkRasterPipeline::StockStage... rest>
+struct Fused<W, stage, rest...> {
+    using F = typename W::F;
+    static SK_ALWAYS_INLINE void call(const SkRasterPipeline::Stock* stock, size_t x, size_t tail,
+                                      F&  r, F&  g, F&  b, F&  a,
+                                      F& dr, F& dg, F& db, F& da) {
+        KernelFor<W, stage>::Get()(stock->fCtx, x,tail, r,g,b,a, dr,dg,db,da);
+        Fused<W, rest...>::call(stock+1, x,tail, r,g,b,a, dr,dg,db,da);
+    }
+    static const uint64_t kKey = (stage+1) | (Fused<W, rest...>::kKey << 5);
+};
+
+// Pack a list of up to 12 stock stages into 64 bits, 5 bits per stage, matching Fused::kKey.
+// 0 means the list is too long to have a fused kernel.
+static inline uint64_t fuse_key(const SkRasterPipeline::Stock* stock, int count) {
+    static_assert(SkRasterPipeline::kNumStockStages < 32, "Stock stages need more than 5 bits.");
+    if (count > 12) {
+        return 0;
+    }
+    uint64_t key = 0;
+    for (int i = count; i --> 0; ) {
+        key = (key << 5) | (stock[i].fStage+1);
+    }
+    return key;
+}
+
+template <typename W, SkRasterPipeline::StockStage... stages>
+static void run_fused(size_t x, size_t n, const SkRasterPipeline::Stock* stock, int) {
+    typename W::F r,g,b,a, dr,dg,db,da;
+    while (n >= W::N) {
+        Fused<W, stages...>::call(stock, x,0, r,g,b,a, dr,dg,db,da);
+        x += W::N;
+        n -= W::N;
+    }
+    if (n > 0) {
+        Fused<W, stages...>::call(stock, x,n, r,g,b,a, dr,dg,db,da);
+    }
+}
+
+// The pipelines SkRasterPipelineBlitter builds for a constant color with srcover:
+// blitH, blitAntiH, and A8 and LCD blitMask, for each destination format it supports.
+#define SK_FUSED_BLITS(M, dst)                                                          \
+    M(P::constant_color, P::load_d_##dst, P::srcover,                                   \
+      P::clamp_01_premul, P::store_##dst)                                               \
+    M(P::constant_color, P::load_d_##dst, P::srcover, P::lerp_constant_float,           \
+      P::clamp_01_premul, P::store_##dst)                                               \
+    M(P::constant_color, P::load_d_##dst, P::srcover, P::lerp_u8,                       \
+      P::clamp_01_premul, P::store_##dst)                                               \
+    M(P::constant_color, P::load_d_##dst, P::srcover, P::lerp_565,                      \
+      P::clamp_01_premul, P::store_##dst)
+
+#define SK_FUSED_PIPELINES(M)                                                           \
+    SK_FUSED_BLITS(M, srgb)                                                             \
+    SK_FUSED_BLITS(M, f16)                                                              \
+    SK_FUSED_BLITS(M, 565)                                                              \
+    M(P::load_s_srgb, P::scale_u8, P::load_d_srgb, P::srcover, P::store_srgb)
+
+// Returns a fused kernel that runs this exact list of stock stages, or null if we have none.
+template <typename W>
+static SkRasterPipeline::RunStockFn fuse_pipeline_W(const SkRasterPipeline::Stock* stock,
+                                                    int count) {
+    using P = SkRasterPipeline;
+    struct Fusion {
+        uint64_t                     fKey;
+        SkRasterPipeline::RunStockFn fRun;
+    };
+    static const Fusion kFusions[] = {
+    #define M(...) { Fused<W, __VA_ARGS__>::kKey, run_fused<W, __VA_ARGS__> },
+        SK_FUSED_PIPELINES(M)
+    #undef M
+    };
+
+    if (uint64_t key = fuse_key(stock, count)) {
+        for (const Fusion& fusion : kFusions) {
+            if (fusion.fKey == key) {
+                return fusion.fRun;
+            }
+        }
+    }
+    return nullptr;
+}
+
+#undef SK_FUSED_PIPELINES
+#undef SK_FUSED_BLITS
+
+static const SkRasterPipeline::Fn* stages_4 = StockFns<W4>::kFns;
+
+static void run_pipeline_4(size_t x, size_t n, const SkRasterPipeline::Stock* stock, int count) {
+    run_pipeline_W<W4>(x, n, stock, count);
+}
+
+static SkRasterPipeline::RunStockFn fuse_pipeline_4(const SkRasterPipeline::Stock* stock,
+                                                    int count) {
+    return fuse_pipeline_W<W4>(stock, count);
+}
+
+static SkRasterPipeline::Fn compile_pipeline_4(const SkRasterPipeline::Stock* stock, int count,
+                                               SkRasterPipeline::Stage* program) {
+    return compile_pipeline_W<W4>(stock, count, program);
+}
+
+static void run_program_4(size_t x, size_t n, SkRasterPipeline::Fn start,
+                          SkRasterPipeline::Stage* program) {
+    run_program_W<W4>(x, n, start, program);
+}
+
+#if SK_CPU_SSE_LEVEL >= SK_CPU_SSE_LEVEL_AVX2
+    static void run_pipeline_8(size_t x, size_t n, const SkRasterPipeline::Stock* stock,
+                               int count) {
+        run_pipeline_W<W8>(x, n, stock, count);
+    }
+
+    static SkRasterPipeline::RunStockFn fuse_pipeline_8(const SkRasterPipeline::Stock* stock,
+                                                        int count) {
+        return fuse_pipeline_W<W8>(stock, count);
+    }
+
+    static SkRasterPipeline::Fn compile_pipeline_8(const SkRasterPipeline::Stock* stock,
+                                                   int count, SkRasterPipeline::Stage* program) {
+        return compile_pipeline_W<W8>(stock, count, program);
+    }
+
+    static void run_program_8(size_t x, size_t n, SkRasterPipeline::Fn start,
+                              SkRasterPipeline::Stage* program) {
+        run_program_W<W8>(x, n, start, program);
+    }
+#endif
+
+}  // namespace SK_OPTS_NS
+
+#endif//SkRasterPipeline_opts_DEFINED
@@ -8,6 +8,7 @@
 #include "SkColorPriv.h"
 #include "SkData.h"
 #include "SkDeflate.h"
+#include "SkImageGenerator.h"
 #include "SkImage_Base.h"
 #include "SkJpegInfo.h"
 #include "SkPDFBitmap.h"
@@ -343,12 +344,12 @@ static sk_sp<SkPDFArray> make_indexed_color_space(
     return result;
 }
 
-static void emit_image_xobject(SkWStream* stream,
-                               const SkImage* image,
-                               bool alpha,
-                               const sk_sp<SkPDFObject>& smask,
-                               const SkPDFObjNumMap& objNumMap,
-                               const SkPDFSubstituteMap& substitutes) {
+// Deflates the pixels (or just the alpha) of image, and fills in the
+// dictionary that describes them.
+static std::unique_ptr<SkStreamAsset> make_image_xobject(const SkImage* image,
+                                                         bool alpha,
+                                                         const sk_sp<SkPDFObject>& smask,
+                                                         SkPDFDict* pdfDict) {
     SkBitmap bitmap;
     image_get_ro_pixels(image, &bitmap);      // TODO(halcanary): test
     SkAutoLockPixels autoLockPixels(bitmap);  // with malformed images.
@@ -364,83 +365,81 @@ static void emit_image_xobject(SkWStream* stream,
     deflateWStream.finalize();  // call before detachAsStream().
     std::unique_ptr<SkStreamAsset> asset(buffer.detachAsStream());
 
-    SkPDFDict pdfDict("XObject");
-    pdfDict.insertName("Subtype", "Image");
-    pdfDict.insertInt("Width", bitmap.width());
-    pdfDict.insertInt("Height", bitmap.height());
+    pdfDict->insertName("Subtype", "Image");
+    pdfDict->insertInt("Width", bitmap.width());
+    pdfDict->insertInt("Height", bitmap.height());
     if (alpha) {
-        pdfDict.insertName("ColorSpace", "DeviceGray");
+        pdfDict->insertName("ColorSpace", "DeviceGray");
     } else if (bitmap.colorType() == kIndex_8_SkColorType) {
         SkASSERT(1 == pdf_color_component_count(bitmap.colorType()));
-        pdfDict.insertObject("ColorSpace",
-                             make_indexed_color_space(bitmap.getColorTable(),
-                                                      bitmap.alphaType()));
+        pdfDict->insertObject("ColorSpace",
+                              make_indexed_color_space(bitmap.getColorTable(),
+                                                       bitmap.alphaType()));
     } else if (1 == pdf_color_component_count(bitmap.colorType())) {
-        pdfDict.insertName("ColorSpace", "DeviceGray");
+        pdfDict->insertName("ColorSpace", "DeviceGray");
     } else {
-        pdfDict.insertName("ColorSpace", "DeviceRGB");
+        pdfDict->insertName("ColorSpace", "DeviceRGB");
     }
     if (smask) {
-        pdfDict.insertObjRef("SMask", smask);
+        pdfDict->insertObjRef("SMask", smask);
     }
-    pdfDict.insertInt("BitsPerComponent", 8);
-    pdfDict.insertName("Filter", "FlateDecode");
-    pdfDict.insertInt("Length", asset->getLength());
-    pdfDict.emitObject(stream, objNumMap, substitutes);
-
-    pdf_stream_begin(stream);
-    stream->writeStream(asset.get(), asset->getLength());
-    pdf_stream_end(stream);
+    pdfDict->insertInt("BitsPerComponent", 8);
+    pdfDict->insertName("Filter", "FlateDecode");
+    pdfDict->insertInt("Length", asset->getLength());
+    return asset;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 namespace {
-// This SkPDFObject only outputs the alpha layer of the given bitmap.
-class PDFAlphaBitmap final : public SkPDFObject {
+// This SkPDFObject starts deflating the given image on a SkTaskGroup thread
+// as soon as it is created, and lets go of the image when that is done.
+// emitObject() waits for the compressed pixels.  If alpha is true, it only
+// outputs the alpha layer of the image.
+class PDFDeflatedBitmap final : public SkPDFObject {
 public:
-    PDFAlphaBitmap(sk_sp<SkImage> image) : fImage(std::move(image)) { SkASSERT(fImage); }
-    void emitObject(SkWStream*  stream,
-                    const SkPDFObjNumMap& objNumMap,
-                    const SkPDFSubstituteMap& subs) const override {
-        SkASSERT(fImage);
-        emit_image_xobject(stream, fImage.get(), true, nullptr, objNumMap, subs);
+    PDFDeflatedBitmap(sk_sp<SkImage> image, bool alpha, sk_sp<SkPDFObject> smask)
+        : fDict("XObject"), fSMask(std::move(smask)) {
+        SkASSERT(image);
+        SkASSERT(!alpha || !fSMask);
+        fCompression.add([this, image, alpha]() {
+            fAsset = make_image_xobject(image.get(), alpha, fSMask, &fDict);
+        });
     }
-    void drop() override { fImage = nullptr; }
-
-private:
-    sk_sp<SkImage> fImage;
-};
-
-}  // namespace
-
-////////////////////////////////////////////////////////////////////////////////
-
-namespace {
-class PDFDefaultBitmap final : public SkPDFObject {
-public:
+    ~PDFDeflatedBitmap() { fCompression.wait(); }
     void emitObject(SkWStream* stream,
                     const SkPDFObjNumMap& objNumMap,
                     const SkPDFSubstituteMap& subs) const override {
-        SkASSERT(fImage);
-        emit_image_xobject(stream, fImage.get(), false, fSMask, objNumMap, subs);
+        fCompression.wait();
+        SkASSERT(fAsset);
+        fDict.emitObject(stream, objNumMap, subs);
+        // duplicate (a cheap operation) preserves const on fAsset.
+        std::unique_ptr<SkStreamAsset> dup(fAsset->duplicate());
+        SkASSERT(dup);
+        pdf_stream_begin(stream);
+        stream->writeStream(dup.get(), dup->getLength());
+        pdf_stream_end(stream);
     }
     void addResources(SkPDFObjNumMap* catalog,
                       const SkPDFSubstituteMap& subs) const override {
-        SkASSERT(fImage);
         if (fSMask.get()) {
             SkPDFObject* obj = subs.getSubstitute(fSMask.get());
             SkASSERT(obj);
             catalog->addObjectRecursively(obj, subs);
         }
     }
-    void drop() override { fImage = nullptr; fSMask = nullptr; }
-    PDFDefaultBitmap(sk_sp<SkImage> image, sk_sp<SkPDFObject> smask)
-        : fImage(std::move(image)), fSMask(std::move(smask)) { SkASSERT(fImage); }
+    void drop() override {
+        fCompression.wait();
+        fAsset = nullptr;
+        fDict.drop();
+        fSMask = nullptr;
+    }
 
 private:
-    sk_sp<SkImage> fImage;
+    std::unique_ptr<SkStreamAsset> fAsset;
+    SkPDFDict fDict;
     sk_sp<SkPDFObject> fSMask;
+    mutable SkTaskGroup fCompression;
 };
 }  // namespace
 
@@ -528,10 +527,50 @@ sk_sp<SkPDFObject> SkPDFCreateBitmapObject(sk_sp<SkImage> image,
 
     sk_sp<SkPDFObject> smask;
     if (!image_compute_is_opaque(image.get())) {
-        smask = sk_make_sp<PDFAlphaBitmap>(image);
+        smask = sk_make_sp<PDFDeflatedBitmap>(image, true, nullptr);
     }
     #ifdef SK_PDF_IMAGE_STATS
     gRegularImageObjects.fetch_add(1);
     #endif
-    return sk_make_sp<PDFDefaultBitmap>(std::move(image), std::move(smask));
+    return sk_make_sp<PDFDeflatedBitmap>(std::move(image), false, std::move(smask));
+}
+
+bool SkPDFComputeImageDigest(const SkImage* image, SkMD5::Digest* digest) {
+    SkASSERT(image);
+    SkASSERT(digest);
+    SkMD5 md5;
+    sk_sp<SkData> data(image->refEncoded());
+    if (data) {
+        // Equal encoded bytes decode to equal pixels, whatever the format,
+        // but a subset refers to all of the bytes of the image it came from.
+        SkAutoTDelete<SkImageGenerator> generator(SkImageGenerator::NewFromEncoded(data.get()));
+        if (generator && generator->getInfo().dimensions() == image->dimensions()) {
+            md5.write8('E');
+            md5.write32(SkToU32(image->width()));
+            md5.write32(SkToU32(image->height()));
+            md5.write(data->data(), data->size());
+            md5.finish(*digest);
+            return true;
+        }
+    }
+    SkPixmap pixmap;
+    if (!image->peekPixels(&pixmap)) {
+        return false;  // Would have to decode or read back.
+    }
+    md5.write8('P');
+    md5.write32(SkToU32(pixmap.width()));
+    md5.write32(SkToU32(pixmap.height()));
+    md5.write8(SkToU8(pixmap.colorType()));
+    md5.write8(SkToU8(pixmap.alphaType()));
+    if (const SkColorTable* ctable = pixmap.ctable()) {
+        // Index8 pixels mean nothing without their colors.
+        md5.write32(SkToU32(ctable->count()));
+        md5.write(ctable->readColors(), ctable->count() * sizeof(SkPMColor));
+    }
+    size_t rowSize = pixmap.info().minRowBytes();
+    for (int y = 0; y < pixmap.height(); ++y) {
+        md5.write(pixmap.addr(0, y), rowSize);
+    }
+    md5.finish(*digest);
+    return true;
 }
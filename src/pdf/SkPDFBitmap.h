@@ -7,6 +7,7 @@
 #ifndef SkPDFBitmap_DEFINED
 #define SkPDFBitmap_DEFINED
 
+#include "SkMD5.h"
 #include "SkRefCnt.h"
 
 class SkImage;
@@ -15,10 +16,19 @@ class SkPDFObject;
 
 /**
  * SkPDFBitmap wraps a SkImage and serializes it as an image Xobject.
- * It is designed to use a minimal amout of memory, aside from refing
- * the image, and its emitObject() does not cache any data.
+ * It starts compressing the image on a SkTaskGroup thread right away,
+ * and holds on to the compressed pixels, rather than the image, until
+ * emitObject() is called.
  */
 sk_sp<SkPDFObject> SkPDFCreateBitmapObject(sk_sp<SkImage>,
                                            SkPixelSerializer*);
 
+/**
+ * Digest the contents of an image: its encoded data if it has any (no
+ * decoding is done), or else its pixels if they are already in memory.
+ * Two images with equal digests produce equivalent image Xobjects.
+ * Returns false if the image has neither.
+ */
+bool SkPDFComputeImageDigest(const SkImage*, SkMD5::Digest*);
+
 #endif  // SkPDFBitmap_DEFINED
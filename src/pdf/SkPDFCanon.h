@@ -7,6 +7,7 @@
 #ifndef SkPDFCanon_DEFINED
 #define SkPDFCanon_DEFINED
 
+#include "SkMD5.h"
 #include "SkPDFGraphicState.h"
 #include "SkPDFShader.h"
 #include "SkPixelSerializer.h"
@@ -35,6 +36,7 @@ class SkPDFFont;
  */
 class SkPDFCanon : SkNoncopyable {
 public:
+    SkPDFCanon() : fDeduplicateImages(false) {}
     ~SkPDFCanon() { this->reset(); }
 
     // reset to original setting, unrefs all objects.
@@ -63,6 +65,14 @@ public:
     sk_sp<SkPDFObject> findPDFBitmap(SkBitmapKey key) const;
     void addPDFBitmap(SkBitmapKey key, sk_sp<SkPDFObject>);
 
+    // Images with different keys but the same contents share an object
+    // when deduplication is on.  See SkPDFComputeImageDigest().
+    sk_sp<SkPDFObject> findPDFBitmapByDigest(const SkMD5::Digest&) const;
+    void addPDFBitmapByDigest(const SkMD5::Digest&, sk_sp<SkPDFObject>);
+
+    bool deduplicateImages() const { return fDeduplicateImages; }
+    void setDeduplicateImages(bool dedup) { fDeduplicateImages = dedup; }
+
     SkTHashMap<uint32_t, bool> fCanEmbedTypeface;
 
     SkPixelSerializer* getPixelSerializer() const { return fPixelSerializer.get(); }
@@ -111,10 +121,12 @@ private:
 
     // TODO(halcanary): make SkTHashMap<K, sk_sp<V>> work correctly.
     SkTHashMap<SkBitmapKey, SkPDFObject*> fPDFBitmapMap;
+    SkTHashMap<SkMD5::Digest, SkPDFObject*> fPDFBitmapDigestMap;
 
     sk_sp<SkPixelSerializer> fPixelSerializer;
     sk_sp<SkPDFStream> fInvertFunction;
     sk_sp<SkPDFDict> fNoSmaskGraphicState;
     sk_sp<SkPDFArray> fRangeObject;
+    bool fDeduplicateImages;
 };
 #endif  // SkPDFCanon_DEFINED
@@ -2023,6 +2023,9 @@ int SkPDFDevice::getFontResourceIndex(SkTypeface* typeface, uint16_t glyphID) {
         resourceIndex = fFontResources.count();
         fFontResources.push(newFont.get());
         newFont.get()->ref();
+        // The document needs to know about every font in a resource
+        // dictionary, even one that ends up drawing no glyphs.
+        fDocument->getGlyphUsage()->noteGlyphUsage(newFont.get(), nullptr, 0);
     }
     return resourceIndex;
 }
@@ -2173,19 +2176,37 @@ void SkPDFDevice::internalDrawImage(const SkMatrix& origMatrix,
     }
 
     SkBitmapKey key = imageBitmap.getKey();
-    sk_sp<SkPDFObject> pdfimage = fDocument->canon()->findPDFBitmap(key);
+    SkPDFCanon* canon = fDocument->canon();
+    sk_sp<SkPDFObject> pdfimage = canon->findPDFBitmap(key);
     if (!pdfimage) {
         sk_sp<SkImage> img = imageBitmap.makeImage();
         if (!img) {
             return;
         }
-        pdfimage = SkPDFCreateBitmapObject(
-                std::move(img), fDocument->canon()->getPixelSerializer());
-        if (!pdfimage) {
-            return;
+        // Fall back on the contents, so the same picture held by another
+        // SkImage or SkBitmap is embedded only once.
+        SkMD5::Digest digest;
+        bool hasDigest = canon->deduplicateImages() &&
+                         SkPDFComputeImageDigest(img.get(), &digest);
+        if (hasDigest) {
+            pdfimage = canon->findPDFBitmapByDigest(digest);
+        }
+        if (pdfimage) {
+            #ifdef SK_PDF_IMAGE_STATS
+            gDeduplicatedImageObjects.fetch_add(1);
+            #endif
+        } else {
+            pdfimage = SkPDFCreateBitmapObject(
+                    std::move(img), canon->getPixelSerializer());
+            if (!pdfimage) {
+                return;
+            }
+            fDocument->serialize(pdfimage);  // serialize images early.
+            if (hasDigest) {
+                canon->addPDFBitmapByDigest(digest, pdfimage);
+            }
         }
-        fDocument->serialize(pdfimage);  // serialize images early.
-        fDocument->canon()->addPDFBitmap(key, pdfimage);
+        canon->addPDFBitmap(key, pdfimage);
     }
     // TODO(halcanary): addXObjectResource() should take a sk_sp<SkPDFObject>
     SkPDFUtils::DrawFormXObject(this->addXObjectResource(pdfimage.get()),
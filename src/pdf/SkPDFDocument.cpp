@@ -9,16 +9,20 @@
 #include "SkPDFCanvas.h"
 #include "SkPDFDevice.h"
 #include "SkPDFDocument.h"
+#include "SkPDFLinearizer.h"
 #include "SkPDFUtils.h"
 #include "SkStream.h"
 
-SkPDFObjectSerializer::SkPDFObjectSerializer() : fBaseOffset(0), fNextToBeSerialized(0) {}
+SkPDFObjectSerializer::SkPDFObjectSerializer()
+    : fBaseOffset(0), fNextToBeSerialized(0), fUseObjectStreams(false) {}
 
 template <class T> static void renew(T* t) { t->~T(); new (t) T; }
 
 SkPDFObjectSerializer::~SkPDFObjectSerializer() {
-    for (int i = 0; i < fObjNumMap.objects().count(); ++i) {
-        fObjNumMap.objects()[i]->drop();
+    for (const sk_sp<SkPDFObject>& object : fObjNumMap.objects()) {
+        if (object) {  // Released objects are gone already.
+            object->drop();
+        }
     }
 }
 
@@ -36,43 +40,154 @@ static_assert((SKPDF_MAGIC[3] & 0x7F) == "Skia"[3], "");
 void SkPDFObjectSerializer::serializeHeader(SkWStream* wStream,
                                             const SkDocument::PDFMetadata& md) {
     fBaseOffset = wStream->bytesWritten();
+    fUseObjectStreams = md.fUseObjectStreams;
     static const char kHeader[] = "%PDF-1.4\n%" SKPDF_MAGIC "\n";
-    wStream->write(kHeader, strlen(kHeader));
+    // Object streams and cross-reference streams are new in PDF 1.5.
+    static const char kHeader15[] = "%PDF-1.5\n%" SKPDF_MAGIC "\n";
+    const char* header = fUseObjectStreams ? kHeader15 : kHeader;
+    wStream->write(header, strlen(header));
     // The PDF spec recommends including a comment with four
     // bytes, all with their high bits set.  "\xD3\xEB\xE9\xE1" is
     // "Skia" with the high bits set.
     fInfoDict = SkPDFMetadata::MakeDocumentInformationDict(md);
     this->addObjectRecursively(fInfoDict);
-    this->serializeObjects(wStream);
+    if (!md.fLinearize) {  // Linearized documents are written all at once.
+        this->serializeObjects(wStream);
+    }
 }
 #undef SKPDF_MAGIC
 
 // Serialize all objects in the fObjNumMap that have not yet been serialized;
 void SkPDFObjectSerializer::serializeObjects(SkWStream* wStream) {
+    // This includes any object streams numbered along the way.
+    this->serializeObjects(wStream, SK_MaxS32);
+}
+
+void SkPDFObjectSerializer::serializeObjects(SkWStream* wStream, int32_t end) {
     const SkTArray<sk_sp<SkPDFObject>>& objects = fObjNumMap.objects();
-    while (fNextToBeSerialized < objects.count()) {
-        SkPDFObject* object = objects[fNextToBeSerialized].get();
+    SkASSERT(end == SK_MaxS32 || end <= objects.count());
+    while (fNextToBeSerialized < SkTMin(end, objects.count())) {
         int32_t index = fNextToBeSerialized + 1;  // Skip object 0.
         // "The first entry in the [XREF] table (object number 0) is
         // always free and has a generation number of 65,535; it is
         // the head of the linked list of free objects."
         SkASSERT(fOffsets.count() == fNextToBeSerialized);
-        fOffsets.push(this->offset(wStream));
-        SkASSERT(object == fSubstituteMap.getSubstitute(object));
+        fOffsets.push(0);
+        fIndexInObjectStream.push(-1);
+        if (fDeferred.contains(objects[fNextToBeSerialized].get())) {
+            fSkipped.push(index);
+        } else {
+            this->serializeObject(wStream, index);
+        }
+        ++fNextToBeSerialized;
+    }
+    for (int i = 0; i < fSkipped.count();) {
+        if (fDeferred.contains(objects[fSkipped[i] - 1].get())) {
+            i++;
+        } else {
+            this->serializeObject(wStream, fSkipped[i]);
+            fSkipped.removeShuffle(i);
+        }
+    }
+    this->releaseWrittenObjects();
+}
+
+void SkPDFObjectSerializer::serializeObject(SkWStream* wStream, int32_t index) {
+    SkPDFObject* object = fObjNumMap.objects()[index - 1].get();
+    SkASSERT(object == fSubstituteMap.getSubstitute(object));
+    if (fUseObjectStreams && object->canBeInObjectStream()) {
+        this->addToObjectStream(index, object);
+    } else {
+        fOffsets[index - 1] = this->offset(wStream);
         wStream->writeDecAsText(index);
         wStream->writeText(" 0 obj\n");  // Generation number is always 0.
         object->emitObject(wStream, fObjNumMap, fSubstituteMap);
         wStream->writeText("\nendobj\n");
-        object->drop();
-        ++fNextToBeSerialized;
     }
+    object->drop();
+    fWritten.push(index);
+}
+
+// Pages, content streams and the like are only referred to by objects
+// written before or just after them, so this keeps memory flat in the
+// page count.  Canonicalized objects stay until the document closes.
+void SkPDFObjectSerializer::releaseWrittenObjects() {
+    for (int i = 0; i < fWritten.count();) {
+        if (fObjNumMap.releaseIfUnique(fWritten[i])) {
+            fWritten.removeShuffle(i);
+        } else {
+            i++;
+        }
+    }
+}
+
+void SkPDFObjectSerializer::defer(SkPDFObject* object) {
+    fDeferred.add(object);
+}
+
+void SkPDFObjectSerializer::undefer(SkPDFObject* object) {
+    SkASSERT(fDeferred.contains(object));
+    fDeferred.remove(object);
+}
+
+// Readers parse a whole object stream to find any object in it, so keep
+// them small enough that this stays cheap.
+static const int kObjectsPerStream = 100;
+
+void SkPDFObjectSerializer::addToObjectStream(int32_t index, SkPDFObject* object) {
+    // fOffsets[index - 1] is set once the object stream has a number.
+    fIndexInObjectStream[index - 1] = fObjectStreamMembers.count();
+    fObjectStreamMembers.push(index);
+    fObjectStreamOffsets.writeDecAsText(index);
+    fObjectStreamOffsets.writeText(" ");
+    fObjectStreamOffsets.writeBigDecAsText(fObjectStreamData.bytesWritten());
+    fObjectStreamOffsets.writeText("\n");
+    object->emitObject(&fObjectStreamData, fObjNumMap, fSubstituteMap);
+    fObjectStreamData.writeText("\n");
+    if (fObjectStreamMembers.count() == kObjectsPerStream) {
+        this->flushObjectStream();
+    }
+}
+
+void SkPDFObjectSerializer::flushObjectStream() {
+    if (fObjectStreamMembers.isEmpty()) {
+        return;
+    }
+    const size_t first = fObjectStreamOffsets.bytesWritten();
+    SkDynamicMemoryWStream data;
+    fObjectStreamOffsets.writeToStream(&data);
+    fObjectStreamData.writeToStream(&data);
+    auto objectStream = sk_make_sp<SkPDFStream>(
+            std::unique_ptr<SkStreamAsset>(data.detachAsStream()));
+    objectStream->dict()->insertName("Type", "ObjStm");
+    objectStream->dict()->insertInt("N", fObjectStreamMembers.count());
+    objectStream->dict()->insertInt("First", first);
+
+    // It is not itself packable, so serializeObjects() writes it out.
+    SkASSERT(!objectStream->canBeInObjectStream());
+    fObjNumMap.addObject(objectStream.get());
+    const int32_t number = fObjNumMap.getObjectNumber(objectStream.get());
+    for (int32_t member : fObjectStreamMembers) {
+        fOffsets[member - 1] = number;
+    }
+    fObjectStreamMembers.reset();
+    fObjectStreamOffsets.reset();
+    fObjectStreamData.reset();
 }
 
 // Xref table and footer
 void SkPDFObjectSerializer::serializeFooter(SkWStream* wStream,
                                             const sk_sp<SkPDFObject> docCatalog,
                                             sk_sp<SkPDFObject> id) {
+    SkASSERT(fDeferred.count() == 0);
     this->serializeObjects(wStream);
+    SkASSERT(fSkipped.isEmpty());
+    if (fUseObjectStreams) {
+        this->flushObjectStream();
+        this->serializeObjects(wStream);
+        this->serializeXRefStream(wStream, docCatalog, std::move(id));
+        return;
+    }
     int32_t xRefFileOffset = this->offset(wStream);
     // Include the special zeroth object in the count.
     int32_t objCount = SkToS32(fOffsets.count() + 1);
@@ -99,6 +214,62 @@ void SkPDFObjectSerializer::serializeFooter(SkWStream* wStream,
     wStream->writeText("\n%%EOF");
 }
 
+static void write_xref_entry(SkWStream* stream, uint8_t type, int32_t field2, uint16_t field3) {
+    // Big-endian, with the /W [1 4 2] field widths.
+    uint8_t entry[7] = {
+        type,
+        SkToU8((field2 >> 24) & 0xFF), SkToU8((field2 >> 16) & 0xFF),
+        SkToU8((field2 >> 8) & 0xFF), SkToU8(field2 & 0xFF),
+        SkToU8(field3 >> 8), SkToU8(field3 & 0xFF),
+    };
+    stream->write(entry, sizeof(entry));
+}
+
+// Cross-reference stream, which also takes the place of the trailer.
+void SkPDFObjectSerializer::serializeXRefStream(SkWStream* wStream,
+                                                const sk_sp<SkPDFObject>& docCatalog,
+                                                sk_sp<SkPDFObject> id) {
+    SkASSERT(fObjectStreamMembers.isEmpty());
+    int32_t xRefFileOffset = this->offset(wStream);
+    // The stream is the last object, and the zeroth object is included.
+    int32_t xRefIndex = SkToS32(fOffsets.count() + 1);
+    int32_t objCount = xRefIndex + 1;
+
+    SkDynamicMemoryWStream entries;
+    write_xref_entry(&entries, 0, 0, 65535);
+    for (int i = 0; i < fOffsets.count(); i++) {
+        if (fIndexInObjectStream[i] < 0) {
+            write_xref_entry(&entries, 1, fOffsets[i], 0);
+        } else {
+            write_xref_entry(&entries, 2, fOffsets[i], SkToU16(fIndexInObjectStream[i]));
+        }
+    }
+    write_xref_entry(&entries, 1, xRefFileOffset, 0);
+
+    SkPDFStream xRef(std::unique_ptr<SkStreamAsset>(entries.detachAsStream()));
+    xRef.dict()->insertName("Type", "XRef");
+    xRef.dict()->insertInt("Size", objCount);
+    auto widths = sk_make_sp<SkPDFArray>();
+    widths->appendInt(1);
+    widths->appendInt(4);
+    widths->appendInt(2);
+    xRef.dict()->insertObject("W", std::move(widths));
+    SkASSERT(docCatalog);
+    xRef.dict()->insertObjRef("Root", docCatalog);
+    SkASSERT(fInfoDict);
+    xRef.dict()->insertObjRef("Info", std::move(fInfoDict));
+    if (id) {
+        xRef.dict()->insertObject("ID", std::move(id));
+    }
+
+    wStream->writeDecAsText(xRefIndex);
+    wStream->writeText(" 0 obj\n");
+    xRef.emitObject(wStream, fObjNumMap, fSubstituteMap);
+    wStream->writeText("\nendobj\nstartxref\n");
+    wStream->writeBigDecAsText(xRefFileOffset);
+    wStream->writeText("\n%%EOF");
+}
+
 int32_t SkPDFObjectSerializer::offset(SkWStream* wStream) {
     size_t offset = wStream->bytesWritten();
     SkASSERT(offset > fBaseOffset);
@@ -106,67 +277,37 @@ int32_t SkPDFObjectSerializer::offset(SkWStream* wStream) {
 }
 
 
-// return root node.
-static sk_sp<SkPDFDict> generate_page_tree(SkTArray<sk_sp<SkPDFDict>>* pages) {
-    // PDF wants a tree describing all the pages in the document.  We arbitrary
-    // choose 8 (kNodeSize) as the number of allowed children.  The internal
-    // nodes have type "Pages" with an array of children, a parent pointer, and
-    // the number of leaves below the node as "Count."  The leaves are passed
-    // into the method, have type "Page" and need a parent pointer. This method
-    // builds the tree bottom up, skipping internal nodes that would have only
-    // one child.
-    static const int kNodeSize = 8;
-
-    // curNodes takes a reference to its items, which it passes to pageTree.
-    int totalPageCount = pages->count();
-    SkTArray<sk_sp<SkPDFDict>> curNodes;
-    curNodes.swap(pages);
-
-    // nextRoundNodes passes its references to nodes on to curNodes.
-    int treeCapacity = kNodeSize;
-    do {
-        SkTArray<sk_sp<SkPDFDict>> nextRoundNodes;
-        for (int i = 0; i < curNodes.count(); ) {
-            if (i > 0 && i + 1 == curNodes.count()) {
-                SkASSERT(curNodes[i]);
-                nextRoundNodes.emplace_back(std::move(curNodes[i]));
-                break;
-            }
-
-            auto newNode = sk_make_sp<SkPDFDict>("Pages");
-            auto kids = sk_make_sp<SkPDFArray>();
-            kids->reserve(kNodeSize);
-
-            int count = 0;
-            for (; i < curNodes.count() && count < kNodeSize; i++, count++) {
-                SkASSERT(curNodes[i]);
-                curNodes[i]->insertObjRef("Parent", newNode);
-                kids->appendObjRef(std::move(curNodes[i]));
-            }
-
-            // treeCapacity is the number of leaf nodes possible for the
-            // current set of subtrees being generated. (i.e. 8, 64, 512, ...).
-            // It is hard to count the number of leaf nodes in the current
-            // subtree. However, by construction, we know that unless it's the
-            // last subtree for the current depth, the leaf count will be
-            // treeCapacity, otherwise it's what ever is left over after
-            // consuming treeCapacity chunks.
-            int pageCount = treeCapacity;
-            if (i == curNodes.count()) {
-                pageCount = ((totalPageCount - 1) % treeCapacity) + 1;
-            }
-            newNode->insertInt("Count", pageCount);
-            newNode->insertObject("Kids", std::move(kids));
-            nextRoundNodes.emplace_back(std::move(newNode));
+// Takes the place of a font in resource dictionaries, so that pages can
+// be written before the document knows which glyphs the font needs.
+// When the document closes, it becomes the font's subset.
+class SkPDFDeferredFont final : public SkPDFObject {
+public:
+    void setFont(sk_sp<SkPDFObject> font) { fFont = std::move(font); }
+    void emitObject(SkWStream* stream,
+                    const SkPDFObjNumMap& objNumMap,
+                    const SkPDFSubstituteMap& substitutes) const override {
+        SkASSERT(fFont);
+        fFont->emitObject(stream, objNumMap, substitutes);
+    }
+    void addResources(SkPDFObjNumMap* catalog,
+                      const SkPDFSubstituteMap& substitutes) const override {
+        if (fFont) {
+            fFont->addResources(catalog, substitutes);
         }
-        SkDEBUGCODE( for (const auto& n : curNodes) { SkASSERT(!n); } );
+    }
+    bool canBeInObjectStream() const override {
+        return fFont && fFont->canBeInObjectStream();
+    }
+    void drop() override {
+        if (fFont) {
+            fFont->drop();
+            fFont = nullptr;
+        }
+    }
 
-        curNodes.swap(&nextRoundNodes);
-        nextRoundNodes.reset();
-        treeCapacity *= kNodeSize;
-    } while (curNodes.count() > 1);
-    return std::move(curNodes[0]);
-}
+private:
+    sk_sp<SkPDFObject> fFont;
+};
 
 #if 0
 // TODO(halcanary): expose notEmbeddableCount in SkDocument
@@ -218,10 +359,17 @@ SkPDFDocument::SkPDFDocument(SkWStream* stream,
                              sk_sp<SkPixelSerializer> jpegEncoder,
                              bool pdfa)
     : SkDocument(stream, doneProc)
+    , fLastPageObjectCount(0)
     , fRasterDpi(rasterDpi)
     , fMetadata(metadata)
     , fPDFA(pdfa) {
     fCanon.setPixelSerializer(std::move(jpegEncoder));
+    fCanon.setDeduplicateImages(fMetadata.fDeduplicateImages);
+    if (fPDFA || fMetadata.fLinearize) {
+        // PDF/A-1 is based on PDF 1.4, which has no object streams, and
+        // the linearization hint tables only describe plain objects.
+        fMetadata.fUseObjectStreams = false;
+    }
 }
 
 SkPDFDocument::~SkPDFDocument() {
@@ -231,13 +379,80 @@ SkPDFDocument::~SkPDFDocument() {
 
 void SkPDFDocument::serialize(const sk_sp<SkPDFObject>& object) {
     fObjectSerializer.addObjectRecursively(object);
-    fObjectSerializer.serializeObjects(this->getStream());
+}
+
+// PDF wants a tree describing all the pages in the document.  We arbitrarily
+// choose 8 (kPageTreeNodeSize) as the number of allowed children.  The
+// internal nodes have type "Pages" with an array of children, a parent
+// pointer, and the number of leaves below the node as "Count."  The leaves
+// are the pages, and need a parent pointer.  We build the tree bottom up as
+// pages end, so that each page can be written right away: each level has one
+// node open for new kids, which is numbered but deferred until it is full.
+static const int kPageTreeNodeSize = 8;
+
+void SkPDFDocument::appendToPageTree(sk_sp<SkPDFDict> kid, int level, int pageCount) {
+    if (level == fPageTreeNodes.count()) {
+        fPageTreeNodes.push_back();
+        fPageTreeKids.push_back();
+        fPageTreeCounts.push(0);
+    }
+    if (!fPageTreeNodes[level]) {
+        fPageTreeNodes[level] = sk_make_sp<SkPDFDict>("Pages");
+        fPageTreeKids[level] = sk_make_sp<SkPDFArray>();
+        fPageTreeKids[level]->reserve(kPageTreeNodeSize);
+        fPageTreeNodes[level]->insertObject("Kids", fPageTreeKids[level]);
+        fPageTreeCounts[level] = 0;
+        fObjectSerializer.defer(fPageTreeNodes[level].get());
+        this->serialize(fPageTreeNodes[level]);
+    }
+    kid->insertObjRef("Parent", fPageTreeNodes[level]);
+    fPageTreeKids[level]->appendObjRef(kid);
+    fPageTreeCounts[level] += pageCount;
+    this->serialize(kid);
+    if (fPageTreeKids[level]->size() == kPageTreeNodeSize) {
+        int count = fPageTreeCounts[level];
+        this->appendToPageTree(this->closePageTreeNode(level), level + 1, count);
+    }
+}
+
+sk_sp<SkPDFDict> SkPDFDocument::closePageTreeNode(int level) {
+    sk_sp<SkPDFDict> node = std::move(fPageTreeNodes[level]);
+    fPageTreeKids[level] = nullptr;
+    node->insertInt("Count", fPageTreeCounts[level]);
+    fObjectSerializer.undefer(node.get());
+    return node;
+}
+
+// Closes the open nodes of every level, and returns the root.
+sk_sp<SkPDFDict> SkPDFDocument::finishPageTree() {
+    SkASSERT(!fPageTreeNodes.empty());
+    // Closing a node can fill the one above, and so add a level.
+    for (int level = 0; level + 1 < fPageTreeNodes.count(); level++) {
+        if (fPageTreeNodes[level]) {
+            int count = fPageTreeCounts[level];
+            this->appendToPageTree(this->closePageTreeNode(level), level + 1, count);
+        }
+    }
+    // The top level's node is only closed here, so it is still open.
+    return this->closePageTreeNode(fPageTreeNodes.count() - 1);
+}
+
+// Gives each font used since the last page a stand-in, which the
+// substitute map puts in its place until the font is subset at close.
+void SkPDFDocument::addFontStandIns() {
+    const auto* entry = fGlyphUsage.begin() + fFontStandIns.count();
+    for (; entry < fGlyphUsage.end(); ++entry) {
+        auto standIn = sk_make_sp<SkPDFDeferredFont>();
+        fObjectSerializer.fSubstituteMap.setSubstitute(entry->fFont, standIn.get());
+        fObjectSerializer.defer(standIn.get());
+        fFontStandIns.push_back(std::move(standIn));
+    }
 }
 
 SkCanvas* SkPDFDocument::onBeginPage(SkScalar width, SkScalar height,
                                      const SkRect& trimBox) {
     SkASSERT(!fCanvas.get());  // endPage() was called before this.
-    if (fPages.empty()) {
+    if (fPageTreeNodes.empty() && fPages.empty()) {
         // if this is the first page if the document.
         fObjectSerializer.serializeHeader(this->getStream(), fMetadata);
         fDests = sk_make_sp<SkPDFDict>();
@@ -251,7 +466,9 @@ SkCanvas* SkPDFDocument::onBeginPage(SkScalar width, SkScalar height,
             fID = SkPDFMetadata::MakePdfId(uuid, uuid);
             fXMP = SkPDFMetadata::MakeXMPObject(fMetadata, uuid, uuid);
             fObjectSerializer.addObjectRecursively(fXMP);
-            fObjectSerializer.serializeObjects(this->getStream());
+            if (!fMetadata.fLinearize) {
+                fObjectSerializer.serializeObjects(this->getStream());
+            }
         }
     }
     SkISize pageSize = SkISize::Make(
@@ -278,21 +495,45 @@ void SkPDFDocument::onEndPage() {
         page->insertObject("Annots", std::move(annotations));
     }
     auto contentObject = sk_make_sp<SkPDFStream>(fPageDevice->content());
-    this->serialize(contentObject);
     page->insertObjRef("Contents", std::move(contentObject));
     fPageDevice->appendDestinations(fDests.get(), page.get());
-    fPages.emplace_back(std::move(page));
     fPageDevice.reset(nullptr);
+    this->addFontStandIns();
+    if (fMetadata.fLinearize) {
+        // The first page goes first, with everything it shares with later
+        // pages, so nothing can be written until every page is known.
+        fPages.push_back(std::move(page));
+        return;
+    }
+    // Images and content streams compress on other threads, so give this
+    // page's objects until the end of the next page before we wait on
+    // them.  Objects keep their numbers, so the output does not change.
+    fObjectSerializer.serializeObjects(this->getStream(), fLastPageObjectCount);
+    this->appendToPageTree(std::move(page), 0, 1);
+    fLastPageObjectCount = fObjectSerializer.fObjNumMap.objects().count();
 }
 
 void SkPDFDocument::onAbort() {
     fCanvas.reset(nullptr);
+    this->reset();
+}
+
+void SkPDFDocument::reset() {
+    fLastPageObjectCount = 0;
+    fPageTreeNodes.reset();
+    fPageTreeKids.reset();
+    fPageTreeCounts.reset();
+    fFontStandIns.reset();
     fPages.reset();
     fCanon.reset();
     renew(&fObjectSerializer);
     renew(&fGlyphUsage);
 }
 
+int SkPDFDocument::heldObjectCountForTesting() const {
+    return fObjectSerializer.fObjNumMap.heldObjectCount();
+}
+
 #ifdef SK_SUPPORT_LEGACY_DOCUMENT_API
 void SkPDFDocument::setMetadata(const SkDocument::Attribute info[],
                                 int infoCount,
@@ -456,15 +697,41 @@ static sk_sp<SkPDFArray> make_srgb_output_intents() {
     return intentArray;
 }
 
+// Every glyph is known once the document closes, so subset the fonts
+// behind the stand-ins.
+void SkPDFDocument::resolveFontStandIns() {
+    SkASSERT(fFontStandIns.count() == fGlyphUsage.end() - fGlyphUsage.begin());
+    int fontIndex = 0;
+    for (const auto& entry : fGlyphUsage) {
+        SkPDFDeferredFont* standIn = fFontStandIns[fontIndex++].get();
+        sk_sp<SkPDFFont> subsetFont(
+                entry.fFont->getFontSubset(&entry.fGlyphSet));
+        standIn->setFont(subsetFont ? std::move(subsetFont) : sk_ref_sp(entry.fFont));
+        // Stand-ins that nothing refers to are never written.
+        if (fObjectSerializer.fObjNumMap.contains(standIn)) {
+            standIn->addResources(&fObjectSerializer.fObjNumMap,
+                                  fObjectSerializer.fSubstituteMap);
+        }
+        fObjectSerializer.undefer(standIn);
+    }
+}
+
 bool SkPDFDocument::onClose(SkWStream* stream) {
     SkASSERT(!fCanvas.get());
-    if (fPages.empty()) {
-        fPages.reset();
-        fCanon.reset();
-        renew(&fObjectSerializer);
-        renew(&fGlyphUsage);
+    if (fPageTreeNodes.empty() && fPages.empty()) {
+        this->reset();
         return false;
     }
+    this->resolveFontStandIns();
+    std::unique_ptr<SkPDFLinearizer> linearizer;
+    if (fMetadata.fLinearize) {
+        // Find what each page uses before the page tree links them all.
+        linearizer.reset(new SkPDFLinearizer(fPages, fObjectSerializer.fSubstituteMap));
+        for (sk_sp<SkPDFDict>& page : fPages) {
+            this->appendToPageTree(std::move(page), 0, 1);
+        }
+        fPages.reset();
+    }
     auto docCatalog = sk_make_sp<SkPDFDict>("Catalog");
     if (fPDFA) {
         SkASSERT(fXMP);
@@ -473,30 +740,20 @@ bool SkPDFDocument::onClose(SkWStream* stream) {
         // no one has ever asked for this feature.
         docCatalog->insertObject("OutputIntents", make_srgb_output_intents());
     }
-    SkASSERT(!fPages.empty());
-    docCatalog->insertObjRef("Pages", generate_page_tree(&fPages));
-    SkASSERT(fPages.empty());
+    docCatalog->insertObjRef("Pages", this->finishPageTree());
 
     if (fDests->size() > 0) {
         docCatalog->insertObjRef("Dests", std::move(fDests));
     }
 
-    // Build font subsetting info before calling addObjectRecursively().
-    for (const auto& entry : fGlyphUsage) {
-        sk_sp<SkPDFFont> subsetFont(
-                entry.fFont->getFontSubset(&entry.fGlyphSet));
-        if (subsetFont) {
-            fObjectSerializer.fSubstituteMap.setSubstitute(
-                    entry.fFont, subsetFont.get());
-        }
-    }
-
     fObjectSerializer.addObjectRecursively(docCatalog);
-    fObjectSerializer.serializeObjects(this->getStream());
-    fObjectSerializer.serializeFooter(this->getStream(), docCatalog, fID);
-    fCanon.reset();
-    renew(&fObjectSerializer);
-    renew(&fGlyphUsage);
+    if (linearizer) {
+        linearizer->serialize(&fObjectSerializer, this->getStream(), docCatalog, fID);
+    } else {
+        fObjectSerializer.serializeObjects(this->getStream());
+        fObjectSerializer.serializeFooter(this->getStream(), docCatalog, fID);
+    }
+    this->reset();
     return true;
 }
 
@@ -11,7 +11,9 @@
 #include "SkPDFCanon.h"
 #include "SkPDFMetadata.h"
 #include "SkPDFFont.h"
+#include "SkStream.h"
 
+class SkPDFDeferredFont;
 class SkPDFDevice;
 
 sk_sp<SkDocument> SkPDFMakeDocument(SkWStream* stream,
@@ -26,23 +28,61 @@ sk_sp<SkDocument> SkPDFMakeDocument(SkWStream* stream,
 struct SkPDFObjectSerializer : SkNoncopyable {
     SkPDFObjNumMap fObjNumMap;
     SkPDFSubstituteMap fSubstituteMap;
+    // The byte offset of each object, or for objects packed into an
+    // object stream, the object number of that stream.
     SkTDArray<int32_t> fOffsets;
+    // The index of each object in its object stream, or -1.
+    SkTDArray<int32_t> fIndexInObjectStream;
     sk_sp<SkPDFObject> fInfoDict;
     size_t fBaseOffset;
     int32_t fNextToBeSerialized;  // index in fObjNumMap
 
+    // With PDFMetadata::fUseObjectStreams, objects that can be packed
+    // are emitted into fObjectStreamData, and written out as an /ObjStm
+    // object every kObjectsPerStream objects.
+    bool fUseObjectStreams;
+    SkDynamicMemoryWStream fObjectStreamOffsets;  // "number offset" pairs
+    SkDynamicMemoryWStream fObjectStreamData;
+    SkTDArray<int32_t> fObjectStreamMembers;      // object numbers
+
+    // Objects passed to defer(), and the numbers of those that
+    // serializeObjects() has had to skip over.
+    SkTHashSet<SkPDFObject*> fDeferred;
+    SkTDArray<int32_t> fSkipped;
+    // Numbers of written objects that the object map still holds.
+    SkTDArray<int32_t> fWritten;
+
     SkPDFObjectSerializer();
     ~SkPDFObjectSerializer();
     void addObjectRecursively(const sk_sp<SkPDFObject>&);
+    // Until undefer() is called, serializeObjects() numbers this object
+    // but does not write it, so it may still change.  Objects after it
+    // are written as usual.
+    void defer(SkPDFObject*);
+    void undefer(SkPDFObject*);
     void serializeHeader(SkWStream*, const SkDocument::PDFMetadata&);
     void serializeObjects(SkWStream*);
+    // Serialize objects in the fObjNumMap up to (but not including) index end.
+    void serializeObjects(SkWStream*, int32_t end);
     void serializeFooter(SkWStream*, const sk_sp<SkPDFObject>, sk_sp<SkPDFObject>);
     int32_t offset(SkWStream*);
+
+private:
+    void serializeObject(SkWStream*, int32_t index);
+    // Forgets written objects that nothing else refers to any more.
+    void releaseWrittenObjects();
+    void addToObjectStream(int32_t index, SkPDFObject*);
+    // Numbers the pending object stream; it is written like any other object.
+    void flushObjectStream();
+    void serializeXRefStream(SkWStream*, const sk_sp<SkPDFObject>&, sk_sp<SkPDFObject>);
 };
 
-/** Concrete implementation of SkDocument that creates PDF files. This
-    class does not produced linearized or optimized PDFs; instead it
-    it attempts to use a minimum amount of RAM. */
+/** Concrete implementation of SkDocument that creates PDF files.  By
+    default it attempts to use a minimum amount of RAM.  Each page is
+    written out soon after it ends, so memory use does not grow with the
+    number of pages; fonts are subset and written when the document
+    closes.  With PDFMetadata::fLinearize, pages are kept until the
+    document closes, and then written as a linearized PDF. */
 class SkPDFDocument : public SkDocument {
 public:
     SkPDFDocument(SkWStream*,
@@ -64,9 +104,10 @@ public:
 #endif  // SK_SUPPORT_LEGACY_DOCUMENT_API
     /**
        Serialize the object, as well as any other objects it
-       indirectly refers to.  If any any other objects have been added
-       to the SkPDFObjNumMap without serializing them, they will be
-       serialized as well.
+       indirectly refers to.  Objects may still be compressing on
+       other threads when they are created, so this only numbers them;
+       they are written out at the end of the next page, or when the
+       document is closed, whichever comes first.
 
        It might go without saying that objects should not be changed
        after calling serialize, since those changes will be too late.
@@ -77,11 +118,32 @@ public:
     SkPDFCanon* canon() { return &fCanon; }
     SkPDFGlyphSetMap* getGlyphUsage() { return &fGlyphUsage; }
 
+    /** The number of objects kept around to be referred to later. */
+    int heldObjectCountForTesting() const;
+
 private:
+    void appendToPageTree(sk_sp<SkPDFDict> kid, int level, int pageCount);
+    sk_sp<SkPDFDict> closePageTreeNode(int level);
+    sk_sp<SkPDFDict> finishPageTree();
+    void addFontStandIns();
+    void resolveFontStandIns();
+    void reset();
+
     SkPDFObjectSerializer fObjectSerializer;
     SkPDFCanon fCanon;
     SkPDFGlyphSetMap fGlyphUsage;
+    // Stand-ins for the fonts in fGlyphUsage, in the same order.
+    SkTArray<sk_sp<SkPDFDeferredFont>> fFontStandIns;
+    // With PDFMetadata::fLinearize, the pages so far, without parents.
     SkTArray<sk_sp<SkPDFDict>> fPages;
+    // The open node at each level of the page tree, its kids, and the
+    // number of pages below it.
+    SkTArray<sk_sp<SkPDFDict>> fPageTreeNodes;
+    SkTArray<sk_sp<SkPDFArray>> fPageTreeKids;
+    SkTDArray<int> fPageTreeCounts;
+    // Objects numbered before the end of the last page, which the end
+    // of the next page serializes.
+    int32_t fLastPageObjectCount;
     sk_sp<SkPDFDict> fDests;
     sk_sp<SkPDFDevice> fPageDevice;
     sk_sp<SkCanvas> fCanvas;
@@ -0,0 +1,474 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkMathPriv.h"
+#include "SkPDFDocument.h"
+#include "SkPDFLinearizer.h"
+#include "SkStream.h"
+
+SkPDFLinearizer::SkPDFLinearizer(const SkTArray<sk_sp<SkPDFDict>>& pages,
+                                 const SkPDFSubstituteMap& substitutes) {
+    fPageObjects.reserve(pages.count());
+    for (int page = 0; page < pages.count(); page++) {
+        SkPDFObjNumMap reachable;
+        reachable.addObjectRecursively(pages[page].get(), substitutes);
+        SkTDArray<SkPDFObject*>& objects = fPageObjects.push_back();
+        objects.setReserve(reachable.objects().count());
+        // The pages keep these alive until the document is written.
+        for (const sk_sp<SkPDFObject>& object : reachable.objects()) {
+            objects.push(object.get());
+            if (PageUse* use = fUses.find(object.get())) {
+                use->fPageCount++;
+            } else {
+                fUses.set(object.get(), PageUse{page, 1});
+            }
+        }
+    }
+}
+
+namespace {
+// Packs the big-endian bit fields of the hint tables.
+class BitWriter {
+public:
+    explicit BitWriter(SkWStream* stream) : fStream(stream), fBits(0), fBitCount(0) {}
+    void write(uint32_t value, int bitCount) {
+        SkASSERT(bitCount >= 0 && bitCount <= 32);
+        for (int i = bitCount - 1; i >= 0; i--) {
+            fBits = SkToU8((fBits << 1) | ((value >> i) & 1));
+            if (++fBitCount == 8) {
+                fStream->write8(fBits);
+                fBits = 0;
+                fBitCount = 0;
+            }
+        }
+    }
+    // Each item of a hint table starts on a byte boundary.
+    void pad() {
+        if (fBitCount > 0) {
+            this->write(0, 8 - fBitCount);
+        }
+    }
+
+private:
+    SkWStream* fStream;
+    uint8_t fBits;
+    int fBitCount;
+};
+}  // namespace
+
+static int bits_needed(int32_t value) {
+    SkASSERT(value >= 0);
+    return value > 0 ? 32 - SkCLZ(SkToU32(value)) : 0;
+}
+
+static int32_t emit_indirect_object(SkWStream* stream,
+                                    int32_t number,
+                                    const SkPDFObject& object,
+                                    const SkPDFObjNumMap& objNumMap,
+                                    const SkPDFSubstituteMap& substitutes) {
+    size_t start = stream->bytesWritten();
+    stream->writeDecAsText(number);
+    stream->writeText(" 0 obj\n");  // Generation number is always 0.
+    object.emitObject(stream, objNumMap, substitutes);
+    stream->writeText("\nendobj\n");
+    return SkToS32(stream->bytesWritten() - start);
+}
+
+static size_t emitted_size(const SkPDFObject& object,
+                           const SkPDFObjNumMap& objNumMap,
+                           const SkPDFSubstituteMap& substitutes) {
+    SkDynamicMemoryWStream buffer;
+    object.emitObject(&buffer, objNumMap, substitutes);
+    return buffer.bytesWritten();
+}
+
+// The linearization dictionary and first-page trailer hold offsets that
+// are only known once everything after them is laid out.  Padding them
+// out to the size they have with the largest offsets keeps that layout.
+static void emit_padded(SkWStream* stream,
+                        const SkPDFObject& object,
+                        size_t width,
+                        const SkPDFObjNumMap& objNumMap,
+                        const SkPDFSubstituteMap& substitutes) {
+    SkDynamicMemoryWStream buffer;
+    object.emitObject(&buffer, objNumMap, substitutes);
+    SkASSERT(buffer.bytesWritten() <= width);
+    buffer.writeToStream(stream);
+    for (size_t i = buffer.bytesWritten(); i < width; i++) {
+        stream->write8(' ');
+    }
+}
+
+// Writes the object to the body and drops it, since nothing else will.
+static int32_t write_object(SkWStream* body,
+                            SkPDFObject* object,
+                            SkTDArray<int32_t>* offsets,
+                            const SkPDFObjNumMap& objNumMap,
+                            const SkPDFSubstituteMap& substitutes) {
+    int32_t number = objNumMap.getObjectNumber(object);
+    (*offsets)[number - 1] = SkToS32(body->bytesWritten());
+    int32_t length = emit_indirect_object(body, number, *object, objNumMap, substitutes);
+    object->drop();
+    return length;
+}
+
+static void write_linearization_object(SkWStream* stream,
+                                       int32_t number,
+                                       const SkPDFDict& dict,
+                                       size_t width,
+                                       const SkPDFObjNumMap& objNumMap,
+                                       const SkPDFSubstituteMap& substitutes) {
+    stream->writeDecAsText(number);
+    stream->writeText(" 0 obj\n");
+    emit_padded(stream, dict, width, objNumMap, substitutes);
+    stream->writeText("\nendobj\n");
+}
+
+static sk_sp<SkPDFDict> make_linearization_dict(int32_t fileLength,
+                                                int32_t hintOffset,
+                                                int32_t hintLength,
+                                                int32_t firstPageNumber,
+                                                int32_t firstPageEnd,
+                                                int pageCount,
+                                                int32_t mainXRefFirstEntry) {
+    auto dict = sk_make_sp<SkPDFDict>();
+    dict->insertInt("Linearized", 1);
+    dict->insertInt("L", fileLength);
+    auto hint = sk_make_sp<SkPDFArray>();
+    hint->appendInt(hintOffset);
+    hint->appendInt(hintLength);
+    dict->insertObject("H", std::move(hint));
+    dict->insertInt("O", firstPageNumber);
+    dict->insertInt("E", firstPageEnd);
+    dict->insertInt("N", pageCount);
+    dict->insertInt("T", mainXRefFirstEntry);
+    return dict;
+}
+
+static sk_sp<SkPDFDict> make_first_page_trailer(int32_t objCount,
+                                                const sk_sp<SkPDFObject>& docCatalog,
+                                                const sk_sp<SkPDFObject>& infoDict,
+                                                const sk_sp<SkPDFObject>& id,
+                                                int32_t mainXRefOffset) {
+    auto trailer = sk_make_sp<SkPDFDict>();
+    trailer->insertInt("Size", objCount);
+    trailer->insertObjRef("Root", docCatalog);
+    SkASSERT(infoDict);
+    trailer->insertObjRef("Info", infoDict);
+    if (id) {
+        trailer->insertObject("ID", id);
+    }
+    trailer->insertInt("Prev", mainXRefOffset);
+    return trailer;
+}
+
+static void write_xref_entries(SkWStream* stream, const int32_t* offsets, int count) {
+    for (int i = 0; i < count; i++) {
+        stream->writeBigDecAsText(offsets[i], 10);
+        stream->writeText(" 00000 n \n");
+    }
+}
+
+// The cross-reference table and trailer that follow the linearization
+// dictionary; they cover the objects numbered from it onwards.
+static void write_first_page_xref(SkWStream* stream,
+                                  const SkTDArray<int32_t>& offsets,
+                                  int32_t firstNumber,
+                                  const SkPDFDict& trailer,
+                                  size_t trailerWidth,
+                                  const SkPDFObjNumMap& objNumMap,
+                                  const SkPDFSubstituteMap& substitutes) {
+    int32_t count = offsets.count() + 1 - firstNumber;
+    stream->writeText("xref\n");
+    stream->writeDecAsText(firstNumber);
+    stream->writeText(" ");
+    stream->writeDecAsText(count);
+    stream->writeText("\n");
+    write_xref_entries(stream, &offsets[firstNumber - 1], count);
+    stream->writeText("trailer\n");
+    emit_padded(stream, trailer, trailerWidth, objNumMap, substitutes);
+    // Readers start from the startxref at the end of the file.
+    stream->writeText("\nstartxref\n0\n%%EOF\n");
+}
+
+void SkPDFLinearizer::serialize(SkPDFObjectSerializer* serializer,
+                                SkWStream* wStream,
+                                const sk_sp<SkPDFObject>& docCatalog,
+                                sk_sp<SkPDFObject> id) {
+    const SkPDFSubstituteMap& substitutes = serializer->fSubstituteMap;
+    const int pageCount = fPageObjects.count();
+    SkASSERT(pageCount > 0);
+    const SkTDArray<SkPDFObject*>& firstPage = fPageObjects[0];
+
+    // After the first page: each other page's own objects, the page
+    // first, then the objects shared by several pages, then whatever
+    // no page uses, like the page tree and the document information.
+    SkTDArray<SkPDFObject*> mainObjects;
+    SkTDArray<int> pageObjectCounts;
+    pageObjectCounts.push(firstPage.count());
+    for (int page = 1; page < pageCount; page++) {
+        int count = 0;
+        for (SkPDFObject* object : fPageObjects[page]) {
+            const PageUse* use = fUses.find(object);
+            if (use->fFirstPage == page && use->fPageCount == 1) {
+                mainObjects.push(object);
+                count++;
+            }
+        }
+        pageObjectCounts.push(count);
+    }
+    const int sharedStart = mainObjects.count();
+    for (int page = 1; page < pageCount; page++) {
+        for (SkPDFObject* object : fPageObjects[page]) {
+            const PageUse* use = fUses.find(object);
+            if (use->fFirstPage == page && use->fPageCount > 1) {
+                mainObjects.push(object);
+            }
+        }
+    }
+    const int sharedCount = mainObjects.count() - sharedStart;
+    for (const sk_sp<SkPDFObject>& object : serializer->fObjNumMap.objects()) {
+        if (object && object != docCatalog && !fUses.find(object.get())) {
+            mainObjects.push(object.get());
+        }
+    }
+
+    // The main cross-reference table covers those, from object 1.  The
+    // linearization dictionary, catalog, hint stream and first page are
+    // numbered after them, and covered by the first-page table.
+    SkPDFObjNumMap objNumMap;
+    for (SkPDFObject* object : mainObjects) {
+        objNumMap.addObject(object);
+    }
+    // Stand-ins to number the two objects written by hand.
+    auto linearizationSlot = sk_make_sp<SkPDFDict>();
+    auto hintSlot = sk_make_sp<SkPDFDict>();
+    objNumMap.addObject(linearizationSlot.get());
+    objNumMap.addObject(docCatalog.get());
+    objNumMap.addObject(hintSlot.get());
+    for (SkPDFObject* object : firstPage) {
+        objNumMap.addObject(object);
+    }
+    const int32_t linearizationNumber = objNumMap.getObjectNumber(linearizationSlot.get());
+    const int32_t catalogNumber = objNumMap.getObjectNumber(docCatalog.get());
+    const int32_t hintNumber = objNumMap.getObjectNumber(hintSlot.get());
+    const int32_t firstPageNumber = objNumMap.getObjectNumber(firstPage[0]);
+    const int32_t firstSharedNumber =
+            sharedCount > 0 ? objNumMap.getObjectNumber(mainObjects[sharedStart]) : 0;
+    // Include the special zeroth object in the count.
+    const int32_t objCount = SkToS32(objNumMap.objects().count() + 1);
+
+    // Offsets start out relative to the section each object is written
+    // in.  Objects are dropped as they are written, so the document is
+    // only ever held once: as objects, or as bytes in these buffers.
+    SkTDArray<int32_t> offsets;
+    offsets.setCount(objCount - 1);
+    SkDynamicMemoryWStream catalogSection;
+    offsets[catalogNumber - 1] = 0;
+    emit_indirect_object(&catalogSection, catalogNumber, *docCatalog, objNumMap, substitutes);
+    docCatalog->drop();
+
+    SkDynamicMemoryWStream body;
+    // Each first-page object and shared object is a shared object group
+    // of its own in the hint tables.
+    SkTDArray<int32_t> groupLengths;
+    for (SkPDFObject* object : firstPage) {
+        groupLengths.push(write_object(&body, object, &offsets, objNumMap, substitutes));
+    }
+    SkTDArray<int32_t> pageLengths;
+    pageLengths.push(SkToS32(body.bytesWritten()));
+    int index = 0;
+    for (int page = 1; page < pageCount; page++) {
+        size_t pageStart = body.bytesWritten();
+        for (int i = 0; i < pageObjectCounts[page]; i++) {
+            write_object(&body, mainObjects[index++], &offsets, objNumMap, substitutes);
+        }
+        pageLengths.push(SkToS32(body.bytesWritten() - pageStart));
+    }
+    SkASSERT(index == sharedStart);
+    const int32_t sharedOffset = SkToS32(body.bytesWritten());
+    for (; index < sharedStart + sharedCount; index++) {
+        groupLengths.push(write_object(&body, mainObjects[index], &offsets, objNumMap,
+                                       substitutes));
+    }
+    for (; index < mainObjects.count(); index++) {
+        write_object(&body, mainObjects[index], &offsets, objNumMap, substitutes);
+    }
+    const int32_t bodyLength = SkToS32(body.bytesWritten());
+
+    // Lay out what comes before the first page.  Those sizes do not
+    // depend on the offsets still to be found, thanks to the padding.
+    const int32_t headerEnd = serializer->offset(wStream);
+    sk_sp<SkPDFDict> linearizationDict = make_linearization_dict(
+            SK_MaxS32, SK_MaxS32, SK_MaxS32, firstPageNumber, SK_MaxS32, pageCount, SK_MaxS32);
+    sk_sp<SkPDFDict> trailer = make_first_page_trailer(
+            objCount, docCatalog, serializer->fInfoDict, id, SK_MaxS32);
+    const size_t linearizationWidth = emitted_size(*linearizationDict, objNumMap, substitutes);
+    const size_t trailerWidth = emitted_size(*trailer, objNumMap, substitutes);
+    SkDynamicMemoryWStream measure;
+    write_linearization_object(&measure, linearizationNumber, *linearizationDict,
+                               linearizationWidth, objNumMap, substitutes);
+    const int32_t firstXRefOffset = headerEnd + SkToS32(measure.bytesWritten());
+    write_first_page_xref(&measure, offsets, linearizationNumber, *trailer, trailerWidth,
+                          objNumMap, substitutes);
+    const int32_t catalogOffset = headerEnd + SkToS32(measure.bytesWritten());
+    const int32_t hintOffset = catalogOffset + SkToS32(catalogSection.bytesWritten());
+
+    // The hint tables.  Their offsets are as if the hint stream were not
+    // there, so the first page would start where the hint stream does.
+    SkDynamicMemoryWStream hintData;
+    BitWriter bits(&hintData);
+    const int32_t sharedTotal = firstPage.count() + sharedCount;
+
+    // Page offset hint table: how many objects and bytes each page has,
+    // and which shared object groups it needs.
+    SkTArray<SkTDArray<int32_t>> sharedGroups(pageCount);
+    int32_t minObjects = SK_MaxS32, maxObjects = 0, minLength = SK_MaxS32, maxLength = 0;
+    int32_t maxShared = 0;
+    for (int page = 0; page < pageCount; page++) {
+        SkTDArray<int32_t>& groups = sharedGroups.push_back();
+        if (page > 0) {
+            // The first page's own groups are implied.
+            for (SkPDFObject* object : fPageObjects[page]) {
+                const PageUse* use = fUses.find(object);
+                if (use->fPageCount > 1) {
+                    int32_t number = objNumMap.getObjectNumber(object);
+                    groups.push(use->fFirstPage == 0
+                                ? number - firstPageNumber
+                                : firstPage.count() + number - firstSharedNumber);
+                }
+            }
+        }
+        minObjects = SkTMin(minObjects, SkToS32(pageObjectCounts[page]));
+        maxObjects = SkTMax(maxObjects, SkToS32(pageObjectCounts[page]));
+        minLength = SkTMin(minLength, pageLengths[page]);
+        maxLength = SkTMax(maxLength, pageLengths[page]);
+        maxShared = SkTMax(maxShared, SkToS32(groups.count()));
+    }
+    const int objectsBits = bits_needed(maxObjects - minObjects);
+    const int lengthBits = bits_needed(maxLength - minLength);
+    const int sharedCountBits = bits_needed(maxShared);
+    const int groupBits = bits_needed(sharedTotal);
+    bits.write(minObjects, 32);
+    bits.write(hintOffset, 32);  // The first page object.
+    bits.write(objectsBits, 16);
+    bits.write(minLength, 32);
+    bits.write(lengthBits, 16);
+    // Content streams are not interleaved with the rest of their page,
+    // so, like Acrobat, give each one an offset of zero and the length
+    // of the whole page.
+    bits.write(0, 32);
+    bits.write(0, 16);
+    bits.write(minLength, 32);
+    bits.write(lengthBits, 16);
+    bits.write(sharedCountBits, 16);
+    bits.write(groupBits, 16);
+    bits.write(0, 16);  // No fractional positions for shared objects,
+    bits.write(1, 16);  // so any denominator will do.
+    for (int page = 0; page < pageCount; page++) {
+        bits.write(pageObjectCounts[page] - minObjects, objectsBits);
+    }
+    bits.pad();
+    for (int page = 0; page < pageCount; page++) {
+        bits.write(pageLengths[page] - minLength, lengthBits);
+    }
+    bits.pad();
+    for (int page = 0; page < pageCount; page++) {
+        bits.write(sharedGroups[page].count(), sharedCountBits);
+    }
+    bits.pad();
+    for (int page = 0; page < pageCount; page++) {
+        for (int32_t group : sharedGroups[page]) {
+            bits.write(group, groupBits);
+        }
+    }
+    bits.pad();
+    // The numerators and content stream offsets take no bits.
+    for (int page = 0; page < pageCount; page++) {
+        bits.write(pageLengths[page] - minLength, lengthBits);
+    }
+    bits.pad();
+    const int32_t sharedTableOffset = SkToS32(hintData.bytesWritten());
+
+    // Shared object hint table: one group per object of the first page,
+    // then one per shared object.
+    int32_t minGroupLength = SK_MaxS32, maxGroupLength = 0;
+    for (int32_t length : groupLengths) {
+        minGroupLength = SkTMin(minGroupLength, length);
+        maxGroupLength = SkTMax(maxGroupLength, length);
+    }
+    const int groupLengthBits = bits_needed(maxGroupLength - minGroupLength);
+    bits.write(firstSharedNumber, 32);
+    bits.write(sharedCount > 0 ? hintOffset + sharedOffset : 0, 32);
+    bits.write(firstPage.count(), 32);
+    bits.write(sharedTotal, 32);
+    bits.write(0, 16);  // Every group is a single object.
+    bits.write(minGroupLength, 32);
+    bits.write(groupLengthBits, 16);
+    for (int32_t length : groupLengths) {
+        bits.write(length - minGroupLength, groupLengthBits);
+    }
+    bits.pad();
+    for (int i = 0; i < groupLengths.count(); i++) {
+        bits.write(0, 1);  // No MD5 signature.
+    }
+    bits.pad();
+
+    SkPDFStream hints(std::unique_ptr<SkStreamAsset>(hintData.detachAsStream()));
+    hints.dict()->insertInt("S", sharedTableOffset);
+    SkDynamicMemoryWStream hintSection;
+    const int32_t hintLength =
+            emit_indirect_object(&hintSection, hintNumber, hints, objNumMap, substitutes);
+
+    // Now every offset is known.
+    const int32_t bodyOffset = hintOffset + hintLength;
+    for (int32_t number = 1; number < objCount; number++) {
+        if (number == linearizationNumber) {
+            offsets[number - 1] = headerEnd;
+        } else if (number == catalogNumber) {
+            offsets[number - 1] += catalogOffset;
+        } else if (number == hintNumber) {
+            offsets[number - 1] = hintOffset;
+        } else {
+            offsets[number - 1] += bodyOffset;
+        }
+    }
+    const int32_t mainXRefOffset = bodyOffset + bodyLength;
+    SkDynamicMemoryWStream mainXRef;
+    mainXRef.writeText("xref\n0 ");
+    mainXRef.writeDecAsText(linearizationNumber);
+    // The linearization dictionary points at the white-space before the
+    // first entry.
+    const int32_t mainXRefFirstEntry = mainXRefOffset + SkToS32(mainXRef.bytesWritten());
+    mainXRef.writeText("\n0000000000 65535 f \n");
+    write_xref_entries(&mainXRef, offsets.begin(), linearizationNumber - 1);
+    SkPDFDict mainTrailer;
+    mainTrailer.insertInt("Size", linearizationNumber);
+    mainXRef.writeText("trailer\n");
+    mainTrailer.emitObject(&mainXRef, objNumMap, substitutes);
+    mainXRef.writeText("\nstartxref\n");
+    mainXRef.writeBigDecAsText(firstXRefOffset);
+    mainXRef.writeText("\n%%EOF");
+    const int32_t fileLength = mainXRefOffset + SkToS32(mainXRef.bytesWritten());
+
+    linearizationDict = make_linearization_dict(fileLength, hintOffset, hintLength,
+                                                firstPageNumber, bodyOffset + pageLengths[0],
+                                                pageCount, mainXRefFirstEntry);
+    trailer = make_first_page_trailer(
+            objCount, docCatalog, serializer->fInfoDict, std::move(id), mainXRefOffset);
+    write_linearization_object(wStream, linearizationNumber, *linearizationDict,
+                               linearizationWidth, objNumMap, substitutes);
+    SkASSERT(serializer->offset(wStream) == firstXRefOffset);
+    write_first_page_xref(wStream, offsets, linearizationNumber, *trailer, trailerWidth,
+                          objNumMap, substitutes);
+    SkASSERT(serializer->offset(wStream) == catalogOffset);
+    catalogSection.writeToStream(wStream);
+    hintSection.writeToStream(wStream);
+    body.writeToStream(wStream);
+    mainXRef.writeToStream(wStream);
+    SkASSERT(serializer->offset(wStream) == fileLength);
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+#ifndef SkPDFLinearizer_DEFINED
+#define SkPDFLinearizer_DEFINED
+
+#include "SkPDFTypes.h"
+#include "SkTArray.h"
+#include "SkTDArray.h"
+#include "SkTHash.h"
+
+struct SkPDFObjectSerializer;
+
+/**
+ *  Lays a document out as a linearized ("fast web view") PDF, as
+ *  described in Annex F of ISO 32000-1.  The first page and everything
+ *  it uses come first, after a linearization dictionary, a small
+ *  cross-reference table and a hint stream, so a viewer fetching the
+ *  file by byte ranges can show page one before it has the rest.  The
+ *  other pages follow in order, each with the objects only it uses,
+ *  then the objects that several pages share.
+ */
+class SkPDFLinearizer : SkNoncopyable {
+public:
+    /** Finds the objects each page uses.  The pages must not have
+        parents yet, or each of them could reach all of the others. */
+    SkPDFLinearizer(const SkTArray<sk_sp<SkPDFDict>>& pages,
+                    const SkPDFSubstituteMap&);
+
+    /** Writes every object in the serializer's object map, renumbered
+        into linearized order, and both cross-reference tables.  The
+        header must have been written already, and nothing else. */
+    void serialize(SkPDFObjectSerializer*,
+                   SkWStream*,
+                   const sk_sp<SkPDFObject>& docCatalog,
+                   sk_sp<SkPDFObject> id);
+
+private:
+    struct PageUse {
+        int fFirstPage;  // The first page to use the object.
+        int fPageCount;  // How many pages use it.
+    };
+    SkTHashMap<SkPDFObject*, PageUse> fUses;
+    // The objects reachable from each page, the page itself first.
+    SkTArray<SkTDArray<SkPDFObject*>> fPageObjects;
+};
+
+#endif  // SkPDFLinearizer_DEFINED
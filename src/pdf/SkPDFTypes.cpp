@@ -530,26 +530,26 @@ void SkPDFSharedStream::addResources(
 
 ////////////////////////////////////////////////////////////////////////////////
 
-SkPDFStream:: SkPDFStream(sk_sp<SkData> data) {
+SkPDFStream:: SkPDFStream(sk_sp<SkData> data) : fDeflated(false) {
     this->setData(std::unique_ptr<SkStreamAsset>(
                           new SkMemoryStream(std::move(data))));
 }
 
-SkPDFStream::SkPDFStream(std::unique_ptr<SkStreamAsset> stream) {
+SkPDFStream::SkPDFStream(std::unique_ptr<SkStreamAsset> stream) : fDeflated(false) {
     this->setData(std::move(stream));
 }
 
-SkPDFStream::SkPDFStream() {}
+SkPDFStream::SkPDFStream() : fDeflated(false) {}
 
-SkPDFStream::~SkPDFStream() {}
+SkPDFStream::~SkPDFStream() { fCompression.wait(); }
 
 void SkPDFStream::addResources(
         SkPDFObjNumMap* catalog, const SkPDFSubstituteMap& substitutes) const {
-    SkASSERT(fCompressedData);
     fDict.addResources(catalog, substitutes);
 }
 
 void SkPDFStream::drop() {
+    fCompression.wait();
     fCompressedData.reset(nullptr);
     fDict.drop();
 }
@@ -557,12 +557,27 @@ void SkPDFStream::drop() {
 void SkPDFStream::emitObject(SkWStream* stream,
                              const SkPDFObjNumMap& objNumMap,
                              const SkPDFSubstituteMap& substitutes) const {
+    fCompression.wait();
     SkASSERT(fCompressedData);
-    fDict.emitObject(stream, objNumMap, substitutes);
     // duplicate (a cheap operation) preserves const on fCompressedData.
     std::unique_ptr<SkStreamAsset> dup(fCompressedData->duplicate());
     SkASSERT(dup);
     SkASSERT(dup->hasLength());
+    stream->writeText("<<");
+    if (fDeflated) {
+        SkPDFUnion::Name("Filter").emitObject(stream, objNumMap, substitutes);
+        stream->writeText(" ");
+        SkPDFUnion::Name("FlateDecode").emitObject(stream, objNumMap, substitutes);
+        stream->writeText("\n");
+    }
+    SkPDFUnion::Name("Length").emitObject(stream, objNumMap, substitutes);
+    stream->writeText(" ");
+    SkPDFUnion::Int(dup->getLength()).emitObject(stream, objNumMap, substitutes);
+    if (fDict.size() > 0) {
+        stream->writeText("\n");
+        fDict.emitAll(stream, objNumMap, substitutes);
+    }
+    stream->writeText(">>");
     stream->writeText(" stream\n");
     stream->writeStream(dup.get(), dup->getLength());
     stream->writeText("\nendstream");
@@ -572,14 +587,20 @@ void SkPDFStream::setData(std::unique_ptr<SkStreamAsset> stream) {
     SkASSERT(!fCompressedData);  // Only call this function once.
     SkASSERT(stream);
     // Code assumes that the stream starts at the beginning.
+    SkASSERT(stream->hasLength());
+
+    // The deflated bytes do not depend on which thread makes them, so the
+    // output is the same as compressing here.
+    SkStreamAsset* asset = stream.release();
+    fCompression.add([this, asset]() {
+        this->compress(std::unique_ptr<SkStreamAsset>(asset));
+    });
+}
 
+void SkPDFStream::compress(std::unique_ptr<SkStreamAsset> stream) {
     #ifdef SK_PDF_LESS_COMPRESSION
     fCompressedData = std::move(stream);
-    SkASSERT(fCompressedData && fCompressedData->hasLength());
-    fDict.insertInt("Length", fCompressedData->getLength());
     #else
-
-    SkASSERT(stream->hasLength());
     SkDynamicMemoryWStream compressedData;
     SkDeflateWStream deflateWStream(&compressedData);
     SkStreamCopy(&deflateWStream, stream.get());
@@ -590,12 +611,10 @@ void SkPDFStream::setData(std::unique_ptr<SkStreamAsset> stream) {
     if (originalLength <= compressedLength + strlen("/Filter_/FlateDecode_")) {
         SkAssertResult(stream->rewind());
         fCompressedData = std::move(stream);
-        fDict.insertInt("Length", originalLength);
         return;
     }
     fCompressedData.reset(compressedData.detachAsStream());
-    fDict.insertName("Filter", "FlateDecode");
-    fDict.insertInt("Length", compressedLength);
+    fDeflated = true;
     #endif
 }
 
@@ -624,7 +643,7 @@ bool SkPDFObjNumMap::addObject(SkPDFObject* obj) {
     if (fObjectNumbers.find(obj)) {
         return false;
     }
-    fObjectNumbers.set(obj, fObjectNumbers.count() + 1);
+    fObjectNumbers.set(obj, fObjects.count() + 1);
     fObjects.emplace_back(sk_ref_sp(obj));
     return true;
 }
@@ -642,17 +661,46 @@ int32_t SkPDFObjNumMap::getObjectNumber(SkPDFObject* obj) const {
     return *objectNumberFound;
 }
 
+bool SkPDFObjNumMap::releaseIfUnique(int32_t objectNumber) {
+    sk_sp<SkPDFObject>& object = fObjects[objectNumber - 1];
+    SkASSERT(object);
+    if (!object->unique()) {
+        return false;
+    }
+    fObjectNumbers.remove(object.get());
+    object = nullptr;
+    // SkTHashMap only reclaims removed slots when it grows, so rebuild
+    // it once they outnumber the objects still held.
+    if (++fReleasedSinceRehash > SkTMax(fObjectNumbers.count(), 64)) {
+        SkTDArray<SkPDFObject*> held;
+        SkTDArray<int32_t> numbers;
+        fObjectNumbers.foreach([&](SkPDFObject* o, int32_t* n) {
+            held.push(o);
+            numbers.push(*n);
+        });
+        fObjectNumbers.reset();
+        for (int i = 0; i < held.count(); i++) {
+            fObjectNumbers.set(held[i], numbers[i]);
+        }
+        fReleasedSinceRehash = 0;
+    }
+    return true;
+}
+
 #ifdef SK_PDF_IMAGE_STATS
 SkAtomic<int> gDrawImageCalls(0);
 SkAtomic<int> gJpegImageObjects(0);
 SkAtomic<int> gRegularImageObjects(0);
+SkAtomic<int> gDeduplicatedImageObjects(0);
 
 void SkPDFImageDumpStats() {
     SkDebugf("\ntotal PDF drawImage/drawBitmap calls: %d\n"
              "total PDF jpeg images: %d\n"
-             "total PDF regular images: %d\n",
+             "total PDF regular images: %d\n"
+             "total PDF images reused by content: %d\n",
              gDrawImageCalls.load(),
              gJpegImageObjects.load(),
-             gRegularImageObjects.load());
+             gRegularImageObjects.load(),
+             gDeduplicatedImageObjects.load());
 }
 #endif // SK_PDF_IMAGE_STATS
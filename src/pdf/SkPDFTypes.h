@@ -11,6 +11,7 @@
 
 #include "SkRefCnt.h"
 #include "SkScalar.h"
+#include "SkTaskGroup.h"
 #include "SkTHash.h"
 #include "SkTypes.h"
 
@@ -52,6 +53,13 @@ public:
     virtual void addResources(SkPDFObjNumMap* catalog,
                               const SkPDFSubstituteMap& substitutes) const {}
 
+    /**
+     *  Returns true if this object may be packed into a PDF 1.5 object
+     *  stream.  Streams may not be, so only objects that know they are
+     *  not streams return true.
+     */
+    virtual bool canBeInObjectStream() const { return false; }
+
     /**
      *  Release all resources associated with this SkPDFObject.  It is
      *  an error to call emitObject() or addResources() after calling
@@ -201,6 +209,7 @@ public:
                     const SkPDFSubstituteMap& substitutes) const override;
     void addResources(SkPDFObjNumMap*,
                       const SkPDFSubstituteMap&) const override;
+    bool canBeInObjectStream() const override { return true; }
     void drop() override;
 
     /** The size of the array.
@@ -251,6 +260,7 @@ public:
                     const SkPDFSubstituteMap& substitutes) const override;
     void addResources(SkPDFObjNumMap*,
                       const SkPDFSubstituteMap&) const override;
+    bool canBeInObjectStream() const override { return true; }
     void drop() override;
 
     /** The size of the dictionary.
@@ -327,8 +337,9 @@ private:
 /** \class SkPDFStream
 
     This class takes an asset and assumes that it is the only owner of
-    the asset's data.  It immediately compresses the asset to save
-    memory.
+    the asset's data.  It immediately starts compressing the asset on a
+    SkTaskGroup thread to save memory; emitObject() waits for that to
+    finish.
  */
 
 class SkPDFStream final : public SkPDFObject {
@@ -342,6 +353,8 @@ public:
     explicit SkPDFStream(std::unique_ptr<SkStreamAsset> stream);
     virtual ~SkPDFStream();
 
+    /** The Length and Filter entries are not in this dictionary; they
+     *  are written ahead of it once the data is compressed. */
     SkPDFDict* dict() { return &fDict; }
 
     // The SkPDFObject interface.
@@ -360,8 +373,13 @@ protected:
     void setData(std::unique_ptr<SkStreamAsset> stream);
 
 private:
+    // Runs on a SkTaskGroup thread, and sets fCompressedData and fDeflated.
+    void compress(std::unique_ptr<SkStreamAsset> stream);
+
     std::unique_ptr<SkStreamAsset> fCompressedData;
+    bool fDeflated;
     SkPDFDict fDict;
+    mutable SkTaskGroup fCompression;
 
     typedef SkPDFDict INHERITED;
 };
@@ -392,11 +410,27 @@ public:
      */
     int32_t getObjectNumber(SkPDFObject* obj) const;
 
+    /** Forget the object with this number if the catalog holds the only
+     *  reference to it, since then nothing can refer to it again.  Its
+     *  entry in objects() becomes nullptr, and its number stays taken.
+     *  @return True iff the object was forgotten.
+     */
+    bool releaseIfUnique(int32_t objectNumber);
+
+    /** True iff the object has been added and not released. */
+    bool contains(SkPDFObject* obj) const { return SkToBool(fObjectNumbers.find(obj)); }
+
+    /** The number of objects added and not yet released. */
+    int heldObjectCount() const { return fObjectNumbers.count(); }
+
     const SkTArray<sk_sp<SkPDFObject>>& objects() const { return fObjects; }
 
+    SkPDFObjNumMap() : fReleasedSinceRehash(0) {}
+
 private:
     SkTArray<sk_sp<SkPDFObject>> fObjects;
     SkTHashMap<SkPDFObject*, int32_t> fObjectNumbers;
+    int fReleasedSinceRehash;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -431,6 +465,7 @@ private:
 extern SkAtomic<int> gDrawImageCalls;
 extern SkAtomic<int> gJpegImageObjects;
 extern SkAtomic<int> gRegularImageObjects;
+extern SkAtomic<int> gDeduplicatedImageObjects;
 extern void SkPDFImageDumpStats();
 #endif // SK_PDF_IMAGE_STATS
 
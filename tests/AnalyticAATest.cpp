@@ -0,0 +1,174 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkBlitter.h"
+#include "SkMatrix.h"
+#include "SkPath.h"
+#include "SkRandom.h"
+#include "SkRasterClip.h"
+#include "SkScan.h"
+#include "Test.h"
+
+#include <memory>
+
+static const int W = 64, H = 48;
+
+// Records coverage into an 8-bit W x H image.
+struct CoverageBlitter : public SkBlitter {
+    CoverageBlitter() { sk_bzero(fAlpha, sizeof(fAlpha)); }
+
+    void blitH(int x, int y, int width) override {
+        for (int i = 0; i < width; i++) {
+            this->set(x+i, y, 0xFF);
+        }
+    }
+
+    void blitAntiH(int x, int y, const SkAlpha alpha[], const int16_t runs[]) override {
+        for (int n = *runs; n > 0; n = *runs) {
+            for (int i = 0; i < n; i++) {
+                this->set(x+i, y, *alpha);
+            }
+            x     += n;
+            alpha += n;
+            runs  += n;
+        }
+    }
+
+    void set(int x, int y, SkAlpha a) {
+        SkASSERT(0 <= x && x < W && 0 <= y && y < H);
+        fAlpha[y][x] = a;
+    }
+
+    SkAlpha fAlpha[H][W];
+};
+
+// Supersampling can't reach past 8192 pixels, so there AntiFillPath() falls back to computing
+// coverage analytically.  We exercise that rasterizer by drawing kFar pixels to the right.
+static const int kFar = 9000;
+
+// Fills path offset by dx into clip offset by dx, recording coverage back at the origin.
+static void fill(const SkPath& path, const SkIRect& clip, int dx, CoverageBlitter* blitter) {
+    // Shifts everything we blit back left by dx.
+    struct OffsetBlitter : public SkBlitter {
+        void blitH(int x, int y, int width) override {
+            fDst->blitH(x - fDX, y, width);
+        }
+        void blitAntiH(int x, int y, const SkAlpha alpha[], const int16_t runs[]) override {
+            fDst->blitAntiH(x - fDX, y, alpha, runs);
+        }
+        CoverageBlitter* fDst;
+        int              fDX;
+    };
+    OffsetBlitter offset;
+    offset.fDst = blitter;
+    offset.fDX  = dx;
+
+    SkPath moved;
+    path.offset(SkIntToScalar(dx), 0, &moved);
+    SkScan::AntiFillPath(moved, SkRasterClip(clip.makeOffset(dx, 0)), &offset);
+}
+
+// Fill a rect, checking each pixel's coverage against its exact area.
+DEF_TEST(AnalyticAA_ExactRect, r) {
+    const SkRect rect = { 1.25f, 2.5f, 40.75f, 30.125f };
+    SkPath path;
+    path.addRect(rect);
+
+    CoverageBlitter blitter;
+    fill(path, SkIRect::MakeWH(W, H), kFar, &blitter);
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            SkRect px = SkRect::MakeXYWH(x, y, 1, 1);
+            float area = px.intersect(rect) ? px.width() * px.height() : 0;
+            int expected = (int)(area * 255 + 0.5f);
+            if (SkTAbs(expected - blitter.fAlpha[y][x]) > 1) {
+                ERRORF(r, "(%d,%d): expected %d, got %d", x, y, expected, blitter.fAlpha[y][x]);
+                return;
+            }
+        }
+    }
+}
+
+// Coverage from scan converting at 16x without antialiasing, averaging 256 samples per pixel.
+static void reference(const SkPath& path, const SkIRect& clip, CoverageBlitter* blitter) {
+    struct BigBlitter : public SkBlitter {
+        BigBlitter() : fCount(new uint8_t[H*16][W*16]) { sk_bzero(fCount.get(), H*16*W*16); }
+        void blitH(int x, int y, int width) override {
+            memset(&fCount[y][x], 1, width);
+        }
+        void blitAntiH(int, int, const SkAlpha[], const int16_t[]) override {
+            SkDEBUGFAIL("not antialiased");
+        }
+        std::unique_ptr<uint8_t[][W*16]> fCount;
+    } big;
+
+    SkPath scaled;
+    path.transform(SkMatrix::MakeScale(16, 16), &scaled);
+    SkIRect bigClip = { clip.fLeft*16, clip.fTop*16, clip.fRight*16, clip.fBottom*16 };
+    SkScan::FillPath(scaled, SkRasterClip(bigClip), &big);
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int sum = 0;
+            for (int j = 0; j < 16; j++) {
+                for (int i = 0; i < 16; i++) {
+                    sum += big.fCount[y*16+j][x*16+i];
+                }
+            }
+            blitter->fAlpha[y][x] = (sum * 255 + 128) / 256;
+        }
+    }
+}
+
+DEF_TEST(AnalyticAA_Accuracy, r) {
+    SkRandom rand;
+    const SkIRect clips[] = {
+        SkIRect::MakeWH(W, H),
+        SkIRect::MakeLTRB(5, 7, 50, 40),
+    };
+
+    for (int i = 0; i < 48; i++) {
+        // Shapes that don't overlap themselves, where analytic coverage is exact.
+        SkPath path;
+        switch (i % 3) {
+            case 0: path.addCircle(rand.nextRangeF(0, W), rand.nextRangeF(0, H),
+                                   rand.nextRangeF(1, 30));
+                    break;
+            case 1: path.addOval(SkRect::MakeXYWH(rand.nextRangeF(-10, W), rand.nextRangeF(-10, H),
+                                                  rand.nextRangeF(1, 40), rand.nextRangeF(1, 40)));
+                    break;
+            case 2: path.moveTo(rand.nextRangeF(-10, W+10), rand.nextRangeF(-10, H+10));
+                    path.lineTo(rand.nextRangeF(-10, W+10), rand.nextRangeF(-10, H+10));
+                    path.lineTo(rand.nextRangeF(-10, W+10), rand.nextRangeF(-10, H+10));
+                    break;
+        }
+        path.setFillType((SkPath::FillType)(i / 3 % 4));
+
+        for (const SkIRect& clip : clips) {
+            CoverageBlitter analytic, supersampled, expected;
+            fill(path, clip, kFar, &analytic);
+            fill(path, clip,    0, &supersampled);
+            reference(path, clip, &expected);
+
+            int analyticError = 0, supersampledError = 0, worst = 0;
+            for (int y = 0; y < H; y++) {
+                for (int x = 0; x < W; x++) {
+                    int diff = SkTAbs(analytic.fAlpha[y][x] - expected.fAlpha[y][x]);
+                    analyticError     += diff;
+                    supersampledError += SkTAbs(supersampled.fAlpha[y][x] - expected.fAlpha[y][x]);
+                    worst = SkTMax(worst, diff);
+                }
+            }
+            // The reference is itself only good to about 1/16 of a pixel.
+            if (worst > 16 || analyticError > supersampledError) {
+                ERRORF(r, "path %d: off by up to %d, %d total (supersampling: %d total)",
+                       i, worst, analyticError, supersampledError);
+            }
+        }
+    }
+}
@@ -12,8 +12,10 @@
 #include "SkEmbossMaskFilter.h"
 #include "SkLayerDrawLooper.h"
 #include "SkMath.h"
+#include "SkOpts.h"
 #include "SkPaint.h"
 #include "SkPath.h"
+#include "SkRandom.h"
 #include "Test.h"
 
 #if SK_SUPPORT_GPU
@@ -552,6 +554,80 @@ DEF_TEST(BlurAsABlur, reporter) {
     }
 }
 
+// Sum of row[a..b], treating anything outside [0,width) as zero.
+static uint32_t sum_row(const uint8_t* row, int width, int a, int b) {
+    uint32_t sum = 0;
+    for (int x = SkTMax(a, 0); x <= SkTMin(b, width - 1); x++) {
+        sum += row[x];
+    }
+    return sum;
+}
+
+// SkOpts' box blur kernels must match SkBlurMask's scalar passes exactly, written out here
+// one pixel at a time.
+DEF_TEST(BlurMask_BoxBlurOpts, reporter) {
+    SkRandom rand;
+    for (int iter = 0; iter < 200; iter++) {
+        const int  width     = rand.nextRangeU(1, 100),
+                   height    = rand.nextRangeU(1, 50),
+                   y0        = rand.nextULessThan(height),
+                   y1        = rand.nextRangeU(y0, height),
+                   radius    = rand.nextRangeU(1, 40),
+                   other     = SkTMax(radius - (int)rand.nextULessThan(2), 0);
+        const bool transpose = rand.nextBool(),
+                   interp    = rand.nextBool();
+        const uint8_t outerWeight = rand.nextULessThan(255);
+
+        SkAutoTMalloc<uint8_t> src(width * height);
+        for (int i = 0; i < width * height; i++) {
+            src[i] = rand.nextBool() ? 0xFF : rand.nextU() & 0xFF;
+        }
+
+        // Interpolated passes are symmetric; plain ones may have radii off by one.
+        const int leftRadius  = interp ? radius : (rand.nextBool() ? radius : other),
+                  rightRadius = interp ? radius : radius + other - leftRadius,
+                  diameter    = leftRadius + rightRadius,
+                  pre         = SkTMax(rightRadius - leftRadius, 0),
+                  newWidth    = interp ? width + diameter
+                                       : width + 2 * SkTMax(leftRadius, rightRadius);
+        SkAutoTMalloc<uint8_t> dst(newWidth * height);
+        const int rows = interp
+            ? SkOpts::box_blur_a8_interp(src.get(), width, dst.get(), radius, width, height,
+                                         transpose, outerWeight, y0, y1)
+            : SkOpts::box_blur_a8(src.get(), width, dst.get(), leftRadius, rightRadius,
+                                  width, height, transpose, y0, y1);
+        REPORTER_ASSERT(reporter, rows % 16 == 0 && rows <= y1 - y0);
+
+        int innerWeight = 255 - outerWeight;
+        uint8_t outer = outerWeight + (outerWeight >> 7);
+        int     inner = innerWeight + (innerWeight >> 7);
+        for (int y = y0; y < y0 + rows; y++) {
+            const uint8_t* row = src.get() + y * width;
+            for (int x = 0; x < newWidth; x++) {
+                int i = x - pre;
+                uint32_t expected;
+                if (interp) {
+                    expected = (sum_row(row, width, i - diameter, i) *
+                                    (uint32_t)((outer << 16) / (diameter + 1)) +
+                                sum_row(row, width, i - diameter + 1, i - 1) *
+                                    (uint32_t)((inner << 16) / (diameter - 1)) +
+                                (1 << 23)) >> 24;
+                } else {
+                    expected = (sum_row(row, width, i - diameter, i) *
+                                    ((1 << 24) / (diameter + 1)) + (1 << 23)) >> 24;
+                }
+                uint8_t actual = transpose ? dst[x * height + y] : dst[y * newWidth + x];
+                if (actual != expected) {
+                    ERRORF(reporter, "%dx%d, radii %d,%d%s: (%d,%d) is %d, expected %d",
+                           width, height, leftRadius, rightRadius, interp ? " interp" : "",
+                           x, y, actual, expected);
+                    return;
+                }
+            }
+        }
+    }
+}
+
 #if SK_SUPPORT_GPU
 
 // This exercises the problem discovered in crbug.com/570232. The return value from
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "Resources.h"
+#include "SkBitmap.h"
+#include "SkCodec.h"
+#include "SkData.h"
+#include "SkStream.h"
+#include "Test.h"
+
+#include <vector>
+
+static bool same_pixels(const SkBitmap& a, const SkBitmap& b) {
+    for (int y = 0; y < a.height(); y++) {
+        if (memcmp(a.getAddr(0, y), b.getAddr(0, y), a.width() * a.bytesPerPixel())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_frames(skiatest::Reporter* r, const char* path, size_t expectedFrameCount) {
+    SkString fullPath(GetResourcePath(path));
+    sk_sp<SkData> data(SkData::MakeFromFileName(fullPath.c_str()));
+    if (!data) {
+        SkDebugf("Missing resource '%s'\n", path);
+        return;
+    }
+
+    SkAutoTDelete<SkCodec> codec(SkCodec::NewFromData(data.get()));
+    if (!codec) {
+        // This codec is not compiled in.
+        return;
+    }
+
+    const std::vector<SkCodec::FrameInfo> frames = codec->getFrameInfo();
+    REPORTER_ASSERT(r, frames.size() == expectedFrameCount);
+    REPORTER_ASSERT(r, codec->getFrameCount() == SkTMax<int>(1, SkToInt(expectedFrameCount)));
+
+    const SkImageInfo info = codec->getInfo().makeColorType(kN32_SkColorType)
+                                             .makeAlphaType(kPremul_SkAlphaType);
+    SkCodec::Options options;
+    SkBitmap bm;
+    bm.allocPixels(info);
+
+    // There is nothing past the last frame.
+    options.fFrameIndex = SkTMax<size_t>(1, frames.size());
+    REPORTER_ASSERT(r, SkCodec::kInvalidParameters ==
+            codec->getPixels(info, bm.getPixels(), bm.rowBytes(), &options, nullptr, nullptr));
+
+    std::vector<SkBitmap> cached(frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        const size_t requiredFrame = frames[i].fRequiredFrame;
+        REPORTER_ASSERT(r, SkCodec::kNone == requiredFrame || requiredFrame < i);
+        REPORTER_ASSERT(r, SkIRect::MakeSize(info.dimensions()).contains(frames[i].fFrameRect));
+
+        // Decode the frame, and any frames it depends on, from scratch.
+        options.fFrameIndex = i;
+        options.fHasPriorFrame = false;
+        cached[i].allocPixels(info);
+        if (SkCodec::kSuccess != codec->getPixels(info, cached[i].getPixels(),
+                                                  cached[i].rowBytes(), &options, nullptr,
+                                                  nullptr)) {
+            ERRORF(r, "Failed to decode frame %d of %s", (int) i, path);
+            return;
+        }
+
+        // Drawing on top of a copy of the required frame should give the same result.
+        if (SkCodec::kNone != requiredFrame) {
+            SkBitmap prior;
+            REPORTER_ASSERT(r, cached[requiredFrame].copyTo(&prior));
+            options.fHasPriorFrame = true;
+            REPORTER_ASSERT(r, SkCodec::kSuccess == codec->getPixels(info, prior.getPixels(),
+                    prior.rowBytes(), &options, nullptr, nullptr));
+            REPORTER_ASSERT(r, same_pixels(cached[i], prior));
+        }
+    }
+
+    // Only getPixels() can decode later frames.
+    if (frames.size() > 1) {
+        options.fFrameIndex = 1;
+        options.fHasPriorFrame = false;
+        REPORTER_ASSERT(r, SkCodec::kUnimplemented == codec->startScanlineDecode(info, &options,
+                                                                                 nullptr, nullptr));
+    }
+}
+
+DEF_TEST(Codec_frames, r) {
+    test_frames(r, "test640x479.gif", 4);
+    test_frames(r, "color_wheel.gif", 0);
+    test_frames(r, "yellow_rose.webp", 0);
+    test_frames(r, "plane.png", 0);
+    test_frames(r, "mandrill_512_q075.jpg", 0);
+}
+
+// Wraps a memory stream, hiding its duplicate().
+class NotDuplicableStream : public SkStream {
+public:
+    NotDuplicableStream(sk_sp<SkData> data) : fStream(std::move(data)) {}
+
+    size_t read(void* buf, size_t bytes) override { return fStream.read(buf, bytes); }
+    bool rewind() override { return fStream.rewind(); }
+    bool isAtEnd() const override { return fStream.isAtEnd(); }
+
+private:
+    SkMemoryStream fStream;
+};
+
+// Asking for the frames partway through a scanline decode must not disturb it.
+DEF_TEST(Codec_framesDuringScanlineDecode, r) {
+    const char* path = "test640x479.gif";
+    SkString fullPath(GetResourcePath(path));
+    sk_sp<SkData> data(SkData::MakeFromFileName(fullPath.c_str()));
+    if (!data) {
+        SkDebugf("Missing resource '%s'\n", path);
+        return;
+    }
+
+    for (bool canDuplicate : { true, false }) {
+        SkAutoTDelete<SkCodec> codec(canDuplicate
+                ? SkCodec::NewFromData(data.get())
+                : SkCodec::NewFromStream(new NotDuplicableStream(data)));
+        if (!codec) {
+            // This codec is not compiled in.
+            return;
+        }
+
+        const SkImageInfo info = codec->getInfo().makeColorType(kN32_SkColorType)
+                                                 .makeAlphaType(kPremul_SkAlphaType);
+        SkBitmap expected;
+        expected.allocPixels(info);
+        REPORTER_ASSERT(r, SkCodec::kSuccess == codec->getPixels(info, expected.getPixels(),
+                                                                 expected.rowBytes()));
+
+        SkBitmap bm;
+        bm.allocPixels(info);
+        REPORTER_ASSERT(r, SkCodec::kSuccess == codec->startScanlineDecode(info));
+        const SkCodec::SkScanlineOrder order = codec->getScanlineOrder();
+        for (int y = 0; y < info.height(); y++) {
+            if (y == info.height() / 2) {
+                // Without a duplicate to read from, the frames have to wait.
+                REPORTER_ASSERT(r, codec->getFrameInfo().size() == (canDuplicate ? 4u : 0u));
+                REPORTER_ASSERT(r, codec->getScanlineOrder() == order);
+            }
+            REPORTER_ASSERT(r, 1 == codec->getScanlines(bm.getAddr(0, codec->outputScanline(y)),
+                                                        1, bm.rowBytes()));
+        }
+        REPORTER_ASSERT(r, same_pixels(expected, bm));
+
+        REPORTER_ASSERT(r, SkCodec::kSuccess == codec->getPixels(info, bm.getPixels(),
+                                                                 bm.rowBytes()));
+        REPORTER_ASSERT(r, codec->getFrameInfo().size() == 4);
+    }
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "Resources.h"
+#include "SkBitmap.h"
+#include "SkCodec.h"
+#include "SkColorPriv.h"
+#include "SkColorSpace.h"
+#include "SkColorSpaceXform.h"
+#include "SkData.h"
+#include "SkHalf.h"
+#include "Test.h"
+
+static bool almost_equal(int x, int y, int tolerance) {
+    return SkTAbs(x - y) <= tolerance;
+}
+
+static void check_8888(skiatest::Reporter* r, const char* path, const SkBitmap& expected,
+                       const SkBitmap& actual, bool premul) {
+    for (int y = 0; y < expected.height(); y++) {
+        const uint32_t* e = expected.getAddr32(0, y);
+        const uint32_t* a = actual.getAddr32(0, y);
+        for (int x = 0; x < expected.width(); x++) {
+            const unsigned alpha = e[x] >> 24;
+            for (int shift : { 0, 8, 16, 24 }) {
+                unsigned want = (e[x] >> shift) & 0xFF;
+                if (premul && 24 != shift) {
+                    want = SkMulDiv255Round(want, alpha);
+                }
+                // Premultiplying in the same pass may round differently.
+                if (!almost_equal(want, (a[x] >> shift) & 0xFF, premul ? 1 : 0)) {
+                    ERRORF(r, "%s: pixel (%d, %d) is %08x, expected %08x", path, x, y,
+                           a[x], e[x]);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+static void check_f16(skiatest::Reporter* r, const char* path, const SkBitmap& expected,
+                      const SkBitmap& actual, bool premul) {
+    for (int y = 0; y < expected.height(); y++) {
+        const uint64_t* e = (const uint64_t*) expected.getAddr(0, y);
+        const uint64_t* a = (const uint64_t*) actual.getAddr(0, y);
+        for (int x = 0; x < expected.width(); x++) {
+            Sk4f want = SkHalfToFloat_finite(e[x]);
+            if (premul) {
+                want = want * Sk4f(want[3], want[3], want[3], 1.0f);
+            }
+            const Sk4f diff = (want - SkHalfToFloat_finite(a[x])).abs();
+            if (diff[0] > 1/256.0f || diff[1] > 1/256.0f || diff[2] > 1/256.0f ||
+                    diff[3] > 0) {
+                ERRORF(r, "%s: pixel (%d, %d) is wrong", path, x, y);
+                return;
+            }
+        }
+    }
+}
+
+// Decoding straight to a different color space, which transforms each row as the swizzler
+// writes it, should match decoding and then transforming the whole image.
+static void test_xform(skiatest::Reporter* r, const char* path) {
+    SkString fullPath(GetResourcePath(path));
+    sk_sp<SkData> data(SkData::MakeFromFileName(fullPath.c_str()));
+    if (!data) {
+        SkDebugf("Missing resource '%s'\n", path);
+        return;
+    }
+
+    SkAutoTDelete<SkCodec> codec(SkCodec::NewFromData(data.get()));
+    if (!codec) {
+        ERRORF(r, "Could not create a codec for %s", path);
+        return;
+    }
+
+    const SkImageInfo srcInfo = codec->getInfo().makeColorType(kRGBA_8888_SkColorType)
+                                                .makeAlphaType(kUnpremul_SkAlphaType);
+    SkBitmap src;
+    src.allocPixels(srcInfo);
+    if (SkCodec::kSuccess != codec->getPixels(srcInfo, src.getPixels(), src.rowBytes())) {
+        ERRORF(r, "Failed to decode %s", path);
+        return;
+    }
+
+    sk_sp<SkColorSpace> adobe = SkColorSpace::NewNamed(SkColorSpace::kAdobeRGB_Named);
+    sk_sp<SkColorSpace> linear = SkColorSpace::NewRGB(SkColorSpace::kLinear_GammaNamed,
+            SkColorSpace::NewNamed(SkColorSpace::kSRGB_Named)->xyz());
+    const bool opaque = kOpaque_SkAlphaType == codec->getInfo().alphaType();
+
+    for (SkColorType colorType : { kRGBA_8888_SkColorType, kBGRA_8888_SkColorType,
+                                   kRGBA_F16_SkColorType }) {
+        const bool f16 = kRGBA_F16_SkColorType == colorType;
+        sk_sp<SkColorSpace> dstSpace = f16 ? linear : adobe;
+        std::unique_ptr<SkColorSpaceXform> xform =
+                SkColorSpaceXform::New(sk_ref_sp(srcInfo.colorSpace()), dstSpace);
+        REPORTER_ASSERT(r, xform);
+
+        const SkImageInfo unpremulInfo = srcInfo.makeColorType(colorType)
+                                                .makeColorSpace(dstSpace);
+        SkBitmap expected;
+        expected.allocPixels(unpremulInfo);
+        for (int y = 0; y < srcInfo.height(); y++) {
+            xform->apply(expected.getAddr(0, y), src.getAddr32(0, y), srcInfo.width(),
+                         colorType, kUnpremul_SkAlphaType);
+        }
+
+        for (SkAlphaType alphaType : { kUnpremul_SkAlphaType, kPremul_SkAlphaType }) {
+            const SkImageInfo dstInfo = unpremulInfo.makeAlphaType(alphaType);
+            const bool premul = !opaque && kPremul_SkAlphaType == alphaType;
+            SkBitmap actual;
+            actual.allocPixels(dstInfo);
+            if (SkCodec::kSuccess != codec->getPixels(dstInfo, actual.getPixels(),
+                                                      actual.rowBytes())) {
+                ERRORF(r, "Failed to decode %s with a color xform", path);
+                return;
+            }
+
+            if (f16) {
+                check_f16(r, path, expected, actual, premul);
+            } else {
+                check_8888(r, path, expected, actual, premul);
+            }
+        }
+    }
+
+    // 565 cannot be color corrected.
+    const SkImageInfo info565 = srcInfo.makeColorType(kRGB_565_SkColorType)
+                                       .makeAlphaType(kOpaque_SkAlphaType)
+                                       .makeColorSpace(adobe);
+    SkBitmap bm565;
+    bm565.allocPixels(info565);
+    REPORTER_ASSERT(r, SkCodec::kSuccess != codec->getPixels(info565, bm565.getPixels(),
+                                                             bm565.rowBytes()));
+}
+
+DEF_TEST(Codec_colorXform, r) {
+    test_xform(r, "yellow_rose.png");             // RGBA
+    test_xform(r, "color_wheel_with_profile.png"); // RGBA, with an ICC profile
+    test_xform(r, "mandrill_256.png");            // RGB
+    test_xform(r, "index8.png");                  // Palette
+    test_xform(r, "mandrill_512_q075.jpg");       // YCbCr
+    test_xform(r, "grayscale.jpg");               // Gray
+    test_xform(r, "CMYK.jpg");                    // CMYK, which always needs a swizzler
+}
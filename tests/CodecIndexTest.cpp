@@ -0,0 +1,210 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "Resources.h"
+#include "SkAndroidCodec.h"
+#include "SkBitmap.h"
+#include "SkCodec.h"
+#include "SkData.h"
+#include "Test.h"
+
+static bool same_rows(const SkBitmap& a, int aY, const SkBitmap& b, int bY, int rows) {
+    for (int y = 0; y < rows; y++) {
+        if (memcmp(a.getAddr(0, aY + y), b.getAddr(0, bY + y), a.width() * a.bytesPerPixel())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decodes rows [top, top + kRows) after skipping to them.
+static const int kRows = 20;
+static bool decode_rows(SkCodec* codec, const SkImageInfo& info, int top, SkBitmap* bm) {
+    bm->allocPixels(info.makeWH(info.width(), kRows));
+    return SkCodec::kSuccess == codec->startScanlineDecode(info) &&
+           codec->skipScanlines(top) &&
+           kRows == codec->getScanlines(bm->getPixels(), kRows, bm->rowBytes());
+}
+
+static void test_index(skiatest::Reporter* r, const char* path, bool supported) {
+    SkString fullPath(GetResourcePath(path));
+    sk_sp<SkData> data(SkData::MakeFromFileName(fullPath.c_str()));
+    if (!data) {
+        SkDebugf("Missing resource '%s'\n", path);
+        return;
+    }
+
+    SkAutoTDelete<SkCodec> codec(SkCodec::NewFromData(data.get()));
+    if (!codec) {
+        ERRORF(r, "Could not create a codec for %s", path);
+        return;
+    }
+
+    const SkImageInfo info = codec->getInfo().makeColorType(kN32_SkColorType)
+                                             .makeAlphaType(kPremul_SkAlphaType);
+    SkBitmap truth;
+    truth.allocPixels(info);
+    if (SkCodec::kSuccess != codec->getPixels(info, truth.getPixels(), truth.rowBytes())) {
+        ERRORF(r, "Failed to decode %s", path);
+        return;
+    }
+
+    REPORTER_ASSERT(r, supported == codec->buildIndex());
+    if (!supported) {
+        return;
+    }
+
+    // Skipping with the index gives the same rows as decoding them all.
+    for (int top = 0; top + kRows <= info.height(); top += 13) {
+        SkBitmap rows;
+        if (!decode_rows(codec.get(), info, top, &rows)) {
+            ERRORF(r, "Failed to decode rows from %d of %s", top, path);
+            return;
+        }
+        REPORTER_ASSERT(r, same_rows(truth, top, rows, 0, kRows));
+    }
+
+    // So does a scaled subset, through SkAndroidCodec.
+    SkAutoTDelete<SkAndroidCodec> androidCodec(SkAndroidCodec::NewFromData(data.get()));
+    REPORTER_ASSERT(r, androidCodec->buildIndex());
+    SkAndroidCodec::AndroidOptions options;
+    SkIRect subset = SkIRect::MakeXYWH(info.width() / 2, info.height() / 2,
+                                       info.width() / 2, info.height() / 2);
+    REPORTER_ASSERT(r, androidCodec->getSupportedSubset(&subset));
+    options.fSubset = &subset;
+    options.fSampleSize = 2;
+    const SkISize size = androidCodec->getSampledSubsetDimensions(2, subset);
+    const SkImageInfo subsetInfo = info.makeWH(size.width(), size.height());
+    SkBitmap indexed, plain;
+    indexed.allocPixels(subsetInfo);
+    plain.allocPixels(subsetInfo);
+    REPORTER_ASSERT(r, SkCodec::kSuccess == androidCodec->getAndroidPixels(subsetInfo,
+            indexed.getPixels(), indexed.rowBytes(), &options));
+
+    androidCodec.reset(SkAndroidCodec::NewFromData(data.get()));
+    REPORTER_ASSERT(r, SkCodec::kSuccess == androidCodec->getAndroidPixels(subsetInfo,
+            plain.getPixels(), plain.rowBytes(), &options));
+    REPORTER_ASSERT(r, same_rows(indexed, 0, plain, 0, subsetInfo.height()));
+}
+
+// Seeking into a truncated image must not make up the missing rows.
+static void test_truncated_index(skiatest::Reporter* r, const char* path) {
+    SkString fullPath(GetResourcePath(path));
+    sk_sp<SkData> data(SkData::MakeFromFileName(fullPath.c_str()));
+    if (!data) {
+        SkDebugf("Missing resource '%s'\n", path);
+        return;
+    }
+    data = SkData::MakeSubset(data.get(), 0, data->size() * 9 / 10);
+
+    SkAutoTDelete<SkCodec> codec(SkCodec::NewFromData(data.get()));
+    SkAutoTDelete<SkCodec> indexed(SkCodec::NewFromData(data.get()));
+    REPORTER_ASSERT(r, indexed->buildIndex());
+    const SkImageInfo info = codec->getInfo().makeColorType(kN32_SkColorType)
+                                             .makeAlphaType(kPremul_SkAlphaType);
+    const int top = info.height() - kRows;
+    SkBitmap rows;
+    REPORTER_ASSERT(r, !decode_rows(codec.get(), info, top, &rows));
+    REPORTER_ASSERT(r, !decode_rows(indexed.get(), info, top, &rows));
+}
+
+// libjpeg reads a comment in this header that the index does not, and skipping it from a seek
+// runs past the end of the data.  That must fail the skip, not hang or invent data.
+static void test_truncated_skip(skiatest::Reporter* r) {
+    const char* path = "invalid_images/truncated_restart_skip.jpg";
+    SkString fullPath(GetResourcePath(path));
+    sk_sp<SkData> data(SkData::MakeFromFileName(fullPath.c_str()));
+    if (!data) {
+        SkDebugf("Missing resource '%s'\n", path);
+        return;
+    }
+
+    SkAutoTDelete<SkCodec> codec(SkCodec::NewFromData(data.get()));
+    if (!codec) {
+        ERRORF(r, "Could not create a codec for %s", path);
+        return;
+    }
+    REPORTER_ASSERT(r, codec->buildIndex());
+    const SkImageInfo info = codec->getInfo().makeColorType(kN32_SkColorType)
+                                             .makeAlphaType(kPremul_SkAlphaType);
+    SkBitmap rows;
+    REPORTER_ASSERT(r, !decode_rows(codec.get(), info, info.height() - kRows, &rows));
+}
+
+DEF_TEST(Codec_index, r) {
+    // Has restart markers.
+    test_index(r, "icc-v2-gbr.jpg", true);
+    // Does not.
+    test_index(r, "mandrill_512_q075.jpg", false);
+    test_index(r, "plane.png", false);
+
+    test_truncated_index(r, "icc-v2-gbr.jpg");
+    test_truncated_skip(r);
+}
+
+// On a machine with several cores, getPixels() can decode indexed JPEGs in bands on separate
+// threads.  That should give exactly what decoding them a row at a time does.
+DEF_TEST(Codec_jpeg_bands, r) {
+    const char* path = "icc-v2-gbr.jpg";
+    SkString fullPath(GetResourcePath(path));
+    sk_sp<SkData> data(SkData::MakeFromFileName(fullPath.c_str()));
+    if (!data) {
+        SkDebugf("Missing resource '%s'\n", path);
+        return;
+    }
+
+    SkAutoTDelete<SkCodec> codec(SkCodec::NewFromData(data.get()));
+    REPORTER_ASSERT(r, codec->buildIndex());
+    const SkImageInfo info = codec->getInfo().makeColorType(kN32_SkColorType)
+                                             .makeAlphaType(kPremul_SkAlphaType);
+    SkCodec::Options options;
+    options.fUseThreads = true;
+    for (float scale : { 1.0f, 0.5f }) {
+        const SkISize size = codec->getScaledDimensions(scale);
+        const SkImageInfo scaledInfo = info.makeWH(size.width(), size.height());
+        SkBitmap all, rows;
+        all.allocPixels(scaledInfo);
+        rows.allocPixels(scaledInfo);
+        REPORTER_ASSERT(r, SkCodec::kSuccess == codec->getPixels(scaledInfo, all.getPixels(),
+                                                                 all.rowBytes(), &options,
+                                                                 nullptr, nullptr));
+        REPORTER_ASSERT(r, SkCodec::kSuccess == codec->startScanlineDecode(scaledInfo));
+        for (int y = 0; y < scaledInfo.height(); y++) {
+            REPORTER_ASSERT(r, 1 == codec->getScanlines(rows.getAddr(0, y), 1, rows.rowBytes()));
+        }
+        REPORTER_ASSERT(r, same_rows(all, 0, rows, 0, scaledInfo.height()));
+    }
+}
+
+// Bands must not hide a truncated image either.
+DEF_TEST(Codec_jpeg_bands_truncated, r) {
+    const char* path = "icc-v2-gbr.jpg";
+    SkString fullPath(GetResourcePath(path));
+    sk_sp<SkData> data(SkData::MakeFromFileName(fullPath.c_str()));
+    if (!data) {
+        SkDebugf("Missing resource '%s'\n", path);
+        return;
+    }
+    data = SkData::MakeSubset(data.get(), 0, data->size() * 9 / 10);
+
+    SkAutoTDelete<SkCodec> codec(SkCodec::NewFromData(data.get()));
+    REPORTER_ASSERT(r, codec->buildIndex());
+    const SkImageInfo info = codec->getInfo().makeColorType(kN32_SkColorType)
+                                             .makeAlphaType(kPremul_SkAlphaType);
+    SkCodec::Options options;
+    options.fUseThreads = true;
+    SkBitmap all, rows;
+    all.allocPixels(info);
+    rows.allocPixels(info);
+    REPORTER_ASSERT(r, SkCodec::kIncompleteInput == codec->getPixels(info, all.getPixels(),
+                                                                     all.rowBytes(), &options,
+                                                                     nullptr, nullptr));
+    REPORTER_ASSERT(r, SkCodec::kSuccess == codec->startScanlineDecode(info));
+    const int decoded = codec->getScanlines(rows.getPixels(), info.height(), rows.rowBytes());
+    REPORTER_ASSERT(r, decoded < info.height());
+    REPORTER_ASSERT(r, same_rows(all, 0, rows, 0, decoded));
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "Resources.h"
+#include "SkBitmap.h"
+#include "SkCodec.h"
+#include "SkData.h"
+#include "SkStream.h"
+#include "Test.h"
+
+// Stream that only hands out the data that has "arrived" so far, like a network stream would.
+class HaltingStream : public SkStream {
+public:
+    HaltingStream(sk_sp<SkData> data, size_t limit)
+        : fTotalSize(data->size())
+        , fLimit(SkTMin(limit, fTotalSize))
+        , fStream(std::move(data))
+    {}
+
+    void addNewData(size_t extra) {
+        fLimit = SkTMin(fTotalSize, fLimit + extra);
+    }
+
+    bool isAllDataReceived() const { return fLimit == fTotalSize; }
+
+    size_t read(void* buffer, size_t size) override {
+        return fStream.read(buffer, SkTMin(size, fLimit - fStream.getPosition()));
+    }
+
+    size_t peek(void* buffer, size_t size) const override {
+        return fStream.peek(buffer, SkTMin(size, fLimit - fStream.getPosition()));
+    }
+
+    bool isAtEnd() const override { return fStream.isAtEnd(); }
+    bool rewind() override { return fStream.rewind(); }
+    bool hasPosition() const override { return true; }
+    size_t getPosition() const override { return fStream.getPosition(); }
+
+private:
+    const size_t   fTotalSize;
+    size_t         fLimit;
+    SkMemoryStream fStream;
+};
+
+static bool decode_complete(SkCodec* codec, SkBitmap* bm) {
+    const SkImageInfo info = codec->getInfo().makeColorType(kN32_SkColorType)
+                                             .makeAlphaType(kPremul_SkAlphaType);
+    bm->allocPixels(info);
+    return SkCodec::kSuccess == codec->getPixels(info, bm->getPixels(), bm->rowBytes());
+}
+
+static bool same_pixels(const SkBitmap& a, const SkBitmap& b) {
+    for (int y = 0; y < a.height(); y++) {
+        if (memcmp(a.getAddr(0, y), b.getAddr(0, y), a.width() * a.bytesPerPixel())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_partial(skiatest::Reporter* r, const char* path) {
+    SkString fullPath(GetResourcePath(path));
+    sk_sp<SkData> data(SkData::MakeFromFileName(fullPath.c_str()));
+    if (!data) {
+        SkDebugf("Missing resource '%s'\n", path);
+        return;
+    }
+
+    SkBitmap truth;
+    SkAutoTDelete<SkCodec> codec(SkCodec::NewFromData(data.get()));
+    if (!codec) {
+        // This codec is not compiled in.
+        return;
+    }
+    if (!decode_complete(codec.get(), &truth)) {
+        ERRORF(r, "Failed to decode %s", path);
+        return;
+    }
+
+    // Create the codec once enough of the header has arrived.
+    const size_t kIncrement = 1000;
+    HaltingStream* stream = nullptr;
+    codec.reset(nullptr);
+    for (size_t limit = kIncrement; !codec && limit < data->size(); limit += kIncrement) {
+        stream = new HaltingStream(data, limit);
+        codec.reset(SkCodec::NewFromStream(stream));
+    }
+    if (!codec) {
+        ERRORF(r, "Could not create a codec for %s from partial data", path);
+        return;
+    }
+
+    REPORTER_ASSERT(r, SkCodec::kInvalidParameters == codec->incrementalDecode());
+
+    SkBitmap incremental;
+    incremental.allocPixels(truth.info());
+    incremental.eraseColor(SK_ColorTRANSPARENT);
+    if (SkCodec::kSuccess != codec->startIncrementalDecode(truth.info(), incremental.getPixels(),
+                                                           incremental.rowBytes())) {
+        ERRORF(r, "Failed to start an incremental decode of %s", path);
+        return;
+    }
+
+    int previousRows = 0;
+    int calls = 0;
+    while (true) {
+        int rowsDecoded = -1;
+        const SkCodec::Result result = codec->incrementalDecode(&rowsDecoded);
+        calls++;
+        if (SkCodec::kSuccess == result) {
+            break;
+        }
+        if (SkCodec::kIncompleteInput != result || stream->isAllDataReceived()) {
+            ERRORF(r, "Incremental decode of %s failed after %d calls", path, calls);
+            return;
+        }
+        REPORTER_ASSERT(r, rowsDecoded >= previousRows && rowsDecoded <= truth.height());
+        previousRows = rowsDecoded;
+        stream->addNewData(kIncrement);
+    }
+
+    // The image should have come in pieces, and match a complete decode.
+    REPORTER_ASSERT(r, calls > 1);
+    REPORTER_ASSERT(r, same_pixels(truth, incremental));
+
+    // A regular decode still works afterwards.
+    SkBitmap again;
+    REPORTER_ASSERT(r, decode_complete(codec.get(), &again) && same_pixels(truth, again));
+}
+
+DEF_TEST(Codec_partial, r) {
+    test_partial(r, "plane.png");
+    test_partial(r, "plane_interlaced.png");
+    test_partial(r, "index8.png");
+    test_partial(r, "mandrill_512_q075.jpg");
+    test_partial(r, "CMYK.jpg");
+    test_partial(r, "color_wheel.gif");
+    test_partial(r, "test640x479.gif");
+    test_partial(r, "yellow_rose.webp");
+}
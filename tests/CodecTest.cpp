@@ -536,6 +536,47 @@ DEF_TEST(Codec_stripes, r) {
     compare_to_good_digest(r, digest, bm);
 }
 
+// Sampling an interlaced PNG only swizzles the rows it keeps, so check that it picks the same
+// rows as sampling the same image stored without interlacing.
+DEF_TEST(Codec_sampledInterlaced, r) {
+    SkAutoTDelete<SkStream> plainStream(resource("plane.png"));
+    SkAutoTDelete<SkStream> interlacedStream(resource("plane_interlaced.png"));
+    if (!plainStream || !interlacedStream) {
+        SkDebugf("Missing resource 'plane.png' or 'plane_interlaced.png'\n");
+        return;
+    }
+
+    SkAutoTDelete<SkAndroidCodec> plain(SkAndroidCodec::NewFromStream(plainStream.release()));
+    SkAutoTDelete<SkAndroidCodec> interlaced(
+            SkAndroidCodec::NewFromStream(interlacedStream.release()));
+    REPORTER_ASSERT(r, plain && interlaced);
+    if (!plain || !interlaced) {
+        return;
+    }
+    REPORTER_ASSERT(r, plain->getInfo().dimensions() == interlaced->getInfo().dimensions());
+
+    for (int sampleSize : { 1, 2, 3, 4, 7 }) {
+        const SkISize size = plain->getSampledDimensions(sampleSize);
+        const SkImageInfo info = plain->getInfo().makeWH(size.width(), size.height())
+                                                 .makeColorType(kN32_SkColorType)
+                                                 .makeAlphaType(kPremul_SkAlphaType);
+        SkAndroidCodec::AndroidOptions options;
+        options.fSampleSize = sampleSize;
+
+        SkBitmap expected, actual;
+        expected.allocPixels(info);
+        actual.allocPixels(info);
+        REPORTER_ASSERT(r, SkCodec::kSuccess == plain->getAndroidPixels(info,
+                expected.getPixels(), expected.rowBytes(), &options));
+        REPORTER_ASSERT(r, SkCodec::kSuccess == interlaced->getAndroidPixels(info,
+                actual.getPixels(), actual.rowBytes(), &options));
+
+        SkMD5::Digest digest;
+        md5(expected, &digest);
+        compare_to_good_digest(r, digest, actual);
+    }
+}
+
 static void test_invalid_stream(skiatest::Reporter* r, const void* stream, size_t len) {
     // Neither of these calls should return a codec. Bots should catch us if we leaked anything.
     SkCodec* codec = SkCodec::NewFromStream(new SkMemoryStream(stream, len, false));
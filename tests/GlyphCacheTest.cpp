@@ -0,0 +1,38 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkGlyphCache.h"
+#include "SkGraphics.h"
+#include "SkTaskGroup.h"
+#include "SkTypeface.h"
+#include "Test.h"
+
+// Look up lots of strikes from many threads at once, while a small budget forces purging.
+DEF_TEST(GlyphCache_Threaded, reporter) {
+    size_t oldCacheLimit = SkGraphics::SetFontCacheLimit(0);
+    int oldCountLimit = SkGraphics::SetFontCacheCountLimit(20);
+
+    SkTaskGroup().batch(16, [](int i) {
+        SkPaint paint;
+        paint.setAntiAlias(true);
+        for (SkScalar size = 8; size < 48; size++) {
+            paint.setTextSize(size + (i & 1) * 0.5f);
+            SkAutoGlyphCacheNoGamma autoCache(paint, nullptr, nullptr);
+            SkGlyphCache* cache = autoCache.getCache();
+            cache->getGlyphIDMetrics(cache->unicharToGlyph('A' + i));
+        }
+    });
+
+    REPORTER_ASSERT(reporter, SkGraphics::GetFontCacheCountUsed() <= 20);
+
+    SkGraphics::PurgeFontCache();
+    REPORTER_ASSERT(reporter, SkGraphics::GetFontCacheCountUsed() == 0);
+    REPORTER_ASSERT(reporter, SkGraphics::GetFontCacheUsed() == 0);
+
+    SkGraphics::SetFontCacheCountLimit(oldCountLimit);
+    SkGraphics::SetFontCacheLimit(oldCacheLimit);
+}
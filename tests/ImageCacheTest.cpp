@@ -7,6 +7,7 @@
 
 #include "SkDiscardableMemory.h"
 #include "SkResourceCache.h"
+#include "SkTaskGroup.h"
 #include "Test.h"
 
 namespace {
@@ -151,3 +152,62 @@ DEF_TEST(ImageCache_doubleAdd, r) {
     REPORTER_ASSERT(r, cache.find(key, TestingRec::Visitor, &value));
     REPORTER_ASSERT(r, 2 == value || 3 == value);
 }
+
+DEF_TEST(ImageCache_global, r) {
+    // The global cache's shards share one budget.
+    const size_t oldLimit = SkResourceCache::SetTotalByteLimit(1000003);
+    REPORTER_ASSERT(r, 1000003 == SkResourceCache::GetTotalByteLimit());
+
+    // Keys spread out over the shards, and racing threads all find what they add.
+    SkTaskGroup().batch(8, [&](int thread) {
+        for (int i = 0; i < COUNT * 10; ++i) {
+            TestingKey key(thread * 1000 + i, 42);
+            SkResourceCache::Add(new TestingRec(key, i));
+
+            intptr_t value = -1;
+            REPORTER_ASSERT(r, SkResourceCache::Find(key, TestingRec::Visitor, &value));
+            REPORTER_ASSERT(r, i == value);
+        }
+    });
+
+    SkResourceCache::PostPurgeSharedID(42);
+    intptr_t value = -1;
+    REPORTER_ASSERT(r, !SkResourceCache::Find(TestingKey(0, 42), TestingRec::Visitor, &value));
+
+    SkResourceCache::SetTotalByteLimit(oldLimit);
+}
+
+namespace {
+struct BigRec : public TestingRec {
+    BigRec(const TestingKey& key, size_t bytes) : TestingRec(key, 0), fBytes(bytes) {}
+    size_t bytesUsed() const override { return fBytes; }
+    size_t fBytes;
+};
+}
+
+DEF_TEST(ImageCache_globalBigRec, r) {
+    // A Rec that fits in the budget stays in the global cache, however big it is next to
+    // the number of shards.
+    const size_t limit = 1 << 20;
+    const size_t oldLimit = SkResourceCache::SetTotalByteLimit(limit);
+    REPORTER_ASSERT(r, limit == SkResourceCache::GetEffectiveSingleAllocationByteLimit());
+
+    TestingKey key(12345);
+    SkResourceCache::Add(new BigRec(key, limit / 2));
+    intptr_t value = -1;
+    REPORTER_ASSERT(r, SkResourceCache::Find(key, TestingRec::Visitor, &value));
+    REPORTER_ASSERT(r, SkResourceCache::GetTotalBytesUsed() <= limit);
+
+    // Adding another makes room for itself by purging, without going over budget.
+    TestingKey other(67890);
+    SkResourceCache::Add(new BigRec(other, limit * 3 / 4));
+    REPORTER_ASSERT(r, SkResourceCache::Find(other, TestingRec::Visitor, &value));
+    REPORTER_ASSERT(r, SkResourceCache::GetTotalBytesUsed() <= limit);
+
+    // One bigger than the whole budget is purged right away.
+    TestingKey huge(13579);
+    SkResourceCache::Add(new BigRec(huge, limit + 1));
+    REPORTER_ASSERT(r, !SkResourceCache::Find(huge, TestingRec::Visitor, &value));
+
+    SkResourceCache::SetTotalByteLimit(oldLimit);
+}
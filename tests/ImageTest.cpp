@@ -9,12 +9,14 @@
 #include <initializer_list>
 #include <vector>
 
+#include "SkAtomics.h"
 #include "SkAutoPixmapStorage.h"
 #include "SkBitmap.h"
 #include "SkCanvas.h"
 #include "SkData.h"
 #include "SkImageEncoder.h"
 #include "SkImageGenerator.h"
+#include "SkImageCacherator.h"
 #include "SkImage_Base.h"
 #include "SkImagePriv.h"
 #include "SkPicture.h"
@@ -23,6 +25,7 @@
 #include "SkRRect.h"
 #include "SkStream.h"
 #include "SkSurface.h"
+#include "SkTaskGroup.h"
 #include "SkUtils.h"
 #include "Test.h"
 
@@ -576,6 +579,50 @@ DEF_TEST(ImageEmpty, reporter) {
     REPORTER_ASSERT(reporter, nullptr == SkImage::MakeFromGenerator(new EmptyGenerator));
 }
 
+class CountingGenerator : public SkImageGenerator {
+public:
+    CountingGenerator(SkAtomic<int>* decodes)
+        : SkImageGenerator(SkImageInfo::MakeN32Premul(64, 64)), fDecodes(decodes) {}
+
+protected:
+    bool onGetPixels(const SkImageInfo& info, void* pixels, size_t rowBytes, SkPMColor[],
+                     int*) override {
+        fDecodes->fetch_add(1);
+        for (int y = 0; y < info.height(); y++) {
+            sk_memset32((uint32_t*)((char*)pixels + y * rowBytes), SK_ColorBLUE, info.width());
+        }
+        return true;
+    }
+
+private:
+    SkAtomic<int>* fDecodes;
+};
+
+// Threads that all miss in the cache at once should share one decode.
+DEF_TEST(Image_concurrentDecode, reporter) {
+    SkAtomic<int> decodes{0};
+    sk_sp<SkImage> image(SkImage::MakeFromGenerator(new CountingGenerator(&decodes)));
+
+    int decodesBefore, avoidedBefore, hitsBefore;
+    SkImageCacherator::GetDecodeStats(&decodesBefore, &avoidedBefore, &hitsBefore);
+
+    const int kThreads = 8;
+    SkTaskGroup().batch(kThreads, [&](int) {
+        SkBitmap bm;
+        REPORTER_ASSERT(reporter, as_IB(image)->getROPixels(&bm));
+        REPORTER_ASSERT(reporter, SK_ColorBLUE == *bm.getAddr32(63, 63));
+    });
+    REPORTER_ASSERT(reporter, 1 == decodes.load());
+
+    // One thread decoded.  The rest either waited for it, or came late enough to find its
+    // bitmap in the cache straight away.
+    int decodesAfter, avoidedAfter, hitsAfter;
+    SkImageCacherator::GetDecodeStats(&decodesAfter, &avoidedAfter, &hitsAfter);
+    REPORTER_ASSERT(reporter, 1 == decodesAfter - decodesBefore);
+    REPORTER_ASSERT(reporter, kThreads - 1 == (avoidedAfter - avoidedBefore) +
+                                              (hitsAfter - hitsBefore));
+}
+
 DEF_TEST(ImageDataRef, reporter) {
     SkImageInfo info = SkImageInfo::MakeN32Premul(1, 1);
     size_t rowBytes = info.minRowBytes();
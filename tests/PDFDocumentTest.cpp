@@ -8,8 +8,14 @@
 
 #include "Resources.h"
 #include "SkCanvas.h"
+#include "SkColorPriv.h"
+#include "SkColorTable.h"
+#include "SkData.h"
 #include "SkDocument.h"
+#include "SkImage.h"
+#include "SkImageEncoder.h"
 #include "SkOSFile.h"
+#include "SkPDFDocument.h"
 #include "SkStream.h"
 #include "SkPixelSerializer.h"
 
@@ -167,3 +173,262 @@ DEF_TEST(document_skbug_4734, r) {
     const char text[] = "HELLO";
     canvas->drawText(text, strlen(text), 0, 0, SkPaint());
 }
+
+static sk_sp<SkData> make_image_document(const SkBitmap& bm, int pages, bool abort) {
+    SkDynamicMemoryWStream stream;
+    sk_sp<SkDocument> doc(SkDocument::MakePDF(&stream));
+    for (int i = 0; i < pages; i++) {
+        SkCanvas* canvas = doc->beginPage(256, 256);
+        // A new pixel ref on every page, so each page has its own image to compress.
+        SkBitmap copy;
+        bm.copyTo(&copy);
+        canvas->drawBitmap(copy, SkIntToScalar(i), 0);
+        canvas->drawColor(SK_ColorBLUE, SkXfermode::kDstOver_Mode);
+        doc->endPage();
+    }
+    if (abort) {
+        doc->abort();
+    } else {
+        doc->close();
+    }
+    return sk_sp<SkData>(stream.copyToData());
+}
+
+// Images and content streams are compressed on other threads, but the
+// document must come out the same every time.
+DEF_TEST(document_parallel_compression, r) {
+    REQUIRE_PDF_DOCUMENT(document_parallel_compression, r);
+    SkBitmap bm;
+    if (!GetResourceAsBitmap("color_wheel.png", &bm)) {
+        return;
+    }
+    sk_sp<SkData> first = make_image_document(bm, 5, false);
+    sk_sp<SkData> second = make_image_document(bm, 5, false);
+    REPORTER_ASSERT(r, first->size() > 0);
+    REPORTER_ASSERT(r, first->equals(second.get()));
+
+    // Aborting while objects are still compressing should be safe.
+    make_image_document(bm, 5, true);
+}
+
+static sk_sp<SkData> make_object_stream_document(bool useObjectStreams) {
+    SkDynamicMemoryWStream stream;
+    SkDocument::PDFMetadata metadata;
+    metadata.fUseObjectStreams = useObjectStreams;
+    sk_sp<SkDocument> doc = SkDocument::MakePDF(&stream, SK_ScalarDefaultRasterDPI,
+                                                metadata, nullptr, false);
+    for (int i = 0; i < 30; i++) {
+        SkCanvas* canvas = doc->beginPage(100, 100);
+        // Each alpha needs its own graphic state dictionary.
+        SkPaint paint;
+        for (int j = 0; j < 10; j++) {
+            paint.setAlpha(SkToU8(i * 8 + j));
+            canvas->drawRect(SkRect::MakeXYWH(SkIntToScalar(j * 10), 0, 10, 10), paint);
+        }
+        doc->endPage();
+    }
+    doc->close();
+    return sk_sp<SkData>(stream.copyToData());
+}
+
+static int count(const SkData* data, const char* text) {
+    size_t len = strlen(text);
+    const char* bytes = (const char*)data->data();
+    int found = 0;
+    for (size_t i = 0; i + len <= data->size(); i++) {
+        if (0 == memcmp(bytes + i, text, len)) {
+            found++;
+        }
+    }
+    return found;
+}
+
+static bool contains(const SkData* data, const char* text) {
+    return count(data, text) > 0;
+}
+
+DEF_TEST(document_object_streams, r) {
+    REQUIRE_PDF_DOCUMENT(document_object_streams, r);
+    sk_sp<SkData> plain = make_object_stream_document(false);
+    sk_sp<SkData> packed = make_object_stream_document(true);
+    REPORTER_ASSERT(r, 0 == memcmp(plain->data(), "%PDF-1.4", 8));
+    REPORTER_ASSERT(r, 0 == memcmp(packed->data(), "%PDF-1.5", 8));
+    REPORTER_ASSERT(r, contains(packed.get(), "/ObjStm"));
+    REPORTER_ASSERT(r, contains(packed.get(), "/XRef"));
+    REPORTER_ASSERT(r, !contains(packed.get(), "\nxref\n"));
+    REPORTER_ASSERT(r, !contains(packed.get(), "trailer"));
+    REPORTER_ASSERT(r, packed->size() < plain->size());
+}
+
+// Pages are written as they end, so the objects a document holds on to
+// should not grow with the number of pages.
+DEF_TEST(document_streaming, r) {
+    REQUIRE_PDF_DOCUMENT(document_streaming, r);
+    SkDynamicMemoryWStream stream;
+    sk_sp<SkDocument> doc(SkDocument::MakePDF(&stream));
+    SkPDFDocument* pdf = static_cast<SkPDFDocument*>(doc.get());
+    int heldAfterFewPages = 0;
+    for (int i = 0; i < 256; i++) {
+        SkCanvas* canvas = doc->beginPage(300, 300);
+        SkPaint paint;
+        SkString text = SkStringPrintf("Page %d", i);
+        canvas->drawText(text.c_str(), text.size(), 20, 20, paint);
+        paint.setAlpha(0x80);
+        canvas->drawRect(SkRect::MakeXYWH(20, 40, 100, 100), paint);
+        doc->endPage();
+        if (i == 15) {
+            heldAfterFewPages = pdf->heldObjectCountForTesting();
+        }
+    }
+    int heldAfterManyPages = pdf->heldObjectCountForTesting();
+    // Allow for the page tree growing another level.
+    REPORTER_ASSERT(r, heldAfterManyPages <= heldAfterFewPages + 16);
+    REPORTER_ASSERT(r, doc->close());
+    sk_sp<SkData> data(stream.copyToData());
+    REPORTER_ASSERT(r, contains(data.get(), "/Count 256"));
+}
+
+static sk_sp<SkData> make_duplicate_image_document(bool dedup, const SkData* jpeg) {
+    SkBitmap bm;
+    bm.allocN32Pixels(32, 32);
+    bm.eraseColor(SK_ColorRED);
+    bm.eraseArea(SkIRect::MakeWH(16, 16), SK_ColorGREEN);
+
+    SkDynamicMemoryWStream stream;
+    SkDocument::PDFMetadata metadata;
+    metadata.fDeduplicateImages = dedup;
+    sk_sp<SkDocument> doc = SkDocument::MakePDF(&stream, SK_ScalarDefaultRasterDPI,
+                                                metadata, nullptr, false);
+    for (int i = 0; i < 4; i++) {
+        SkCanvas* canvas = doc->beginPage(100, 100);
+        // Distinct pixel refs and images, same contents.
+        SkBitmap copy;
+        bm.copyTo(&copy);
+        canvas->drawBitmap(copy, 0, 0);
+        canvas->drawImage(SkImage::MakeFromBitmap(copy), 50, 0);
+        if (jpeg) {
+            sk_sp<SkData> bytes = SkData::MakeWithCopy(jpeg->data(), jpeg->size());
+            canvas->drawImage(SkImage::MakeFromEncoded(std::move(bytes)), 0, 50);
+        }
+        doc->endPage();
+    }
+    doc->close();
+    return sk_sp<SkData>(stream.copyToData());
+}
+
+static sk_sp<SkImage> make_index8_image(SkColor color) {
+    SkPMColor pmColor = SkPreMultiplyColor(color);
+    sk_sp<SkColorTable> ctable(new SkColorTable(&pmColor, 1));
+    uint8_t indices[8 * 8] = { 0 };
+    SkPixmap pixmap(SkImageInfo::Make(8, 8, kIndex_8_SkColorType, kPremul_SkAlphaType),
+                    indices, 8, ctable.get());
+    return SkImage::MakeRasterCopy(pixmap);
+}
+
+DEF_TEST(document_image_deduplication, r) {
+    REQUIRE_PDF_DOCUMENT(document_image_deduplication, r);
+    SkString path = GetResourcePath("mandrill_h1v1.jpg");
+    sk_sp<SkData> jpeg(SkData::MakeFromFileName(path.c_str()));
+    sk_sp<SkData> plain = make_duplicate_image_document(false, jpeg.get());
+    sk_sp<SkData> deduped = make_duplicate_image_document(true, jpeg.get());
+    int expected = jpeg ? 2 : 1;
+    REPORTER_ASSERT(r, count(deduped.get(), "/Subtype /Image") == expected);
+    REPORTER_ASSERT(r, count(plain.get(), "/Subtype /Image") > expected);
+    REPORTER_ASSERT(r, deduped->size() < plain->size());
+
+    // Index8 images with the same indices but different colors are different images.
+    SkDynamicMemoryWStream stream;
+    SkDocument::PDFMetadata metadata;
+    metadata.fDeduplicateImages = true;
+    sk_sp<SkDocument> doc = SkDocument::MakePDF(&stream, SK_ScalarDefaultRasterDPI,
+                                                metadata, nullptr, false);
+    SkCanvas* canvas = doc->beginPage(100, 100);
+    canvas->drawImage(make_index8_image(SK_ColorRED), 0, 0);
+    canvas->drawImage(make_index8_image(SK_ColorBLUE), 10, 0);
+    canvas->drawImage(make_index8_image(SK_ColorRED), 20, 0);
+    doc->endPage();
+    REPORTER_ASSERT(r, doc->close());
+    sk_sp<SkData> data(stream.copyToData());
+    REPORTER_ASSERT(r, 2 == count(data.get(), "/Subtype /Image"));
+}
+
+// Subsets of one encoded image share its bytes but not its pixels.
+DEF_TEST(document_image_deduplication_subsets, r) {
+    REQUIRE_PDF_DOCUMENT(document_image_deduplication_subsets, r);
+    SkBitmap bm;
+    bm.allocN32Pixels(64, 32);
+    bm.eraseColor(SK_ColorBLUE);
+    bm.eraseArea(SkIRect::MakeWH(32, 32), SK_ColorRED);
+    sk_sp<SkData> png(SkImageEncoder::EncodeData(bm, SkImageEncoder::kPNG_Type, 100));
+    REPORTER_ASSERT(r, png);
+    if (!png) {
+        return;
+    }
+
+    SkDynamicMemoryWStream stream;
+    SkDocument::PDFMetadata metadata;
+    metadata.fDeduplicateImages = true;
+    sk_sp<SkDocument> doc = SkDocument::MakePDF(&stream, SK_ScalarDefaultRasterDPI,
+                                                metadata, nullptr, false);
+    SkCanvas* canvas = doc->beginPage(100, 100);
+    const SkIRect left = SkIRect::MakeWH(32, 32);
+    const SkIRect right = SkIRect::MakeXYWH(32, 0, 32, 32);
+    canvas->drawImage(SkImage::MakeFromEncoded(png, &left), 0, 0);
+    canvas->drawImage(SkImage::MakeFromEncoded(png, &right), 50, 0);
+    // Whole copies of the same bytes are still embedded once.
+    for (int i = 0; i < 2; i++) {
+        sk_sp<SkData> bytes = SkData::MakeWithCopy(png->data(), png->size());
+        canvas->drawImage(SkImage::MakeFromEncoded(std::move(bytes)), 0, 50);
+    }
+    doc->endPage();
+    REPORTER_ASSERT(r, doc->close());
+    sk_sp<SkData> data(stream.copyToData());
+    REPORTER_ASSERT(r, 3 == count(data.get(), "/Subtype /Image"));
+}
+
+static const char* find(const SkData* data, const char* text, size_t limit) {
+    size_t len = strlen(text);
+    const char* bytes = (const char*)data->data();
+    for (size_t i = 0; i + len <= SkTMin(limit, data->size()); i++) {
+        if (0 == memcmp(bytes + i, text, len)) {
+            return bytes + i;
+        }
+    }
+    return nullptr;
+}
+
+// The first page and its resources come first, after a linearization
+// dictionary that gives the file length and page count.
+DEF_TEST(document_linearized, r) {
+    REQUIRE_PDF_DOCUMENT(document_linearized, r);
+    SkBitmap bm;
+    bm.allocN32Pixels(32, 32);
+    bm.eraseColor(SK_ColorRED);
+    SkDynamicMemoryWStream stream;
+    SkDocument::PDFMetadata metadata;
+    metadata.fLinearize = true;
+    metadata.fUseObjectStreams = true;  // Ignored.
+    sk_sp<SkDocument> doc = SkDocument::MakePDF(&stream, SK_ScalarDefaultRasterDPI,
+                                                metadata, nullptr, false);
+    for (int i = 0; i < 3; i++) {
+        SkCanvas* canvas = doc->beginPage(100, 100);
+        SkPaint paint;
+        canvas->drawText("Page", 4, 20, 20, paint);
+        if (i != 1) {
+            canvas->drawBitmap(bm, 0, 50);  // Shared by the first page and the last.
+        }
+        doc->endPage();
+    }
+    REPORTER_ASSERT(r, doc->close());
+    sk_sp<SkData> data(stream.copyToData());
+    REPORTER_ASSERT(r, 0 == memcmp(data->data(), "%PDF-1.4", 8));
+    REPORTER_ASSERT(r, !contains(data.get(), "/ObjStm"));
+    // Viewers only look for it in the first kilobyte.
+    REPORTER_ASSERT(r, find(data.get(), "/Linearized 1", 1024));
+    REPORTER_ASSERT(r, find(data.get(), "/N 3", 1024));
+    const char* fileLength = find(data.get(), "/L ", 1024);
+    REPORTER_ASSERT(r, fileLength && atoi(fileLength + 3) == SkToInt(data->size()));
+    REPORTER_ASSERT(r, 1 == count(data.get(), "/Subtype /Image"));
+    REPORTER_ASSERT(r, 2 == count(data.get(), "\ntrailer\n"));
+    REPORTER_ASSERT(r, contains(data.get(), "/Prev "));
+}
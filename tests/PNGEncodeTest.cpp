@@ -0,0 +1,78 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "Resources.h"
+#include "SkBitmap.h"
+#include "SkCodec.h"
+#include "SkColorPriv.h"
+#include "SkData.h"
+#include "SkImageEncoder.h"
+#include "SkImageEncoderPriv.h"
+#include "Test.h"
+
+static sk_sp<SkData> encode_png(const SkBitmap& bm, bool useThreads) {
+    gSkPNGEncodeUseThreads = useThreads;
+    sk_sp<SkData> data(SkImageEncoder::EncodeData(bm, SkImageEncoder::kPNG_Type, 100));
+    gSkPNGEncodeUseThreads = false;
+    return data;
+}
+
+static bool decode_png(SkData* data, const SkImageInfo& info, SkBitmap* bm) {
+    SkAutoTDelete<SkCodec> codec(SkCodec::NewFromData(data));
+    if (!codec) {
+        return false;
+    }
+    bm->allocPixels(info);
+    return SkCodec::kSuccess == codec->getPixels(info, bm->getPixels(), bm->rowBytes());
+}
+
+// Encoding in chunks on several threads gives a PNG that decodes to the same pixels as one
+// encoded by libpng alone.
+DEF_TEST(PNGEncode_threads, r) {
+    SkBitmap src;
+    if (!GetResourceAsBitmap("mandrill_512.png", &src)) {
+        SkDebugf("Missing resource 'mandrill_512.png'\n");
+        return;
+    }
+
+    SkBitmap opaque, translucent, rgb565;
+    src.copyTo(&opaque, kN32_SkColorType);
+    src.copyTo(&translucent, kN32_SkColorType);
+    translucent.setAlphaType(kPremul_SkAlphaType);
+    for (int y = 0; y < translucent.height(); y++) {
+        for (int x = 0; x < translucent.width(); x++) {
+            // Scale each pixel by a varying alpha, keeping it premultiplied.
+            const unsigned alpha = (x + y) & 0xFF;
+            uint32_t* pixel = translucent.getAddr32(x, y);
+            *pixel = SkAlphaMulQ(*pixel, SkAlpha255To256(alpha));
+        }
+    }
+    src.copyTo(&rgb565, kRGB_565_SkColorType);
+
+    for (const SkBitmap* bm : { &opaque, &translucent, &rgb565 }) {
+        sk_sp<SkData> serial = encode_png(*bm, false),
+                      chunked = encode_png(*bm, true);
+        REPORTER_ASSERT(r, serial && chunked);
+        if (!serial || !chunked) {
+            continue;
+        }
+
+        const SkImageInfo info = bm->info().makeColorType(kN32_SkColorType)
+                                           .makeAlphaType(bm->isOpaque() ? kOpaque_SkAlphaType
+                                                                         : kUnpremul_SkAlphaType);
+        SkBitmap expected, actual;
+        REPORTER_ASSERT(r, decode_png(serial.get(), info, &expected));
+        REPORTER_ASSERT(r, decode_png(chunked.get(), info, &actual));
+        for (int y = 0; y < info.height(); y++) {
+            REPORTER_ASSERT(r, 0 == memcmp(expected.getAddr(0, y), actual.getAddr(0, y),
+                                           info.minRowBytes()));
+        }
+
+        // The output does not depend on how many threads there are.
+        REPORTER_ASSERT(r, chunked->equals(encode_png(*bm, true).get()));
+    }
+}
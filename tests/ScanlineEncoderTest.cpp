@@ -0,0 +1,94 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "Resources.h"
+#include "SkBitmap.h"
+#include "SkCodec.h"
+#include "SkData.h"
+#include "SkImageEncoder.h"
+#include "SkStream.h"
+#include "Test.h"
+
+static bool decode(SkData* data, const SkImageInfo& info, SkBitmap* bm) {
+    SkAutoTDelete<SkCodec> codec(SkCodec::NewFromData(data));
+    if (!codec) {
+        return false;
+    }
+    bm->allocPixels(info);
+    return SkCodec::kSuccess == codec->getPixels(info, bm->getPixels(), bm->rowBytes());
+}
+
+// Writing an image in bands gives a file that decodes to the same pixels as encoding it
+// all at once.
+static void test_bands(skiatest::Reporter* r, const SkBitmap& src, SkImageEncoder::Type type) {
+    SkDynamicMemoryWStream stream;
+    SkAutoTDelete<SkScanlineEncoder> encoder(
+            SkScanlineEncoder::Create(&stream, src.info(), type, 100));
+    if (!encoder) {
+        // There is no scanline encoder for this type on this platform.
+        return;
+    }
+
+    // Rows must come before finish(), and not run past the bottom.
+    REPORTER_ASSERT(r, !encoder->finish());
+    REPORTER_ASSERT(r, !encoder->writeRows(src.getPixels(), src.rowBytes(), src.height() + 1));
+
+    const int kBandRows = 37;
+    for (int y = 0; y < src.height(); y += kBandRows) {
+        const int rows = SkTMin(kBandRows, src.height() - y);
+        REPORTER_ASSERT(r, encoder->writeRows(src.getAddr(0, y), src.rowBytes(), rows));
+    }
+    REPORTER_ASSERT(r, encoder->rowsWritten() == src.height());
+    REPORTER_ASSERT(r, encoder->finish());
+    REPORTER_ASSERT(r, !encoder->writeRows(src.getPixels(), src.rowBytes(), 1));
+
+    sk_sp<SkData> banded(stream.copyToData());
+    sk_sp<SkData> whole(SkImageEncoder::EncodeData(src, type, 100));
+    REPORTER_ASSERT(r, whole);
+    if (!whole) {
+        return;
+    }
+
+    const SkImageInfo info = src.info().makeColorType(kN32_SkColorType)
+                                       .makeAlphaType(kOpaque_SkAlphaType);
+    SkBitmap expected, actual;
+    REPORTER_ASSERT(r, decode(whole.get(), info, &expected));
+    REPORTER_ASSERT(r, decode(banded.get(), info, &actual));
+    for (int y = 0; y < info.height(); y++) {
+        REPORTER_ASSERT(r, 0 == memcmp(expected.getAddr(0, y), actual.getAddr(0, y),
+                                       info.minRowBytes()));
+    }
+}
+
+DEF_TEST(ScanlineEncoder, r) {
+    SkBitmap src;
+    if (!GetResourceAsBitmap("mandrill_256.png", &src)) {
+        SkDebugf("Missing resource 'mandrill_256.png'\n");
+        return;
+    }
+
+    SkBitmap n32, rgb565;
+    REPORTER_ASSERT(r, src.copyTo(&n32, kN32_SkColorType));
+    REPORTER_ASSERT(r, src.copyTo(&rgb565, kRGB_565_SkColorType));
+    for (const SkBitmap* bm : { &n32, &rgb565 }) {
+        test_bands(r, *bm, SkImageEncoder::kPNG_Type);
+        test_bands(r, *bm, SkImageEncoder::kJPEG_Type);
+    }
+
+    // There is no scanline encoder for WebP, or for alpha-only images.
+    SkDynamicMemoryWStream stream;
+    REPORTER_ASSERT(r, !SkScanlineEncoder::Create(&stream, n32.info(),
+                                                  SkImageEncoder::kWEBP_Type, 100));
+    REPORTER_ASSERT(r, !SkScanlineEncoder::Create(&stream, n32.info().makeColorType(
+                                                  kAlpha_8_SkColorType),
+                                                  SkImageEncoder::kPNG_Type, 100));
+
+    // The PNG encoder unpremultiplies each row, so it cannot take rows that already are.
+    REPORTER_ASSERT(r, !SkScanlineEncoder::Create(&stream, n32.info().makeAlphaType(
+                                                  kUnpremul_SkAlphaType),
+                                                  SkImageEncoder::kPNG_Type, 100));
+}
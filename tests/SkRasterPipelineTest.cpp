@@ -6,24 +6,21 @@
  */
 
 #include "Test.h"
+#include "SkCanvas.h"
+#include "SkOpts.h"
+#include "SkPM4f.h"
 #include "SkRasterPipeline.h"
+#include "SkSurface.h"
 
-// load needs two variants, one to load 4 values...
+// load and store need to respect the tail, loading or storing only the pixels that are there...
 SK_RASTER_STAGE(load) {
     auto ptr = (const float*)ctx + x;
-    r = Sk4f{ptr[0]};
-    g = Sk4f{ptr[1]};
-    b = Sk4f{ptr[2]};
-    a = Sk4f{ptr[3]};
+    float buf[4] = {0,0,0,0};
+    memcpy(buf, ptr, (tail ? tail : 4) * sizeof(float));
+    r = Sk4f::Load(buf);
 }
 
-// ...and one to load a single value.
-SK_RASTER_STAGE(load_tail) {
-    auto ptr = (const float*)ctx + x;
-    r = Sk4f{*ptr};
-}
-
-// square doesn't really care how many of its inputs are active, nor does it need a context.
+// ...but square doesn't really care how many of its inputs are active, nor does it need a context.
 SK_RASTER_STAGE(square) {
     r *= r;
     g *= g;
@@ -31,18 +28,11 @@ SK_RASTER_STAGE(square) {
     a *= a;
 }
 
-// Like load, store has a _tail variant.
 SK_RASTER_STAGE(store) {
     auto ptr = (float*)ctx + x;
-    ptr[0] = r[0];
-    ptr[1] = g[0];
-    ptr[2] = b[0];
-    ptr[3] = a[0];
-}
-
-SK_RASTER_STAGE(store_tail) {
-    auto ptr = (float*)ctx + x;
-    *ptr = r[0];
+    float buf[4];
+    r.store(buf);
+    memcpy(ptr, buf, (tail ? tail : 4) * sizeof(float));
 }
 
 DEF_TEST(SkRasterPipeline, r) {
@@ -55,12 +45,12 @@ DEF_TEST(SkRasterPipeline, r) {
     // This pipeline loads up some values, squares them, then writes them back to memory.
 
     const float src_vals[] = { 1,2,3,4,5 };
-    float       dst_vals[] = { 0,0,0,0,0 };
+    float       dst_vals[] = { 0,0,0,0,0,0 };
 
     SkRasterPipeline p;
-    p.append<load, load_tail>(src_vals);
+    p.append<load>(src_vals);
     p.append<square>();
-    p.append<store, store_tail>(dst_vals);
+    p.append<store>(dst_vals);
 
     p.run(5);
 
@@ -69,6 +59,7 @@ DEF_TEST(SkRasterPipeline, r) {
     REPORTER_ASSERT(r, dst_vals[2] ==  9);
     REPORTER_ASSERT(r, dst_vals[3] == 16);
     REPORTER_ASSERT(r, dst_vals[4] == 25);
+    REPORTER_ASSERT(r, dst_vals[5] ==  0);
 }
 
 DEF_TEST(SkRasterPipeline_empty, r) {
@@ -84,3 +75,164 @@ DEF_TEST(SkRasterPipeline_nonsense, r) {
     p.append<square>();
     p.run(20);
 }
+
+DEF_TEST(SkRasterPipeline_stock, r) {
+    // The stock stages run as wide as the CPU allows.  They should agree with the 4-wide ones,
+    // and neither should touch pixels past the end, whatever the tail.
+    uint32_t src[20];
+    uint8_t mask[20];
+    for (int i = 0; i < 20; i++) {
+        src[i]  = 0x01020304 * (i+1) | 0xff000000 * (i&1);
+        mask[i] = 13 * i;
+    }
+
+    // Stages that touch memory take a pointer to the row pointer.
+    uint32_t* srcPtr = src;
+    uint8_t* maskPtr = mask;
+    for (size_t n = 0; n <= 19; n++) {
+        uint32_t wide[20], narrow[20];
+        for (int i = 0; i < 20; i++) {
+            wide[i] = narrow[i] = 0x80402010 + i;
+        }
+        uint32_t* widePtr = wide;
+        uint32_t* narrowPtr = narrow;
+
+        SkRasterPipeline::Stock wideStages[] = {
+            { SkRasterPipeline::load_s_srgb, &srcPtr },
+            { SkRasterPipeline::scale_u8,    &maskPtr },
+            { SkRasterPipeline::load_d_srgb, &widePtr },
+            { SkRasterPipeline::srcover,     nullptr },
+            { SkRasterPipeline::store_srgb,  &widePtr },
+        };
+        SkRasterPipeline::Stock narrowStages[] = {
+            { SkRasterPipeline::load_s_srgb, &srcPtr },
+            { SkRasterPipeline::scale_u8,    &maskPtr },
+            { SkRasterPipeline::load_d_srgb, &narrowPtr },
+            { SkRasterPipeline::srcover,     nullptr },
+            { SkRasterPipeline::store_srgb,  &narrowPtr },
+        };
+        SkOpts::run_pipeline  (0, n, wideStages,   SK_ARRAY_COUNT(wideStages));
+        SkOpts::run_pipeline_4(0, n, narrowStages, SK_ARRAY_COUNT(narrowStages));
+
+        REPORTER_ASSERT(r, 0 == memcmp(wide, narrow, sizeof(wide)));
+        for (size_t i = n; i < 20; i++) {
+            REPORTER_ASSERT(r, wide[i] == 0x80402010 + i);
+        }
+    }
+}
+
+DEF_TEST(SkRasterPipeline_compiled, r) {
+    // A pipeline of stock stages with no fused kernel is laid out once, when it's compiled,
+    // and should then draw what run_pipeline does, row after row.
+    uint32_t src[2][20], compiled[2][20], chained[2][20];
+    for (int y = 0; y < 2; y++) {
+        for (int i = 0; i < 20; i++) {
+            src[y][i] = 0x01020304 * (i+y+1) | 0xff000000 * (i&1);
+            compiled[y][i] = chained[y][i] = 0x80402010 + i;
+        }
+    }
+
+    uint32_t* srcPtr = nullptr;
+    uint32_t* dstPtr = nullptr;
+    SkRasterPipeline p;
+    p.append(SkRasterPipeline::load_s_srgb, &srcPtr);
+    p.append(SkRasterPipeline::load_d_srgb, &dstPtr);
+    p.append(SkRasterPipeline::srcover);
+    p.append(SkRasterPipeline::store_srgb,  &dstPtr);
+    p.compile();
+
+    const SkRasterPipeline::Stock stages[] = {
+        { SkRasterPipeline::load_s_srgb, &srcPtr },
+        { SkRasterPipeline::load_d_srgb, &dstPtr },
+        { SkRasterPipeline::srcover,     nullptr },
+        { SkRasterPipeline::store_srgb,  &dstPtr },
+    };
+    REPORTER_ASSERT(r, !SkOpts::fuse_pipeline(stages, SK_ARRAY_COUNT(stages)));
+
+    for (int y = 0; y < 2; y++) {
+        srcPtr = src[y];
+        dstPtr = compiled[y];
+        p.run(19);
+        dstPtr = chained[y];
+        SkOpts::run_pipeline(0, 19, stages, SK_ARRAY_COUNT(stages));
+    }
+    REPORTER_ASSERT(r, 0 == memcmp(compiled, chained, sizeof(compiled)));
+
+    // Appending a custom stage runs the stock stages 4 at a time along with it.
+    const float src_vals[] = { 1,2,3,4,5 };
+    float       dst_vals[] = { 0,0,0,0,0,0 };
+    srcPtr = src[0];
+    dstPtr = compiled[0];
+    p.append<load>(src_vals);
+    p.append<square>();
+    p.append<store>(dst_vals);
+    p.run(5);
+    REPORTER_ASSERT(r, dst_vals[4] == 25);
+    REPORTER_ASSERT(r, dst_vals[5] ==  0);
+}
+
+DEF_TEST(SkRasterPipeline_fused, r) {
+    // A blitAntiH-style pipeline should find a fused kernel and draw what the stage chain does.
+    SkPM4f color = {{ 0.25f, 0.5f, 0.125f, 0.75f }};
+    float coverage = 0.5f;
+    for (size_t n = 0; n <= 19; n++) {
+        uint32_t fused[20], chained[20];
+        for (int i = 0; i < 20; i++) {
+            fused[i] = chained[i] = 0x80402010 + i;
+        }
+        uint32_t* fusedPtr = fused;
+        uint32_t* chainedPtr = chained;
+
+        SkRasterPipeline p;
+        p.append(SkRasterPipeline::constant_color, &color);
+        p.append(SkRasterPipeline::load_d_srgb, &fusedPtr);
+        p.append(SkRasterPipeline::srcover);
+        p.append(SkRasterPipeline::lerp_constant_float, &coverage);
+        p.append(SkRasterPipeline::clamp_01_premul);
+        p.append(SkRasterPipeline::store_srgb, &fusedPtr);
+
+        int compiled, hits, compiledAfter, hitsAfter;
+        SkRasterPipeline::GetFuseStats(&compiled, &hits);
+        p.run(n);
+        SkRasterPipeline::GetFuseStats(&compiledAfter, &hitsAfter);
+        REPORTER_ASSERT(r, compiledAfter > compiled);
+        REPORTER_ASSERT(r, hitsAfter > hits);
+
+        const SkRasterPipeline::Stock stages[] = {
+            { SkRasterPipeline::constant_color,      &color },
+            { SkRasterPipeline::load_d_srgb,         &chainedPtr },
+            { SkRasterPipeline::srcover,             nullptr },
+            { SkRasterPipeline::lerp_constant_float, &coverage },
+            { SkRasterPipeline::clamp_01_premul,     nullptr },
+            { SkRasterPipeline::store_srgb,          &chainedPtr },
+        };
+        REPORTER_ASSERT(r, SkOpts::fuse_pipeline(stages, SK_ARRAY_COUNT(stages)));
+        SkOpts::run_pipeline(0, n, stages, SK_ARRAY_COUNT(stages));
+
+        REPORTER_ASSERT(r, 0 == memcmp(fused, chained, sizeof(fused)));
+        for (size_t i = n; i < 20; i++) {
+            REPORTER_ASSERT(r, fused[i] == 0x80402010 + i);
+        }
+    }
+
+    // Any other order has no fused kernel.
+    const SkRasterPipeline::Stock unfused[] = {
+        { SkRasterPipeline::srcover,     nullptr },
+        { SkRasterPipeline::load_d_srgb, nullptr },
+    };
+    REPORTER_ASSERT(r, !SkOpts::fuse_pipeline(unfused, SK_ARRAY_COUNT(unfused)));
+}
+
+DEF_TEST(SkRasterPipeline_blitter, r) {
+    // The blitter builds its pipelines once, not once per span.
+    auto surface = SkSurface::MakeRaster(SkImageInfo::MakeS32(100, 100, kPremul_SkAlphaType));
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setColor(0x80FF0000);
+
+    int compiled, hits, compiledAfter, hitsAfter;
+    SkRasterPipeline::GetFuseStats(&compiled, &hits);
+    surface->getCanvas()->drawCircle(50, 50, 40, paint);
+    SkRasterPipeline::GetFuseStats(&compiledAfter, &hitsAfter);
+    REPORTER_ASSERT(r, compiledAfter - compiled <= 4);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkAtomics.h"
+#include "SkTaskGroup.h"
+#include "Test.h"
+
+DEF_TEST(SkTaskGroup_Batch, r) {
+    SkAtomic<int> sum(0);
+    SkTaskGroup().batch(1000, [&](int i) {
+        sum.fetch_add(i);
+    });
+    REPORTER_ASSERT(r, 1000 * 999 / 2 == sum.load());
+}
+
+DEF_TEST(SkTaskGroup_Reuse, r) {
+    SkAtomic<int> count(0);
+    SkTaskGroup tg;
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < 100; j++) {
+            tg.add([&] { count.fetch_add(1); });
+        }
+        tg.wait();
+        REPORTER_ASSERT(r, 100 * (i + 1) == count.load());
+    }
+}
+
+// Each task adds and waits on tasks of its own, so waits happen on the pool's threads too.
+static int fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    int a, b;
+    SkTaskGroup tg;
+    tg.add([&] { a = fib(n - 1); });
+    tg.add([&] { b = fib(n - 2); });
+    tg.wait();
+    return a + b;
+}
+
+DEF_TEST(SkTaskGroup_Nested, r) {
+    REPORTER_ASSERT(r, 6765 == fib(20));
+
+    // Big nested batches make the pool threads' own queues grow.
+    SkAtomic<int> count(0);
+    SkTaskGroup().batch(8, [&](int) {
+        SkTaskGroup().batch(1000, [&](int) {
+            count.fetch_add(1);
+        });
+    });
+    REPORTER_ASSERT(r, 8000 == count.load());
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkBlurMaskFilter.h"
+#include "SkCanvas.h"
+#include "SkDashPathEffect.h"
+#include "SkGradientShader.h"
+#include "SkImage.h"
+#include "SkImageFilter.h"
+#include "SkBlurImageFilter.h"
+#include "SkPath.h"
+#include "SkRandom.h"
+#include "SkRRect.h"
+#include "SkSurface.h"
+#include "Test.h"
+
+// Exercise most of the device's draw calls, with clips and layers mixed in.
+static void draw_scene(SkCanvas* canvas, sk_sp<SkImage> image) {
+    const int w = canvas->imageInfo().width(),
+              h = canvas->imageInfo().height();
+    SkRandom rand;
+    SkPaint paint;
+
+    canvas->drawColor(SK_ColorWHITE);
+
+    // Long, thin antialiased paths cross every tile.
+    paint.setAntiAlias(true);
+    for (int i = 0; i < 20; i++) {
+        SkPath path;
+        path.moveTo(rand.nextRangeF(0, w), rand.nextRangeF(0, h));
+        for (int j = 0; j < 4; j++) {
+            path.cubicTo(rand.nextRangeF(0, w), rand.nextRangeF(0, h),
+                         rand.nextRangeF(0, w), rand.nextRangeF(0, h),
+                         rand.nextRangeF(0, w), rand.nextRangeF(0, h));
+        }
+        paint.setColor(rand.nextU() | 0x80000000);
+        paint.setStyle(i & 1 ? SkPaint::kStroke_Style : SkPaint::kFill_Style);
+        paint.setStrokeWidth(rand.nextRangeF(0, 5));
+        canvas->drawPath(path, paint);
+    }
+
+    // Hairlines and dashed points.
+    SkPoint pts[32];
+    for (SkPoint& pt : pts) {
+        pt.set(rand.nextRangeF(0, w), rand.nextRangeF(0, h));
+    }
+    paint.setStrokeWidth(0);
+    canvas->drawPoints(SkCanvas::kPolygon_PointMode, SK_ARRAY_COUNT(pts), pts, paint);
+    const SkScalar intervals[] = { 4, 2 };
+    paint.setPathEffect(SkDashPathEffect::Make(intervals, 2, 0));
+    paint.setStrokeWidth(3);
+    canvas->drawPoints(SkCanvas::kLines_PointMode, SK_ARRAY_COUNT(pts), pts, paint);
+    paint.setPathEffect(nullptr);
+
+    // Shaded and blurred rects and rrects.
+    const SkPoint gradPts[] = { { 0, 0 }, { SkIntToScalar(w), SkIntToScalar(h) } };
+    const SkColor colors[] = { SK_ColorRED, SK_ColorBLUE };
+    paint.setShader(SkGradientShader::MakeLinear(gradPts, colors, nullptr, 2,
+                                                 SkShader::kClamp_TileMode));
+    paint.setStyle(SkPaint::kFill_Style);
+    canvas->drawRect(SkRect::MakeXYWH(w * 0.1f, h * 0.1f, w * 0.3f, h * 0.7f), paint);
+    paint.setShader(nullptr);
+    paint.setMaskFilter(SkBlurMaskFilter::Make(kNormal_SkBlurStyle, 6));
+    canvas->drawRRect(SkRRect::MakeRectXY(SkRect::MakeXYWH(w * 0.5f, h * 0.2f, w * 0.3f, h * 0.5f),
+                                          20, 20), paint);
+    paint.setMaskFilter(nullptr);
+
+    // Scaled, rotated and filtered images, with and without src rects.
+    SkPaint imagePaint;
+    imagePaint.setFilterQuality(kLow_SkFilterQuality);
+    canvas->save();
+    canvas->rotate(17);
+    canvas->drawImage(image, w * 0.2f, 0, &imagePaint);
+    canvas->restore();
+    canvas->drawImageRect(image, SkRect::MakeXYWH(3.5f, 4.5f, 20, 30),
+                          SkRect::MakeXYWH(0, h * 0.5f, w * 0.5f, h * 0.4f), &imagePaint);
+
+    // Text, under an antialiased clip.
+    canvas->save();
+    canvas->clipRRect(SkRRect::MakeOval(SkRect::MakeWH(w, h)), SkRegion::kIntersect_Op, true);
+    SkPaint textPaint;
+    textPaint.setAntiAlias(true);
+    textPaint.setTextSize(h / 8.0f);
+    for (int i = 0; i < 8; i++) {
+        canvas->drawText("Threaded raster", 15, 5, h * (i + 1) / 8.0f, textPaint);
+    }
+    canvas->restore();
+
+    // Layers with alpha and with an image filter.
+    canvas->saveLayerAlpha(nullptr, 0x80);
+    paint.setColor(SK_ColorGREEN);
+    canvas->drawCircle(w * 0.5f, h * 0.5f, h * 0.3f, paint);
+    canvas->restore();
+
+    SkPaint layerPaint;
+    layerPaint.setImageFilter(SkBlurImageFilter::Make(3, 3, nullptr));
+    canvas->saveLayer(nullptr, &layerPaint);
+    paint.setColor(SK_ColorMAGENTA);
+    canvas->drawOval(SkRect::MakeXYWH(w * 0.6f, h * 0.6f, w * 0.3f, h * 0.3f), paint);
+    canvas->restore();
+
+    // Vertices.
+    const SkPoint verts[] = { { 0, 0 }, { SkIntToScalar(w), h * 0.5f }, { w * 0.5f, h * 1.0f } };
+    const SkColor vertColors[] = { 0x40FF0000, 0x4000FF00, 0x400000FF };
+    canvas->drawVertices(SkCanvas::kTriangles_VertexMode, 3, verts, nullptr, vertColors,
+                         nullptr, nullptr, 0, SkPaint());
+}
+
+static sk_sp<SkImage> make_image() {
+    auto surface = SkSurface::MakeRasterN32Premul(37, 41);
+    SkPaint paint;
+    SkRandom rand;
+    for (int i = 0; i < 20; i++) {
+        paint.setColor(rand.nextU() | 0xFF000000);
+        surface->getCanvas()->drawRect(SkRect::MakeXYWH(rand.nextRangeF(0, 37),
+                                                        rand.nextRangeF(0, 41), 8, 8), paint);
+    }
+    return surface->makeImageSnapshot();
+}
+
+DEF_TEST(ThreadedRaster_MatchesSingleThreaded, reporter) {
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(301, 257);
+    sk_sp<SkImage> image = make_image();
+
+    auto expected = SkSurface::MakeRaster(info);
+    draw_scene(expected->getCanvas(), image);
+    SkBitmap expectedBM;
+    expectedBM.allocPixels(info);
+    REPORTER_ASSERT(reporter, expected->readPixels(info, expectedBM.getPixels(),
+                                                   expectedBM.rowBytes(), 0, 0));
+
+    for (int tiles : { 0, 1, 3, 16, 257 }) {
+        auto threaded = SkSurface::MakeRasterThreaded(info, tiles);
+        REPORTER_ASSERT(reporter, threaded);
+        draw_scene(threaded->getCanvas(), image);
+
+        // Read back through a snapshot, which must flush the queued draws.
+        sk_sp<SkImage> snapshot = threaded->makeImageSnapshot();
+        SkBitmap actualBM;
+        actualBM.allocPixels(info);
+        REPORTER_ASSERT(reporter, snapshot->readPixels(info, actualBM.getPixels(),
+                                                       actualBM.rowBytes(), 0, 0));
+
+        int mismatches = 0;
+        for (int y = 0; y < info.height(); y++) {
+            if (memcmp(expectedBM.getAddr32(0, y), actualBM.getAddr32(0, y),
+                       info.minRowBytes())) {
+                mismatches++;
+            }
+        }
+        if (mismatches) {
+            ERRORF(reporter, "%d tiles: %d rows differ from single-threaded raster",
+                   tiles, mismatches);
+        }
+    }
+}
+
+DEF_TEST(ThreadedRaster_FlushOnRead, reporter) {
+    auto surface = SkSurface::MakeRasterThreaded(SkImageInfo::MakeN32Premul(16, 64), 4);
+    SkCanvas* canvas = surface->getCanvas();
+    canvas->drawColor(SK_ColorRED);
+
+    SkPMColor pixel;
+    const SkImageInfo one = SkImageInfo::MakeN32Premul(1, 1);
+    REPORTER_ASSERT(reporter, canvas->readPixels(one, &pixel, sizeof(pixel), 3, 50));
+    REPORTER_ASSERT(reporter, SkPreMultiplyColor(SK_ColorRED) == pixel);
+
+    // Draws after a snapshot must not show up in it.
+    sk_sp<SkImage> red = surface->makeImageSnapshot();
+    canvas->drawColor(SK_ColorBLUE);
+    REPORTER_ASSERT(reporter, red->readPixels(one, &pixel, sizeof(pixel), 3, 50));
+    REPORTER_ASSERT(reporter, SkPreMultiplyColor(SK_ColorRED) == pixel);
+
+    SkPixmap pmap;
+    REPORTER_ASSERT(reporter, canvas->peekPixels(&pmap));
+    REPORTER_ASSERT(reporter, SkPreMultiplyColor(SK_ColorBLUE) == *pmap.addr32(3, 50));
+}
@@ -28,7 +28,7 @@ static const char defaultConfigs[] =
 static const char configHelp[] =
     "Options: 565 8888 debug gpu gl gpudebug gpudft gpunull "
     "msaa16 msaa4 glmsaa4 gpuf16 gpusrgb glsrgb nonrendering null nullgpu "
-    "nvpr16 nvpr4 nvprdit16 nvprdit4 glnvpr4 glnvprdit4 pdf skp svg xps"
+    "nvpr16 nvpr4 nvprdit16 nvprdit4 glnvpr4 glnvprdit4 pdf skp svg threaded8888 xps"
     "glinst glinst4 glinstdit4 glinst16 glinstdit16 esinst esinst4 esinsdit4"
 #if SK_ANGLE
 #ifdef SK_BUILD_FOR_WIN
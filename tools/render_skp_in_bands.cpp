@@ -0,0 +1,93 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkBitmap.h"
+#include "SkCanvas.h"
+#include "SkCommandLineFlags.h"
+#include "SkImageEncoder.h"
+#include "SkPicture.h"
+#include "SkStream.h"
+
+DEFINE_string2(input, i, "", "skp to render");
+DEFINE_string2(output, o, "out.png", "png to write");
+DEFINE_double(scale, 1, "Scale to render the skp at");
+DEFINE_int32(bandHeight, 256, "Rows to render at a time");
+
+// This tool renders an SKP, at any scale, to a PNG.  It renders one horizontal band at a time
+// and hands each band to an SkScanlineEncoder, so its memory use depends on the band height
+// and not on the height of the image.
+// return codes:
+static const int kSuccess = 0;
+static const int kMissingInput = 1;
+static const int kIOError = 2;
+static const int kEncodeError = 3;
+
+int tool_main(int argc, char** argv);
+int tool_main(int argc, char** argv) {
+    SkCommandLineFlags::SetUsage("Renders an skp to a png, a band of rows at a time");
+    SkCommandLineFlags::Parse(argc, argv);
+
+    if (FLAGS_input.count() != 1) {
+        SkDebugf("Missing input file\n");
+        return kMissingInput;
+    }
+
+    SkFILEStream input(FLAGS_input[0]);
+    sk_sp<SkPicture> picture(SkPicture::MakeFromStream(&input));
+    if (!picture) {
+        SkDebugf("Could not read %s\n", FLAGS_input[0]);
+        return kIOError;
+    }
+
+    const SkRect bounds = picture->cullRect();
+    const SkScalar scale = SkDoubleToScalar(FLAGS_scale);
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(
+            SkScalarCeilToInt(bounds.width() * scale), SkScalarCeilToInt(bounds.height() * scale));
+
+    SkFILEWStream output(FLAGS_output[0]);
+    if (!output.isValid()) {
+        SkDebugf("Could not open %s\n", FLAGS_output[0]);
+        return kIOError;
+    }
+    SkAutoTDelete<SkScanlineEncoder> encoder(
+            SkScanlineEncoder::Create(&output, info, SkImageEncoder::kPNG_Type, 100));
+    if (!encoder) {
+        SkDebugf("No png scanline encoder for %dx%d\n", info.width(), info.height());
+        return kEncodeError;
+    }
+
+    SkBitmap band;
+    band.allocPixels(info.makeWH(info.width(), SkTMax(1, SkTMin(FLAGS_bandHeight,
+                                                                info.height()))));
+    SkCanvas canvas(band);
+    for (int top = 0; top < info.height(); top += band.height()) {
+        band.eraseColor(SK_ColorTRANSPARENT);
+        canvas.save();
+        canvas.translate(0, SkIntToScalar(-top));
+        canvas.scale(scale, scale);
+        canvas.translate(-bounds.left(), -bounds.top());
+        canvas.drawPicture(picture);
+        canvas.restore();
+
+        const int rows = SkTMin(band.height(), info.height() - top);
+        if (!encoder->writeRows(band.getPixels(), band.rowBytes(), rows)) {
+            SkDebugf("Failed to encode rows %d to %d\n", top, top + rows);
+            return kEncodeError;
+        }
+    }
+    if (!encoder->finish()) {
+        SkDebugf("Failed to finish %s\n", FLAGS_output[0]);
+        return kEncodeError;
+    }
+    return kSuccess;
+}
+
+#if !defined SK_BUILD_FOR_IOS
+int main(int argc, char * const argv[]) {
+    return tool_main(argc, (char**) argv);
+}
+#endif